@@ -13,6 +13,7 @@ import com.dsd.kosjenka.presentation.home.calibrate.GazeCalibrationView;
 import com.dsd.kosjenka.presentation.home.camera.TrackerView;
 
 import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 
 public class VisageWrapper {
 
@@ -33,6 +34,14 @@ public class VisageWrapper {
     static final int DISPLAY_DEFAULT = DISPLAY_FEATURE_POINTS + DISPLAY_SPLINES + DISPLAY_GAZE + DISPLAY_IRIS + DISPLAY_AXES + DISPLAY_TRACKING_QUALITY + DISPLAY_POINT_QUALITY;
     public static final int NUM_EMOTIONS = 6; //should be 6 because neutral emotion won't be displayed
 
+    public static final int YUV_MATRIX_BT601_FULL = 0;
+    public static final int YUV_MATRIX_BT601_LIMITED = 1;
+    public static final int YUV_MATRIX_BT709_FULL = 2;
+    public static final int YUV_MATRIX_BT709_LIMITED = 3;
+
+    public static final int TRACKING_INPUT_RGB = 0;
+    public static final int TRACKING_INPUT_LUMINANCE = 2;
+
     public enum TrackScreen {
         CAMERA,
         CALIBRATION,
@@ -247,6 +256,110 @@ public class VisageWrapper {
 
     //public static native void SetParameters(int width, int height);
 
+    public static native void SetColorMatrix(int matrix);
+
+    // TRACKING_INPUT_LUMINANCE by default, TRACKING_INPUT_RGB tracks on converted RGB frames as before
+    public static native void SetTrackingInputFormat(int format);
+
+    public static native int GetTrackingInputFormat();
+
+    public static native float GetCaptureCpuTime();
+
+    public static native long[] GetFrameCounters();
+
+    public static native long[] GetImagePoolStats();
+
+    public static native void SetFramePacing(boolean enabled, int maxDelayMs);
+
+    public static native int[] GetCaptureRecommendation();
+
+    public static native float[] GetFramePacingStats();
+
+    public static native void TrimImagePool();
+
+    public static native boolean StartFrameRecording(String path, int bufferFrames);
+
+    public static native void StopFrameRecording();
+
+    public static native long[] GetFrameRecordingStats();
+
+    public static native long[] GetTrackLoopStats();
+
+    public static native void SetFaceAnalysisInterval(int intervalMs);
+
+    public static native float[] GetFaceAnalysisStats();
+
+    // Stage and counter order of GetPipelineMetrics, see PipelineMetrics.h
+    public static final int STAGE_YUV_CONVERSION = 0;
+    public static final int STAGE_ROTATION = 1;
+    public static final int STAGE_FRAME_WAIT = 2;
+    public static final int STAGE_TRACK = 3;
+    public static final int STAGE_PUBLISH = 4;
+    public static final int STAGE_ANALYSIS = 5;
+    public static final int STAGE_RENDER_COPY = 6;
+    public static final int STAGE_TEXTURE_UPLOAD = 7;
+    public static final int STAGE_OVERLAY_DRAW = 8;
+    public static final int STAGE_COUNT = 9;
+    public static final int STAGE_VALUES = 7; // count, mean, p50, p90, p99, max, mean CPU time
+    public static final int COUNTER_FRAMES_IN = 0;
+    public static final int COUNTER_FRAMES_DROPPED = 1;
+    public static final int COUNTER_FRAMES_PROCESSED = 2;
+    public static final int COUNTER_FRAMES_TRACKED = 3;
+    public static final int COUNTER_FRAMES_RENDERED = 4;
+    public static final int COUNTER_DRAW_CALLS = 5;
+    public static final int COUNTER_OVERLAY_ALLOCATIONS = 6;
+    public static final int COUNTER_OVERLAY_CACHE_HITS = 7;
+
+    public static native long[] GetPipelineMetrics();
+
+    public static native String DumpPipelineMetrics();
+
+    public static native void ResetPipelineMetrics();
+
+    // Thread kinds of GetThreadCpuHistory, see ThreadCpuMonitor.h
+    public static final int THREAD_CAMERA = 0;
+    public static final int THREAD_TRACKING = 1;
+    public static final int THREAD_TRACKER_WORKERS = 2;
+    public static final int THREAD_ANALYSIS = 3;
+    public static final int THREAD_RENDER = 4;
+    public static final int THREAD_OTHER = 5;
+    public static final int THREAD_KIND_COUNT = 6;
+    public static final int THREAD_CPU_VALUES = 2 + THREAD_KIND_COUNT; // interval start, length, CPU time per kind
+
+    public static native boolean StartThreadCpuMonitor(int intervalMs);
+
+    public static native void StopThreadCpuMonitor();
+
+    public static native long[] GetThreadCpuHistory();
+
+    public static native String DumpThreadCpu();
+
+    // Pipeline trace in Chrome trace-event JSON, returns false if the library was built without PIPELINE_TRACING
+    public static native boolean SetPipelineTracing(boolean enabled);
+
+    public static native boolean WritePipelineTrace(String path);
+
+    public static native void SetMaxFaces(int maxFaces);
+
+    public static native int GetMaxFaces();
+
+    public static final int TRACKING_SCALE_AUTO = 0;
+
+    public static native void SetTrackingScale(int scale);
+
+    public static native int GetTrackingScale();
+
+    public static native float[] GetTrackerTimeByScale();
+
+    public static final int LATENCY_GAZE = 0;
+    public static final int LATENCY_DISPLAY = 1;
+
+    public static native void SetSensorTimestampSource(int source);
+
+    public static native long[] GetLatencyHistogram(int stage);
+
+    public static native float[] GetLatencyStats(int stage);
+
     public native void TrackerStop();
 
     public native void PauseTracker();
@@ -297,19 +410,179 @@ public class VisageWrapper {
 
     public native ScreenSpaceGazeData GetScreenSpaceGazeData();
 
+    public static native ByteBuffer GetFrameResultsBuffer();
+
+    public static native int DrainGazeSamples(ByteBuffer samples);
+
+    public static native long[] GetGazeSampleStats();
+
     public static class ScreenSpaceGazeData {
         public int index;
         public float x;
         public float y;
         public int inState;
         public float quality;
+        public long timestamp; // sensor timestamp of the frame, in nanoseconds
 
-        public ScreenSpaceGazeData(int index, float x, float y, int inState, float quality) {
+        public ScreenSpaceGazeData(int index, float x, float y, int inState, float quality, long timestamp) {
             this.index = index;
             this.x = x;
             this.y = y;
             this.inState = inState;
             this.quality = quality;
+            this.timestamp = timestamp;
+        }
+    }
+
+    /**
+     * Per-frame results of the tracker, read from a buffer the native tracking thread writes after every frame.
+     * Reading takes no JNI call and allocates nothing, so it can be polled from a draw loop.
+     * Offsets match SharedFrameResults in SharedResults.h.
+     */
+    public static class FrameResults {
+        private static final int SEQUENCE = 0;
+        private static final int FRAME = 8;
+        private static final int TRACKED_FACES = 12;
+        private static final int TIMESTAMP = 16;
+        private static final int GAZE_TIMESTAMP = 24;
+        private static final int GAZE_AVAILABLE = 32;
+        private static final int GAZE_INDEX = 36;
+        private static final int GAZE_X = 40;
+        private static final int GAZE_Y = 44;
+        private static final int GAZE_IN_STATE = 48;
+        private static final int GAZE_QUALITY = 52;
+        private static final int CURRENT_FACE = 56;
+        private static final int TRACKING_QUALITY = 60;
+        private static final int AGE = 64;
+        private static final int GENDER = 68;
+        private static final int EMOTIONS = 72;
+        private static final int STATUS = 100;
+        private static final int SIZE = 120;
+        private static final int MAX_READ_ATTEMPTS = 4;
+
+        public static final int EMOTION_COUNT = 7;
+        public static final int FACE_COUNT = 16;
+
+        public int frame = -1;              // number of frames published, changes with every tracked frame
+        public boolean isNew;               // true if the last read() picked up a frame not seen before
+        public int trackedFaces;
+        public long timestamp;              // sensor timestamp of the last frame with a face, in nanoseconds
+        public boolean gazeAvailable;
+        public final ScreenSpaceGazeData gaze = new ScreenSpaceGazeData(0, 0, 0, 0, 0, 0);
+        public int currentFace = -1;        // face selected for the analyser
+        public float trackingQuality = -1;
+        public float age = -1;
+        public int gender = -1;
+        public final float[] emotions = new float[EMOTION_COUNT];
+        public final int[] status = new int[FACE_COUNT];
+
+        private ByteBuffer shared;
+        private final byte[] copy = new byte[SIZE];
+        private final ByteBuffer values = ByteBuffer.wrap(copy).order(ByteOrder.nativeOrder());
+        private volatile int fence;
+
+        /**
+         * Reads the newest results.
+         * @return false if the native side was writing during every attempt, the previous values are kept then
+         */
+        public boolean read() {
+            if (shared == null)
+                shared = GetFrameResultsBuffer().duplicate().order(ByteOrder.nativeOrder());
+
+            for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+                int sequence = shared.getInt(SEQUENCE);
+                if ((sequence & 1) != 0)
+                    continue;
+                orderReads();
+                shared.position(0);
+                shared.get(copy);
+                orderReads();
+                if (shared.getInt(SEQUENCE) == sequence) {
+                    unpack();
+                    return true;
+                }
+            }
+            isNew = false;
+            return false;
+        }
+
+        // A volatile write followed by a volatile read is a full barrier, so the buffer reads before it
+        // complete before the ones after it. The copy is checked against the sequence counter this way.
+        private void orderReads() {
+            fence = 0;
+            if (fence != 0)
+                fence = 0;
+        }
+
+        private void unpack() {
+            int newFrame = values.getInt(FRAME);
+            isNew = newFrame != frame;
+            frame = newFrame;
+            trackedFaces = values.getInt(TRACKED_FACES);
+            timestamp = values.getLong(TIMESTAMP);
+            gazeAvailable = values.getInt(GAZE_AVAILABLE) != 0;
+            gaze.timestamp = values.getLong(GAZE_TIMESTAMP);
+            gaze.index = values.getInt(GAZE_INDEX);
+            gaze.x = values.getFloat(GAZE_X);
+            gaze.y = values.getFloat(GAZE_Y);
+            gaze.inState = values.getInt(GAZE_IN_STATE);
+            gaze.quality = values.getFloat(GAZE_QUALITY);
+            currentFace = values.getInt(CURRENT_FACE);
+            trackingQuality = values.getFloat(TRACKING_QUALITY);
+            age = values.getFloat(AGE);
+            gender = values.getInt(GENDER);
+            for (int i = 0; i < EMOTION_COUNT; i++)
+                emotions[i] = values.getFloat(EMOTIONS + 4 * i);
+            for (int i = 0; i < FACE_COUNT; i++)
+                status[i] = values.get(STATUS + i);
+        }
+    }
+
+    /**
+     * Batch of gaze samples drained from the native queue, which holds every sample of every face at tracker rate.
+     * The buffer is allocated once, drain() fills it in a single JNI call. Layout matches GazeSample in GazeSampleRing.h.
+     */
+    public static class GazeSamples {
+        public static final int SAMPLE_SIZE = 32;
+        private static final int TIMESTAMP = 0;
+        private static final int INDEX = 8;
+        private static final int X = 12;
+        private static final int Y = 16;
+        private static final int IN_STATE = 20;
+        private static final int QUALITY = 24;
+        private static final int FACE = 28;
+
+        private final ByteBuffer samples;
+        private int count;
+
+        public GazeSamples(int capacity) {
+            samples = ByteBuffer.allocateDirect(capacity * SAMPLE_SIZE).order(ByteOrder.nativeOrder());
+        }
+
+        /**
+         * Replaces the batch with the samples produced since the last drain, oldest first.
+         * Samples that do not fit stay queued for the next call.
+         * @return number of samples in the batch
+         */
+        public int drain() {
+            count = Math.max(DrainGazeSamples(samples), 0);
+            return count;
         }
+
+        public int size() { return count; }
+
+        public long getTimestamp(int i) { return samples.getLong(i * SAMPLE_SIZE + TIMESTAMP); }
+
+        public int getIndex(int i) { return samples.getInt(i * SAMPLE_SIZE + INDEX); }
+
+        public float getX(int i) { return samples.getFloat(i * SAMPLE_SIZE + X); }
+
+        public float getY(int i) { return samples.getFloat(i * SAMPLE_SIZE + Y); }
+
+        public int getInState(int i) { return samples.getInt(i * SAMPLE_SIZE + IN_STATE); }
+
+        public float getQuality(int i) { return samples.getFloat(i * SAMPLE_SIZE + QUALITY); }
+
+        public int getFace(int i) { return samples.getInt(i * SAMPLE_SIZE + FACE); }
     }
 }
@@ -108,7 +108,6 @@ class CalibrateFragment: Fragment() {
     private val onImageAvailableListener = ImageReader.OnImageAvailableListener { reader ->
         var image: Image? = null
         try {
-            val tsA = System.currentTimeMillis()
             image = reader.acquireLatestImage()
             if (image == null) return@OnImageAvailableListener
             val planes: Array<Image.Plane> = image.planes
@@ -120,7 +119,7 @@ class CalibrateFragment: Fragment() {
                 byteBuffer0,
                 byteBuffer1,
                 byteBuffer2,
-                tsA,
+                image.timestamp,
                 frameID++.toLong(),
                 planes[1].pixelStride
             )
@@ -431,6 +430,14 @@ class CalibrateFragment: Fragment() {
                 "Current preview size is " + mPreviewSize.width + " " + mPreviewSize.height
             )
             mOrientation = getCorrectCameraOrientation(characteristics)
+            VisageWrapper.SetSensorTimestampSource(
+                characteristics.get(CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE)
+                    ?: CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN
+            )
+            VisageWrapper.SetTrackingInputFormat(
+                if (preferences.isLuminanceTracking) VisageWrapper.TRACKING_INPUT_LUMINANCE
+                else VisageWrapper.TRACKING_INPUT_RGB
+            )
 
             if (ActivityCompat.checkSelfPermission(
                     requireContext(),
@@ -11,7 +11,7 @@ import android.util.Log
 import android.view.MotionEvent
 import android.view.WindowManager
 import com.dsd.kosjenka.presentation.home.VisageWrapper
-import com.dsd.kosjenka.presentation.home.VisageWrapper.ScreenSpaceGazeData
+import com.dsd.kosjenka.presentation.home.VisageWrapper.FrameResults
 import com.dsd.kosjenka.utils.GLTriangle
 import java.util.Random
 import javax.microedition.khronos.egl.EGLConfig
@@ -167,6 +167,9 @@ class GazeCalibrationView(context: Context, wrapper: VisageWrapper) : GLSurfaceV
 
         private var screenRatio by Delegates.notNull<Float>() //= width/ height.toFloat()
 
+        // Reused every frame, reading it neither allocates nor calls into native code
+        private val frameResults = FrameResults()
+
         @Volatile
         var translateBy: List<Float> = listOf(0f,0f,0f)
         @Volatile
@@ -198,8 +201,9 @@ class GazeCalibrationView(context: Context, wrapper: VisageWrapper) : GLSurfaceV
 
             Matrix.setIdentityM(translateMatrix, 0)
 
-            val gazeData: ScreenSpaceGazeData? = visageWrapper.GetScreenSpaceGazeData()
-            gazeData?.let {
+            frameResults.read()
+            val gazeData = if (frameResults.gazeAvailable) frameResults.gaze else null
+            if (gazeData != null && frameResults.isNew) {
                 Log.d(TAG, "Tracking state: ${gazeData.inState}, Quality: ${gazeData.quality}")
             }
             if (currentGazeMode == GazeTrackerMode.Calibration){
@@ -124,7 +124,6 @@ class Camera2Fragment : Fragment(), ActivityCompat.OnRequestPermissionsResultCal
     private val onImageAvailableListener = ImageReader.OnImageAvailableListener { reader ->
         var image: Image? = null
         try {
-            val tsA = System.currentTimeMillis()
             image = reader.acquireLatestImage()
             if (image == null) return@OnImageAvailableListener
             val planes: Array<Image.Plane> = image.planes
@@ -136,7 +135,7 @@ class Camera2Fragment : Fragment(), ActivityCompat.OnRequestPermissionsResultCal
                 byteBuffer0,
                 byteBuffer1,
                 byteBuffer2,
-                tsA,
+                image.timestamp,
                 frameID++.toLong(),
                 planes[1].pixelStride
             )
@@ -408,6 +407,10 @@ class Camera2Fragment : Fragment(), ActivityCompat.OnRequestPermissionsResultCal
                 "Current preview size is " + mPreviewSize!!.width + " " + mPreviewSize!!.height
             )
             mOrientation = getCorrectCameraOrientation(characteristics)
+            VisageWrapper.SetSensorTimestampSource(
+                characteristics.get(CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE)
+                    ?: CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN
+            )
 
             manager.openCamera(cameraId!!, mStateCallback, null)
             mImageReader = ImageReader.newInstance(
@@ -3,6 +3,7 @@ package com.dsd.kosjenka.presentation.home.camera;
 import android.content.Context;
 import android.graphics.PixelFormat;
 import android.graphics.Point;
+import android.opengl.GLES20;
 import android.opengl.GLSurfaceView;
 import android.util.Log;
 import android.view.Display;
@@ -27,6 +28,8 @@ public class TrackerView extends GLSurfaceView {
         visageWrapper = wrapper;
 
 
+        // the native renderer draws with OpenGL ES 2.0 shaders
+        setEGLContextClientVersion(2);
         setEGLConfigChooser(8,8,8,8,16,0);
         getHolder().setFormat(PixelFormat.TRANSPARENT);
         setRenderer(trackerRenderer);
@@ -74,7 +77,7 @@ public class TrackerView extends GLSurfaceView {
 
         @Override
         public void onSurfaceChanged(GL10 gl, int width, int height) {
-            gl.glViewport(0, 0, width, height);
+            GLES20.glViewport(0, 0, width, height);
             this.width = width;
             this.height = height;
             Log.d(TAG, "onSurfaceChanged");
@@ -84,9 +87,9 @@ public class TrackerView extends GLSurfaceView {
 
         @Override
         public void onDrawFrame(GL10 gl) {
-            gl.glEnable(GL10.GL_BLEND);
-//            gl.glClearColor(mRed, mGreen, mBlue, 1.0f);
-            gl.glClear(GL10.GL_COLOR_BUFFER_BIT | GL10.GL_DEPTH_BUFFER_BIT);
+            GLES20.glEnable(GLES20.GL_BLEND);
+//            GLES20.glClearColor(mRed, mGreen, mBlue, 1.0f);
+            GLES20.glClear(GLES20.GL_COLOR_BUFFER_BIT | GLES20.GL_DEPTH_BUFFER_BIT);
 
             visageWrapper.DisplayTrackingStatus(width, height);
         }
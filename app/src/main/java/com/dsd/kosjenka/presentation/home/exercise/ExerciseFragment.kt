@@ -365,6 +365,14 @@ class ExerciseFragment : Fragment(), HighlightCallback {
                 "Current preview size is " + mPreviewSize.width + " " + mPreviewSize.height
             )
             mOrientation = getCorrectCameraOrientation(characteristics)
+            VisageWrapper.SetSensorTimestampSource(
+                characteristics.get(CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE)
+                    ?: CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN
+            )
+            VisageWrapper.SetTrackingInputFormat(
+                if (preferences.isLuminanceTracking) VisageWrapper.TRACKING_INPUT_LUMINANCE
+                else VisageWrapper.TRACKING_INPUT_RGB
+            )
 
             if (ActivityCompat.checkSelfPermission(
                     requireContext(),
@@ -412,7 +420,6 @@ class ExerciseFragment : Fragment(), HighlightCallback {
                 ImageReader.OnImageAvailableListener { reader ->
                     var image: Image? = null
                     try {
-                        val tsA = System.currentTimeMillis()
                         image = reader.acquireLatestImage()
                         if (image == null) return@OnImageAvailableListener
                         val planes: Array<Image.Plane> = image.planes
@@ -424,7 +431,7 @@ class ExerciseFragment : Fragment(), HighlightCallback {
                             byteBuffer0,
                             byteBuffer1,
                             byteBuffer2,
-                            tsA,
+                            image.timestamp,
                             frameID++.toLong(),
                             planes[1].pixelStride
                         )
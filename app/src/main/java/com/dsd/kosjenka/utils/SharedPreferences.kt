@@ -38,6 +38,11 @@ class SharedPreferences
         get() = preferences.getBoolean(IS_GAZE_READING_MODE, false)
         set(newToken) = preferences.edit().putBoolean(IS_GAZE_READING_MODE, newToken).apply()
 
+    // Gaze screens track on the camera's luminance plane unless this is turned off, then on RGB frames
+    var isLuminanceTracking: Boolean
+        get() = preferences.getBoolean(IS_LUMINANCE_TRACKING, true)
+        set(newValue) = preferences.edit().putBoolean(IS_LUMINANCE_TRACKING, newValue).apply()
+
     var categories: List<Category>
         get() {
             val json = preferences.getString(CATEGORIES, null)
@@ -64,5 +69,6 @@ class SharedPreferences
         private const val CATEGORIES = "CATEGORIES"
         private const val IS_GAZE_READING_MODE = "IS_GAZE_READING_MODE"
         private const val IS_CALIBRATED = "IS_CALIBRATED"
+        private const val IS_LUMINANCE_TRACKING = "IS_LUMINANCE_TRACKING"
     }
 }
\ No newline at end of file
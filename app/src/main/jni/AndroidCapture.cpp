@@ -14,8 +14,8 @@ namespace VisageSDK {
 
     }
 
-    AndroidCapture::AndroidCapture(int width, int height, int orientation, int flip ) {
-        cameraCapture = new AndroidStreamCapture(width, height, orientation, flip);
+    AndroidCapture::AndroidCapture(int width, int height, int orientation, int flip, int format, int scale) {
+        cameraCapture = new AndroidStreamCapture(width, height, orientation, flip, format, scale);
         imageCapture = 0;
     }
 
@@ -27,11 +27,22 @@ namespace VisageSDK {
 
     }
 
-    VsImage *AndroidCapture::GrabFrame(long &timeStamp) {
-        if(imageCapture)
-            return imageCapture->GrabFrame(timeStamp);
+    VsImage *AndroidCapture::GrabFrame(long long &timeStamp) {
+        if(imageCapture) {
+            long imageTimeStamp;
+            VsImage *image = imageCapture->GrabFrame(imageTimeStamp);
+            timeStamp = imageTimeStamp;
+            return image;
+        }
         if(cameraCapture)
             return cameraCapture->GrabFrame(timeStamp);
+        return 0;
+    }
+
+    long long AndroidCapture::GetGrabbedFrameId() {
+        if(cameraCapture)
+            return cameraCapture->GetGrabbedFrameId();
+        return -1;
     }
 
     void AndroidCapture::WriteFrame(unsigned char *imageData, int width, int height) {
@@ -41,11 +52,58 @@ namespace VisageSDK {
 
     void AndroidCapture::WriteFrameYUV420(unsigned char *imageDataChannel0,
                                           unsigned char *imageDataChannel1,
-                                          unsigned char *imageDataChannel2, long timestamp_A, int pixelStride) {
+                                          unsigned char *imageDataChannel2, long long timestamp_A, int pixelStride,
+                                          long long frameId) {
+
+        if(cameraCapture)
+            cameraCapture->WriteFrameYUV420(imageDataChannel0, imageDataChannel1, imageDataChannel2, timestamp_A, pixelStride, frameId);
+
+    }
 
+    void AndroidCapture::WakeGrab() {
         if(cameraCapture)
-            cameraCapture->WriteFrameYUV420(imageDataChannel0, imageDataChannel1, imageDataChannel2, timestamp_A, pixelStride);
+            cameraCapture->WakeGrab();
+    }
 
+    void AndroidCapture::SetColorMatrix(YuvColorMatrix matrix) {
+        if(cameraCapture)
+            cameraCapture->SetColorMatrix(matrix);
+    }
+
+    bool AndroidCapture::ConvertGrabbedFrameToRGB(VsImage *dst) {
+        if(cameraCapture)
+            return cameraCapture->ConvertGrabbedFrameToRGB(dst);
+        //a still image is tracked as it was written, RGB input copies straight into the preview
+        if(imageCapture)
+            return imageCapture->CopyGrabbedFrame(dst);
+        return false;
+    }
+
+    bool AndroidCapture::CopyGrabbedFrameNV12(VsImage *yDst, VsImage *uvDst) {
+        if(cameraCapture)
+            return cameraCapture->CopyGrabbedFrameNV12(yDst, uvDst);
+        return false;
+    }
+
+    void AndroidCapture::GetFrameSize(int &width, int &height) {
+        width = height = 0;
+        if(cameraCapture)
+            cameraCapture->GetFrameSize(width, height);
+        if(imageCapture)
+            imageCapture->GetFrameSize(width, height);
+    }
+
+    float AndroidCapture::GetAverageWriteCpuTime() {
+        if(cameraCapture)
+            return cameraCapture->GetAverageWriteCpuTime();
+        return 0.0f;
+    }
+
+    FrameRingStats AndroidCapture::GetFrameStats() {
+        if(cameraCapture)
+            return cameraCapture->GetFrameStats();
+        FrameRingStats stats = {0, 0, 0};
+        return stats;
     }
 
 }
@@ -20,15 +20,32 @@ namespace VisageSDK
         AndroidCapture();
 
         AndroidCapture(int width, int height, int format = VISAGE_FRAMEGRABBER_FMT_LUMINANCE);
-        AndroidCapture(int width, int height, int orientation, int flip);
+        AndroidCapture(int width, int height, int orientation, int flip, int format = VISAGE_FRAMEGRABBER_FMT_RGB, int scale = 1);
 
         ~AndroidCapture();
 
-        VsImage *GrabFrame(long &timeStamp);
+        VsImage *GrabFrame(long long &timeStamp);
+
+        long long GetGrabbedFrameId();
 
         void WriteFrame(unsigned char *imageData, int width, int height);
         void WriteFrameYUV420(unsigned char* imageDataChannel0, unsigned char* imageDataChannel1,
-                         unsigned char* imageDataChannel2, long timestamp_A, int pixelStride);
+                         unsigned char* imageDataChannel2, long long timestamp_A, int pixelStride,
+                              long long frameId = -1);
+
+        void SetColorMatrix(YuvColorMatrix matrix);
+
+        bool ConvertGrabbedFrameToRGB(VsImage *dst);
+
+        bool CopyGrabbedFrameNV12(VsImage *yDst, VsImage *uvDst);
+
+        void GetFrameSize(int &width, int &height);
+
+        void WakeGrab();
+
+        float GetAverageWriteCpuTime();
+
+        FrameRingStats GetFrameStats();
     };
 }
 
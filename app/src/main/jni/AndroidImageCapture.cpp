@@ -52,4 +52,18 @@ VsImage *AndroidImageCapture::GrabFrame(long &timeStamp)
 	timeStamp = pts++;
 	return buffer;
 }
+
+bool AndroidImageCapture::CopyGrabbedFrame(VsImage *dst)
+{
+	if (dst->width != buffer->width || dst->height != buffer->height || dst->nChannels != buffer->nChannels)
+		return false;
+	vsCopy(buffer, dst);
+	return true;
+}
+
+void AndroidImageCapture::GetFrameSize(int &frameWidth, int &frameHeight) const
+{
+	frameWidth = buffer->width;
+	frameHeight = buffer->height;
+}
 }
@@ -58,6 +58,18 @@ public:
 	*/
 	void WriteFrame(unsigned char *imageData, int width, int height);
 
+	/**
+	* Copies the frame returned by GrabFrame into dst.
+	* @param dst image of the size and number of channels of the frame, see GetFrameSize
+	* @return false if dst does not match the frame
+	*/
+	bool CopyGrabbedFrame(VsImage *dst);
+
+	/**
+	* Size of the frames returned by GrabFrame.
+	*/
+	void GetFrameSize(int &frameWidth, int &frameHeight) const;
+
 
 private:
 
@@ -1,238 +1,294 @@
 #include "AndroidStreamCapture.h"
+#include "PipelineMetrics.h"
+#include "PipelineTrace.h"
+#include "FrameTiming.h"
+
+#ifdef __ANDROID__
 #include <android/log.h>
 
 #define  LOG_TAG    "AndroidCameraCapture"
 #define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,LOG_TAG,__VA_ARGS__)
 #define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
+#else
+// host builds (frame replay benchmarks) log to stderr
+#include <cstdio>
+
+#define  LOGI(...)  (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define  LOGE(...)  (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#endif
 
 namespace VisageSDK
 {
-/**
- * Simple timer function
- */
-long getTimeNsec() {
-    struct timespec now;
-    clock_gettime(CLOCK_REALTIME, &now);
-    return (long) ((now.tv_sec*1000000000LL + now.tv_nsec)/1000000LL);
-}
+// number of frames over which camera thread CPU time is averaged and logged
+static const int CPU_TIME_REPORT_FRAMES = 300;
+
+// how long GrabFrame waits for a new frame before giving up
+static const int GRAB_TIMEOUT_MS = 2000;
 
-AndroidStreamCapture::AndroidStreamCapture(int width, int height, int orientation, int flip)
+AndroidStreamCapture::AndroidStreamCapture(int width, int height, int orientation, int flip, int format, int scale)
+    : ring(FRAME_SLOTS)
 {
-    for(int i = 0; i < 3; i++){
-        _buffers.push_back(make_pair(vsCreateImage(vsSize(width, height), VS_DEPTH_8U, 3), 0));
-        _buffers[i].first->widthStep = 3 * width; //removing padding because OpenGL cannot handle image data with additional padding
+    if (!YuvConverter::IsScaleSupported(width, height, scale))
+    {
+        LOGE("Tracking scale 1/%d not supported for %dx%d frames, using full resolution", scale, width, height);
+        scale = 1;
     }
 
-	bufferN = vsCreateImage(vsSize(width, height),VS_DEPTH_8U,3);
-	bufferN->widthStep = 3 * width; 
-	bufferT = vsCreateImage(vsSize(height, width),VS_DEPTH_8U,3);
-	bufferT->widthStep = 3 * height;
+    // frames are handed to the tracker in their final orientation and scale, so the buffers are sized accordingly
+    int outWidth, outHeight;
+    YuvConverter::OrientedSize(width / scale, height / scale, orientation, outWidth, outHeight);
+
+    // the NV12 planes kept for display and RGB conversion stay at camera resolution whatever the tracking scale
+    int fullWidth, fullHeight;
+    YuvConverter::OrientedSize(width, height, orientation, fullWidth, fullHeight);
+
+    const int channels = (format == VISAGE_FRAMEGRABBER_FMT_LUMINANCE) ? 1 : 3;
+
+    // all frame buffers come from the shared pool (without padding, OpenGL cannot handle image data with additional padding),
+    // so recreating the capture after a rotation or scale change reuses the memory of the previous one
+    ImagePool& pool = ImagePool::Shared();
 
-	pthread_mutex_init(&mutex, NULL);
-    pthread_mutex_init(&paramMutex, NULL);
-	pthread_cond_init(&cond, NULL);
+    _buffers.reserve(FRAME_SLOTS);
+    _chroma.reserve(FRAME_SLOTS);
+    _frameIds.assign(FRAME_SLOTS, -1);
+    for(int i = 0; i < FRAME_SLOTS; i++){
+        _buffers.push_back(make_pair(pool.Acquire(outWidth, outHeight, channels), 0));
 
-	frameArrived = false;
-	grabCount = 0;
-    writeCount = 0;
+        if (channels == 1 || scale > 1)
+            _chroma.push_back(pool.Acquire(fullWidth / 2, fullHeight / 2, 2));
+
+        if (scale > 1)
+            _luma.push_back(pool.Acquire(fullWidth, fullHeight, 1));
+    }
+
+    // downscaled RGB frames are area-averaged in the YUV domain first, into a single scratch frame
+    // and converted from there
+    scaledLuma = 0;
+    scaledChroma = 0;
+    if (channels == 3 && scale > 1)
+    {
+        scaledLuma = pool.Acquire(outWidth, outHeight, 1);
+        scaledChroma = pool.Acquire(outWidth / 2, outHeight / 2, 2);
+    }
+
+    grabbedSlot = -1;
+    colorMatrix.store(YUV_MATRIX_BT601_FULL);
 
     this->orientation = orientation;
 	this->flip = flip;
 	this->width = width;
 	this->height = height;
+	this->scale = scale;
+	this->format = (channels == 1) ? VISAGE_FRAMEGRABBER_FMT_LUMINANCE : VISAGE_FRAMEGRABBER_FMT_RGB;
 
-    _wb = 0;
-    _rb = 1;
-    _ub = 2;
+    writeCpuTimeNs = 0;
+    writeCpuTimeFrames = 0;
+    averageWriteCpuTime = 0.0f;
+    countedDrops = 0;
 
+    LOGI("YUV converter backend: %s", YuvConverter::BackendName());
 }
 
 AndroidStreamCapture::~AndroidStreamCapture(void)
 {
-    for(int i = 0; i < 3; i++)
+    ImagePool& pool = ImagePool::Shared();
+
+    for(int i = 0; i < FRAME_SLOTS; i++)
     {
-        vsReleaseImage(&_buffers[i].first);
+        pool.Release(&_buffers[i].first);
     }
 
-    _buffers.clear();
+    for(size_t i = 0; i < _chroma.size(); i++)
+    {
+        pool.Release(&_chroma[i]);
+    }
+
+    for(size_t i = 0; i < _luma.size(); i++)
+    {
+        pool.Release(&_luma[i]);
+    }
 
-    // cleaning up
-	vsReleaseImage(&bufferN);
-	vsReleaseImage(&bufferT);
+    _buffers.clear();
+    _chroma.clear();
+    _luma.clear();
+    _frameIds.clear();
 
-	pthread_mutex_destroy(&mutex);
-    pthread_mutex_destroy(&paramMutex);
-	pthread_cond_destroy(&cond);
+    pool.Release(&scaledLuma);
+    pool.Release(&scaledChroma);
 }
 
 void AndroidStreamCapture::WriteFrameYUV420(unsigned char* imageDataChannel0, unsigned char* imageDataChannel1,
-                                         unsigned char* imageDataChannel2, long timestamp_A, int pixelStride)
+                                         unsigned char* imageDataChannel2, long long timestamp_A, int pixelStride,
+                                         long long frameId)
 {
-	pthread_mutex_lock(&paramMutex);
-    _buffers[_wb].second = timestamp_A;
+    // planes handed over by the Java side are tightly packed
+    YuvFrame frame;
+    frame.y = imageDataChannel0;
+    frame.u = imageDataChannel1;
+    frame.v = imageDataChannel2;
+    frame.width = width;
+    frame.height = height;
+    frame.yRowStride = width;
+    frame.uvRowStride = (width >> 1) * pixelStride;
+    frame.uvPixelStride = pixelStride;
+
+    WriteFrame(frame, timestamp_A, frameId);
+}
 
-    YUV420toRGB(imageDataChannel0, imageDataChannel1, imageDataChannel2, _buffers[_wb].first, width, height, pixelStride);
+void AndroidStreamCapture::WriteFrame(const YuvFrame& frame, long long timestamp, long long frameId)
+{
+    long long cpuStart = ThreadCpuNsec();
 
-    pthread_mutex_unlock(&paramMutex);
+    // the slot belongs to this thread until EndWrite, nothing else is locked while converting
+    int slot = ring.BeginWrite();
+    _buffers[slot].second = timestamp;
+    _frameIds[slot] = frameId;
 
-    int tmp;
+    YuvColorMatrix matrix = colorMatrix.load(std::memory_order_relaxed);
+    if (converter.GetColorMatrix() != matrix)
+        converter.SetColorMatrix(matrix);
+
+    PipelineMetrics& metrics = PipelineMetrics::Shared();
+    long long start = MonotonicNsec();
+    long long cpu = ThreadCpuNsec();
+
+    if (scale > 1)
+    {
+        // the planes are kept at camera resolution for display, the tracked frame is area-averaged in the same
+        // pass from the camera rows just read, so rotation and downscaling are timed as one stage
+        bool luminance = format == VISAGE_FRAMEGRABBER_FMT_LUMINANCE;
+        converter.ExtractNV12(frame, luminance ? _buffers[slot].first : scaledLuma, luminance ? NULL : scaledChroma,
+                              orientation, flip, scale, _luma[slot], _chroma[slot]);
+        long long rotated = MonotonicNsec();
+        long long rotatedCpu = ThreadCpuNsec();
+        metrics.Record(STAGE_ROTATION, rotated - start, rotatedCpu - cpu);
+        PIPELINE_TRACE_SPAN("rotation", start, rotated, frameId);
+
+        if (!luminance)
+        {
+            converter.ConvertNV12(scaledLuma, scaledChroma, _buffers[slot].first);
+            long long end = MonotonicNsec();
+            metrics.Record(STAGE_YUV_CONVERSION, end - rotated, ThreadCpuNsec() - rotatedCpu);
+            PIPELINE_TRACE_SPAN("yuv_conversion", rotated, end, frameId);
+        }
+    }
+    else if (format == VISAGE_FRAMEGRABBER_FMT_LUMINANCE)
+    {
+        YUV420toNV12(frame, _buffers[slot].first, _chroma[slot]);
+        long long end = MonotonicNsec();
+        metrics.Record(STAGE_ROTATION, end - start, ThreadCpuNsec() - cpu);
+        PIPELINE_TRACE_SPAN("rotation", start, end, frameId);
+    }
+    else
+    {
+        // rotation is fused into the conversion here
+        YUV420toRGB(frame, _buffers[slot].first);
+        long long end = MonotonicNsec();
+        metrics.Record(STAGE_YUV_CONVERSION, end - start, ThreadCpuNsec() - cpu);
+        PIPELINE_TRACE_SPAN("yuv_conversion", start, end, frameId);
+    }
 
-    pthread_mutex_lock(&mutex);
-    tmp = _wb;
-    _wb = _rb;
-    _rb = tmp;
+    ring.EndWrite();
 
-	frameArrived = true;
-    writeCount++;
+    // the ring counts drops on both sides, only the difference since the last frame is new
+    uint64_t drops = ring.GetStats().dropped;
+    metrics.Count(COUNTER_FRAMES_IN);
+    metrics.Count(COUNTER_FRAMES_DROPPED, drops - countedDrops);
+    countedDrops = drops;
 
-	pthread_cond_signal(&cond);
-	pthread_mutex_unlock(&mutex);
+    writeCpuTimeNs += ThreadCpuNsec() - cpuStart;
+    if (++writeCpuTimeFrames == CPU_TIME_REPORT_FRAMES)
+    {
+        averageWriteCpuTime = writeCpuTimeNs / (1000000.0f * writeCpuTimeFrames);
+        LOGI("Camera thread CPU time (%s input): %.3f ms/frame", format == VISAGE_FRAMEGRABBER_FMT_LUMINANCE ? "luminance" : "rgb", averageWriteCpuTime);
+        writeCpuTimeNs = 0;
+        writeCpuTimeFrames = 0;
+
+        FrameRingStats stats = ring.GetStats();
+        LOGI("Frames produced %llu, consumed %llu, dropped %llu", (unsigned long long) stats.produced,
+             (unsigned long long) stats.consumed, (unsigned long long) stats.dropped);
+    }
 }
 
-VsImage *AndroidStreamCapture::GrabFrame(long &timeStamp)
+VsImage *AndroidStreamCapture::GrabFrame(long long &timeStamp)
 {
-    struct timespec   ts;
-    struct timeval    tp;
-    VsImage* ret;
-    timeStamp = _buffers[_ub].second;
-    int rc = gettimeofday(&tp, NULL);
-    ts.tv_sec  = tp.tv_sec + 2;
-    ts.tv_nsec = 0;
-	pthread_mutex_lock(&mutex);
-	while (!frameArrived){
-		int ret_cond = pthread_cond_timedwait(&cond, &mutex, &ts);
-        if (ret_cond == ETIMEDOUT){
-            pthread_mutex_unlock(&mutex);
-            return 0;
-    	}
-    }
+    // releases the previously grabbed slot and takes the newest published one, older frames are dropped
+    grabbedSlot = ring.AcquireLatest(GRAB_TIMEOUT_MS);
+    if (grabbedSlot == -1)
+        return 0;
 
-    int tmp = _ub;
-    _ub = _rb;
-    _rb = tmp;
-
-    frameArrived = false;
-    pthread_mutex_unlock(&mutex);
-
-    long startTime2 = getTimeNsec();
-
-    pthread_mutex_lock(&paramMutex);
-	switch(orientation){
-
-	case 0: case 360:
-				if (flip)
-					vsFlip(_buffers[_ub].first, bufferN, 1);
-				else
-					vsCopy(_buffers[_ub].first, bufferN);
-				ret = bufferN;
-				break;
-			case 90:
-				vsTranspose(_buffers[_ub].first, bufferT);
-				if (!flip)
-					vsFlip(bufferT, bufferT, 1);
-				ret = bufferT;
-				break;
-			case 180:
-				if (flip)
-					vsFlip(_buffers[_ub].first, bufferN, 0);
-				else
-					vsFlip(_buffers[_ub].first, bufferN, -1);
-				ret = bufferN;
-				break;
-			case 270:
-				vsTranspose(_buffers[_ub].first, bufferT);
-				if (flip)
-					vsFlip(bufferT, bufferT, -1);
-				else
-					vsFlip(bufferT, bufferT, 0);
-				ret = bufferT;
-				break;
-	}
-    pthread_mutex_unlock(&paramMutex);
-    int time2 = (int) (getTimeNsec() - startTime2);
-    grabCount++;
-	return ret;
-}
-void AndroidStreamCapture::YUV420toRGB(unsigned char* dataChannel0, unsigned char* dataChannel1, unsigned char* dataChannel2, VsImage* buff, int width, int height, int pixelStride){
-    int size = width*height;
-    int u, v, y1, y2, y3, y4;
-    const int widthStep = buff->widthStep;
-    // i along Y and the final pixels
-    // k along pixels U and V
-    for(int i=0, k=0; i < size; i+=2, k+=pixelStride) {
-        y1 = dataChannel0[i  ]&0xff;
-        y2 = dataChannel0[i+1]&0xff;
-        y3 = dataChannel0[width+i  ]&0xff;
-        y4 = dataChannel0[width+i+1]&0xff;
-
-        u = dataChannel1[k]&0xff;
-        v = dataChannel2[k]&0xff;
-
-		convertYUV420toARGB(y1,u,v, &buff->imageData[i*3], &buff->imageData[i*3+1], &buff->imageData[i*3+2]);
-		convertYUV420toARGB(y2,u,v, &buff->imageData[(i+1)*3], &buff->imageData[(i+1)*3+1], &buff->imageData[(i+1)*3+2]);
-		convertYUV420toARGB(y3,u,v, &buff->imageData[widthStep+i*3], &buff->imageData[widthStep+i*3+1], &buff->imageData[widthStep+i*3+2]);
-		convertYUV420toARGB(y4,u,v, &buff->imageData[widthStep+(i+1)*3], &buff->imageData[widthStep+(i+1)*3+1], &buff->imageData[widthStep+(i+1)*3+2]);
-        if (i!=0 && (i+2)%width==0)
-            i+=width;
-    }
-}
- 
-int AndroidStreamCapture::clamp(int x) {
-    unsigned y;
-    return !(y=x>>8) ? x : (0xff ^ (y>>24));
+    timeStamp = _buffers[grabbedSlot].second;
+
+    // rotation and flipping were already applied in WriteFrameYUV420, the buffer is handed out as is
+	return _buffers[grabbedSlot].first;
 }
 
-void AndroidStreamCapture::YUV_NV21_TO_RGB(unsigned char* yuv, VsImage* buff, int width, int height)
+long long AndroidStreamCapture::GetGrabbedFrameId() const
 {
-    const int frameSize = width * height;
+    return (grabbedSlot == -1) ? -1 : _frameIds[grabbedSlot];
+}
 
-    const int ii = 0;
-    const int ij = 0;
-    const int di = +1;
-    const int dj = +1;
+void AndroidStreamCapture::YUV420toRGB(const YuvFrame& frame, VsImage* buff){
+    converter.Convert(frame, buff, orientation, flip);
+}
 
-    unsigned char* rgb = (unsigned char*)buff->imageData;
+void AndroidStreamCapture::YUV420toNV12(const YuvFrame& frame, VsImage* yBuff, VsImage* uvBuff){
+    converter.ExtractNV12(frame, yBuff, uvBuff, orientation, flip);
+}
 
-    int a = 0;
-    for (int i = 0, ci = ii; i < height; ++i, ci += di)
+bool AndroidStreamCapture::ConvertGrabbedFrameToRGB(VsImage* dst)
+{
+    // the grabbed slot is owned by the grabbing thread until the next GrabFrame, so no locking is needed
+    if (grabbedSlot == -1)
+        return false;
+
+    // without retained planes the grabbed frame is the RGB frame at camera resolution
+    if (_chroma.empty())
     {
-        for (int j = 0, cj = ij; j < width; ++j, cj += dj)
-        {
-            int y = (0xff & ((int) yuv[ci * width + cj]));
-            int v = (0xff & ((int) yuv[frameSize + (ci >> 1) * width + (cj & ~1) + 0]));
-            int u = (0xff & ((int) yuv[frameSize + (ci >> 1) * width + (cj & ~1) + 1]));
-            y = y < 16 ? 16 : y;
-
-            //int r = (int) (1.164f * (y - 16) + 1.596f * (v - 128));
-            //int g = (int) (1.164f * (y - 16) - 0.813f * (v - 128) - 0.391f * (u - 128));
-            //int b = (int) (1.164f * (y - 16) + 2.018f * (u - 128));
-
-            int a0 = 1192 * (y -  16);
-            int a1 = 1634 * (v - 128);
-            int a2 =  832 * (v - 128);
-            int a3 =  400 * (u - 128);
-            int a4 = 2066 * (u - 128);
-
-            int r = (a0 + a1) >> 10;
-            int g = (a0 - a2 - a3) >> 10;
-            int b = (a0 + a4) >> 10;
-
-            *rgb++ = clamp(r);
-            *rgb++ = clamp(g);
-            *rgb++ = clamp(b);
-        }
+        vsCopy(_buffers[grabbedSlot].first, dst);
+        return true;
     }
+
+    YuvColorMatrix matrix = colorMatrix.load(std::memory_order_relaxed);
+    if (rgbConverter.GetColorMatrix() != matrix)
+        rgbConverter.SetColorMatrix(matrix);
+
+    rgbConverter.ConvertNV12(GetFullLuma(grabbedSlot), _chroma[grabbedSlot], dst);
+    return true;
 }
 
-void AndroidStreamCapture::convertYUV420toARGB(int y, int u, int v, char *r, char *g, char *b) {
+bool AndroidStreamCapture::CopyGrabbedFrameNV12(VsImage* yDst, VsImage* uvDst)
+{
+    if (grabbedSlot == -1 || format != VISAGE_FRAMEGRABBER_FMT_LUMINANCE)
+        return false;
 
-    int rTmp = y + (int)(1.370705 * (v-128));
-    int gTmp = y - (int)(0.698001 * (v-128)) - (int)(0.337633 * (u-128));
-    int bTmp = y + (int)(1.732446 * (u-128));
+    vsCopy(GetFullLuma(grabbedSlot), yDst);
+    vsCopy(_chroma[grabbedSlot], uvDst);
+    return true;
+}
+
+void AndroidStreamCapture::SetColorMatrix(YuvColorMatrix matrix)
+{
+    // picked up by the converting threads on their next frame
+    colorMatrix.store(matrix, std::memory_order_relaxed);
+}
+
+void AndroidStreamCapture::YUV_NV21_TO_RGB(unsigned char* yuv, VsImage* buff, int width, int height)
+{
+    // NV21: full resolution Y plane followed by interleaved V/U samples
+    const int frameSize = width * height;
 
-    *r = (char) ((rTmp) > 255 ? 255 : (rTmp) < 0 ? 0 : (rTmp));
-    *g = (char) ((gTmp) > 255 ? 255 : (gTmp) < 0 ? 0 : (gTmp));
-    *b = (char) ((bTmp) > 255 ? 255 : (bTmp) < 0 ? 0 : (bTmp));
+    YuvFrame frame;
+    frame.y = yuv;
+    frame.u = yuv + frameSize + 1;
+    frame.v = yuv + frameSize;
+    frame.width = width;
+    frame.height = height;
+    frame.yRowStride = width;
+    frame.uvRowStride = width;
+    frame.uvPixelStride = 2;
+
+    converter.Convert(frame, buff);
 }
 
 
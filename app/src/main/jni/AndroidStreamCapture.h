@@ -4,6 +4,10 @@
 #include <pthread.h>
 #include <cerrno>
 #include "vs_main.h"
+#include "YuvConverter.h"
+#include "FrameRing.h"
+#include "ImagePool.h"
+#include <atomic>
 #include <vector>
 #include <cmath>
 
@@ -25,15 +29,25 @@ namespace VisageSDK
  * input to track from Android camera.
  * @ref GrabFrame method will be periodically called to get new frame.
  * For inputing new frame, @ref WriteFrame should be used. This method expects frame in
- * Android camera NV21 format (YUV420sp). YUV420sp to RGB converting, rotation and flipping
- * is done in @ref GrabFrame.
+ * Android camera YUV_420_888 format. YUV to RGB converting, rotation and flipping
+ * are fused into a single pass in @ref WriteFrameYUV420, so @ref GrabFrame hands out the converted buffer without copying.
+ *
+ * When created with VISAGE_FRAMEGRABBER_FMT_LUMINANCE no color conversion is done on the camera thread at all:
+ * the Y plane is rotated/flipped into a 1 channel image which @ref GrabFrame returns, and the chroma planes are kept
+ * alongside it so that RGB can be produced on demand with @ref ConvertGrabbedFrameToRGB.
+ *
+ * With a downscale factor only the frames returned by @ref GrabFrame are downscaled. The rotated NV12 planes are kept
+ * at camera resolution, so @ref ConvertGrabbedFrameToRGB and @ref CopyGrabbedFrameNV12 always produce frames of the
+ * oriented camera size, whatever the tracking scale.
+ *
+ * Frames are handed from the camera thread to the tracking thread through a lock-free @ref FrameRing, so the two
+ * threads never wait for each other; if the tracker falls behind, it always gets the newest frame and the
+ * skipped ones are counted as dropped (see @ref GetFrameStats).
  */
 class AndroidStreamCapture {
 
 public:
 
-	bool frameArrived;
-
 	/** Constructor.
 	 *
 	 */
@@ -45,8 +59,11 @@ public:
 	* @param height height of image
 	* @param orientation Orientation of image. Allowed values are 0, 90, 180, 270
 	* @param flip Flip image horizontaly.
+	* @param format format of images returned by @ref GrabFrame, VISAGE_FRAMEGRABBER_FMT_RGB or VISAGE_FRAMEGRABBER_FMT_LUMINANCE
+	* @param scale downscale factor of images returned by @ref GrabFrame (1, 2 or 4). Frames are area-averaged while they are written,
+	* falls back to 1 if the frame size does not divide evenly.
 	*/
-	AndroidStreamCapture(int width, int height, int orientation=0, int flip = 0);
+	AndroidStreamCapture(int width, int height, int orientation=0, int flip = 0, int format = VISAGE_FRAMEGRABBER_FMT_RGB, int scale = 1);
 
 	/** Destructor.
 	 *
@@ -57,47 +74,139 @@ public:
 	 *
 	 * This function is called periodically to get the new video frame to process.
 	 *
+	 * @param timeStamp receives the sensor timestamp of the returned frame, as passed to @ref WriteFrameYUV420
 	 */
-	VsImage *GrabFrame(long &timeStamp);
+	VsImage *GrabFrame(long long &timeStamp);
+
+	/** ID of the frame last returned by @ref GrabFrame as passed to @ref WriteFrameYUV420, -1 if none.
+	* Must be called from the thread calling @ref GrabFrame.
+	*/
+	long long GetGrabbedFrameId() const;
 
+	/**
+	 * Writes a new camera frame.
+	 *
+	 * @param timestamp_A sensor timestamp of the frame in nanoseconds (Image.getTimestamp()), carried with the frame to @ref GrabFrame
+	 * @param frameId ID of the frame in the pipeline trace, carried with the frame to @ref GetGrabbedFrameId
+	 */
 	void WriteFrameYUV420(unsigned char* imageDataChannel0, unsigned char* imageDataChannel1,
-						unsigned char* imageDataChannel2, long timestamp_A, int pixelStride);
+						unsigned char* imageDataChannel2, long long timestamp_A, int pixelStride, long long frameId = -1);
+
+	/**
+	 * Writes a new frame described by its planes and strides, e.g. one replayed from a recording.
+	 * The frame must have the size the capture was created with.
+	 *
+	 * @param timestamp sensor timestamp of the frame in nanoseconds, carried with the frame to @ref GrabFrame
+	 * @param frameId ID of the frame in the pipeline trace, carried with the frame to @ref GetGrabbedFrameId
+	 */
+	void WriteFrame(const YuvFrame& frame, long long timestamp, long long frameId = -1);
 
 	void YUV_NV21_TO_RGB(unsigned char* yuv, VsImage* buff, int width, int height);
 
-	int clamp(int x);
+	/** Selects the color matrix used for YUV to RGB conversion.
+	*/
+	void SetColorMatrix(YuvColorMatrix matrix);
+
+	/** Writes the RGB version of the frame last returned by @ref GrabFrame into dst.
+	* In luminance mode the frame is converted from the retained chroma planes, otherwise it is copied.
+	* Must be called from the thread calling @ref GrabFrame, before the next call to it.
+	* @param dst 3 channel image of the oriented camera frame size
+	* @return false if there is no grabbed frame
+	*/
+	bool ConvertGrabbedFrameToRGB(VsImage* dst);
+
+	/** Copies the NV12 planes of the frame last returned by @ref GrabFrame, already rotated and flipped, e.g. for
+	* conversion to RGB on the GPU. Only in luminance mode, must be called from the thread calling @ref GrabFrame.
+	* @param yDst 1 channel image of the oriented camera frame size
+	* @param uvDst 2 channel image of half the size
+	* @return false if there is no grabbed frame or the capture does not keep the chroma planes
+	*/
+	bool CopyGrabbedFrameNV12(VsImage* yDst, VsImage* uvDst);
+
+	/** Makes a @ref GrabFrame that is waiting for a frame, or the next one, return 0 right away.
+	*/
+	void WakeGrab() { ring.Wake(); }
+
+	int GetFormat() const { return format; }
+
+	/** Size of the oriented frame at camera resolution, which @ref ConvertGrabbedFrameToRGB and
+	* @ref CopyGrabbedFrameNV12 write whatever the tracking scale.
+	*/
+	void GetFrameSize(int& frameWidth, int& frameHeight) const
+	{
+		YuvConverter::OrientedSize(width, height, orientation, frameWidth, frameHeight);
+	}
+
+	int GetScale() const { return scale; }
+
+	/** Average camera thread CPU time spent in @ref WriteFrameYUV420 per frame, in milliseconds.
+	*/
+	float GetAverageWriteCpuTime() const { return averageWriteCpuTime; }
+
+	/** Number of frames produced, consumed and dropped since the capture was created.
+	*/
+	FrameRingStats GetFrameStats() const { return ring.GetStats(); }
+
 	void rotateYUV(const unsigned char* input, unsigned char* output, int width, int height, int rotation, bool flip);
 
 
 private:
 
 	/**
-	* Convert default Android camera output format (YUV420sp) to RGB.
+	* Convert default Android camera output format (YUV_420_888) to RGB, rotated and flipped according to orientation and flip.
 	*/
-	void YUV420toRGB(unsigned char* dataChannel0, unsigned char* dataChannel1, unsigned char* dataChannel2, VsImage* buff, int width, int height, int pixelStride);
-	void convertYUV420toARGB(int y, int u, int v, char *r, char *g, char *b);
+	void YUV420toRGB(const YuvFrame& frame, VsImage* buff);
 
-    std::vector <std::pair<VsImage*, long>> _buffers;
+	/**
+	* Rotate and flip YUV_420_888 into NV12 planes without color conversion, at camera resolution. Used in luminance mode and when downscaling.
+	*/
+	void YUV420toNV12(const YuvFrame& frame, VsImage* yBuff, VsImage* uvBuff);
+
+	/** Y plane at camera resolution of a slot, the grabbed frame itself unless it is downscaled.
+	*/
+	VsImage* GetFullLuma(int slot) const { return (scale > 1) ? _luma[slot] : _buffers[slot].first; }
 
-    int _wb;
-    int _rb;
-    int _ub;
+	// number of frame slots in the ring
+	static const int FRAME_SLOTS = 3;
 
-    pthread_mutex_t mutex;
-    pthread_mutex_t paramMutex;
+	// converter used on the camera thread
+	YuvConverter converter;
+	// converter used by ConvertGrabbedFrameToRGB on the tracking thread
+	YuvConverter rgbConverter;
+	std::atomic<YuvColorMatrix> colorMatrix;
 
-	VsImage* bufferN;
-	VsImage* bufferT;
+	FrameRing ring;
+
+    std::vector <std::pair<VsImage*, long long>> _buffers;
+    // frame IDs belonging to _buffers
+    std::vector <long long> _frameIds;
+    // interleaved UV planes at camera resolution belonging to _buffers, used in luminance mode and when downscaling
+    std::vector <VsImage*> _chroma;
+    // Y planes at camera resolution belonging to _buffers, only used when downscaling
+    std::vector <VsImage*> _luma;
+
+    // scratch NV12 frame at the tracking scale for downscaled RGB output
+    VsImage* scaledLuma;
+    VsImage* scaledChroma;
+
+    // slot last returned by GrabFrame, -1 if none
+    int grabbedSlot;
 
 	unsigned char *data;
 	int orientation;
 	int flip;
 	int pts;
-    int writeCount;
-    int grabCount;
 	int width, height;
+	int format;
+	int scale;
+
+	// CPU time accounting for WriteFrameYUV420
+	long long writeCpuTimeNs;
+	int writeCpuTimeFrames;
+	float averageWriteCpuTime;
 
-	pthread_cond_t cond;
+	// dropped frames of the ring already added to the pipeline metrics
+	uint64_t countedDrops;
 };
 
 }
@@ -1,6 +1,6 @@
 #include <jni.h>
 #include <EGL/egl.h>
-#include <GLES/gl.h>
+#include <GLES2/gl2.h>
 #include <vector>
 #include <stdio.h>
 #include <unistd.h>
@@ -11,6 +11,20 @@
 //#include "AndroidImageCapture.h"
 //#include "AndroidStreamCapture.h"
 #include "AndroidCapture.h"
+#include "FrameTiming.h"
+#include "ImagePool.h"
+#include "FrameGovernor.h"
+#include "FrameRecorder.h"
+#include "TrackerControl.h"
+#include "FaceAnalysisWorker.h"
+#include "TripleBuffer.h"
+#include "FaceSnapshot.h"
+#include "FaceStore.h"
+#include "SharedResults.h"
+#include "GazeSampleRing.h"
+#include "PipelineMetrics.h"
+#include "PipelineTrace.h"
+#include "ThreadCpuMonitor.h"
 #include <numeric>
 #include <iterator>
 #include "LicenseString.h"
@@ -33,10 +47,6 @@ namespace VisageSDK
 //static AndroidImageCapture *a_cap_image = 0;
 //static AndroidStreamCapture *a_cap_camera = 0;
 static AndroidCapture *androidCapture = 0;
-static VsImage *drawImageBuffer = 0;
-static VsImage *renderImage = 0;
-
-void Sleep(int ms) { usleep(ms * 1000); }
 
 /** \file AndroidWrapper.cpp
  * Implementation of simple interface around visage|SDK VisageTracker functionality.
@@ -46,7 +56,7 @@ void Sleep(int ms) { usleep(ms * 1000); }
  *
  * Key members of wrapper are:
  * - m_Tracker: the VisageTracker object
- * - trackingData: the TrackingData object used for retrieving and holding tracking data
+ * - faceStore: the per-face tracking data and state, sized to the configured number of faces
  * - displayTrackingResults: method that demonstrates how to acquire, use and display tracking data and 3D face model
  * 
  */
@@ -57,30 +67,99 @@ extern "C" {
 // Variables used in tracking thread
 // ********************************
 
-const int MAX_FACES = 4;
 static VisageGazeTracker *m_Tracker = 0;
-static FaceData trackingData[MAX_FACES];
+// Tracker output and per-face state, sized to maxFacesSetting when the tracker is created
+static FaceStore faceStore;
+// Number of faces tracked at the same time, applied by the next TrackerInit that creates the tracker
+int maxFacesSetting = DEFAULT_FACE_CAPACITY;
+static_assert(FaceAnalysisWorker::MAX_FACES >= MAX_FACE_CAPACITY, "analysis worker cannot hold all faces");
 static VisageFaceAnalyser *m_Analyser = 0;
 int *trackingStatus = 0;
-int trackingTime;
 int displayOptions = 0;
-int analyserOptions = 0;
+
+
+// Sensor timestamp (ns) of the first frame tracked, frame times passed to track() are relative to it
+long long trackingEpoch = -1;
 
 
 // ********************************
 // Buffers for track->render communication
 // ********************************
 
-static FaceData trackingDataBuffer[MAX_FACES];
-int trackingStatusBuffer[MAX_FACES];
+/**
+* Results of one tracked frame as handed over from the tracking thread to the rendering thread.
+*/
+struct TrackingResults {
+    // One entry per face of the face capacity
+    std::vector<FaceSnapshot> faces;
+    std::vector<int> status;
+    // Full tracker output, only copied while the wireframe or the action units are drawn
+    std::vector<FaceData> faceData;
+    // Indices of the faces with TRACK_STAT_OK, only these entries are filled and drawn
+    std::vector<int> tracked;
+    int trackedCount;
+    bool hasFaceData;
+    // Sensor timestamp (ns) of the last frame in which a face was tracked
+    long long timestamp;
+    // ID of the camera frame the results were tracked in, for the pipeline trace
+    long long frameId;
+
+    TrackingResults() : trackedCount(0), hasFaceData(false), timestamp(0), frameId(-1) {}
+};
+
+/**
+* Newest tracking results. The rendering thread draws straight from the front slot, so results are taken only once
+* per frame, as snapshots of the tracker's output. Written with guardFrame_mutex held, which serializes the tracking thread
+* with the threads that clear the results.
+*/
+static TripleBuffer<TrackingResults> trackingResults;
+/**
+* Generation of the last face snapshot, every snapshot gets a new one so the renderer can tell whether its cached overlays
+* are still current. Only used by the tracking thread.
+*/
+static unsigned int snapshotGeneration = 0;
+/**
+* Generations of the faces drawn by the last DisplayTrackingStatus, the key of the cached overlays. Only used by the rendering thread.
+*/
+static std::vector<unsigned int> drawnGenerations;
+/**
+* Camera frame as handed over from the tracking thread to the rendering thread. With luminance input the rendering thread
+* gets the NV12 planes and converts them on the GPU, RGB is then only produced for the analyser.
+*/
+struct PreviewFrame {
+    // Y plane and interleaved U/V plane of half the size, valid if yuv is set
+    VsImage *luma;
+    VsImage *chroma;
+    YuvColorMatrix colorMatrix;
+    // RGB frame, converted for the analyser or, with RGB input, for the rendering thread
+    VsImage *rgb;
+    bool yuv;
+
+    PreviewFrame() : luma(0), chroma(0), colorMatrix(YUV_MATRIX_BT601_FULL), rgb(0), yuv(false) {}
+};
+
+/**
+* Frames for the analyser and the rendering thread, copied or converted straight into the back slot. Written with
+* guardFrame_mutex held, updated by the rendering thread with displayRes_mutex held as the frames are reallocated under both.
+*/
+static TripleBuffer<PreviewFrame> previewFrames;
+// Sensor timestamp (ns) of the last frame in which a face was tracked, tracking thread only
+long long frameTimestampBuffer = 0;
+// Gaze of the first face that is not TRACK_STAT_OFF for GetScreenSpaceGazeData, protected by displayRes_mutex
+static FaceSnapshotGaze gazeDataBuffer;
+long long gazeTimestampBuffer = 0;
+bool gazeAvailable = false;
+// Every gaze sample of every face at tracker rate, pushed by the tracking thread and drained by DrainGazeSamples
+static GazeSampleRing gazeSamples(1024);
+// Serializes callers of DrainGazeSamples, the ring has a single consumer; the tracking thread never takes it
+static pthread_mutex_t gazeDrain_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 
 // ********************************
 // Variables used in rendering thread
 // ********************************
 
-static FaceData trackingDataRender[MAX_FACES];
-int trackingStatusRender[MAX_FACES];
+long long lastDisplayedTimestamp = 0;
 // Logo image
 VsImage *logo = 0;
 
@@ -91,15 +170,24 @@ VsImage *logo = 0;
 
 bool trackingOk = false;
 bool isTracking = false;
-bool orientationChanged = false;
-bool trackerPaused = false;
-bool trackerStopped = false;
+/**
+* State of the tracking thread (initialized, running, paused, stopped, waiting for a new capture), see TrackerControl.
+*/
+TrackerControl trackerControl;
 //
 int camOrientation;
 int camHeight;
 int camWidth;
 int camFlip;
+YuvColorMatrix camColorMatrix = YUV_MATRIX_BT601_FULL;
+// Format of the frames passed to the tracker. With luminance input RGB is only produced when it is consumed.
+int camFormat = VISAGE_FRAMEGRABBER_FMT_LUMINANCE;
+// Requested tracking downscale factor (1, 2 or 4), 0 selects it automatically from the tracked face size
+int trackingScaleSetting = 0;
+// Downscale factor the current capture is set up for, the frame buffers always have the camera resolution
+int trackingScale = 1;
 //
+// When both are needed, guardFrame_mutex is always locked first
 pthread_mutex_t displayRes_mutex;
 pthread_mutex_t guardFrame_mutex;
 
@@ -121,6 +209,61 @@ int glHeight;
 int analyserInitialized = 0;
 
 
+// ********************************
+// Latency measurement
+// ********************************
+
+/**
+* Time from sensor exposure to the gaze sample of the frame being available.
+*/
+LatencyHistogram gazeLatency;
+
+/**
+* Time from sensor exposure to the tracking results of the frame being drawn.
+*/
+LatencyHistogram displayLatency;
+
+
+// ********************************
+// Frame pacing
+// ********************************
+
+/**
+* Decides which camera frames are converted and tracked, see FrameGovernor.
+*/
+FrameGovernor frameGovernor;
+
+/**
+* Writes raw camera frames to a file for replay, see StartFrameRecording.
+*/
+FrameRecorder frameRecorder;
+
+
+// ********************************
+// Tracking resolution
+// ********************************
+
+/**
+* Smallest face, in pixels of the tracked frame, that automatic scaling keeps.
+*/
+const float MIN_TRACKED_FACE_SCALE = 120.0f;
+
+/**
+* Frames without a tracked face after which automatic scaling returns to full resolution.
+*/
+const int SCALE_RESET_FRAMES = 30;
+
+int framesWithoutFace = 0;
+
+/**
+* Tracker time per downscale factor (1, 2, 4), accumulated for the periodic report.
+*/
+long long trackTimeNs[3] = {0, 0, 0};
+int trackTimeFrames[3] = {0, 0, 0};
+float averageTrackTime[3] = {0.0f, 0.0f, 0.0f};
+const int TRACK_TIME_REPORT_FRAMES = 300;
+
+
 // ********************************
 // JNI variables
 // ********************************
@@ -129,6 +272,18 @@ JNIEnv *_env;
 jobject _obj;
 const char *_path;
 
+// Classes, methods and fields used from native code, looked up once in JNI_OnLoad
+static jclass gazeDataClass = 0;
+static jmethodID gazeDataConstructor = 0;
+static jclass mainActivityClass = 0;
+static jmethodID alertDialogMethod = 0;
+static jfieldID wrapperContextField = 0;
+
+// Per-frame results shared with Java, written with guardFrame_mutex held
+static SharedResults sharedResults;
+// Direct ByteBuffer over sharedResults, created once in JNI_OnLoad
+static jobject sharedResultsBuffer = 0;
+
 
 //*******************************************
 //*   Variables used for visage Analyser    *
@@ -137,9 +292,10 @@ const char *_path;
 const int NUM_EMOTIONS = 7;
 int currentFace = 0;
 
-std::array<float, MAX_FACES> age;
-std::array<int, MAX_FACES> gender;
-std::array<std::array<float, NUM_EMOTIONS>, MAX_FACES> emotions;
+/**
+* Runs m_Analyser on its own thread and publishes age, gender and emotions per face, see FaceAnalysisWorker.
+*/
+FaceAnalysisWorker faceAnalysisWorker;
 
 bool ageActivated = false;
 bool genderActivated = false;
@@ -151,18 +307,16 @@ bool emotionsActivated = false;
 //**************************************************************************
 
 
-bool CalculateBoundingBox(int width, int height, FaceData *trackingData, VsRect *boundingBox,
+bool CalculateBoundingBox(int width, int height, const FaceSnapshot *face, VsRect *boundingBox,
                           bool flipY = false);
 
-int SelectFaceForAnalyser();
-int UserSelectedFace();
+int SelectFaceForAnalyser(const FaceSnapshot *faces);
+int UserSelectedFace(const FaceSnapshot *faces);
 static float FPDistance(const VsPoint *fp1, const VsPoint *fp2);
 static bool
-GetFeaturePoint(VsPoint &point, FaceData *trackingData, int group, int index, int width, int height,
+GetFeaturePoint(VsPoint &point, const FaceSnapshot *face, int fp, int width, int height,
                 bool flipY = false);
 
-int *CountFaces();
-
 int tapPositionX;
 int tapPositionY;
 
@@ -180,8 +334,6 @@ int numTrackedFaces = 0;
 
 long durationTimeAnim = 1500;
 long startTimeAnim;
-bool animationEnabled[MAX_FACES] = {false};
-VsRect *face;
 
 void
 AnimateWireframe(FaceData *faceData, int index, float alphaMin, float alphaMax, int glw, int glh);
@@ -198,76 +350,273 @@ void ResetWireframeAnimation(int index);
  * Alerts the user that the license is not valid
  */
 void AlertCallback(const char *warningMessage) {
-    jclass dataClass = _env->FindClass("com/dsd/kosjenka/presentation/MainActivity");
-    if (_env->ExceptionCheck())
-        _env->ExceptionClear();
-    if (dataClass != NULL) {
-        jclass javaClassRef = (jclass) _env->NewGlobalRef(dataClass);
-        jmethodID javaMethodRef = _env->GetMethodID(javaClassRef, "AlertDialogFunction",
-                                                    "(Ljava/lang/String;)V");
-        if (_env->ExceptionCheck())
-            _env->ExceptionClear();
+    if (alertDialogMethod != 0) {
         jstring message = _env->NewStringUTF(warningMessage);
-        if (javaMethodRef != 0)
-            _env->CallVoidMethod(_obj, javaMethodRef, message);
-
-        _env->DeleteGlobalRef(javaClassRef);
+        _env->CallVoidMethod(_obj, alertDialogMethod, message);
         _env->DeleteLocalRef(message);
     }
 }
 
+/**
+ * Looks up a class and keeps a global reference to it, clears the exception if it does not exist
+ */
+static jclass FindClassGlobal(JNIEnv *env, const char *name) {
+    jclass cls = env->FindClass(name);
+    if (env->ExceptionCheck() || cls == NULL) {
+        env->ExceptionClear();
+        LOGE("Class %s not found", name);
+        return 0;
+    }
+    jclass global = (jclass) env->NewGlobalRef(cls);
+    env->DeleteLocalRef(cls);
+    return global;
+}
+
+/**
+ * Looks up a method, clears the exception if it does not exist
+ */
+static jmethodID GetMethodIDChecked(JNIEnv *env, jclass cls, const char *name, const char *signature) {
+    if (cls == 0)
+        return 0;
+    jmethodID method = env->GetMethodID(cls, name, signature);
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        LOGE("Method %s%s not found", name, signature);
+        return 0;
+    }
+    return method;
+}
+
+
+static int ScaleIndex(int scale) {
+    return (scale >= 4) ? 2 : scale - 1;
+}
+
+/**
+ * Returns the frames of all preview slots to the image pool.
+ * Must be called with guardFrame_mutex and displayRes_mutex locked.
+ */
+static void ReleaseFrameBuffers() {
+    ImagePool &pool = ImagePool::Shared();
+    for (int i = 0; i < TripleBuffer<PreviewFrame>::SLOT_COUNT; i++) {
+        PreviewFrame &frame = previewFrames.GetSlot(i);
+        pool.Release(&frame.luma);
+        pool.Release(&frame.chroma);
+        pool.Release(&frame.rgb);
+        frame.yuv = false;
+    }
+}
+
+/**
+ * (Re)creates the preview frames for the current camera parameters.
+ * The preview keeps the camera resolution at any tracking scale, so a scale change does not touch these frames.
+ * Must be called with guardFrame_mutex and displayRes_mutex locked.
+ */
+static void AllocateFrameBuffers() {
+    int width, height;
+    YuvConverter::OrientedSize(camWidth, camHeight, camOrientation, width, height);
+
+    //Return the previous buffers to the pool, after a rotation the same memory is handed out again
+    ReleaseFrameBuffers();
+    ImagePool &pool = ImagePool::Shared();
+    for (int i = 0; i < TripleBuffer<PreviewFrame>::SLOT_COUNT; i++) {
+        PreviewFrame &frame = previewFrames.GetSlot(i);
+        frame.luma = pool.Acquire(width, height, 1);
+        frame.chroma = pool.Acquire(width / 2, height / 2, 2);
+        frame.rgb = pool.Acquire(width, height, 3);
+    }
+
+    //Nothing has been converted into the new frames yet
+    previewFrames.Reset();
+}
+
+/**
+ * Reallocates the frames of a preview slot that do not have the size of the captured frame, e.g. for a still image
+ * written with WriteFrameImage, whose size is independent of the camera parameters.
+ * Must be called by the tracking thread on the back slot with guardFrame_mutex locked.
+ */
+static void FitPreviewFrame(PreviewFrame &frame, int width, int height) {
+    if (frame.rgb && frame.rgb->width == width && frame.rgb->height == height)
+        return;
+
+    ImagePool &pool = ImagePool::Shared();
+    pool.Release(&frame.luma);
+    pool.Release(&frame.chroma);
+    pool.Release(&frame.rgb);
+    frame.luma = pool.Acquire(width, height, 1);
+    frame.chroma = pool.Acquire(width / 2, height / 2, 2);
+    frame.rgb = pool.Acquire(width, height, 3);
+}
+
+/**
+ * Publishes empty tracking results, e.g. after the tracker or the frame parameters were reset.
+ * Must be called with guardFrame_mutex and displayRes_mutex locked.
+ */
+static void ClearTrackingResults() {
+    TrackingResults &results = trackingResults.Back();
+    results.status.assign(results.status.size(), TRACK_STAT_OFF);
+    results.trackedCount = 0;
+    results.timestamp = 0;
+    trackingResults.Publish();
+
+    gazeAvailable = false;
+
+    SharedFrameResults shared = sharedResults.GetLast();
+    shared.trackedFaces = 0;
+    shared.timestamp = 0;
+    shared.gazeAvailable = 0;
+    shared.trackingQuality = -1.0f;
+    for (int i = 0; i < SHARED_RESULTS_FACES; i++)
+        shared.status[i] = TRACK_STAT_OFF;
+    sharedResults.Publish(shared);
+}
+
+/**
+ * Latest analysis results of the face selected for the analyser, -1 for values that are not known
+ * @param emotions - NUM_EMOTIONS probabilities
+ */
+static void GetCurrentAnalysis(float &age, int &gender, float *emotions) {
+    FaceAnalysisResult result;
+    faceAnalysisWorker.GetResult(currentFace, result);
+
+    age = (result.age < 0 || currentFace == -1) ? -1.0f : result.age;
+    gender = (result.gender < 0 || currentFace == -1) ? -1 : result.gender;
+
+    bool emotionsKnown = currentFace != -1 &&
+                         !std::all_of(result.emotions, result.emotions + NUM_EMOTIONS, [](float em) { return em < 0.01; });
+    for (int i = 0; i < NUM_EMOTIONS; i++)
+        emotions[i] = emotionsKnown ? result.emotions[i] : -1.0f;
+}
+
+/**
+ * Publishes the results of a tracked frame to the buffer shared with Java.
+ * Must be called on the tracking thread with guardFrame_mutex locked, after the face for the analyser was selected.
+ * @param gazeFace - face whose gaze is exported, -1 to keep the previous gaze sample
+ */
+static void PublishSharedResults(const TrackingResults &results, int gazeFace, long long frameTimestamp) {
+    SharedFrameResults shared = sharedResults.GetLast();
+
+    shared.trackedFaces = faceStore.GetTrackedCount();
+    shared.timestamp = results.timestamp;
+    for (int i = 0; i < SHARED_RESULTS_FACES; i++)
+        shared.status[i] = (int8_t) ((i < faceStore.GetCapacity()) ? faceStore.GetStatus(i) : TRACK_STAT_OFF);
+
+    if (gazeFace != -1) {
+        const FaceSnapshotGaze &gaze = results.faces[gazeFace].gaze;
+        shared.gazeTimestamp = frameTimestamp;
+        shared.gazeAvailable = 1;
+        shared.gazeIndex = gaze.index;
+        shared.gazeX = gaze.x;
+        shared.gazeY = gaze.y;
+        shared.gazeInState = gaze.inState;
+        shared.gazeQuality = gaze.quality;
+    }
+
+    int qualityFace = (currentFace != -1 && faceStore.GetStatus(currentFace) == TRACK_STAT_OK) ? currentFace
+                    : (faceStore.GetTrackedCount() > 0) ? faceStore.GetTracked(0) : -1;
+    shared.trackingQuality = (qualityFace != -1) ? results.faces[qualityFace].trackingQuality : -1.0f;
+
+    shared.currentFace = currentFace;
+    GetCurrentAnalysis(shared.age, shared.gender, shared.emotions);
+
+    sharedResults.Publish(shared);
+}
+
+/**
+ * Sizes the per-face state and the results slots for the given number of faces.
+ * Only while the tracker does not exist, so that neither the tracking nor the rendering thread uses them.
+ */
+static void SetFaceCapacity(int capacity) {
+    faceStore.SetCapacity(capacity);
+    capacity = faceStore.GetCapacity();
+    for (int i = 0; i < TripleBuffer<TrackingResults>::SLOT_COUNT; i++) {
+        TrackingResults &results = trackingResults.GetSlot(i);
+        results.faces.resize(capacity);
+        results.status.assign(capacity, TRACK_STAT_OFF);
+        std::vector<FaceData>(capacity).swap(results.faceData);
+        results.tracked.assign(capacity, 0);
+        results.trackedCount = 0;
+        results.timestamp = 0;
+    }
+    trackingResults.Reset();
+    LOGI("Face capacity %d", capacity);
+}
+
+/**
+ * Chooses the tracking downscale factor from the size of the tracked faces.
+ *
+ * Picks the largest factor at which the smallest tracked face is still at least MIN_TRACKED_FACE_SCALE pixels, with
+ * hysteresis when going to a smaller frame. Falls back to full resolution when no face has been found for a while, so
+ * that faces further away can be detected.
+ */
+static int SelectTrackingScale(const FaceStore &faces) {
+    if (trackingScaleSetting != 0)
+        return YuvConverter::IsScaleSupported(camWidth, camHeight, trackingScaleSetting) ? trackingScaleSetting : 1;
+
+    float smallestFace = -1.0f;
+    for (int n = 0; n < faces.GetTrackedCount(); n++) {
+        //faceScale is in pixels of the tracked frame
+        float faceScale = faces.GetFaceData(faces.GetTracked(n)).faceScale * trackingScale;
+        if (smallestFace < 0 || faceScale < smallestFace)
+            smallestFace = faceScale;
+    }
+
+    if (smallestFace < 0) {
+        return (++framesWithoutFace >= SCALE_RESET_FRAMES) ? 1 : trackingScale;
+    }
+    framesWithoutFace = 0;
+
+    const int scales[] = {4, 2, 1};
+    for (int i = 0; i < 3; i++) {
+        int scale = scales[i];
+        float required = (scale > trackingScale) ? 1.5f * MIN_TRACKED_FACE_SCALE : MIN_TRACKED_FACE_SCALE;
+        if (scale == 1 || (smallestFace / scale >= required && YuvConverter::IsScaleSupported(camWidth, camHeight, scale)))
+            return scale;
+    }
+    return 1;
+}
 
 /**
- * Simple timer function
+ * Simple timer function, milliseconds on the monotonic clock
  */
-long getTimeNsec() {
-    struct timespec now;
-    clock_gettime(CLOCK_REALTIME, &now);
-    return (long) ((now.tv_sec * 1000000000LL + now.tv_nsec) / 1000000LL);
+long getTimeMsec() {
+    return (long) (MonotonicNsec() / 1000000LL);
 }
 
 void ResetAnalyser(int index) {
-    age[index] = -1.0;
-    gender[index] = -1;
-    std::fill(emotions[index].begin(), emotions[index].end(), 0.0f);
-    if (m_Analyser) m_Analyser->resetStreamAnalysis(index);
+    faceAnalysisWorker.Reset(index);
 }
 
-bool AnalyseFace(VsImage *trackImage, int index) {
+/**
+ * Hands the face over to the analysis worker, results become available through faceAnalysisWorker.GetResult
+ */
+bool AnalyseFace(VsImage *trackImage, int index, long long frameId) {
 
-    if (trackingStatusBuffer[index] != TRACK_STAT_OK) {
+    if (faceStore.GetStatus(index) != TRACK_STAT_OK) {
         ResetAnalyser(index);
         return false;
     }
 
-    AnalysisData analysisData;
+    int analyserOptions = 0;
 
-    if (ageActivated) {
+    if (ageActivated)
         analyserOptions |= VFA_AGE;
-    } else {
-        analyserOptions &= ~VFA_AGE;
-    }
 
-    if (genderActivated) {
+    if (genderActivated)
         analyserOptions |= VFA_GENDER;
-    } else {
-        analyserOptions &= ~VFA_GENDER;
-    }
 
-    if (emotionsActivated) {
+    if (emotionsActivated)
         analyserOptions |= VFA_EMOTION;
+
+    //The analyser gets the frame at camera resolution, faceScale is in pixels of the tracked frame
+    const FaceData &faceData = faceStore.GetFaceData(index);
+    if (trackingScale == 1) {
+        faceAnalysisWorker.Submit(trackImage, faceData, index, analyserOptions, frameId);
     } else {
-        analyserOptions &= ~VFA_EMOTION;
+        FaceData scaled = faceData;
+        scaled.faceScale *= trackingScale;
+        faceAnalysisWorker.Submit(trackImage, scaled, index, analyserOptions, frameId);
     }
-
-    m_Analyser->analyseStream(trackImage, trackingDataBuffer[index], analyserOptions, analysisData, index);
-
-    if ((ageActivated && !analysisData.ageValid) || (genderActivated && !analysisData.genderValid) || (emotionsActivated && !analysisData.emotionsValid))
-        return false;
-
-    age[index] = analysisData.age;
-    gender[index] = analysisData.gender;
-    emotions[index] = analysisData.emotionProbabilities;
     return true;
 }
 
@@ -280,6 +629,46 @@ static bool endsWith(const std::string &str, const std::string &suffix) {
 // Wrapper function
 // ********************************
 
+/**
+ * Caches the classes, methods and fields used from native code and creates the shared results buffer
+ *
+ * Called once when the library is loaded from MainActivity, so application classes can be found here but not from native threads.
+ */
+jint JNI_OnLoad(JavaVM *vm, void *reserved) {
+    JNIEnv *env;
+    if (vm->GetEnv((void **) &env, JNI_VERSION_1_6) != JNI_OK)
+        return JNI_ERR;
+
+    gazeDataClass = FindClassGlobal(env, "com/dsd/kosjenka/presentation/home/VisageWrapper$ScreenSpaceGazeData");
+    gazeDataConstructor = GetMethodIDChecked(env, gazeDataClass, "<init>", "(IFFIFJ)V");
+
+    mainActivityClass = FindClassGlobal(env, "com/dsd/kosjenka/presentation/MainActivity");
+    alertDialogMethod = GetMethodIDChecked(env, mainActivityClass, "AlertDialogFunction", "(Ljava/lang/String;)V");
+
+    jclass wrapperClass = env->FindClass("com/dsd/kosjenka/presentation/home/VisageWrapper");
+    if (wrapperClass == NULL)
+        return JNI_ERR;
+    wrapperContextField = env->GetFieldID(wrapperClass, "ctx", "Landroid/content/Context;");
+    env->DeleteLocalRef(wrapperClass);
+    if (wrapperContextField == 0)
+        return JNI_ERR;
+
+    jobject buffer = env->NewDirectByteBuffer(sharedResults.GetAddress(), (jlong) SharedResults::GetSize());
+    sharedResultsBuffer = env->NewGlobalRef(buffer);
+    env->DeleteLocalRef(buffer);
+
+    return JNI_VERSION_1_6;
+}
+
+/**
+ * Returns the direct ByteBuffer holding the per-frame results shared with Java
+ *
+ * The same buffer is returned on every call, VisageWrapper.FrameResults reads it without JNI calls or allocations.
+ */
+jobject Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetFrameResultsBuffer(JNIEnv *env, jclass obj) {
+    return sharedResultsBuffer;
+}
+
 
 /**
  * Method for initializing the tracker.
@@ -294,10 +683,7 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_TrackerInit(JNIEnv *e
 
     _env = env;
 
-    jclass VisageWrapperClass = env->GetObjectClass(instance);
-
-    jfieldID fidCtx = env->GetFieldID(VisageWrapperClass, "ctx", "Landroid/content/Context;");
-    jobject ctxObject = env->GetObjectField(instance, fidCtx);
+    jobject ctxObject = env->GetObjectField(instance, wrapperContextField);
 
     _obj = ctxObject;
 
@@ -315,13 +701,12 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_TrackerInit(JNIEnv *e
     if (m_Tracker) {
         LOGI("m_tracker already initialised");
     } else {
+        //Per-face state is sized before the tracker exists, so neither the tracking nor the rendering thread uses it
+        SetFaceCapacity(maxFacesSetting);
         m_Tracker = new VisageSDK::VisageGazeTracker(
                 (std::string(_path) + "/" + std::string(_configFilename)).c_str());
     }
 
-    trackerStopped = false;
-    trackerPaused = true;
-
     //Set up mutex for track->render thread synchronization
     pthread_mutex_destroy(&displayRes_mutex);
     pthread_mutex_init(&displayRes_mutex, NULL);
@@ -330,16 +715,14 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_TrackerInit(JNIEnv *e
     pthread_mutex_destroy(&guardFrame_mutex);
     pthread_mutex_init(&guardFrame_mutex, NULL);
 
-    //Delete previously allocated objects
+    //Delete previously allocated objects, tracking waits until the camera thread creates a new capture
+    trackerControl.DetachCapture();
     delete androidCapture;
     androidCapture = 0;
+    trackerControl.Initialize();
 
     LOGI("Configuration file %s", _configFilename);
 
-    if(!face){
-        face = new VsRect[MAX_FACES];
-    }
-
     env->ReleaseStringUTFChars(configFilename, _configFilename);
 }
 
@@ -347,7 +730,7 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_TrackerInit(JNIEnv *e
  * Method that sets frame parameters
  *
  * Called initially before tracking starts and every time orientation changes. Creates buffer of
- * correct sizes and sets orientationChanged to true
+ * correct sizes and pauses tracking until the camera thread has created a capture for them
  *
  * @param width - width of the received frame
  * @param height - height of the received frame
@@ -366,43 +749,33 @@ Java_com_dsd_kosjenka_presentation_home_VisageWrapper_SetParameters(JNIEnv *env,
     camHeight = height;
     camWidth = width;
     camFlip = flip;
-    //Dispose of the previous drawImageBuffer
-    if (!drawImageBuffer) {
-        vsReleaseImage(&drawImageBuffer);
-        drawImageBuffer = 0;
-    }
 
-    //Depending on the camera orientation (landscape or portrait), create a drawImageBuffer buffer for storing pixels that will be used in the tracking thread
-    if (camOrientation == 90 || camOrientation == 270)
-        drawImageBuffer = vsCreateImage(vsSize(height, width), VS_DEPTH_8U, 3);
-    else
-        drawImageBuffer = vsCreateImage(vsSize(width, height), VS_DEPTH_8U, 3);
-
-    //Dispose of the previous drawImage
-    vsReleaseImage(&renderImage);
-    renderImage = 0;
+    //Start at full resolution for detection unless a fixed tracking scale was requested
+    trackingScale = (trackingScaleSetting != 0 && YuvConverter::IsScaleSupported(width, height, trackingScaleSetting)) ? trackingScaleSetting : 1;
+    framesWithoutFace = 0;
 
-    //Create a renderImage buffer based on the drawImageBuffer which will be used in the rendering thread
-    //NOTE: Copying imageData between track and draw buffers is protected with mutexes
-    renderImage = vsCloneImage(drawImageBuffer);
+    //Depending on the camera orientation (landscape or portrait), create the frame buffers
+    AllocateFrameBuffers();
 
-    orientationChanged = true;
     trackingOk = false;
-    trackerStopped = false;
+    trackingEpoch = -1;
+    frameTimestampBuffer = 0;
+    ClearTrackingResults();
 
-    for (int i = 0; i < MAX_FACES; i++) {
-        trackingStatusRender[i] = TRACK_STAT_OFF;
-        trackingStatusBuffer[i] = TRACK_STAT_OFF;
+    for (int i = 0; i < faceStore.GetCapacity(); i++) {
         ResetWireframeAnimation(i);
     }
 
     pthread_mutex_unlock(&displayRes_mutex);
     pthread_mutex_unlock(&guardFrame_mutex);
 
-    for (int i = 0; i < MAX_FACES; i++) {
+    for (int i = 0; i < faceStore.GetCapacity(); i++) {
         ResetAnalyser(i);
     }
 
+    //Pause tracking until the camera thread has created a capture for the new parameters
+    trackerControl.Reconfigure();
+
     //Reseting m_Tracker object before getting new frame source
     if(m_Tracker){
         m_Tracker->track(0,0,0,0);
@@ -410,6 +783,320 @@ Java_com_dsd_kosjenka_presentation_home_VisageWrapper_SetParameters(JNIEnv *env,
     return 0;
 }
 
+/**
+ * Selects the color matrix used for converting camera frames to RGB
+ *
+ * @param matrix - one of YUV_MATRIX_BT601_FULL (0), YUV_MATRIX_BT601_LIMITED (1), YUV_MATRIX_BT709_FULL (2), YUV_MATRIX_BT709_LIMITED (3)
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_SetColorMatrix(JNIEnv *env, jclass obj,
+                                                                          jint matrix) {
+    pthread_mutex_lock(&guardFrame_mutex);
+    camColorMatrix = (YuvColorMatrix) matrix;
+    if (androidCapture)
+        androidCapture->SetColorMatrix(camColorMatrix);
+    pthread_mutex_unlock(&guardFrame_mutex);
+}
+
+/**
+ * Selects the format of frames passed to the tracker
+ *
+ * Takes effect on the next frame, the capture object is recreated with the new format.
+ * @param format - VISAGE_FRAMEGRABBER_FMT_LUMINANCE (2) to track on the Y plane only, VISAGE_FRAMEGRABBER_FMT_RGB (0) to track on converted RGB frames
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_SetTrackingInputFormat(JNIEnv *env, jclass obj,
+                                                                                  jint format) {
+    pthread_mutex_lock(&guardFrame_mutex);
+    int newFormat = (format == VISAGE_FRAMEGRABBER_FMT_LUMINANCE) ? VISAGE_FRAMEGRABBER_FMT_LUMINANCE
+                                                                  : VISAGE_FRAMEGRABBER_FMT_RGB;
+    if (newFormat != camFormat) {
+        camFormat = newFormat;
+        trackerControl.Reconfigure();
+    }
+    pthread_mutex_unlock(&guardFrame_mutex);
+}
+
+/**
+ * Returns the format of frames passed to the tracker, see SetTrackingInputFormat
+ */
+jint Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetTrackingInputFormat(JNIEnv *env, jclass obj) {
+    return camFormat;
+}
+
+/**
+ * Returns the average camera thread CPU time spent per frame in WriteFrameStream, in milliseconds
+ */
+jfloat Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetCaptureCpuTime(JNIEnv *env, jclass obj) {
+    pthread_mutex_lock(&guardFrame_mutex);
+    float cpuTime = androidCapture ? androidCapture->GetAverageWriteCpuTime() : 0.0f;
+    pthread_mutex_unlock(&guardFrame_mutex);
+    return cpuTime;
+}
+
+/**
+ * Selects the clock the camera sensor timestamps passed to WriteFrameStream are taken on
+ *
+ * @param source - value of CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE, 1 (REALTIME) for CLOCK_BOOTTIME, otherwise CLOCK_MONOTONIC
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_SetSensorTimestampSource(JNIEnv *env, jclass obj,
+                                                                                    jint source) {
+    SetSensorTimestampSource(source == SENSOR_TIMESTAMP_REALTIME ? SENSOR_TIMESTAMP_REALTIME
+                                                                 : SENSOR_TIMESTAMP_UNKNOWN);
+}
+
+/**
+ * Returns the end-to-end latency histogram
+ *
+ * @param stage - 0 for sensor exposure to gaze sample available, 1 for sensor exposure to results drawn
+ * @return counts of latencies in 1 ms buckets, the last bucket also holds all larger latencies
+ */
+jlongArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetLatencyHistogram(JNIEnv *env, jclass obj,
+                                                                                    jint stage) {
+    const LatencyHistogram &histogram = (stage == 1) ? displayLatency : gazeLatency;
+
+    uint64_t buckets[LatencyHistogram::BUCKETS];
+    histogram.GetBuckets(buckets);
+
+    jlong counts[LatencyHistogram::BUCKETS];
+    for (int i = 0; i < LatencyHistogram::BUCKETS; i++)
+        counts[i] = (jlong) buckets[i];
+
+    jlongArray result = env->NewLongArray(LatencyHistogram::BUCKETS);
+    env->SetLongArrayRegion(result, 0, LatencyHistogram::BUCKETS, counts);
+    return result;
+}
+
+/**
+ * Returns end-to-end latency statistics in milliseconds
+ *
+ * @param stage - 0 for sensor exposure to gaze sample available, 1 for sensor exposure to results drawn
+ * @return array of mean, 50th, 90th and 99th percentile and maximal latency
+ */
+jfloatArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetLatencyStats(JNIEnv *env, jclass obj,
+                                                                                 jint stage) {
+    const LatencyHistogram &histogram = (stage == 1) ? displayLatency : gazeLatency;
+
+    jfloat stats[5] = {histogram.GetMean(), histogram.GetPercentile(0.5f), histogram.GetPercentile(0.9f),
+                       histogram.GetPercentile(0.99f), histogram.GetMax()};
+
+    jfloatArray result = env->NewFloatArray(5);
+    env->SetFloatArrayRegion(result, 0, 5, stats);
+    return result;
+}
+
+/**
+ * Selects the resolution frames are tracked at
+ *
+ * Frames are downscaled by area averaging while they are copied from the camera. Takes effect after the next tracked frame,
+ * factors the camera resolution does not divide evenly by fall back to full resolution.
+ * @param scale - 1, 2 or 4 for a fixed downscale factor, 0 to choose it automatically from the size of the tracked faces
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_SetTrackingScale(JNIEnv *env, jclass obj,
+                                                                            jint scale) {
+    pthread_mutex_lock(&guardFrame_mutex);
+    trackingScaleSetting = (scale == 1 || scale == 2 || scale == 4) ? scale : 0;
+    pthread_mutex_unlock(&guardFrame_mutex);
+}
+
+/**
+ * Sets the number of faces tracked at the same time
+ *
+ * Takes effect when TrackerInit creates the tracker, i.e. before the first TrackerInit or after TrackerStop. Per-frame work
+ * only visits the faces that are present, so a larger capacity mainly costs memory.
+ * @param maxFaces - 1 to 16, default 4
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_SetMaxFaces(JNIEnv *env, jclass obj, jint maxFaces) {
+    maxFacesSetting = (maxFaces < 1) ? 1 : (maxFaces > MAX_FACE_CAPACITY) ? MAX_FACE_CAPACITY : maxFaces;
+}
+
+/**
+ * Returns the number of faces the current tracker tracks at the same time
+ */
+jint Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetMaxFaces(JNIEnv *env, jclass obj) {
+    return faceStore.GetCapacity();
+}
+
+/**
+ * Returns the current tracking downscale factor
+ */
+jint Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetTrackingScale(JNIEnv *env, jclass obj) {
+    return trackingScale;
+}
+
+/**
+ * Returns the average tracker time in milliseconds at each downscale factor
+ *
+ * @return array of three elements for factors 1, 2 and 4, 0 where no full measurement period was completed yet
+ */
+jfloatArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetTrackerTimeByScale(JNIEnv *env, jclass obj) {
+    jfloatArray result = env->NewFloatArray(3);
+    env->SetFloatArrayRegion(result, 0, 3, averageTrackTime);
+    return result;
+}
+
+/**
+ * Returns memory accounting of the frame image pool
+ *
+ * @return array of bytes live, bytes pooled, peak bytes, number of allocations and number of reuses
+ */
+jlongArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetImagePoolStats(JNIEnv *env, jclass obj) {
+    ImagePoolStats stats = ImagePool::Shared().GetStats();
+
+    jlong values[5] = {(jlong) stats.bytesLive, (jlong) stats.bytesPooled, (jlong) stats.peakBytes,
+                       (jlong) stats.allocations, (jlong) stats.reuses};
+    jlongArray result = env->NewLongArray(5);
+    env->SetLongArrayRegion(result, 0, 5, values);
+    return result;
+}
+
+/**
+ * Frees frame images kept in the pool for reuse, e.g. when the system is low on memory
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_TrimImagePool(JNIEnv *env, jclass obj) {
+    ImagePool::Shared().Trim();
+}
+
+/**
+ * Enables or disables frame pacing
+ *
+ * When enabled, camera frames are only converted as often as the tracker can take them.
+ * @param enabled - true to pace frames, false to convert every camera frame
+ * @param maxDelayMs - longest time a camera frame may be held back, limits the added gaze latency
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_SetFramePacing(JNIEnv *env, jclass obj,
+                                                                          jboolean enabled, jint maxDelayMs) {
+    frameGovernor.SetEnabled(enabled);
+    if (maxDelayMs > 0)
+        frameGovernor.SetMaxFrameDelay(maxDelayMs * 1000000LL);
+}
+
+/**
+ * Returns capture settings the pipeline can sustain
+ *
+ * @return array of recommended frame rate (0 if not known yet), width and height of the camera frames
+ */
+jintArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetCaptureRecommendation(JNIEnv *env, jclass obj) {
+    CaptureRecommendation recommendation = frameGovernor.GetRecommendation();
+
+    jint values[3] = {recommendation.fps, camWidth / recommendation.resolutionDivisor,
+                      camHeight / recommendation.resolutionDivisor};
+    jintArray result = env->NewIntArray(3);
+    env->SetIntArrayRegion(result, 0, 3, values);
+    return result;
+}
+
+/**
+ * Returns frame pacing statistics
+ *
+ * @return array of average camera frame interval, conversion time, tracking time, tracking thread busy and wait time
+ * (all in milliseconds), the pacing multiplier and the number of admitted and skipped frames
+ */
+jfloatArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetFramePacingStats(JNIEnv *env, jclass obj) {
+    jfloat values[8];
+    frameGovernor.GetAverages(values[0], values[1], values[2], values[3], values[4]);
+    values[5] = frameGovernor.GetPacing();
+    values[6] = (jfloat) frameGovernor.GetAdmittedFrames();
+    values[7] = (jfloat) frameGovernor.GetSkippedFrames();
+
+    jfloatArray result = env->NewFloatArray(8);
+    env->SetFloatArrayRegion(result, 0, 8, values);
+    return result;
+}
+
+/**
+ * Starts writing raw camera frames to a file
+ *
+ * Frames are recorded with their strides, orientation and sensor timestamps so that a session can be replayed
+ * off-device. Recording never blocks the camera, frames that cannot be written in time are dropped and counted.
+ * @param path - file to write, replaced if it exists
+ * @param bufferFrames - number of frames that may wait to be written
+ * @return true if recording started
+ */
+jboolean Java_com_dsd_kosjenka_presentation_home_VisageWrapper_StartFrameRecording(JNIEnv *env, jclass obj,
+                                                                                  jstring path, jint bufferFrames) {
+    const char *filePath = env->GetStringUTFChars(path, 0);
+    bool started = frameRecorder.Start(filePath, bufferFrames);
+    env->ReleaseStringUTFChars(path, filePath);
+    return started;
+}
+
+/**
+ * Writes out the frames still waiting and closes the recording
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_StopFrameRecording(JNIEnv *env, jclass obj) {
+    frameRecorder.Stop();
+}
+
+/**
+ * Returns counters of the current or last recording
+ *
+ * @return array of three elements: frames recorded, frames dropped and bytes written
+ */
+jlongArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetFrameRecordingStats(JNIEnv *env, jclass obj) {
+    FrameRecorderStats stats = frameRecorder.GetStats();
+
+    jlong values[3] = {(jlong) stats.recorded, (jlong) stats.dropped, (jlong) stats.bytesWritten};
+    jlongArray result = env->NewLongArray(3);
+    env->SetLongArrayRegion(result, 0, 3, values);
+    return result;
+}
+
+/**
+ * Returns state and CPU counters of the tracking thread
+ *
+ * @return array of six elements: tracker state (0 uninitialized, 1 paused, 2 running, 3 stopped), wakeups while idle,
+ * wall time and CPU time spent idle in nanoseconds, CPU time spent tracking in nanoseconds and the latency of the
+ * last resume in nanoseconds
+ */
+jlongArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetTrackLoopStats(JNIEnv *env, jclass obj) {
+    TrackerControlStats stats = trackerControl.GetStats();
+
+    jlong values[6] = {(jlong) stats.state, (jlong) stats.idleWakeups, (jlong) stats.idleWallNs,
+                       (jlong) stats.idleCpuNs, (jlong) stats.busyCpuNs, (jlong) stats.resumeLatencyNs};
+    jlongArray result = env->NewLongArray(6);
+    env->SetLongArrayRegion(result, 0, 6, values);
+    return result;
+}
+
+/**
+ * Sets the minimal time between two frames analysed for age, gender and emotions
+ *
+ * @param intervalMs - interval in milliseconds, 0 analyses frames as fast as the analysis thread can
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_SetFaceAnalysisInterval(JNIEnv *env, jclass obj,
+                                                                                   jint intervalMs) {
+    faceAnalysisWorker.SetInterval(intervalMs < 0 ? 0 : intervalMs);
+}
+
+/**
+ * Returns counters of the face analysis thread
+ *
+ * @return array of two elements: number of analysed frames and the average analysis time in milliseconds
+ */
+jfloatArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetFaceAnalysisStats(JNIEnv *env, jclass obj) {
+    jfloat values[2] = {(jfloat) faceAnalysisWorker.GetAnalysedFrames(), faceAnalysisWorker.GetAverageAnalysisTime()};
+    jfloatArray result = env->NewFloatArray(2);
+    env->SetFloatArrayRegion(result, 0, 2, values);
+    return result;
+}
+
+/**
+ * Returns camera frame counters of the current capture
+ *
+ * @return array of three elements: frames produced by the camera, frames consumed by the tracker and frames dropped in between
+ */
+jlongArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetFrameCounters(JNIEnv *env, jclass obj) {
+    FrameRingStats stats = {0, 0, 0};
+    pthread_mutex_lock(&guardFrame_mutex);
+    if (androidCapture)
+        stats = androidCapture->GetFrameStats();
+    pthread_mutex_unlock(&guardFrame_mutex);
+
+    jlong counters[3] = {(jlong) stats.produced, (jlong) stats.consumed, (jlong) stats.dropped};
+    jlongArray result = env->NewLongArray(3);
+    env->SetLongArrayRegion(result, 0, 3, counters);
+    return result;
+}
+
 void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_InitOnlineGazeCalibration(JNIEnv *env,
                                                                             jobject obj) {
     if (!m_Tracker)
@@ -440,117 +1127,415 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_FinalizeOnlineGazeCal
 jobject
 Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetScreenSpaceGazeData(JNIEnv *env,
                                                                                     jobject obj) {
-    if (m_Tracker && !trackerStopped && !trackerPaused){
+    if (m_Tracker && !trackerControl.IsPaused() && gazeDataConstructor != 0){
 
         pthread_mutex_lock(&displayRes_mutex);
 
-        ScreenSpaceGazeData data = trackingDataBuffer->gazeData;
+        if (!gazeAvailable) {
+            pthread_mutex_unlock(&displayRes_mutex);
+            return nullptr;
+        }
 
-        // get a reference to your class if you don't have it already
-        jclass cls = env->FindClass("com/dsd/kosjenka/presentation/home/VisageWrapper$ScreenSpaceGazeData");
-        // get a reference to the constructor; the name is <init>
-        jmethodID constructor = env->GetMethodID(cls, "<init>", "(IFFIF)V");
+        FaceSnapshotGaze data = gazeDataBuffer;
 
-        jvalue args[5];
+        jvalue args[6];
 
-//        LOGI("isTracking %d", isTracking);
-        for (int i = 0; i < MAX_FACES; i++) {
-            if (trackingStatusBuffer[i] == TRACK_STAT_OFF){
-                continue;
-            }
-//            LOGI("found face data");
-            // set up the arguments
-            args[0].i = data.index;
-            args[1].f = data.x;
-            args[2].f = data.y;
-            args[3].i = data.inState;
-            args[4].f = data.quality;
-        }
+        // set up the arguments
+        args[0].i = data.index;
+        args[1].f = data.x;
+        args[2].f = data.y;
+        args[3].i = data.inState;
+        args[4].f = data.quality;
+        args[5].j = gazeTimestampBuffer;
         pthread_mutex_unlock(&displayRes_mutex);
 
-        jobject gazeObject = env->NewObjectA(cls, constructor, args);
+        //class and constructor are cached in JNI_OnLoad, readers polling every frame should use FrameResults instead
+        jobject gazeObject = env->NewObjectA(gazeDataClass, gazeDataConstructor, args);
 
         return gazeObject;
     }
     return nullptr;
 }
 
+/**
+ * Returns the pipeline metrics since the last ResetPipelineMetrics
+ *
+ * @return array of 1 + 7 * STAGE_COUNT + COUNTER_COUNT elements: the covered time in nanoseconds, then for every stage
+ * its run count, mean, 50th, 90th, 99th percentile and maximal duration and mean CPU time in nanoseconds, then the counters.
+ * Stage and counter order is given by PipelineStage and PipelineCounter in PipelineMetrics.h.
+ */
+jlongArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetPipelineMetrics(JNIEnv *env, jclass obj) {
+    PipelineMetricsSnapshot snapshot;
+    PipelineMetrics::Shared().GetSnapshot(snapshot);
+
+    const int size = 1 + 7 * STAGE_COUNT + COUNTER_COUNT;
+    jlong values[size];
+    int n = 0;
+    values[n++] = snapshot.elapsedNs;
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const PipelineStageStats &stats = snapshot.stages[s];
+        values[n++] = (jlong) stats.count;
+        values[n++] = stats.meanNs;
+        values[n++] = stats.p50Ns;
+        values[n++] = stats.p90Ns;
+        values[n++] = stats.p99Ns;
+        values[n++] = stats.maxNs;
+        values[n++] = stats.meanCpuNs;
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++)
+        values[n++] = (jlong) snapshot.counters[c];
+
+    jlongArray result = env->NewLongArray(size);
+    env->SetLongArrayRegion(result, 0, size, values);
+    return result;
+}
+
+/**
+ * Returns the pipeline metrics as a text table and writes it to the log
+ */
+jstring Java_com_dsd_kosjenka_presentation_home_VisageWrapper_DumpPipelineMetrics(JNIEnv *env, jclass obj) {
+    std::string text = PipelineMetrics::Shared().Dump();
+    LOGI("%s", text.c_str());
+    return env->NewStringUTF(text.c_str());
+}
+
+/**
+ * Starts a new measurement period for the pipeline metrics, e.g. before a benchmark run
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_ResetPipelineMetrics(JNIEnv *env, jclass obj) {
+    PipelineMetrics::Shared().Reset();
+}
+
+/**
+ * Starts sampling the CPU time of every thread of the process, see ThreadCpuMonitor.h
+ *
+ * The camera, tracking, analysis and rendering threads are told apart from the tracker's OpenMP workers and the
+ * remaining threads, so CPU time can be compared with wall time per kind of thread and per interval.
+ *
+ * @param intervalMs sampling interval in milliseconds, 1000 for per-second figures
+ * @return false if the sampling thread could not be started
+ */
+jboolean Java_com_dsd_kosjenka_presentation_home_VisageWrapper_StartThreadCpuMonitor(JNIEnv *env, jclass obj,
+                                                                                   jint intervalMs) {
+    return ThreadCpuMonitor::Shared().Start(intervalMs);
+}
+
+/**
+ * Stops sampling thread CPU time, the collected intervals stay available
+ */
+void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_StopThreadCpuMonitor(JNIEnv *env, jclass obj) {
+    ThreadCpuMonitor::Shared().Stop();
+}
+
+/**
+ * Returns the sampled intervals, oldest first
+ *
+ * @return array of 2 + THREAD_KIND_COUNT elements per interval: its start (MonotonicNsec) and length in nanoseconds,
+ * then the CPU time in nanoseconds of the camera, tracking, tracker worker, analysis, rendering and other threads
+ * in the order of PipelineThread in ThreadCpuMonitor.h
+ */
+jlongArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetThreadCpuHistory(JNIEnv *env, jclass obj) {
+    std::vector<ThreadCpuInterval> intervals = ThreadCpuMonitor::Shared().GetHistory();
+
+    const int stride = 2 + THREAD_KIND_COUNT;
+    std::vector<jlong> values(intervals.size() * stride);
+    for (size_t i = 0; i < intervals.size(); i++) {
+        values[i * stride] = intervals[i].startNs;
+        values[i * stride + 1] = intervals[i].wallNs;
+        for (int k = 0; k < THREAD_KIND_COUNT; k++)
+            values[i * stride + 2 + k] = intervals[i].cpuNs[k];
+    }
+
+    jlongArray result = env->NewLongArray((jsize) values.size());
+    if (!values.empty())
+        env->SetLongArrayRegion(result, 0, (jsize) values.size(), values.data());
+    return result;
+}
+
+/**
+ * Returns thread CPU time against wall time as a text table and writes it to the log
+ */
+jstring Java_com_dsd_kosjenka_presentation_home_VisageWrapper_DumpThreadCpu(JNIEnv *env, jclass obj) {
+    std::string text = ThreadCpuMonitor::Shared().Dump();
+    LOGI("%s", text.c_str());
+    return env->NewStringUTF(text.c_str());
+}
+
+/**
+ * Starts or stops recording the pipeline trace
+ *
+ * Spans of the camera, tracking, analysis and rendering threads are kept in per-thread rings holding the last few
+ * thousand spans each, tagged with the frameID passed to WriteFrameStream. Recording while enabled costs a few stores
+ * per span, while disabled a single branch.
+ *
+ * @param enabled true to record spans, false to stop; recorded spans are kept for WritePipelineTrace
+ * @return false if the library was built without PIPELINE_TRACING
+ */
+jboolean Java_com_dsd_kosjenka_presentation_home_VisageWrapper_SetPipelineTracing(JNIEnv *env, jclass obj,
+                                                                                jboolean enabled) {
+    if (enabled)
+        PipelineTrace::Shared().Clear();
+    return PipelineTrace::SetEnabled(enabled);
+}
+
+/**
+ * Writes the recorded pipeline trace as Chrome trace-event JSON, to be opened in Perfetto or chrome://tracing
+ *
+ * @param path file to write, e.g. in the app's files or cache directory
+ * @return false if the file could not be written
+ */
+jboolean Java_com_dsd_kosjenka_presentation_home_VisageWrapper_WritePipelineTrace(JNIEnv *env, jclass obj,
+                                                                                jstring path) {
+    const char *filePath = env->GetStringUTFChars(path, 0);
+    bool written = PipelineTrace::Shared().WriteJson(filePath);
+    if (written)
+        LOGI("Pipeline trace written to %s", filePath);
+    else
+        LOGE("Could not write pipeline trace to %s", filePath);
+    env->ReleaseStringUTFChars(path, filePath);
+    return written;
+}
+
+/**
+ * Moves all gaze samples produced since the last call into the given buffer
+ *
+ * Every face that is not TRACK_STAT_OFF produces one sample per tracked frame. Samples are 32 bytes in native byte order,
+ * see VisageWrapper.GazeSamples for the layout. Samples that do not fit stay queued for the next call.
+ * @param samples - direct ByteBuffer receiving the samples, oldest first
+ * @return number of samples written, -1 if the buffer is not a direct buffer
+ */
+jint Java_com_dsd_kosjenka_presentation_home_VisageWrapper_DrainGazeSamples(JNIEnv *env, jclass obj, jobject samples) {
+    GazeSample *out = (GazeSample *) env->GetDirectBufferAddress(samples);
+    jlong capacity = env->GetDirectBufferCapacity(samples);
+    if (!out || capacity < 0)
+        return -1;
+
+    pthread_mutex_lock(&gazeDrain_mutex);
+    int count = gazeSamples.Drain(out, (int) (capacity / (jlong) sizeof(GazeSample)));
+    pthread_mutex_unlock(&gazeDrain_mutex);
+    return count;
+}
+
+/**
+ * Returns counters of the gaze sample queue
+ *
+ * @return array of three elements: samples produced, samples drained and samples dropped because nobody drained the queue in time
+ */
+jlongArray Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetGazeSampleStats(JNIEnv *env, jclass obj) {
+    GazeSampleRingStats stats = gazeSamples.GetStats();
+    jlong values[3] = {(jlong) stats.pushed, (jlong) stats.drained, (jlong) stats.dropped};
+    jlongArray result = env->NewLongArray(3);
+    env->SetLongArrayRegion(result, 0, 3, values);
+    return result;
+}
+
 /**
  * Method for starting tracking from camera
  *
  * Initiates a while loop. Image is grabbed and track() function is called every iteration.
  * Copies data to the buffers for rendering.
+ *
+ * While the tracker is paused or waits for a new capture the thread sleeps until the next state change,
+ * the loop returns when the tracker is stopped.
  */
 void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_TrackLoop(JNIEnv *env,
                                                                       jobject obj) {
-    while (!trackerStopped) {
-        if (m_Tracker && androidCapture && !trackerStopped && !trackerPaused) {
-            pthread_mutex_lock(&guardFrame_mutex);
-            long ts;
-            VsImage *trackImage = androidCapture->GrabFrame(ts);
+    ThreadCpuMonitor::Shared().RegisterThread(THREAD_TRACKING);
 
-            if (trackerStopped || trackImage == 0) {
-                pthread_mutex_unlock(&guardFrame_mutex);
-                return;
-            }
+    while (trackerControl.BeginFrame()) {
+        pthread_mutex_lock(&guardFrame_mutex);
+        if (!m_Tracker || !androidCapture || trackerControl.IsStopped()) {
+            pthread_mutex_unlock(&guardFrame_mutex);
+            trackerControl.EndFrame();
+            continue;
+        }
 
-            long startTime = getTimeNsec();
-            if (camOrientation == 90 || camOrientation == 270)
-                trackingStatus = m_Tracker->track(camHeight, camWidth, trackImage->imageData,
-                                                  trackingData, VISAGE_FRAMEGRABBER_FMT_RGB,
-                                                  VISAGE_FRAMEGRABBER_ORIGIN_TL, 0, -1, MAX_FACES);
-            else
-                trackingStatus = m_Tracker->track(camWidth, camHeight, trackImage->imageData,
-                                                  trackingData, VISAGE_FRAMEGRABBER_FMT_RGB,
-                                                  VISAGE_FRAMEGRABBER_ORIGIN_TL, 0, -1, MAX_FACES);
-            long endTime = getTimeNsec();
-            trackingTime = (int) endTime - startTime;
+        long long ts;
+        long long waitStart = MonotonicNsec();
+        long long waitCpu = ThreadCpuNsec();
+        VsImage *trackImage = androidCapture->GrabFrame(ts);
+        long long grabbed = MonotonicNsec();
+        long long grabbedCpu = ThreadCpuNsec();
+
+        //No frame in time, or woken up by a state change which the next BeginFrame picks up
+        if (trackImage == 0 || trackerControl.IsStopped()) {
             pthread_mutex_unlock(&guardFrame_mutex);
+            trackerControl.EndFrame();
+            continue;
+        }
+        frameGovernor.OnFrameGrabbed(grabbed);
+        long long frameId = androidCapture->GetGrabbedFrameId();
+
+        int trackFormat = (trackImage->nChannels == 1) ? VISAGE_FRAMEGRABBER_FMT_LUMINANCE
+                                                       : VISAGE_FRAMEGRABBER_FMT_RGB;
+
+        //Frame time in milliseconds for the tracker's time based smoothing, relative to the first frame so it fits into long
+        if (trackingEpoch < 0)
+            trackingEpoch = ts;
+        long frameTime = (long) ((ts - trackingEpoch) / 1000000LL);
+
+        //The frame is already rotated and scaled to the tracking resolution. Feature points are normalized to
+        //the frame, so they map to the camera resolution preview without any correction, faceScale is in pixels
+        //of the tracked frame and is scaled up in the snapshots.
+        long long startTime = MonotonicNsec();
+        long long trackCpu = ThreadCpuNsec();
+        trackingStatus = m_Tracker->track(trackImage->width, trackImage->height, trackImage->imageData,
+                                          faceStore.GetTrackingData(), trackFormat,
+                                          VISAGE_FRAMEGRABBER_ORIGIN_TL, 0, frameTime, faceStore.GetCapacity());
+        //Single pass over the statuses, everything below only visits the faces that are present
+        faceStore.Update(trackingStatus);
+        long long endTime = MonotonicNsec();
+        long long endCpu = ThreadCpuNsec();
+
+        //CPU time is that of this thread only, the tracker's OpenMP workers are accounted by the thread CPU monitor
+        PipelineMetrics &metrics = PipelineMetrics::Shared();
+        metrics.Record(STAGE_FRAME_WAIT, grabbed - waitStart, grabbedCpu - waitCpu);
+        metrics.Record(STAGE_TRACK, endTime - startTime, endCpu - trackCpu);
+        metrics.Count(COUNTER_FRAMES_PROCESSED);
+        PIPELINE_TRACE_SPAN("frame_wait", waitStart, grabbed, frameId);
+        PIPELINE_TRACE_SPAN("track", startTime, endTime, frameId);
+
+        int scaleIndex = ScaleIndex(trackingScale);
+        trackTimeNs[scaleIndex] += endTime - startTime;
+        if (++trackTimeFrames[scaleIndex] == TRACK_TIME_REPORT_FRAMES) {
+            averageTrackTime[scaleIndex] = trackTimeNs[scaleIndex] / (1000000.0f * TRACK_TIME_REPORT_FRAMES);
+            LOGI("Tracker time at 1/%d scale (%dx%d): %.2f ms/frame", trackingScale, trackImage->width,
+                 trackImage->height, averageTrackTime[scaleIndex]);
+            trackTimeNs[scaleIndex] = 0;
+            trackTimeFrames[scaleIndex] = 0;
+        }
 
-            //***
-            //*** LOCK render thread while copying data for rendering ***
-            //***
-            pthread_mutex_lock(&displayRes_mutex);
-            for (int i = 0; i < MAX_FACES; i++) {
-                if (trackingStatus[i] == TRACK_STAT_OFF)
-                    continue;
-                trackingDataBuffer[i] = trackingData[i];
-                trackingStatusBuffer[i] = trackingStatus[i];
-                //Signalize that at least one face was tracked
-                trackingOk = true;
+        int newScale = SelectTrackingScale(faceStore);
+
+        bool analyserActive = ageActivated || genderActivated || emotionsActivated;
+
+        //Fill the free results slot, the rendering thread takes the newest one without copying it again.
+        //Full face data is only needed for the wireframe and the action units, everything else is drawn from the snapshots.
+        TrackingResults &results = trackingResults.Back();
+        results.hasFaceData = analyserActive || (displayOptions & (DISPLAY_WIRE_FRAME | DISPLAY_ACTION_UNITS));
+        std::copy(faceStore.GetStatuses(), faceStore.GetStatuses() + faceStore.GetCapacity(), results.status.begin());
+        for (int n = 0; n < faceStore.GetActiveCount(); n++) {
+            int i = faceStore.GetActive(n);
+            TakeFaceSnapshot(faceStore.GetFaceData(i), results.faces[i]);
+            results.faces[i].faceScale *= trackingScale;
+            results.faces[i].generation = ++snapshotGeneration;
+            if (results.hasFaceData)
+                results.faceData[i] = faceStore.GetFaceData(i);
+
+            const FaceSnapshotGaze &gaze = results.faces[i].gaze;
+            GazeSample sample = {ts, gaze.index, gaze.x, gaze.y, gaze.inState, gaze.quality, i};
+            gazeSamples.Push(sample);
+        }
+        results.trackedCount = faceStore.GetTrackedCount();
+        for (int n = 0; n < results.trackedCount; n++)
+            results.tracked[n] = faceStore.GetTracked(n);
+
+        //Signalize that at least one face was tracked
+        bool faceTracked = faceStore.GetActiveCount() > 0;
+        if (faceTracked) {
+            trackingOk = true;
+            metrics.Count(COUNTER_FRAMES_TRACKED);
+        }
 
-            }
+        //Single gaze readers get the first face that is present, whichever slot it is in
+        int gazeFace = faceTracked ? faceStore.GetActive(0) : -1;
+        FaceSnapshotGaze gaze = {0, 0.0f, 0.0f, 0, 0.0f};
+        if (gazeFace != -1)
+            gaze = results.faces[gazeFace].gaze;
+
+        if (faceTracked)
+            frameTimestampBuffer = ts;
+        results.timestamp = frameTimestampBuffer;
+        results.frameId = frameId;
+
+        //The analysis worker only takes a new frame once it has finished the previous one
+        bool analyserWantsFrame = analyserActive && faceAnalysisWorker.WantsFrame();
+
+        //Color is only needed by the analyser and the renderer. With luminance input the renderer converts the NV12
+        //planes on the GPU, so the frame is converted to RGB on the CPU only when the analyser will consume it.
+        //The preview is only published if the capture filled it, at the size of the frame it grabbed.
+        PreviewFrame &preview = previewFrames.Back();
+        bool yuvInput = trackFormat == VISAGE_FRAMEGRABBER_FMT_LUMINANCE;
+        bool rgbWanted = trackingOk && (analyserWantsFrame || (!yuvInput && previewFrames.IsConsumed()));
+        bool yuvWanted = trackingOk && yuvInput && previewFrames.IsConsumed();
+        bool rgbWritten = false;
+        bool previewWritten = false;
+        if (rgbWanted || yuvWanted) {
+            int frameWidth, frameHeight;
+            androidCapture->GetFrameSize(frameWidth, frameHeight);
+            FitPreviewFrame(preview, frameWidth, frameHeight);
+        }
+        if (rgbWanted) {
+            rgbWritten = androidCapture->ConvertGrabbedFrameToRGB(preview.rgb);
+            previewWritten = rgbWritten && !yuvInput;
+        }
+        if (yuvWanted)
+            previewWritten = androidCapture->CopyGrabbedFrameNV12(preview.luma, preview.chroma);
+        if (previewWritten) {
+            preview.yuv = yuvInput;
+            preview.colorMatrix = camColorMatrix;
+        }
+
+        if (analyserActive) {
 
-            isTracking = true;
+            //The tap position and the selected face are shared with the UI and rendering threads
+            pthread_mutex_lock(&displayRes_mutex);
+            int selectedFace = SelectFaceForAnalyser(results.faces.data());
 
-            if (trackingOk) {
-                vsCopy(trackImage, drawImageBuffer);
+            if (currentFace != selectedFace) {
+                for (int i = 0; i < faceStore.GetCapacity(); i++) {
+                    ResetAnalyser(i);
+                    ResetWireframeAnimation(i);
+                }
+                currentFace = selectedFace;
             }
+            pthread_mutex_unlock(&displayRes_mutex);
+
+            //A lost face is reset right away, without waiting for the worker
+            if (selectedFace != -1 && ((analyserWantsFrame && rgbWritten) || faceStore.GetStatus(selectedFace) != TRACK_STAT_OK))
+                AnalyseFace(preview.rgb, selectedFace, frameId);
+        }
 
+        //Per-frame results for Java, read from the shared buffer without a JNI call
+        PublishSharedResults(results, gazeFace, ts);
 
-            if (ageActivated || genderActivated || emotionsActivated) {
+        if (previewWritten)
+            previewFrames.Publish();
+        trackingResults.Publish();
+        pthread_mutex_unlock(&guardFrame_mutex);
+        long long published = MonotonicNsec();
+        metrics.Record(STAGE_PUBLISH, published - endTime, ThreadCpuNsec() - endCpu);
+        PIPELINE_TRACE_SPAN("publish", endTime, published, frameId);
 
-                int selectedFace = SelectFaceForAnalyser();
+        //***
+        //*** LOCK render thread only to share the gaze sample ***
+        //***
+        pthread_mutex_lock(&displayRes_mutex);
+        isTracking = true;
+        if (faceTracked) {
+            gazeDataBuffer = gaze;
+            gazeTimestampBuffer = ts;
+            gazeAvailable = true;
+        }
+        pthread_mutex_unlock(&displayRes_mutex);
 
-                if (currentFace != selectedFace) {
-                    for (int i = 0; i < MAX_FACES; i++) {
-                        ResetAnalyser(i);
-                        ResetWireframeAnimation(i);
-                    }
-                    currentFace = selectedFace;
-                }
+        //gaze sample of this frame is available from here on
+        if (faceTracked)
+            gazeLatency.Record(SensorClockNsec() - ts);
 
-                if (currentFace != -1)
-                    AnalyseFace(drawImageBuffer, currentFace);
-            }
+        frameGovernor.OnFrameTracked(endTime - startTime, MonotonicNsec() - grabbed, grabbed - waitStart);
 
-            //***
-            //*** UNLOCK render thread ***
-            //***
-            pthread_mutex_unlock(&displayRes_mutex);
-        } else {
-            Sleep(1);
+        if (newScale != trackingScale) {
+            //Pause tracking until the camera thread has recreated the capture for the new scale. The preview frames
+            //and the tracker stay as they are, the renderer keeps drawing the last published frame meanwhile.
+            pthread_mutex_lock(&guardFrame_mutex);
+            LOGI("Tracking scale 1/%d -> 1/%d", trackingScale, newScale);
+            trackingScale = newScale;
+            trackerControl.Reconfigure();
+            pthread_mutex_unlock(&guardFrame_mutex);
         }
+
+        trackerControl.EndFrame();
     }
     return;
 }
@@ -560,25 +1545,33 @@ jboolean Java_com_dsd_kosjenka_presentation_home_VisageWrapper_DisplayTrackingSt
                                                                                   jint width,
                                                                                   jint height) {
 
+    ThreadCpuMonitor::Shared().RegisterThread(THREAD_RENDER);
+
+    PipelineMetrics &metrics = PipelineMetrics::Shared();
+    long long copyStart = MonotonicNsec();
+    long long copyCpu = ThreadCpuNsec();
+
     //***
-    //*** LOCK track thread to copy data for rendering ***
+    //*** LOCK track thread to take the newest results for rendering ***
     //***
     pthread_mutex_lock(&displayRes_mutex);
-    if (!m_Tracker || trackerStopped || !isTracking || !drawImageBuffer || trackerPaused) {
+    if (!m_Tracker || trackerControl.IsPaused() || !isTracking) {
         pthread_mutex_unlock(&displayRes_mutex);
         return false;
     }
 
-    //copy image for rendering
-    vsCopy(drawImageBuffer, renderImage);
-
-    //copy faceData and statuses
-    for (int i = 0; i < MAX_FACES; i++) {
-        if (trackingStatusBuffer[i] == TRACK_STAT_OFF)
-            continue;
-        trackingDataRender[i] = trackingDataBuffer[i];
-        trackingStatusRender[i] = trackingStatusBuffer[i];
+    //the front slots stay untouched by the tracking thread until the next Update, so nothing is copied
+    trackingResults.Update();
+    previewFrames.Update();
+    TrackingResults &results = trackingResults.Front();
+    const PreviewFrame &preview = previewFrames.Front();
+    //the overlays only take the size of the frame, which both planes of a YUV frame share with the RGB one
+    VsImage *renderImage = preview.yuv ? preview.luma : preview.rgb;
+    if (!renderImage || (preview.yuv && !preview.chroma)) {
+        pthread_mutex_unlock(&displayRes_mutex);
+        return false;
     }
+
     int currentF = currentFace;
 
     glWidth = width;
@@ -610,26 +1603,56 @@ jboolean Java_com_dsd_kosjenka_presentation_home_VisageWrapper_DisplayTrackingSt
     //*** UNLOCK track thread ***
     //***
     pthread_mutex_unlock(&displayRes_mutex);
+    long long copyEnd = MonotonicNsec();
+    metrics.Record(STAGE_RENDER_COPY, copyEnd - copyStart, ThreadCpuNsec() - copyCpu);
+    PIPELINE_TRACE_SPAN("render_copy", copyStart, copyEnd, results.frameId);
 
-
-
-    //Render tracking results for the first face and display frame
-    VisageRendering::DisplayResults(&trackingDataRender[0], trackingStatusRender[0], w,
-                                    h, renderImage, DISPLAY_FRAME);
+    //Display the frame
+    if (preview.yuv)
+        VisageRendering::DisplayFrameNV12(preview.luma, preview.chroma, preview.colorMatrix, w, h);
+    else
+        VisageRendering::DisplayResults(NULL, NULL, TRACK_STAT_OFF, w, h, renderImage, DISPLAY_FRAME);
     if (logo)
         VisageRendering::DisplayLogo(logo, w, h);
-    //Render tracking results for rest of the faces without rendering the frame
-    for (int i = 0; i < MAX_FACES; i++) {
-        if (trackingStatusRender[i] == TRACK_STAT_OK)
-        {
-            VisageRendering::DisplayResults(&trackingDataRender[i], trackingStatusRender[i],
-                                                        w, h, renderImage, displayOptions);
+
+    long long drawStart = MonotonicNsec();
+    long long drawCpu = ThreadCpuNsec();
+    //Render tracking results of the tracked faces without rendering the frame, all faces share one draw call per layer.
+    //The display usually refreshes faster than the tracker delivers results, the overlays are then only rebuilt when the
+    //results change and redrawn from the GPU buffers in between.
+    int overlayOptions = displayOptions & ~DISPLAY_FRAME;
+    drawnGenerations.resize(results.trackedCount);
+    for (int n = 0; n < results.trackedCount; n++)
+        drawnGenerations[n] = results.faces[results.tracked[n]].generation;
+
+    VisageRendering::BeginFrame();
+    if (VisageRendering::DrawCachedResults(drawnGenerations.data(), results.trackedCount, w, h, renderImage, overlayOptions)) {
+        metrics.Count(COUNTER_OVERLAY_CACHE_HITS);
+    } else {
+        for (int n = 0; n < results.trackedCount; n++) {
+            int i = results.tracked[n];
+            VisageRendering::DisplayResults(&results.faces[i], results.hasFaceData ? &results.faceData[i] : NULL, results.status[i],
+                                            w, h, renderImage, overlayOptions);
         }
+        VisageRendering::CacheResults(drawnGenerations.data(), results.trackedCount, w, h, renderImage, overlayOptions);
     }
 
     if (ageActivated || genderActivated || emotionsActivated) {
-        if (currentF != -1 && trackingStatusRender[currentF] == TRACK_STAT_OK)
-            AnimateWireframe(trackingDataRender, currentF, 0.2f, 0.6f, w, h);
+        if (currentF != -1 && results.status[currentF] == TRACK_STAT_OK && results.hasFaceData)
+            AnimateWireframe(results.faceData.data(), currentF, 0.2f, 0.6f, w, h);
+    }
+    VisageRendering::EndFrame();
+    long long drawEnd = MonotonicNsec();
+    metrics.Record(STAGE_OVERLAY_DRAW, drawEnd - drawStart, ThreadCpuNsec() - drawCpu);
+    metrics.Count(COUNTER_FRAMES_RENDERED);
+    //the frame span encloses the texture upload, which is traced without knowing the frame
+    PIPELINE_TRACE_SPAN("overlay_draw", drawStart, drawEnd, results.frameId);
+    PIPELINE_TRACE_SPAN("render_frame", copyStart, drawEnd, results.frameId);
+
+    //Results of a frame are usually drawn several times, only the first time counts
+    if (results.timestamp != lastDisplayedTimestamp) {
+        displayLatency.Record(SensorClockNsec() - results.timestamp);
+        lastDisplayedTimestamp = results.timestamp;
     }
 
     return true;
@@ -640,22 +1663,19 @@ jboolean Java_com_dsd_kosjenka_presentation_home_VisageWrapper_DisplayTrackingSt
  * Stops the tracker and cleans memory
  */
 void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_TrackerStop(JNIEnv *env, jobject obj) {
+    frameRecorder.Stop();
+
     if (m_Tracker) {
-        trackerStopped = true;
+        trackerControl.Stop();
         trackingOk = false;
         pthread_mutex_lock(&guardFrame_mutex);
         pthread_mutex_lock(&displayRes_mutex);
-        for (int i = 0; i < MAX_FACES; i++) {
-            trackingStatusRender[i] = TRACK_STAT_OFF;
-            trackingStatusBuffer[i] = TRACK_STAT_OFF;
-        }
+        ClearTrackingResults();
         m_Tracker->stop();
         delete m_Tracker;
         m_Tracker = 0;
-        vsReleaseImage(&drawImageBuffer);
-        drawImageBuffer = 0;
-        vsReleaseImage(&renderImage);
-        renderImage = 0;
+        ReleaseFrameBuffers();
+        previewFrames.Reset();
         VisageRendering::Reset();
 
         vsReleaseImage(&logo);
@@ -668,6 +1688,7 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_TrackerStop(JNIEnv *e
     }
 
     if (m_Analyser) {
+        faceAnalysisWorker.Stop();
         delete m_Analyser;
         m_Analyser = 0;
     }
@@ -678,9 +1699,10 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_TrackerStop(JNIEnv *e
 * function whenever new frame from camera is available. Data inside frame should be in Android NV21 (YUV420sp) format and @ref VisageSDK::AndroidStreamCapture
 * will perform conversion to RGB.
 *
-* This function will reinitialize AndroidStreamCapture wrapper in case setParameter function was called, signaled by the orientationChanged flag. After creation,
-* tracking will be resumed, signaled by trackerPaused flag.
+* This function will reinitialize AndroidStreamCapture wrapper in case setParameter function was called, signaled by TrackerControl::NeedsCapture. After creation,
+* tracking will be resumed.
 * @param frame byte array with image data
+* @param timestampA sensor timestamp of the frame in nanoseconds (Image.getTimestamp()), see SetSensorTimestampSource
 */
 void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_WriteFrameStream(JNIEnv *env,
                                                                             jclass obj,
@@ -691,22 +1713,53 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_WriteFrameStream(JNIE
                                                                              jlong frameID,
                                                                              jint pixelStride) {
 
-    if (trackerStopped)
+    ThreadCpuMonitor::Shared().RegisterThread(THREAD_CAMERA);
+
+    if (trackerControl.IsStopped())
         return;
-    //Reinitialize if the parameters changed or initialize if it is the first time
-    if (!androidCapture || orientationChanged) {
+    //Reinitialize if the parameters changed or initialize if it is the first time, or after tracking still images
+    if (!androidCapture || !androidCapture->cameraCapture || trackerControl.NeedsCapture()) {
+        //The tracking thread finishes its frame with the old capture first
+        trackerControl.DetachCapture();
+        pthread_mutex_lock(&guardFrame_mutex);
         delete androidCapture;
-        androidCapture = new AndroidCapture(camWidth, camHeight, camOrientation, camFlip);
-        orientationChanged = false;
-        trackerPaused = false;
+        androidCapture = new AndroidCapture(camWidth, camHeight, camOrientation, camFlip, camFormat, trackingScale);
+        androidCapture->SetColorMatrix(camColorMatrix);
+        pthread_mutex_unlock(&guardFrame_mutex);
+        frameGovernor.Reset();
+        trackerControl.AttachCapture(androidCapture);
     }
 
     unsigned char *channel0 = (unsigned char *) env->GetDirectBufferAddress(frameChannel0);
     unsigned char *channel1 = (unsigned char *) env->GetDirectBufferAddress(frameChannel1);
     unsigned char *channel2 = (unsigned char *) env->GetDirectBufferAddress(frameChannel2);
 
+    //Keep every camera frame for replay while recording, the copy is written out on a background thread
+    if (frameRecorder.IsRecording()) {
+        YuvFrame frame;
+        frame.y = channel0;
+        frame.u = channel1;
+        frame.v = channel2;
+        frame.width = camWidth;
+        frame.height = camHeight;
+        frame.yRowStride = camWidth;
+        frame.uvRowStride = (camWidth >> 1) * pixelStride;
+        frame.uvPixelStride = pixelStride;
+
+        frameRecorder.RecordFrame(frame, (size_t) env->GetDirectBufferCapacity(frameChannel0),
+                                  (size_t) env->GetDirectBufferCapacity(frameChannel1),
+                                  (size_t) env->GetDirectBufferCapacity(frameChannel2),
+                                  timestampA, camOrientation, camFlip);
+    }
+
+    //Do not spend time on frames the tracker would never see
+    if (!frameGovernor.AdmitFrame(timestampA, MonotonicNsec()))
+        return;
+
     //Writes frame from Java to native
-    androidCapture->WriteFrameYUV420(channel0, channel1, channel2, timestampA, pixelStride);
+    long long convertStart = MonotonicNsec();
+    androidCapture->WriteFrameYUV420(channel0, channel1, channel2, timestampA, pixelStride, frameID);
+    frameGovernor.OnFrameConverted(MonotonicNsec() - convertStart, androidCapture->GetFrameStats().dropped);
 }
 
 
@@ -796,28 +1849,30 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_ToggleRefineLandmarks
  */
 void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_PauseTracker(JNIEnv *env, jobject obj) {
 
-    pthread_mutex_lock(&displayRes_mutex);
+    trackerControl.Pause();
+
     pthread_mutex_lock(&guardFrame_mutex);
+    pthread_mutex_lock(&displayRes_mutex);
 
-    trackerPaused = true;
     isTracking = false;
 
-    pthread_mutex_unlock(&guardFrame_mutex);
     pthread_mutex_unlock(&displayRes_mutex);
+    pthread_mutex_unlock(&guardFrame_mutex);
 }
 
 void
 Java_com_dsd_kosjenka_presentation_home_VisageWrapper_ResumeTracker(JNIEnv *env,
                                                                      jobject instance) {
 
-    pthread_mutex_lock(&displayRes_mutex);
     pthread_mutex_lock(&guardFrame_mutex);
+    pthread_mutex_lock(&displayRes_mutex);
 
-    trackerPaused = false;
     isTracking = false;
 
-    pthread_mutex_unlock(&guardFrame_mutex);
     pthread_mutex_unlock(&displayRes_mutex);
+    pthread_mutex_unlock(&guardFrame_mutex);
+
+    trackerControl.Resume();
 
 }
 
@@ -832,28 +1887,34 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_WriteFrameImage(JNIEn
                                                                             jbyteArray frame,
                                                                             jint width,
                                                                             jint height) {
-    pthread_mutex_lock(&displayRes_mutex);
+    //The tracking thread finishes its frame with the old capture before it is replaced. An image capture is only
+    //kept for images of its size, its buffer and the preview are sized from the image.
+    int captureWidth = 0, captureHeight = 0;
+    if (androidCapture && androidCapture->imageCapture)
+        androidCapture->GetFrameSize(captureWidth, captureHeight);
+    bool newCapture = trackerControl.NeedsCapture() || captureWidth != width || captureHeight != height;
+    if (newCapture)
+        trackerControl.DetachCapture();
+
     pthread_mutex_lock(&guardFrame_mutex);
+    pthread_mutex_lock(&displayRes_mutex);
 
-    for (int i = 0; i < MAX_FACES; i++) {
-        trackingStatusRender[i] = TRACK_STAT_OFF;
-        trackingStatusBuffer[i] = TRACK_STAT_OFF;
-    }
+    ClearTrackingResults();
 
-    if (!androidCapture || orientationChanged) {
+    if (newCapture) {
         delete androidCapture;
         androidCapture = new AndroidCapture(width, height, VISAGE_FRAMEGRABBER_FMT_RGB);
-
-        orientationChanged = false;
-        trackerPaused = false;
     }
 
     jbyte *f = env->GetByteArrayElements(frame, 0);
 
     androidCapture->WriteFrame((unsigned char *) f, (int) width, (int) height);
 
-    pthread_mutex_unlock(&guardFrame_mutex);
     pthread_mutex_unlock(&displayRes_mutex);
+    pthread_mutex_unlock(&guardFrame_mutex);
+
+    if (newCapture)
+        trackerControl.AttachCapture(androidCapture);
 
     env->ReleaseByteArrayElements(frame, f, 0);
 }
@@ -861,23 +1922,12 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_WriteFrameImage(JNIEn
 jfloatArray
 Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetEmotions(JNIEnv *env, jclass type) {
 
-    std::vector<float> emoTemp(NUM_EMOTIONS);
-
-    if (std::all_of(emotions[currentFace].begin(), emotions[currentFace].end(), [](float em) { return em < 0.01; }) || currentFace == -1) {
-        emoTemp.insert(emoTemp.end(), 7, -1.0f);
-    } else {
-        std::copy(emotions.at(currentFace).begin(), emotions.at(currentFace).end(), emoTemp.begin());
-    }
-
+    float age;
+    int gender;
     jfloat values[NUM_EMOTIONS];
-    for (int i = 0; i < NUM_EMOTIONS; i++)
-        values[i] = emoTemp[i];
-
+    GetCurrentAnalysis(age, gender, values);
 
-    jfloatArray emotionsLocal;
-
-
-    emotionsLocal = env->NewFloatArray(NUM_EMOTIONS);
+    jfloatArray emotionsLocal = env->NewFloatArray(NUM_EMOTIONS);
 
     if (emotionsLocal == NULL) {
         LOGE("Out of memory error!");
@@ -891,19 +1941,21 @@ Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetEmotions(JNIEnv *env, j
 
 jfloat
 Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetAge(JNIEnv *env, jclass type) {
-    if (age[currentFace] < 0 || currentFace == -1)
-        return -1.0f;
-
-    return (jfloat) age[currentFace];
+    float age;
+    int gender;
+    float emotions[NUM_EMOTIONS];
+    GetCurrentAnalysis(age, gender, emotions);
+    return (jfloat) age;
 
 }
 
 jint Java_com_dsd_kosjenka_presentation_home_VisageWrapper_GetGender(JNIEnv *env, jclass type) {
 
-    if (gender[currentFace] < 0 || currentFace == -1)
-        return -1;
-
-    return (jint) gender[currentFace];
+    float age;
+    int gender;
+    float emotions[NUM_EMOTIONS];
+    GetCurrentAnalysis(age, gender, emotions);
+    return (jint) gender;
 }
 
 
@@ -955,6 +2007,9 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_InitAnalyser(JNIEnv *
         std::string analyzerPath = std::string(_path) + "/vfa";
         analyserInitialized = m_Analyser->init(analyzerPath.c_str());
 
+        if (analyserInitialized)
+            faceAnalysisWorker.Start(m_Analyser);
+
         int num_threads = 1;
         int max_task_number = 2;
     }
@@ -993,23 +2048,23 @@ void Java_com_dsd_kosjenka_presentation_home_VisageWrapper_WriteLogoImage(JNIEnv
  *
  * @param width Frame width. ( In our case frame is stretched to match screen size, so we pass the width of the screen in pixels)
  * @param height Frame height. ( In our case is calculated according to the aspect of the frame and frame width)
- * @param trackingData Face data of the face to calculate bounding box.
+ * @param face Snapshot of the face to calculate bounding box.
  * @param boundingBox Object to store bounding box parameters
  * @param flipY Bool to indicate if feature points are flipped according to the x-axis.
  * @return True if the calculation was successful, false otherwise.
  */
-bool CalculateBoundingBox(int width, int height, FaceData *trackingData, VsRect *boundingBox,
+bool CalculateBoundingBox(int width, int height, const FaceSnapshot *face, VsRect *boundingBox,
                           bool flipY) {
     //load crucial feature points
     VsPoint leye1, leye2, reye1, reye2, nose1, nose2, mouth;
 
-    if (!(GetFeaturePoint(leye1, trackingData, 3, 11, width, height, flipY) &&
-          GetFeaturePoint(leye2, trackingData, 3, 7, width, height, flipY) &&
-          GetFeaturePoint(reye1, trackingData, 3, 12, width, height, flipY) &&
-          GetFeaturePoint(reye2, trackingData, 3, 8, width, height, flipY) &&
-          GetFeaturePoint(nose1, trackingData, 9, 5, width, height, flipY) &&
-          GetFeaturePoint(nose2, trackingData, 9, 4, width, height, flipY) &&
-          GetFeaturePoint(mouth, trackingData, 8, 1, width, height, flipY)))
+    if (!(GetFeaturePoint(leye1, face, FaceSnapshotPoint(3, 11), width, height, flipY) &&
+          GetFeaturePoint(leye2, face, FaceSnapshotPoint(3, 7), width, height, flipY) &&
+          GetFeaturePoint(reye1, face, FaceSnapshotPoint(3, 12), width, height, flipY) &&
+          GetFeaturePoint(reye2, face, FaceSnapshotPoint(3, 8), width, height, flipY) &&
+          GetFeaturePoint(nose1, face, FaceSnapshotPoint(9, 5), width, height, flipY) &&
+          GetFeaturePoint(nose2, face, FaceSnapshotPoint(9, 4), width, height, flipY) &&
+          GetFeaturePoint(mouth, face, FaceSnapshotPoint(8, 1), width, height, flipY)))
         return false;
 
     //calculate mid-points
@@ -1049,13 +2104,12 @@ float FPDistance(const VsPoint *fp1, const VsPoint *fp2) {
     return (float) sqrt(pow((float) (fp1->x - fp2->x), 2) + pow((float) (fp1->y - fp2->y), 2));
 }
 
-bool GetFeaturePoint(VsPoint &point, FaceData *trackingData, int group, int index, int width,
+bool GetFeaturePoint(VsPoint &point, const FaceSnapshot *face, int fp, int width,
                      int height,
                      bool flipY) {
-    const FeaturePoint &fp = trackingData->featurePoints2D->getFP(group, index);
-    point.x = vsRound(fp.pos[0] * width);
-    point.y = vsRound((flipY ? 1 - fp.pos[1] : fp.pos[1]) * height);
-    return (bool) fp.defined;
+    point.x = vsRound(face->x[fp] * width);
+    point.y = vsRound((flipY ? 1 - face->y[fp] : face->y[fp]) * height);
+    return (face->flags[fp] & FACE_POINT_DEFINED) != 0;
 }
 
 /**
@@ -1069,13 +2123,13 @@ bool GetFeaturePoint(VsPoint &point, FaceData *trackingData, int group, int inde
 void
 AnimateWireframe(FaceData *faceData, int index, float alphaMin, float alphaMax, int glw, int glh) {
 
-    if (!animationEnabled[index]) {
-        startTimeAnim = getTimeNsec();
-        animationEnabled[index] = true;
+    if (!faceStore.IsAnimationEnabled(index)) {
+        startTimeAnim = getTimeMsec();
+        faceStore.SetAnimationEnabled(index, true);
     }
 
-    if (animationEnabled[index]) {
-        long currTimeAnim = getTimeNsec();
+    if (faceStore.IsAnimationEnabled(index)) {
+        long currTimeAnim = getTimeMsec();
         double weight = (float) (currTimeAnim - startTimeAnim) / (float) durationTimeAnim;
         double alpha = (alphaMax - alphaMin) / 2 * sin(2 * M_PI * weight - M_PI / 2) +
                        (alphaMax + alphaMin) / 2;
@@ -1083,7 +2137,7 @@ AnimateWireframe(FaceData *faceData, int index, float alphaMin, float alphaMax,
         VisageRendering::DisplayWireFrame(&faceData[index], glw, glh, alpha);
 
         if (weight > 1) {
-            animationEnabled[index] = false;
+            faceStore.SetAnimationEnabled(index, false);
         }
     }
 }
@@ -1093,30 +2147,32 @@ AnimateWireframe(FaceData *faceData, int index, float alphaMin, float alphaMax,
  * @param index Index of the face.
  */
 void ResetWireframeAnimation(int index) {
-    animationEnabled[index] = false;
+    faceStore.SetAnimationEnabled(index, false);
 }
 
 /**
  * Analyser display can host estimations for only one face at a time so we use this method to choose that face. If there is only one face in the frame, we
  * analyse that face. If there is more than one, we check whether the user tapped on the screen to select the face, otherwise, we choose
  * the smallest index with valid face data.
- * It should be used when trackingStatusBuffer is updated with the latest values and inside the displayRes_mutex lock.
+ * It should be used on the tracking thread after tracking a frame and inside the displayRes_mutex lock.
+ * @param faces Snapshots of the faces tracked in the frame.
  * @return Index of the selected face. If there are no faces in the frame, returns -1.
  */
-int SelectFaceForAnalyser() {
-    int *countedFaces = CountFaces();
+int SelectFaceForAnalyser(const FaceSnapshot *faces) {
+    int trackedFaces = faceStore.GetTrackedCount();
+    int firstTrackedFace = (trackedFaces > 0) ? faceStore.GetTracked(0) : -1;
     int selectedFace = -1;
 
-    if (countedFaces[0] == 1) {
-        selectedFace = countedFaces[1];
+    if (trackedFaces == 1) {
+        selectedFace = firstTrackedFace;
     } else {
-        selectedFace = UserSelectedFace();
+        selectedFace = UserSelectedFace(faces);
         if (selectedFace == -1)
-            selectedFace = trackingStatusBuffer[currentFace] == TRACK_STAT_OK ? currentFace
-                                                                              : countedFaces[1];
+            selectedFace = (currentFace != -1 && faceStore.GetStatus(currentFace) == TRACK_STAT_OK) ? currentFace
+                                                                                                    : firstTrackedFace;
 
-        if (countedFaces[0] != numTrackedFaces) {
-            numTrackedFaces = countedFaces[0];
+        if (trackedFaces != numTrackedFaces) {
+            numTrackedFaces = trackedFaces;
             if (!numFacesChanged) {
                 numFacesChanged = true;
                 displayText = true;
@@ -1129,60 +2185,42 @@ int SelectFaceForAnalyser() {
 
 /**
  * Method checks whether user tapped on screen and selected face for the analyser.
- * It should be used when trackingStatusBuffer is updated with the latest values and inside the displayRes_mutex lock.
+ * It should be used on the tracking thread after tracking a frame and inside the displayRes_mutex lock.
+ * @param faces Snapshots of the faces tracked in the frame.
  * @return Index of the face user selected. If no tapping occurred, or the user didn't select face, returns -1.
  */
-int UserSelectedFace() {
+int UserSelectedFace(const FaceSnapshot *faces) {
     int selectedFace = -1;
 
     if (tapPositionX == -1 || tapPositionY == -1)
         return selectedFace;
 
-    float videoAspect = (float) drawImageBuffer->width / (float) drawImageBuffer->height;
+    int frameWidth, frameHeight;
+    YuvConverter::OrientedSize(camWidth, camHeight, camOrientation, frameWidth, frameHeight);
+    float videoAspect = (float) frameWidth / (float) frameHeight;
 
     int winWidth = glWidth;
     int winHeight = vsRound(winWidth / videoAspect);
 
 
-    for (int i = 0; i < MAX_FACES; i++) {
+    for (int n = 0; n < faceStore.GetTrackedCount(); n++) {
         //calculate bounding boxes for all found faces
-
-        if (trackingStatusBuffer[i] == TRACK_STAT_OK) {
-            CalculateBoundingBox(winWidth, winHeight, &trackingDataBuffer[i], &face[i]);
-
-            if (tapPositionX > (face[i].x) && tapPositionX < (face[i].x + face[i].width) &&
-                tapPositionY > (face[i].y) && tapPositionY < (face[i].y + face[i].height)) {
-                //save index of clicked face
-                selectedFace = i;
-
-                displayText = false;
-                tapPositionX = -1;
-                tapPositionY = -1;
-            }
+        int i = faceStore.GetTracked(n);
+        VsRect &face = faceStore.GetBoundingBox(i);
+        CalculateBoundingBox(winWidth, winHeight, &faces[i], &face);
+
+        if (tapPositionX > (face.x) && tapPositionX < (face.x + face.width) &&
+            tapPositionY > (face.y) && tapPositionY < (face.y + face.height)) {
+            //save index of clicked face
+            selectedFace = i;
+
+            displayText = false;
+            tapPositionX = -1;
+            tapPositionY = -1;
         }
     }
 
     return selectedFace;
 }
 
-/**
- * This method counts tracked faces. It should be used when trackingStatusBuffer is updated with the latest values and inside the displayRes_mutex lock.
- * @return Array with two values, the first value is the number of tracked faces, second is the smallest index with tracking status ok.
- */
-int *CountFaces() {
-
-    static int count[2] = {0, -1};
-
-    count[0] = 0;
-    count[1] = -1;
-    for (int i = MAX_FACES - 1; i >= 0; --i) {
-        if (trackingStatusBuffer[i] == TRACK_STAT_OK) {
-            count[0]++;
-            count[1] = i;
-        }
-    }
-
-    return count;
-}
-
 }
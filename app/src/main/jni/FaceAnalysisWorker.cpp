@@ -0,0 +1,280 @@
+#include "FaceAnalysisWorker.h"
+#include "FrameTiming.h"
+#include "PipelineMetrics.h"
+#include "PipelineTrace.h"
+#include "ThreadCpuMonitor.h"
+#include "ImagePool.h"
+
+namespace VisageSDK
+{
+
+// weight of a new sample in the average analysis time, 1/AVERAGE_WEIGHT
+static const int AVERAGE_WEIGHT = 16;
+
+static void ClearResult(FaceAnalysisResult& result)
+{
+	result.age = -1.0f;
+	result.gender = -1;
+	for (int i = 0; i < VFA_EMOTIONS_COUNT; i++)
+		result.emotions[i] = 0.0f;
+}
+
+FaceAnalysisWorker::FaceAnalysisWorker()
+	: ring(SNAPSHOT_SLOTS)
+{
+	analyser = 0;
+	running = false;
+	stopRequested.store(false);
+
+	for (int i = 0; i < SNAPSHOT_SLOTS; i++)
+	{
+		snapshots[i].frame = 0;
+		snapshots[i].faceIndex = -1;
+		snapshots[i].options = 0;
+		snapshots[i].frameId = -1;
+	}
+
+	busy.store(false);
+	intervalNs.store(0);
+	lastSubmitted.store(0);
+	resetMask.store(0);
+
+	FaceAnalysisResult cleared;
+	ClearResult(cleared);
+	for (int i = 0; i < MAX_FACES; i++)
+	{
+		results[i].sequence.store(0);
+		Publish(i, cleared);
+	}
+
+	analysedFrames.store(0);
+	analysisTimeNs.store(0);
+}
+
+FaceAnalysisWorker::~FaceAnalysisWorker()
+{
+	Stop();
+}
+
+bool FaceAnalysisWorker::Start(VisageFaceAnalyser* analyser)
+{
+	if (running || !analyser)
+		return false;
+
+	this->analyser = analyser;
+	stopRequested.store(false);
+	busy.store(false);
+	resetMask.store(0);
+
+	if (pthread_create(&thread, 0, WorkerThread, this) != 0)
+	{
+		this->analyser = 0;
+		return false;
+	}
+
+	running = true;
+	return true;
+}
+
+void FaceAnalysisWorker::Stop()
+{
+	if (!running)
+		return;
+
+	stopRequested.store(true);
+	ring.Wake();
+	pthread_join(thread, 0);
+
+	running = false;
+	analyser = 0;
+
+	// the worker may have left on the wakeup with a snapshot still ready, which must not reach the next worker
+	// without its frame
+	ring.Reset();
+	for (int i = 0; i < SNAPSHOT_SLOTS; i++)
+		ImagePool::Shared().Release(&snapshots[i].frame);
+
+	// nothing analyses the faces any more
+	FaceAnalysisResult cleared;
+	ClearResult(cleared);
+	for (int i = 0; i < MAX_FACES; i++)
+		Publish(i, cleared);
+}
+
+bool FaceAnalysisWorker::WantsFrame() const
+{
+	if (!running || busy.load(std::memory_order_acquire))
+		return false;
+
+	const long long last = lastSubmitted.load(std::memory_order_relaxed);
+	return last == 0 || MonotonicNsec() - last >= intervalNs.load(std::memory_order_relaxed);
+}
+
+void FaceAnalysisWorker::Submit(const VsImage* frame, const FaceData& faceData, int faceIndex, int options, long long frameId)
+{
+	if (!running || faceIndex < 0 || faceIndex >= MAX_FACES)
+		return;
+
+	// the slot belongs to this thread until EndWrite
+	Snapshot& snapshot = snapshots[ring.BeginWrite()];
+
+	if (!snapshot.frame || snapshot.frame->width != frame->width || snapshot.frame->height != frame->height ||
+		snapshot.frame->nChannels != frame->nChannels)
+	{
+		ImagePool::Shared().Release(&snapshot.frame);
+		snapshot.frame = ImagePool::Shared().Acquire(frame->width, frame->height, frame->nChannels);
+	}
+
+	vsCopy(frame, snapshot.frame);
+	snapshot.faceData = faceData;
+	snapshot.faceIndex = faceIndex;
+	snapshot.options = options;
+	snapshot.frameId = frameId;
+
+	busy.store(true, std::memory_order_release);
+	lastSubmitted.store(MonotonicNsec(), std::memory_order_relaxed);
+	ring.EndWrite();
+}
+
+void FaceAnalysisWorker::Reset(int faceIndex)
+{
+	if (faceIndex < 0 || faceIndex >= MAX_FACES)
+		return;
+
+	resetMask.fetch_or(1u << faceIndex);
+
+	// the worker applies the reset right away even when no snapshot comes
+	if (running)
+		ring.Wake();
+}
+
+void FaceAnalysisWorker::GetResult(int faceIndex, FaceAnalysisResult& result) const
+{
+	if (faceIndex < 0 || faceIndex >= MAX_FACES)
+	{
+		ClearResult(result);
+		return;
+	}
+
+	const PublishedResult& published = results[faceIndex];
+
+	uint32_t before;
+	uint32_t after;
+	do
+	{
+		before = published.sequence.load(std::memory_order_acquire);
+
+		result.age = published.age.load(std::memory_order_relaxed);
+		result.gender = published.gender.load(std::memory_order_relaxed);
+		for (int i = 0; i < VFA_EMOTIONS_COUNT; i++)
+			result.emotions[i] = published.emotions[i].load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		after = published.sequence.load(std::memory_order_relaxed);
+	}
+	while ((before & 1) || before != after);
+}
+
+void FaceAnalysisWorker::Publish(int faceIndex, const FaceAnalysisResult& result)
+{
+	PublishedResult& published = results[faceIndex];
+
+	const uint32_t sequence = published.sequence.load(std::memory_order_relaxed);
+	published.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	published.age.store(result.age, std::memory_order_relaxed);
+	published.gender.store(result.gender, std::memory_order_relaxed);
+	for (int i = 0; i < VFA_EMOTIONS_COUNT; i++)
+		published.emotions[i].store(result.emotions[i], std::memory_order_relaxed);
+
+	published.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void FaceAnalysisWorker::ApplyResets()
+{
+	uint32_t mask = resetMask.exchange(0);
+	if (!mask)
+		return;
+
+	FaceAnalysisResult cleared;
+	ClearResult(cleared);
+
+	for (int i = 0; i < MAX_FACES; i++)
+	{
+		if (!(mask & (1u << i)))
+			continue;
+
+		analyser->resetStreamAnalysis(i);
+		Publish(i, cleared);
+	}
+}
+
+void* FaceAnalysisWorker::WorkerThread(void* worker)
+{
+	((FaceAnalysisWorker*) worker)->Run();
+	return 0;
+}
+
+void FaceAnalysisWorker::Run()
+{
+	ThreadCpuMonitor::Shared().RegisterThread(THREAD_ANALYSIS);
+
+	while (!stopRequested.load())
+	{
+		// sleeps until a snapshot is submitted, a reset is requested or the worker is stopped
+		int slot = ring.AcquireLatest(-1);
+
+		ApplyResets();
+
+		if (slot == -1)
+			continue;
+
+		const Snapshot& snapshot = snapshots[slot];
+		if (!snapshot.frame)
+		{
+			busy.store(false, std::memory_order_release);
+			continue;
+		}
+
+		// a reset requested after the snapshot was taken makes its result stale
+		if (!(resetMask.load() & (1u << snapshot.faceIndex)))
+		{
+			long long start = MonotonicNsec();
+			long long cpuStart = ThreadCpuNsec();
+
+			AnalysisData analysisData;
+			analyser->analyseStream(snapshot.frame, snapshot.faceData, snapshot.options, analysisData, snapshot.faceIndex);
+
+			long long end = MonotonicNsec();
+			long long elapsed = end - start;
+			PipelineMetrics::Shared().Record(STAGE_ANALYSIS, elapsed, ThreadCpuNsec() - cpuStart);
+			PIPELINE_TRACE_SPAN("analysis", start, end, snapshot.frameId);
+			long long average = analysisTimeNs.load(std::memory_order_relaxed);
+			analysisTimeNs.store(average == 0 ? elapsed : average + (elapsed - average) / AVERAGE_WEIGHT, std::memory_order_relaxed);
+			analysedFrames.fetch_add(1, std::memory_order_relaxed);
+
+			// the stream analysis only reports results once it has collected enough good frames
+			const bool valid = (!(snapshot.options & VFA_AGE) || analysisData.ageValid) &&
+							   (!(snapshot.options & VFA_GENDER) || analysisData.genderValid) &&
+							   (!(snapshot.options & VFA_EMOTION) || analysisData.emotionsValid);
+
+			if (valid && !(resetMask.load() & (1u << snapshot.faceIndex)))
+			{
+				FaceAnalysisResult result;
+				result.age = analysisData.age;
+				result.gender = analysisData.gender;
+				for (int i = 0; i < VFA_EMOTIONS_COUNT; i++)
+					result.emotions[i] = analysisData.emotionProbabilities[i];
+
+				Publish(snapshot.faceIndex, result);
+			}
+		}
+
+		busy.store(false, std::memory_order_release);
+	}
+
+	ApplyResets();
+}
+
+}
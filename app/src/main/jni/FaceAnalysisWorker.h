@@ -0,0 +1,139 @@
+#ifndef __FaceAnalysisWorker_h__
+#define __FaceAnalysisWorker_h__
+
+#include "VisageFaceAnalyser.h"
+#include "FrameRing.h"
+#include <pthread.h>
+#include <atomic>
+#include <cstdint>
+
+namespace VisageSDK
+{
+
+/** Age, gender and emotion estimate of a single face published by @ref FaceAnalysisWorker.
+ */
+struct FaceAnalysisResult {
+	float age;				///< estimated age, -1 if not known
+	int gender;				///< 1 for male, 0 for female, -1 if not known
+	float emotions[VFA_EMOTIONS_COUNT];	///< emotion probabilities, all 0 if not known
+};
+
+/** FaceAnalysisWorker runs VisageFaceAnalyser on its own thread so that face analysis does not add to tracking time.
+ *
+ * The tracking thread hands over a snapshot of the frame and the face to analyse with @ref Submit. Snapshots pass
+ * through a @ref FrameRing, so the worker always analyses the newest one and older snapshots are dropped. A snapshot
+ * is only taken when the worker is idle and the configured interval has passed, so frames are not copied for nothing.
+ *
+ * Results are published per face with a sequence lock: the worker is the only writer and readers on any thread retry
+ * until they get a consistent copy, so neither side ever blocks.
+ */
+class FaceAnalysisWorker {
+
+public:
+
+	/** Largest face index that can be analysed, plus one. Covers the largest face capacity of the tracker.
+	*/
+	static const int MAX_FACES = 16;
+
+	FaceAnalysisWorker();
+
+	~FaceAnalysisWorker();
+
+	/** Starts the worker thread for the given analyser, which must stay valid until @ref Stop.
+	*/
+	bool Start(VisageFaceAnalyser* analyser);
+
+	/** Stops the worker thread. A running analysis is finished first.
+	*/
+	void Stop();
+
+	bool IsRunning() const { return running; }
+
+	/** Minimal time between two analysed frames, in milliseconds. 0 analyses frames as fast as the worker can.
+	*/
+	void SetInterval(int ms) { intervalNs.store(ms * 1000000LL, std::memory_order_relaxed); }
+
+	/** True if the worker is ready for a new snapshot, i.e. it is idle and the interval has passed.
+	* Called from the tracking thread before preparing the data for @ref Submit.
+	*/
+	bool WantsFrame() const;
+
+	/** Copies the frame and face data and hands them to the worker. Called from the tracking thread only.
+	* @param frame 3 channel RGB frame
+	* @param faceData tracking result of the face to analyse
+	* @param faceIndex index of the face, results are published under it
+	* @param options VFA_AGE, VFA_GENDER and VFA_EMOTION flags
+	* @param frameId camera frame ID the analysis is traced under
+	*/
+	void Submit(const VsImage* frame, const FaceData& faceData, int faceIndex, int options, long long frameId = -1);
+
+	/** Clears the results of a face and its stream analysis state, e.g. when the face was lost or replaced.
+	* Can be called from any thread, the analyser state is reset on the worker thread.
+	*/
+	void Reset(int faceIndex);
+
+	/** Copies the latest results of a face. Never blocks.
+	*/
+	void GetResult(int faceIndex, FaceAnalysisResult& result) const;
+
+	/** Number of analysed snapshots.
+	*/
+	uint64_t GetAnalysedFrames() const { return analysedFrames.load(std::memory_order_relaxed); }
+
+	/** Running average of the time spent in analyseStream, in milliseconds.
+	*/
+	float GetAverageAnalysisTime() const { return analysisTimeNs.load(std::memory_order_relaxed) / 1000000.0f; }
+
+private:
+
+	static void* WorkerThread(void* worker);
+
+	void Run();
+
+	void ApplyResets();
+
+	void Publish(int faceIndex, const FaceAnalysisResult& result);
+
+	FaceAnalysisWorker(const FaceAnalysisWorker&);
+	FaceAnalysisWorker& operator=(const FaceAnalysisWorker&);
+
+	static const int SNAPSHOT_SLOTS = 3;
+
+	struct Snapshot {
+		VsImage* frame;
+		FaceData faceData;
+		int faceIndex;
+		int options;
+		long long frameId;
+	};
+
+	// result of one face behind a sequence lock, odd while the worker writes it
+	struct PublishedResult {
+		std::atomic<uint32_t> sequence;
+		std::atomic<float> age;
+		std::atomic<int> gender;
+		std::atomic<float> emotions[VFA_EMOTIONS_COUNT];
+	};
+
+	VisageFaceAnalyser* analyser;
+	bool running;
+	pthread_t thread;
+	std::atomic<bool> stopRequested;
+
+	FrameRing ring;
+	Snapshot snapshots[SNAPSHOT_SLOTS];
+
+	std::atomic<bool> busy;
+	std::atomic<long long> intervalNs;
+	std::atomic<long long> lastSubmitted;
+	std::atomic<uint32_t> resetMask;
+
+	PublishedResult results[MAX_FACES];
+
+	std::atomic<uint64_t> analysedFrames;
+	std::atomic<long long> analysisTimeNs;
+};
+
+}
+
+#endif // __FaceAnalysisWorker_h__
@@ -0,0 +1,102 @@
+#include "FaceSnapshot.h"
+#include <string.h>
+
+namespace VisageSDK
+{
+
+// groups kept in the feature point table and their highest kept index, in table order
+static const int SNAPSHOT_GROUPS[][2] = {
+	{2, 9},
+	{3, 14},
+	{4, 6},
+	{8, 10},
+	{9, 15},
+	{10, 24},
+	{12, 12},
+	{14, 25},
+	{15, 17},
+	{16, 28},
+	{17, 20}
+};
+
+static const int SNAPSHOT_GROUP_COUNT = sizeof(SNAPSHOT_GROUPS) / sizeof(SNAPSHOT_GROUPS[0]);
+
+static_assert(FaceSnapshotPoint(17, 20) == FACE_SNAPSHOT_POINTS - 1, "feature point table layout out of sync");
+
+static void CopyPoint3D(const FDP *fdp, int group, int n, float *dst)
+{
+	const FeaturePoint &fp = fdp->getFP(group, n);
+	dst[0] = fp.pos[0];
+	dst[1] = fp.pos[1];
+	dst[2] = fp.pos[2];
+}
+
+void TakeFaceSnapshot(const FaceData& faceData, FaceSnapshot& snapshot)
+{
+	const FDP *fdp = faceData.featurePoints2D;
+
+	for (int g = 0; g < SNAPSHOT_GROUP_COUNT; g++)
+	{
+		const int group = SNAPSHOT_GROUPS[g][0];
+
+		for (int n = 1; n <= SNAPSHOT_GROUPS[g][1]; n++)
+		{
+			const int i = FaceSnapshotPoint(group, n);
+
+			if (!fdp || !FDP::FPIsValid(group, n))
+			{
+				snapshot.x[i] = 0.0f;
+				snapshot.y[i] = 0.0f;
+				snapshot.quality[i] = -1.0f;
+				snapshot.flags[i] = 0;
+				continue;
+			}
+
+			const FeaturePoint &fp = fdp->getFP(group, n);
+			snapshot.x[i] = fp.pos[0];
+			snapshot.y[i] = fp.pos[1];
+			snapshot.quality[i] = fp.quality;
+
+			unsigned char flags = 0;
+			if (fp.defined)
+				flags |= FACE_POINT_DEFINED;
+			if (fp.defined && fp.detected && fp.pos[0] != 0 && fp.pos[1] != 0)
+				flags |= FACE_POINT_DRAWABLE;
+			snapshot.flags[i] = flags;
+		}
+	}
+
+	const FDP *fdp3D = faceData.featurePoints3D;
+	snapshot.has3D = fdp3D != 0;
+	snapshot.eyes3DDefined = false;
+
+	if (fdp3D)
+	{
+		snapshot.eyes3DDefined = fdp3D->getFP(3, 5).defined && fdp3D->getFP(3, 6).defined;
+		CopyPoint3D(fdp3D, 3, 5, snapshot.eyes3D[0]);
+		CopyPoint3D(fdp3D, 3, 6, snapshot.eyes3D[1]);
+
+		float brow1[3], brow2[3];
+		CopyPoint3D(fdp3D, 4, 1, brow1);
+		CopyPoint3D(fdp3D, 4, 2, brow2);
+		for (int i = 0; i < 3; i++)
+			snapshot.browCenter3D[i] = (brow1[i] + brow2[i]) / 2.0f;
+	}
+
+	memcpy(snapshot.faceTranslation, faceData.faceTranslation, sizeof(snapshot.faceTranslation));
+	memcpy(snapshot.faceRotation, faceData.faceRotation, sizeof(snapshot.faceRotation));
+	memcpy(snapshot.gazeDirectionGlobal, faceData.gazeDirectionGlobal, sizeof(snapshot.gazeDirectionGlobal));
+	memcpy(snapshot.eyeClosure, faceData.eyeClosure, sizeof(snapshot.eyeClosure));
+	memcpy(snapshot.irisRadius, faceData.irisRadius, sizeof(snapshot.irisRadius));
+	snapshot.cameraFocus = faceData.cameraFocus;
+	snapshot.trackingQuality = faceData.trackingQuality;
+	snapshot.faceScale = faceData.faceScale;
+
+	snapshot.gaze.index = faceData.gazeData.index;
+	snapshot.gaze.x = faceData.gazeData.x;
+	snapshot.gaze.y = faceData.gazeData.y;
+	snapshot.gaze.inState = faceData.gazeData.inState;
+	snapshot.gaze.quality = faceData.gazeData.quality;
+}
+
+}
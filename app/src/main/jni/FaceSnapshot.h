@@ -0,0 +1,93 @@
+#ifndef __FaceSnapshot_h__
+#define __FaceSnapshot_h__
+
+#include "FaceData.h"
+
+namespace VisageSDK
+{
+
+/** Number of feature points kept in a @ref FaceSnapshot.
+ *
+ * Groups 2, 3, 4, 8, 9, 10, 12, 14, 15, 16 and 17 are kept up to the highest index that is drawn or used for the
+ * bounding box, the other groups are not kept.
+ */
+static const int FACE_SNAPSHOT_POINTS = 180;
+
+/** Index of feature point n of the given group in the feature point table of a @ref FaceSnapshot, -1 if the point
+ * is not kept. Evaluated at compile time for constant arguments, so point lists resolve to table indices up front.
+ */
+constexpr int FaceSnapshotPoint(int group, int n)
+{
+	return (group == 2 && n >= 1 && n <= 9) ? n - 1 :
+		   (group == 3 && n >= 1 && n <= 14) ? 9 + n - 1 :
+		   (group == 4 && n >= 1 && n <= 6) ? 23 + n - 1 :
+		   (group == 8 && n >= 1 && n <= 10) ? 29 + n - 1 :
+		   (group == 9 && n >= 1 && n <= 15) ? 39 + n - 1 :
+		   (group == 10 && n >= 1 && n <= 24) ? 54 + n - 1 :
+		   (group == 12 && n >= 1 && n <= 12) ? 78 + n - 1 :
+		   (group == 14 && n >= 1 && n <= 25) ? 90 + n - 1 :
+		   (group == 15 && n >= 1 && n <= 17) ? 115 + n - 1 :
+		   (group == 16 && n >= 1 && n <= 28) ? 132 + n - 1 :
+		   (group == 17 && n >= 1 && n <= 20) ? 160 + n - 1 :
+		   -1;
+}
+
+/** Flags of a feature point in a @ref FaceSnapshot.
+ */
+enum FaceSnapshotPointFlags {
+	FACE_POINT_DEFINED = 1,		///< the point is defined in the 2D feature points
+	FACE_POINT_DRAWABLE = 2		///< defined, detected and not at the origin, i.e. drawn by VisageRendering
+};
+
+/** Screen space gaze of a face, the fields of ScreenSpaceGazeData exported to the application.
+ */
+struct FaceSnapshotGaze {
+	int index;		///< index of the frame
+	float x;		///< horizontal gaze position on screen
+	float y;		///< vertical gaze position on screen
+	int inState;	///< state of the screen space gaze estimator
+	float quality;	///< quality of the estimate
+};
+
+/** FaceSnapshot is a compact, fixed-size copy of the tracking results of one face.
+ *
+ * FaceData owns feature point sets, model vertices and action unit arrays on the heap, while the renderer, face
+ * selection and gaze export only read a few groups of 2D feature points, the pose and the gaze. A snapshot is taken
+ * once per tracked face and frame with @ref TakeFaceSnapshot and holds exactly that, so it can be copied with memcpy
+ * and read without FDP::getFP lookups.
+ *
+ * The 2D feature points are a structure of arrays indexed with @ref FaceSnapshotPoint, so drawing a point list walks
+ * contiguous coordinates.
+ */
+struct alignas(64) FaceSnapshot {
+	float x[FACE_SNAPSHOT_POINTS];					///< normalized 2D x coordinates
+	float y[FACE_SNAPSHOT_POINTS];					///< normalized 2D y coordinates, 0 at the bottom
+	float quality[FACE_SNAPSHOT_POINTS];			///< feature point quality, negative if not known
+	unsigned char flags[FACE_SNAPSHOT_POINTS];		///< @ref FaceSnapshotPointFlags
+
+	bool has3D;						///< false if the tracker did not return 3D feature points
+	bool eyes3DDefined;				///< true if both 3D eye centers are defined
+	float eyes3D[2][3];				///< 3D eye centers, points 3.5 and 3.6
+	float browCenter3D[3];			///< 3D point between the inner eyebrow ends 4.1 and 4.2, origin of the model axes
+
+	float faceTranslation[3];
+	float faceRotation[3];
+	float gazeDirectionGlobal[3];
+	float eyeClosure[2];
+	float irisRadius[2];
+	float cameraFocus;
+	float trackingQuality;
+	int faceScale;
+
+	FaceSnapshotGaze gaze;
+
+	unsigned int generation;		///< changes whenever the results of the face do, set by the tracking thread
+};
+
+/** Fills a snapshot from the tracking results of a face.
+ */
+void TakeFaceSnapshot(const FaceData& faceData, FaceSnapshot& snapshot);
+
+}
+
+#endif // __FaceSnapshot_h__
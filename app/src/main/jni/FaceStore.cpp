@@ -0,0 +1,62 @@
+#include "FaceStore.h"
+#include "VisageTracker.h"
+
+namespace VisageSDK
+{
+
+FaceStore::FaceStore()
+{
+	capacity = 0;
+	activeCount = 0;
+	trackedCount = 0;
+	SetCapacity(DEFAULT_FACE_CAPACITY);
+}
+
+void FaceStore::SetCapacity(int newCapacity)
+{
+	if (newCapacity < 1)
+		newCapacity = 1;
+	if (newCapacity > MAX_FACE_CAPACITY)
+		newCapacity = MAX_FACE_CAPACITY;
+
+	capacity = newCapacity;
+
+	// fresh objects, the tracker allocates their members on its first call
+	std::vector<FaceData>(capacity).swap(trackingData);
+	status.assign(capacity, TRACK_STAT_OFF);
+	animationEnabled.assign(capacity, 0);
+	boundingBox.assign(capacity, vsRect(0, 0, 0, 0));
+	active.assign(capacity, 0);
+	tracked.assign(capacity, 0);
+
+	activeCount = 0;
+	trackedCount = 0;
+}
+
+void FaceStore::Update(const int* newStatus)
+{
+	activeCount = 0;
+	trackedCount = 0;
+
+	for (int i = 0; i < capacity; i++)
+	{
+		const int s = newStatus[i];
+		status[i] = s;
+
+		if (s == TRACK_STAT_OFF)
+			continue;
+		active[activeCount++] = i;
+
+		if (s == TRACK_STAT_OK)
+			tracked[trackedCount++] = i;
+	}
+}
+
+void FaceStore::Clear()
+{
+	status.assign(capacity, TRACK_STAT_OFF);
+	activeCount = 0;
+	trackedCount = 0;
+}
+
+}
@@ -0,0 +1,100 @@
+#ifndef __FaceStore_h__
+#define __FaceStore_h__
+
+#include "FaceData.h"
+#include <vector>
+
+namespace VisageSDK
+{
+
+/** Number of faces tracked at the same time unless configured otherwise.
+ */
+static const int DEFAULT_FACE_CAPACITY = 4;
+
+/** Largest supported number of faces tracked at the same time.
+ */
+static const int MAX_FACE_CAPACITY = 16;
+
+/** FaceStore keeps the per-face state of the tracking wrapper for a face capacity chosen at runtime.
+ *
+ * All per-face values live in parallel arrays of the same capacity (structure of arrays): the tracker output passed
+ * to VisageTracker::track, a copy of the returned statuses, the wireframe animation flags and the bounding boxes used
+ * for face selection. After every frame @ref Update rebuilds two index lists, the active faces (any status other than
+ * TRACK_STAT_OFF) and the tracked faces (TRACK_STAT_OK), in ascending order, so per-frame work walks only the faces
+ * that are actually present instead of all slots.
+ */
+class FaceStore {
+
+public:
+
+	FaceStore();
+
+	/** Sets the number of faces and resets all per-face state.
+	* The tracker output array is reallocated, so this must only be called before the tracker is created.
+	* @param capacity number of faces, clamped to 1 .. MAX_FACE_CAPACITY
+	*/
+	void SetCapacity(int capacity);
+
+	int GetCapacity() const { return capacity; }
+
+	/** Array of GetCapacity() faces that receives the tracking results from VisageTracker::track.
+	*/
+	FaceData* GetTrackingData() { return &trackingData[0]; }
+
+	const FaceData& GetFaceData(int face) const { return trackingData[face]; }
+
+	/** Copies the statuses returned by VisageTracker::track and rebuilds the lists of active and tracked faces.
+	*/
+	void Update(const int* status);
+
+	/** Sets all faces to TRACK_STAT_OFF.
+	*/
+	void Clear();
+
+	int GetStatus(int face) const { return status[face]; }
+
+	const int* GetStatuses() const { return &status[0]; }
+
+	/** Number of faces with a status other than TRACK_STAT_OFF.
+	*/
+	int GetActiveCount() const { return activeCount; }
+
+	/** Index of the n-th active face.
+	*/
+	int GetActive(int n) const { return active[n]; }
+
+	/** Number of faces with TRACK_STAT_OK.
+	*/
+	int GetTrackedCount() const { return trackedCount; }
+
+	/** Index of the n-th tracked face, GetTracked(0) is the tracked face with the smallest index.
+	*/
+	int GetTracked(int n) const { return tracked[n]; }
+
+	bool IsAnimationEnabled(int face) const { return animationEnabled[face] != 0; }
+
+	void SetAnimationEnabled(int face, bool enabled) { animationEnabled[face] = enabled; }
+
+	VsRect& GetBoundingBox(int face) { return boundingBox[face]; }
+
+private:
+
+	FaceStore(const FaceStore&);
+	FaceStore& operator=(const FaceStore&);
+
+	int capacity;
+
+	std::vector<FaceData> trackingData;
+	std::vector<int> status;
+	std::vector<unsigned char> animationEnabled;
+	std::vector<VsRect> boundingBox;
+
+	std::vector<int> active;
+	int activeCount;
+	std::vector<int> tracked;
+	int trackedCount;
+};
+
+}
+
+#endif // __FaceStore_h__
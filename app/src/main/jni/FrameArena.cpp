@@ -0,0 +1,111 @@
+#include "FrameArena.h"
+#include "PipelineMetrics.h"
+#include <stdlib.h>
+
+namespace VisageSDK
+{
+
+static inline size_t AlignUp(size_t value)
+{
+	return (value + FrameArena::ALIGNMENT - 1) & ~(FrameArena::ALIGNMENT - 1);
+}
+
+FrameArena& FrameArena::Shared()
+{
+	static FrameArena arena;
+	return arena;
+}
+
+FrameArena::FrameArena(size_t initialSize)
+{
+	current = 0;
+	offset = 0;
+	used = 0;
+	peak = 0;
+	this->initialSize = initialSize;
+	heapAllocations = 0;
+}
+
+FrameArena::~FrameArena()
+{
+	while (current)
+	{
+		Block* previous = current->previous;
+		free(current);
+		current = previous;
+	}
+}
+
+unsigned char* FrameArena::Data(Block* block)
+{
+	return (unsigned char*) AlignUp((size_t) (block + 1));
+}
+
+FrameArena::Block* FrameArena::NewBlock(size_t size)
+{
+	// room to align the data behind the header
+	Block* block = (Block*) malloc(sizeof(Block) + ALIGNMENT + size);
+	if (!block)
+		return 0;
+
+	block->previous = 0;
+	block->size = size;
+	heapAllocations++;
+	PipelineMetrics::Shared().Count(COUNTER_OVERLAY_ALLOCATIONS);
+	return block;
+}
+
+void* FrameArena::Allocate(size_t bytes)
+{
+	size_t start = AlignUp(offset);
+
+	if (!current || start + bytes > current->size)
+	{
+		// blocks double, so a frame that outgrows the arena needs only a few of them
+		size_t size = current ? 2 * current->size : initialSize;
+		if (size < bytes)
+			size = AlignUp(bytes);
+
+		Block* block = NewBlock(size);
+		if (!block)
+			return 0;
+
+		block->previous = current;
+		used += offset;
+		current = block;
+		start = 0;
+	}
+
+	offset = start + bytes;
+	return Data(current) + start;
+}
+
+void FrameArena::Reset()
+{
+	if (GetUsed() > peak)
+		peak = GetUsed();
+
+	// the frame did not fit into one block, the next one gets a block as large as all of them
+	if (current && current->previous)
+	{
+		size_t size = 0;
+		while (current)
+		{
+			Block* previous = current->previous;
+			size += current->size;
+			free(current);
+			current = previous;
+		}
+		current = NewBlock(size);
+	}
+
+	offset = 0;
+	used = 0;
+}
+
+size_t FrameArena::GetPeak() const
+{
+	return GetUsed() > peak ? GetUsed() : peak;
+}
+
+}
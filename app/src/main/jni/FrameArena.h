@@ -0,0 +1,93 @@
+#ifndef __FrameArena_h__
+#define __FrameArena_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace VisageSDK
+{
+
+/** FrameArena hands out scratch memory for the overlay geometry of one frame by bumping a pointer.
+ *
+ * Nothing is freed individually, @ref Reset releases everything allocated since the previous reset at once. When a frame
+ * needs more than the current block another block is taken from the heap, and the next @ref Reset replaces all blocks
+ * by a single one large enough for the whole frame. Once the overlays of a frame have been drawn in their current
+ * configuration (number of faces, display options), frames are served without touching the heap.
+ *
+ * Every heap allocation is counted in @ref GetHeapAllocations and in the overlay_allocations pipeline counter.
+ * Memory is not initialized and destructors are not run, only plain data may be allocated. Not thread-safe.
+ */
+class FrameArena {
+
+public:
+
+	/** Alignment of all allocations, enough for any vector type.
+	*/
+	static const size_t ALIGNMENT = 16;
+
+	/** Arena of the GL thread.
+	*/
+	static FrameArena& Shared();
+
+	/** Constructor.
+	* @param initialSize - size of the first block in bytes, allocated on the first @ref Allocate
+	*/
+	explicit FrameArena(size_t initialSize = 64 * 1024);
+
+	~FrameArena();
+
+	/** Allocates bytes, aligned to @ref ALIGNMENT. Valid until the next @ref Reset.
+	*/
+	void* Allocate(size_t bytes);
+
+	/** Allocates an array of count uninitialized elements.
+	*/
+	template <typename T>
+	T* Allocate(size_t count)
+	{
+		return static_cast<T*>(Allocate(count * sizeof(T)));
+	}
+
+	/** Releases all allocations. If the last frame did not fit into one block, the blocks are replaced by one
+	* that holds all of it.
+	*/
+	void Reset();
+
+	/** Bytes allocated since the last @ref Reset, including alignment.
+	*/
+	size_t GetUsed() const { return used + offset; }
+
+	/** Largest number of bytes used within one frame so far.
+	*/
+	size_t GetPeak() const;
+
+	/** Number of blocks taken from the heap since the arena was created.
+	*/
+	uint64_t GetHeapAllocations() const { return heapAllocations; }
+
+private:
+
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+
+	struct Block {
+		Block* previous;
+		size_t size;
+	};
+
+	Block* NewBlock(size_t size);
+	static unsigned char* Data(Block* block);
+
+	// newest block, allocations are taken from it
+	Block* current;
+	size_t offset;
+	// bytes used in the blocks before the current one
+	size_t used;
+	size_t peak;
+	size_t initialSize;
+	uint64_t heapAllocations;
+};
+
+}
+
+#endif // __FrameArena_h__
@@ -0,0 +1,155 @@
+#include "FrameGovernor.h"
+
+namespace VisageSDK
+{
+
+// weight of a new sample in the running averages, 1/AVERAGE_WEIGHT
+static const int AVERAGE_WEIGHT = 16;
+
+// range and step of the feedback multiplier, in 1/1000
+static const int PACING_MIN = 500;
+static const int PACING_MAX = 1500;
+static const int PACING_DEFAULT = 1000;
+static const int PACING_STEP = 10;
+
+// default latency bound for holding back frames
+static const long long DEFAULT_MAX_DELAY_NS = 100000000LL;
+
+FrameGovernor::FrameGovernor()
+{
+	enabled.store(true);
+	maxDelayNs.store(DEFAULT_MAX_DELAY_NS);
+	Reset();
+}
+
+void FrameGovernor::SetEnabled(bool enabled)
+{
+	this->enabled.store(enabled);
+}
+
+void FrameGovernor::Reset()
+{
+	lastTimestamp = 0;
+	lastAdmitted = 0;
+	lastDropped = 0;
+	trackerGrabbed.store(0);
+
+	cameraInterval.store(0);
+	convertTime.store(0);
+	trackTime.store(0);
+	trackBusy.store(0);
+	trackWait.store(0);
+
+	pacing.store(PACING_DEFAULT);
+
+	admitted.store(0);
+	skipped.store(0);
+}
+
+void FrameGovernor::Average(std::atomic<long long>& average, long long sample)
+{
+	// each average has a single writer, so load and store do not race with another update
+	long long current = average.load(std::memory_order_relaxed);
+	average.store(current == 0 ? sample : current + (sample - current) / AVERAGE_WEIGHT, std::memory_order_relaxed);
+}
+
+bool FrameGovernor::AdmitFrame(long long sensorTimestamp, long long now)
+{
+	if (lastTimestamp != 0 && sensorTimestamp > lastTimestamp)
+		Average(cameraInterval, sensorTimestamp - lastTimestamp);
+	lastTimestamp = sensorTimestamp;
+
+	bool admit = true;
+
+	const long long camera = cameraInterval.load(std::memory_order_relaxed);
+	const long long busy = trackBusy.load(std::memory_order_relaxed);
+	const long long grabbed = trackerGrabbed.load(std::memory_order_relaxed);
+
+	if (enabled.load(std::memory_order_relaxed) && lastAdmitted != 0 && camera > 0 && busy > 0 && grabbed > 0)
+	{
+		// the tracker is expected to take its next frame at freeAt; skip this frame if the next camera frame
+		// would still be converted by then
+		const long long freeAt = grabbed + busy * pacing.load(std::memory_order_relaxed) / 1000;
+		const long long nextReady = now + camera + convertTime.load(std::memory_order_relaxed);
+
+		admit = nextReady > freeAt || sensorTimestamp - lastAdmitted >= maxDelayNs.load(std::memory_order_relaxed);
+	}
+
+	if (admit)
+	{
+		lastAdmitted = sensorTimestamp;
+		admitted.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		skipped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return admit;
+}
+
+void FrameGovernor::OnFrameConverted(long long convertNs, uint64_t droppedTotal)
+{
+	Average(convertTime, convertNs);
+
+	// a converted frame was overwritten before the tracker took it, admit less often
+	if (droppedTotal > lastDropped)
+	{
+		int p = pacing.load(std::memory_order_relaxed) + PACING_STEP * (int) (droppedTotal - lastDropped);
+		pacing.store(p > PACING_MAX ? PACING_MAX : p, std::memory_order_relaxed);
+	}
+	lastDropped = droppedTotal;
+}
+
+void FrameGovernor::OnFrameGrabbed(long long grabbed)
+{
+	trackerGrabbed.store(grabbed, std::memory_order_relaxed);
+}
+
+void FrameGovernor::OnFrameTracked(long long trackNs, long long busyNs, long long waitNs)
+{
+	Average(trackTime, trackNs);
+	Average(trackWait, waitNs);
+	Average(trackBusy, busyNs);
+
+	// the tracker waited for a frame noticeably longer than conversion takes, admit more often
+	const long long camera = cameraInterval.load(std::memory_order_relaxed);
+	if (camera > 0 && waitNs > camera / 2)
+	{
+		int p = pacing.load(std::memory_order_relaxed) - PACING_STEP;
+		pacing.store(p < PACING_MIN ? PACING_MIN : p, std::memory_order_relaxed);
+	}
+}
+
+void FrameGovernor::GetAverages(float& cameraMs, float& convertMs, float& trackMs, float& busyMs, float& waitMs) const
+{
+	cameraMs = cameraInterval.load(std::memory_order_relaxed) / 1000000.0f;
+	convertMs = convertTime.load(std::memory_order_relaxed) / 1000000.0f;
+	trackMs = trackTime.load(std::memory_order_relaxed) / 1000000.0f;
+	busyMs = trackBusy.load(std::memory_order_relaxed) / 1000000.0f;
+	waitMs = trackWait.load(std::memory_order_relaxed) / 1000000.0f;
+}
+
+CaptureRecommendation FrameGovernor::GetRecommendation() const
+{
+	CaptureRecommendation recommendation = {0, 1};
+
+	const long long camera = cameraInterval.load(std::memory_order_relaxed);
+	const long long track = trackBusy.load(std::memory_order_relaxed);
+	const long long convert = convertTime.load(std::memory_order_relaxed);
+
+	if (camera <= 0 || track <= 0)
+		return recommendation;
+
+	// the tracker cannot take frames faster than it tracks them
+	const long long sustainable = (track > camera) ? track : camera;
+	recommendation.fps = (int) (1000000000LL / sustainable);
+
+	// conversion taking a large part of the frame time on the camera thread means the frames are bigger than needed
+	if (convert * 4 > camera || track > 2 * camera)
+		recommendation.resolutionDivisor = 2;
+
+	return recommendation;
+}
+
+}
@@ -0,0 +1,121 @@
+#ifndef __FrameGovernor_h__
+#define __FrameGovernor_h__
+
+#include <atomic>
+#include <cstdint>
+
+namespace VisageSDK
+{
+
+/** Capture settings suggested by @ref FrameGovernor.
+ */
+struct CaptureRecommendation {
+	int fps;		///< frame rate the pipeline can sustain, 0 if there is no recommendation yet
+	int resolutionDivisor;	///< 1 to keep the capture resolution, 2 if each dimension should be halved
+};
+
+/** FrameGovernor paces camera frame ingest to the rate at which the tracker actually consumes frames.
+ *
+ * The camera delivers frames at its own rate and the tracker always takes the newest one, so when tracking
+ * is slower than the camera most converted frames are overwritten before anybody looks at them. The governor
+ * keeps running averages of the camera frame interval, the conversion time and the time the tracking thread is busy
+ * with a frame. From the moment the tracker took its current frame it predicts when it will be free again, and a
+ * camera frame is skipped if the next one would still be converted by then.
+ *
+ * A feedback factor corrects the prediction: it grows while frames are still dropped by the frame ring and
+ * shrinks when the tracker has to wait for frames. A frame is always admitted once the last admitted one is
+ * older than the latency bound, so gaze latency stays bounded even with a bad estimate.
+ *
+ * @ref AdmitFrame and @ref OnFrameConverted are called from the camera thread, @ref OnFrameTracked from the
+ * tracking thread.
+ */
+class FrameGovernor {
+
+public:
+
+	FrameGovernor();
+
+	/** Enables or disables pacing. When disabled every frame is admitted.
+	*/
+	void SetEnabled(bool enabled);
+
+	bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+	/** Longest time, in nanoseconds, a camera frame may be held back before the next one is admitted.
+	*/
+	void SetMaxFrameDelay(long long ns) { maxDelayNs.store(ns, std::memory_order_relaxed); }
+
+	/** Decides whether a camera frame should be converted and handed to the tracker.
+	* @param sensorTimestamp sensor timestamp of the frame in nanoseconds
+	* @param now current CLOCK_MONOTONIC time in nanoseconds
+	*/
+	bool AdmitFrame(long long sensorTimestamp, long long now);
+
+	/** Reports the wall time spent converting an admitted frame and the frame ring drop counter after it.
+	*/
+	void OnFrameConverted(long long convertNs, uint64_t droppedTotal);
+
+	/** Reports one tracking cycle.
+	* @param trackNs time spent in track()
+	* @param busyNs time the tracking thread spent on the frame in total (tracking, analysis, copies)
+	* @param waitNs time the tracking thread waited for the frame
+	*/
+	void OnFrameTracked(long long trackNs, long long busyNs, long long waitNs);
+
+	/** Reports that the tracking thread took a new frame at the given CLOCK_MONOTONIC time in nanoseconds.
+	*/
+	void OnFrameGrabbed(long long grabbed);
+
+	/** Clears all statistics, e.g. after the capture was recreated.
+	*/
+	void Reset();
+
+	/** Frame rate and resolution the pipeline can sustain, derived from the measured times.
+	*/
+	CaptureRecommendation GetRecommendation() const;
+
+	/** Running averages in milliseconds: camera frame interval, conversion time, track() time, busy and waiting time of
+	* the tracking thread per frame.
+	*/
+	void GetAverages(float& cameraMs, float& convertMs, float& trackMs, float& busyMs, float& waitMs) const;
+
+	/** Current feedback multiplier of the predicted busy time.
+	*/
+	float GetPacing() const { return pacing.load(std::memory_order_relaxed) / 1000.0f; }
+
+	uint64_t GetAdmittedFrames() const { return admitted.load(std::memory_order_relaxed); }
+
+	uint64_t GetSkippedFrames() const { return skipped.load(std::memory_order_relaxed); }
+
+private:
+
+	static void Average(std::atomic<long long>& average, long long sample);
+
+	std::atomic<bool> enabled;
+	std::atomic<long long> maxDelayNs;
+
+	// camera thread
+	long long lastTimestamp;
+	long long lastAdmitted;
+	uint64_t lastDropped;
+
+	// CLOCK_MONOTONIC time at which the tracker took its current frame, 0 if unknown
+	std::atomic<long long> trackerGrabbed;
+
+	// running averages in nanoseconds, 0 until the first sample
+	std::atomic<long long> cameraInterval;
+	std::atomic<long long> convertTime;
+	std::atomic<long long> trackTime;
+	std::atomic<long long> trackBusy;
+	std::atomic<long long> trackWait;
+
+	// feedback multiplier of the predicted busy time, in 1/1000
+	std::atomic<int> pacing;
+
+	std::atomic<uint64_t> admitted;
+	std::atomic<uint64_t> skipped;
+};
+
+}
+
+#endif // __FrameGovernor_h__
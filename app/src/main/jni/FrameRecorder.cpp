@@ -0,0 +1,367 @@
+#include "FrameRecorder.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+
+#define  LOG_TAG    "FrameRecorder"
+#define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,LOG_TAG,__VA_ARGS__)
+#define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
+#else
+#include <cstdio>
+
+#define  LOGI(...)  (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define  LOGE(...)  (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#endif
+
+namespace VisageSDK
+{
+
+// the camera thread signals the flusher without taking the mutex, so a wakeup can be missed;
+// the flusher then picks the frame up after at most this long
+static const long FLUSH_POLL_NS = 20000000L;
+
+// staging slots are aligned like the records in the file
+static const size_t SLOT_ALIGNMENT = YUV_RECORD_ALIGNMENT;
+
+FrameRecorder::FrameRecorder()
+{
+	recording.store(false);
+	writers.store(0);
+	slotCapacity = 0;
+	queued.store(0);
+	flushed.store(0);
+	fd = -1;
+	chunkSize = 0;
+	chunk = 0;
+	chunkIndex = 0;
+	fileOffset = 0;
+	failed = false;
+	stopRequested.store(false);
+	recorded.store(0);
+	dropped.store(0);
+	bytesWritten.store(0);
+
+	pthread_mutex_init(&wakeMutex, 0);
+	pthread_cond_init(&wakeCond, 0);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	Stop();
+
+	pthread_cond_destroy(&wakeCond);
+	pthread_mutex_destroy(&wakeMutex);
+}
+
+bool FrameRecorder::Start(const char* path, int bufferFrames, size_t chunkBytes)
+{
+	if (recording.load() || fd != -1)
+		return false;
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1)
+	{
+		LOGE("Cannot create recording %s", path);
+		return false;
+	}
+
+	const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+	chunkSize = (chunkBytes + pageSize - 1) / pageSize * pageSize;
+	chunkIndex = 0;
+	fileOffset = 0;
+	failed = false;
+
+	// the header goes in before the flusher starts, records follow at the next aligned offset
+	YuvRecordingHeader header;
+	memcpy(header.magic, YUV_RECORDING_MAGIC, sizeof(header.magic));
+	header.version = YUV_RECORDING_VERSION;
+	header.headerSize = sizeof(YuvRecordingHeader);
+
+	if (!MapChunk(0) || !Append((const unsigned char*) &header, sizeof(header)))
+	{
+		UnmapChunk();
+		close(fd);
+		fd = -1;
+		unlink(path);
+		return false;
+	}
+	fileOffset = (fileOffset + YUV_RECORD_ALIGNMENT - 1) & ~(size_t) (YUV_RECORD_ALIGNMENT - 1);
+
+	// slot memory is allocated with the first frame, when the frame size is known
+	slots.assign(bufferFrames > 0 ? bufferFrames : 1, (unsigned char*) 0);
+	slotCapacity = 0;
+	queued.store(0);
+	flushed.store(0);
+
+	recorded.store(0);
+	dropped.store(0);
+	bytesWritten.store(fileOffset);
+
+	stopRequested.store(false);
+	if (pthread_create(&flusher, 0, FlusherThread, this) != 0)
+	{
+		LOGE("Cannot start the recording flusher");
+		UnmapChunk();
+		close(fd);
+		fd = -1;
+		return false;
+	}
+
+	recording.store(true);
+
+	LOGI("Recording camera frames to %s", path);
+	return true;
+}
+
+void FrameRecorder::Stop()
+{
+	if (fd == -1)
+		return;
+
+	// no new frames, and wait for a frame being queued right now
+	recording.store(false);
+	while (writers.load() != 0)
+		sched_yield();
+
+	stopRequested.store(true);
+	pthread_mutex_lock(&wakeMutex);
+	pthread_cond_signal(&wakeCond);
+	pthread_mutex_unlock(&wakeMutex);
+	pthread_join(flusher, 0);
+
+	// the flusher wrote everything that was queued, cut off the rest of the last chunk
+	UnmapChunk();
+	if (ftruncate(fd, (off_t) fileOffset) != 0)
+		LOGE("Cannot truncate the recording");
+	close(fd);
+	fd = -1;
+
+	ReleaseSlots();
+
+	LOGI("Recorded %llu frames (%llu dropped), %llu bytes", (unsigned long long) recorded.load(),
+		 (unsigned long long) dropped.load(), (unsigned long long) bytesWritten.load());
+}
+
+bool FrameRecorder::RecordFrame(const YuvFrame& frame, size_t ySize, size_t uSize, size_t vSize,
+								long long timestamp, int orientation, int flip)
+{
+	writers.fetch_add(1);
+	if (!recording.load())
+	{
+		writers.fetch_sub(1);
+		return false;
+	}
+
+	const uint64_t head = queued.load(std::memory_order_relaxed);
+	const uint64_t tail = flushed.load(std::memory_order_acquire);
+	const size_t recordSize = YuvFrameRecordSize((uint32_t) ySize, (uint32_t) uSize, (uint32_t) vSize);
+
+	bool queuedFrame = false;
+
+	if (recordSize > slotCapacity && head == tail)
+	{
+		// first frame or a larger one: the flusher is idle, so the slots can be replaced
+		ReleaseSlots();
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			void* memory = 0;
+			if (posix_memalign(&memory, SLOT_ALIGNMENT, recordSize) != 0)
+			{
+				ReleaseSlots();
+				break;
+			}
+			slots[i] = (unsigned char*) memory;
+		}
+		if (slots[0])
+			slotCapacity = recordSize;
+	}
+
+	if (recordSize <= slotCapacity && head - tail < slots.size())
+	{
+		unsigned char* slot = slots[head % slots.size()];
+
+		YuvFrameRecord record;
+		memset(&record, 0, sizeof(record));
+		record.magic = YUV_FRAME_RECORD_MAGIC;
+		record.recordSize = (uint32_t) recordSize;
+		record.timestamp = timestamp;
+		record.width = frame.width;
+		record.height = frame.height;
+		record.yRowStride = frame.yRowStride;
+		record.uvRowStride = frame.uvRowStride;
+		record.uvPixelStride = frame.uvPixelStride;
+		record.ySize = (uint32_t) ySize;
+		record.uSize = (uint32_t) uSize;
+		record.vSize = (uint32_t) vSize;
+		record.orientation = orientation;
+		record.flip = flip;
+
+		unsigned char* p = slot;
+		memcpy(p, &record, sizeof(record));
+		p += sizeof(record);
+		memcpy(p, frame.y, ySize);
+		p += ySize;
+		memcpy(p, frame.u, uSize);
+		p += uSize;
+		memcpy(p, frame.v, vSize);
+		p += vSize;
+		memset(p, 0, recordSize - (p - slot));
+
+		queued.store(head + 1, std::memory_order_release);
+		pthread_cond_signal(&wakeCond);
+		queuedFrame = true;
+	}
+	else
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	writers.fetch_sub(1);
+	return queuedFrame;
+}
+
+void* FrameRecorder::FlusherThread(void* recorder)
+{
+	((FrameRecorder*) recorder)->Flush();
+	return 0;
+}
+
+void FrameRecorder::Flush()
+{
+	for (;;)
+	{
+		uint64_t head = queued.load(std::memory_order_acquire);
+		uint64_t tail = flushed.load(std::memory_order_relaxed);
+
+		if (head == tail)
+		{
+			// Stop sets the flag only after the last frame was queued
+			if (stopRequested.load())
+			{
+				if (queued.load(std::memory_order_acquire) == tail)
+					break;
+				continue;
+			}
+
+			struct timespec until;
+			clock_gettime(CLOCK_REALTIME, &until);
+			until.tv_nsec += FLUSH_POLL_NS;
+			if (until.tv_nsec >= 1000000000L)
+			{
+				until.tv_sec++;
+				until.tv_nsec -= 1000000000L;
+			}
+
+			pthread_mutex_lock(&wakeMutex);
+			if (queued.load(std::memory_order_acquire) == tail && !stopRequested.load())
+				pthread_cond_timedwait(&wakeCond, &wakeMutex, &until);
+			pthread_mutex_unlock(&wakeMutex);
+			continue;
+		}
+
+		for (; tail != head; tail++)
+		{
+			const unsigned char* slot = slots[tail % slots.size()];
+			const size_t size = ((const YuvFrameRecord*) slot)->recordSize;
+
+			if (!failed && Append(slot, size))
+			{
+				recorded.fetch_add(1, std::memory_order_relaxed);
+				bytesWritten.store(fileOffset, std::memory_order_relaxed);
+			}
+			else
+			{
+				failed = true;
+				dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			// the slot can be reused by the camera thread
+			flushed.store(tail + 1, std::memory_order_release);
+		}
+	}
+}
+
+bool FrameRecorder::Append(const unsigned char* data, size_t size)
+{
+	while (size > 0)
+	{
+		const size_t index = fileOffset / chunkSize;
+		if (index != chunkIndex || !chunk)
+		{
+			UnmapChunk();
+			if (!MapChunk(index))
+				return false;
+		}
+
+		const size_t offset = fileOffset - chunkIndex * chunkSize;
+		const size_t n = (size < chunkSize - offset) ? size : chunkSize - offset;
+
+		memcpy(chunk + offset, data, n);
+		data += n;
+		size -= n;
+		fileOffset += n;
+	}
+
+	return true;
+}
+
+bool FrameRecorder::MapChunk(size_t index)
+{
+	// reserve the blocks first: a mapped page that cannot be backed by the disk would fault during the copy
+	const off_t offset = (off_t) (index * chunkSize);
+	int error = posix_fallocate(fd, offset, (off_t) chunkSize);
+	if (error != 0)
+	{
+		LOGE("Cannot extend the recording by %zu bytes (error %d), further frames are dropped", chunkSize, error);
+		return false;
+	}
+
+	void* address = mmap(0, chunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+	if (address == MAP_FAILED)
+	{
+		LOGE("Cannot map recording chunk %zu", index);
+		return false;
+	}
+
+	chunk = (unsigned char*) address;
+	chunkIndex = index;
+	return true;
+}
+
+void FrameRecorder::UnmapChunk()
+{
+	if (!chunk)
+		return;
+
+	// written back by the kernel in the background, nothing waits for the disk here
+	munmap(chunk, chunkSize);
+	chunk = 0;
+}
+
+void FrameRecorder::ReleaseSlots()
+{
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		free(slots[i]);
+		slots[i] = 0;
+	}
+	slotCapacity = 0;
+}
+
+FrameRecorderStats FrameRecorder::GetStats() const
+{
+	FrameRecorderStats stats;
+	stats.recorded = recorded.load(std::memory_order_relaxed);
+	stats.dropped = dropped.load(std::memory_order_relaxed);
+	stats.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+	return stats;
+}
+
+}
@@ -0,0 +1,116 @@
+#ifndef __FrameRecorder_h__
+#define __FrameRecorder_h__
+
+#include "YuvConverter.h"
+#include "YuvRecording.h"
+#include <pthread.h>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace VisageSDK
+{
+
+/** Counters reported by @ref FrameRecorder.
+ */
+struct FrameRecorderStats {
+	uint64_t recorded;		///< frames written to the file
+	uint64_t dropped;		///< frames that could not be queued or written
+	uint64_t bytesWritten;	///< size of the recording so far
+};
+
+/** FrameRecorder writes raw camera frames into a recording (see YuvRecording.h) for later replay with
+ * @ref ReplayFrameSource.
+ *
+ * @ref RecordFrame is called on the camera thread and never blocks: the frame is copied into one of a bounded
+ * number of staging slots and a background flusher thread appends it to the file. When all slots are taken the
+ * frame is dropped and counted instead of stalling the camera.
+ *
+ * The file grows in chunks that are reserved on disk and then memory-mapped, so the flusher writes with plain
+ * memory copies and running out of space is noticed when a chunk is reserved rather than as a fault during the copy.
+ * @ref Stop truncates the file to the recorded frames.
+ */
+class FrameRecorder {
+
+public:
+
+	FrameRecorder();
+
+	~FrameRecorder();
+
+	/** Creates the recording and starts the flusher thread.
+	* @param path file to write, replaced if it exists
+	* @param bufferFrames number of frames that can be waiting for the flusher
+	* @param chunkBytes size by which the file grows, rounded up to whole pages
+	* @return false if already recording or the file cannot be created
+	*/
+	bool Start(const char* path, int bufferFrames = 8, size_t chunkBytes = 32 << 20);
+
+	/** Writes the frames still queued, finishes the file and stops the flusher. Can be called from any thread.
+	*/
+	void Stop();
+
+	bool IsRecording() const { return recording.load(std::memory_order_relaxed); }
+
+	/** Queues a frame for recording. Called from the camera thread only.
+	* @param frame frame planes and strides
+	* @param ySize, uSize, vSize sizes in bytes of the plane buffers
+	* @param timestamp sensor timestamp in nanoseconds
+	* @param orientation orientation of the capture
+	* @param flip 1 if the capture is mirrored
+	* @return false if the frame was dropped
+	*/
+	bool RecordFrame(const YuvFrame& frame, size_t ySize, size_t uSize, size_t vSize,
+					 long long timestamp, int orientation, int flip);
+
+	FrameRecorderStats GetStats() const;
+
+private:
+
+	static void* FlusherThread(void* recorder);
+
+	void Flush();
+
+	bool Append(const unsigned char* data, size_t size);
+
+	bool MapChunk(size_t index);
+
+	void UnmapChunk();
+
+	void ReleaseSlots();
+
+	FrameRecorder(const FrameRecorder&);
+	FrameRecorder& operator=(const FrameRecorder&);
+
+	std::atomic<bool> recording;
+	// camera threads currently inside RecordFrame, Stop waits for them before tearing down
+	std::atomic<int> writers;
+
+	// staging slots, written by the camera thread at 'queued' and read by the flusher at 'flushed'
+	std::vector<unsigned char*> slots;
+	size_t slotCapacity;
+	std::atomic<uint64_t> queued;
+	std::atomic<uint64_t> flushed;
+
+	// file, only touched by the flusher once it runs
+	int fd;
+	size_t chunkSize;
+	unsigned char* chunk;
+	size_t chunkIndex;
+	size_t fileOffset;
+	bool failed;
+
+	pthread_t flusher;
+	pthread_mutex_t wakeMutex;
+	pthread_cond_t wakeCond;
+	std::atomic<bool> stopRequested;
+
+	std::atomic<uint64_t> recorded;
+	std::atomic<uint64_t> dropped;
+	std::atomic<uint64_t> bytesWritten;
+};
+
+}
+
+#endif // __FrameRecorder_h__
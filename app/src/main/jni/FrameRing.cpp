@@ -0,0 +1,222 @@
+#include "FrameRing.h"
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace VisageSDK
+{
+
+static void futexWait(std::atomic<uint32_t>* word, uint32_t expected, const struct timespec* timeout)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, timeout, 0, 0);
+}
+
+static void futexWake(std::atomic<uint32_t>* word)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+}
+
+static long long monotonicNsec()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+FrameRing::FrameRing(int slots)
+{
+	slotCount = (slots < 3) ? 3 : slots;
+	this->slots = new std::atomic<uint64_t>[slotCount];
+	for (int i = 0; i < slotCount; i++)
+		this->slots[i].store(Pack(0, SLOT_FREE));
+
+	writeSlot = -1;
+	nextSequence = 0;
+	readSlot = -1;
+
+	published.store(0);
+	waiters.store(0);
+	wakeRequested.store(0);
+	produced.store(0);
+	consumed.store(0);
+	dropped.store(0);
+}
+
+FrameRing::~FrameRing()
+{
+	delete[] slots;
+}
+
+int FrameRing::BeginWrite()
+{
+	for (;;)
+	{
+		int oldest = -1;
+		uint64_t oldestWord = 0;
+
+		for (int i = 0; i < slotCount; i++)
+		{
+			uint64_t word = slots[i].load(std::memory_order_acquire);
+			if (StateOf(word) == SLOT_FREE)
+			{
+				// only the producer moves a slot out of the free state, so no compare-and-swap is needed
+				slots[i].store(Pack(SequenceOf(word), SLOT_WRITING), std::memory_order_relaxed);
+				writeSlot = i;
+				return i;
+			}
+			if (StateOf(word) == SLOT_READY && (oldest == -1 || SequenceOf(word) < SequenceOf(oldestWord)))
+			{
+				oldest = i;
+				oldestWord = word;
+			}
+		}
+
+		// consumer is behind, overwrite the oldest frame it has not taken yet
+		if (oldest != -1 && slots[oldest].compare_exchange_strong(oldestWord, Pack(SequenceOf(oldestWord), SLOT_WRITING),
+																  std::memory_order_acquire))
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			writeSlot = oldest;
+			return oldest;
+		}
+		// lost the race against the consumer, which has freed a slot in the meantime
+	}
+}
+
+uint64_t FrameRing::EndWrite()
+{
+	uint64_t sequence = ++nextSequence;
+
+	slots[writeSlot].store(Pack(sequence, SLOT_READY), std::memory_order_release);
+	writeSlot = -1;
+
+	produced.fetch_add(1, std::memory_order_relaxed);
+
+	published.fetch_add(1);
+	if (waiters.load() > 0)
+		futexWake(&published);
+
+	return sequence;
+}
+
+int FrameRing::TakeLatestReady(uint64_t& sequence)
+{
+	for (;;)
+	{
+		int latest = -1;
+		uint64_t latestWord = 0;
+
+		for (int i = 0; i < slotCount; i++)
+		{
+			uint64_t word = slots[i].load(std::memory_order_acquire);
+			if (StateOf(word) == SLOT_READY && (latest == -1 || SequenceOf(word) > SequenceOf(latestWord)))
+			{
+				latest = i;
+				latestWord = word;
+			}
+		}
+
+		if (latest == -1)
+			return -1;
+
+		if (!slots[latest].compare_exchange_strong(latestWord, Pack(SequenceOf(latestWord), SLOT_READING),
+												   std::memory_order_acquire))
+			continue; // reclaimed by the producer, look again
+
+		// anything older than the frame just taken will never be consumed
+		for (int i = 0; i < slotCount; i++)
+		{
+			uint64_t word = slots[i].load(std::memory_order_relaxed);
+			if (StateOf(word) == SLOT_READY && SequenceOf(word) < SequenceOf(latestWord) &&
+				slots[i].compare_exchange_strong(word, Pack(SequenceOf(word), SLOT_FREE), std::memory_order_release))
+				dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		sequence = SequenceOf(latestWord);
+		return latest;
+	}
+}
+
+int FrameRing::AcquireLatest(int timeoutMs, uint64_t* sequence)
+{
+	// the previous frame is no longer in use
+	if (readSlot != -1)
+	{
+		uint64_t word = slots[readSlot].load(std::memory_order_relaxed);
+		slots[readSlot].store(Pack(SequenceOf(word), SLOT_FREE), std::memory_order_release);
+		readSlot = -1;
+	}
+
+	const long long deadline = (timeoutMs < 0) ? 0 : monotonicNsec() + timeoutMs * 1000000LL;
+
+	for (;;)
+	{
+		if (wakeRequested.exchange(0))
+			return -1;
+
+		uint32_t seen = published.load();
+
+		uint64_t s;
+		int slot = TakeLatestReady(s);
+		if (slot != -1)
+		{
+			readSlot = slot;
+			consumed.fetch_add(1, std::memory_order_relaxed);
+			if (sequence)
+				*sequence = s;
+			return slot;
+		}
+
+		struct timespec remaining;
+		struct timespec* timeout = 0;
+		if (timeoutMs >= 0)
+		{
+			long long left = deadline - monotonicNsec();
+			if (left <= 0)
+				return -1;
+			remaining.tv_sec = left / 1000000000LL;
+			remaining.tv_nsec = left % 1000000000LL;
+			timeout = &remaining;
+		}
+
+		// returns immediately if anything was published since 'seen' was read
+		waiters.fetch_add(1);
+		futexWait(&published, seen, timeout);
+		waiters.fetch_sub(1);
+	}
+}
+
+void FrameRing::Wake()
+{
+	wakeRequested.store(1);
+	published.fetch_add(1);
+	futexWake(&published);
+}
+
+void FrameRing::Reset()
+{
+	for (int i = 0; i < slotCount; i++)
+	{
+		uint64_t word = slots[i].load(std::memory_order_relaxed);
+		if (StateOf(word) == SLOT_READY)
+			dropped.fetch_add(1, std::memory_order_relaxed);
+		slots[i].store(Pack(SequenceOf(word), SLOT_FREE), std::memory_order_release);
+	}
+
+	writeSlot = -1;
+	readSlot = -1;
+	wakeRequested.store(0);
+}
+
+FrameRingStats FrameRing::GetStats() const
+{
+	FrameRingStats stats;
+	stats.produced = produced.load(std::memory_order_relaxed);
+	stats.consumed = consumed.load(std::memory_order_relaxed);
+	stats.dropped = dropped.load(std::memory_order_relaxed);
+	return stats;
+}
+
+}
@@ -0,0 +1,115 @@
+#ifndef __FrameRing_h__
+#define __FrameRing_h__
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+namespace VisageSDK
+{
+
+/** Frame counters reported by @ref FrameRing.
+ */
+struct FrameRingStats {
+	uint64_t produced;	///< frames published by the producer
+	uint64_t consumed;	///< frames handed out to the consumer
+	uint64_t dropped;	///< published frames that were overwritten or skipped before being consumed
+};
+
+/** FrameRing is a lock-free single-producer/single-consumer ring of frame slots with latest-frame-wins semantics.
+ *
+ * The ring only manages slot ownership; the frame payload lives in arrays owned by the user and indexed by slot.
+ * Every slot is in one of four states (free, being written, ready, being read) which are changed with
+ * compare-and-swap, so neither side ever waits for the other. The producer writes into a free slot, or
+ * reclaims the oldest ready one when the consumer falls behind. The consumer always takes the ready slot with
+ * the highest sequence number and discards the older ones, keeping it until its next @ref AcquireLatest.
+ *
+ * A consumer with nothing to read sleeps on a futex holding the publication counter, so a wakeup costs a
+ * single syscall and only when somebody is actually waiting. Timeouts are relative and use the monotonic clock.
+ */
+class FrameRing {
+
+public:
+
+	/** Constructor.
+	*
+	* @param slots number of slots, at least 3 so that the producer never has to wait
+	*/
+	FrameRing(int slots = 3);
+
+	~FrameRing();
+
+	int GetSlotCount() const { return slotCount; }
+
+	/** Claims a slot for writing. Never blocks.
+	* @return slot index whose payload may be filled until @ref EndWrite
+	*/
+	int BeginWrite();
+
+	/** Publishes the slot claimed with @ref BeginWrite and wakes the consumer.
+	* @return sequence number assigned to the frame, starting at 1
+	*/
+	uint64_t EndWrite();
+
+	/** Releases the slot held by the consumer and claims the most recently published one.
+	* Waits up to timeoutMs for a frame that has not been consumed yet.
+	* @param timeoutMs maximal wait in milliseconds, negative to wait indefinitely
+	* @param sequence if not null, receives the sequence number of the frame
+	* @return slot index, or -1 on timeout or after @ref Wake
+	*/
+	int AcquireLatest(int timeoutMs, uint64_t* sequence = 0);
+
+	/** Wakes a consumer blocked in @ref AcquireLatest, which then returns -1.
+	*/
+	void Wake();
+
+	/** Returns every slot to the free state, dropping frames that were not consumed, and discards a pending
+	* @ref Wake. Neither side may use the ring at the same time, e.g. after the consumer thread has been joined.
+	*/
+	void Reset();
+
+	FrameRingStats GetStats() const;
+
+private:
+
+	enum SlotState {
+		SLOT_FREE = 0,
+		SLOT_WRITING,
+		SLOT_READY,
+		SLOT_READING
+	};
+
+	// slot state in the low 2 bits, sequence number of the frame it holds above them; keeping both in one
+	// word lets the compare-and-swap detect a slot that was rewritten in the meantime
+	static uint64_t Pack(uint64_t sequence, int state) { return (sequence << 2) | (uint64_t) state; }
+	static int StateOf(uint64_t word) { return (int) (word & 3); }
+	static uint64_t SequenceOf(uint64_t word) { return word >> 2; }
+
+	int TakeLatestReady(uint64_t& sequence);
+
+	FrameRing(const FrameRing&);
+	FrameRing& operator=(const FrameRing&);
+
+	int slotCount;
+	std::atomic<uint64_t>* slots;
+
+	// producer side
+	int writeSlot;
+	uint64_t nextSequence;
+
+	// consumer side
+	int readSlot;
+
+	// incremented on every publication (and on Wake), futex word the consumer sleeps on
+	std::atomic<uint32_t> published;
+	std::atomic<int> waiters;
+	std::atomic<int> wakeRequested;
+
+	std::atomic<uint64_t> produced;
+	std::atomic<uint64_t> consumed;
+	std::atomic<uint64_t> dropped;
+};
+
+}
+
+#endif // __FrameRing_h__
@@ -0,0 +1,111 @@
+#include "FrameTiming.h"
+#include <time.h>
+
+namespace VisageSDK
+{
+
+static std::atomic<int> sensorClock(CLOCK_MONOTONIC);
+
+long long MonotonicNsec()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+long long ThreadCpuNsec()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+void SetSensorTimestampSource(SensorTimestampSource source)
+{
+	sensorClock.store(source == SENSOR_TIMESTAMP_REALTIME ? CLOCK_BOOTTIME : CLOCK_MONOTONIC);
+}
+
+long long SensorClockNsec()
+{
+	struct timespec now;
+	clock_gettime(sensorClock.load(std::memory_order_relaxed), &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+void LatencyHistogram::Record(long long latencyNs)
+{
+	if (latencyNs < 0)
+		return;
+
+	long long bucket = latencyNs / 1000000LL;
+	if (bucket >= BUCKETS)
+		bucket = BUCKETS - 1;
+
+	buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sumNs.fetch_add((uint64_t) latencyNs, std::memory_order_relaxed);
+
+	long long prev = maxNs.load(std::memory_order_relaxed);
+	while (latencyNs > prev && !maxNs.compare_exchange_weak(prev, latencyNs, std::memory_order_relaxed))
+		;
+}
+
+void LatencyHistogram::Reset()
+{
+	for (int i = 0; i < BUCKETS; i++)
+		buckets[i].store(0, std::memory_order_relaxed);
+	count.store(0, std::memory_order_relaxed);
+	sumNs.store(0, std::memory_order_relaxed);
+	maxNs.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::GetBuckets(uint64_t* dst) const
+{
+	for (int i = 0; i < BUCKETS; i++)
+		dst[i] = buckets[i].load(std::memory_order_relaxed);
+}
+
+float LatencyHistogram::GetPercentile(float fraction) const
+{
+	uint64_t snapshot[BUCKETS];
+	uint64_t total = 0;
+	for (int i = 0; i < BUCKETS; i++)
+	{
+		snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+		total += snapshot[i];
+	}
+
+	if (total == 0)
+		return 0.0f;
+
+	uint64_t target = (uint64_t) (fraction * total);
+	if (target >= total)
+		target = total - 1;
+
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKETS; i++)
+	{
+		seen += snapshot[i];
+		if (seen > target)
+			return (float) (i + 1);
+	}
+	return (float) BUCKETS;
+}
+
+float LatencyHistogram::GetMax() const
+{
+	return maxNs.load(std::memory_order_relaxed) / 1000000.0f;
+}
+
+float LatencyHistogram::GetMean() const
+{
+	uint64_t n = count.load(std::memory_order_relaxed);
+	return n ? (float) (sumNs.load(std::memory_order_relaxed) / (double) n / 1000000.0) : 0.0f;
+}
+
+}
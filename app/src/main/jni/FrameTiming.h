@@ -0,0 +1,85 @@
+#ifndef __FrameTiming_h__
+#define __FrameTiming_h__
+
+#include <atomic>
+#include <cstdint>
+
+namespace VisageSDK
+{
+
+/** Timestamp sources reported by Android camera2 (CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE).
+ */
+enum SensorTimestampSource {
+	SENSOR_TIMESTAMP_UNKNOWN = 0,	///< sensor timestamps are on the CLOCK_MONOTONIC timebase
+	SENSOR_TIMESTAMP_REALTIME = 1	///< sensor timestamps are on the CLOCK_BOOTTIME timebase
+};
+
+/** Current CLOCK_MONOTONIC time in nanoseconds.
+ */
+long long MonotonicNsec();
+
+/** CPU time consumed by the calling thread (CLOCK_THREAD_CPUTIME_ID) in nanoseconds.
+ */
+long long ThreadCpuNsec();
+
+/** Selects the clock on which camera sensor timestamps (Image.getTimestamp()) are taken.
+ */
+void SetSensorTimestampSource(SensorTimestampSource source);
+
+/** Current time in nanoseconds on the same timebase as the camera sensor timestamps,
+ * so that the difference to a frame timestamp is the age of the frame.
+ */
+long long SensorClockNsec();
+
+/** LatencyHistogram collects latencies in 1 millisecond buckets.
+ *
+ * Recording is a couple of relaxed atomic increments, so it can be done from any thread
+ * while another thread reads the histogram.
+ */
+class LatencyHistogram {
+
+public:
+
+	/** Number of buckets. Bucket i counts latencies in [i, i+1) ms, the last bucket also everything above.
+	*/
+	static const int BUCKETS = 256;
+
+	LatencyHistogram();
+
+	/** Adds a single measurement.
+	* @param latencyNs latency in nanoseconds, negative values are ignored
+	*/
+	void Record(long long latencyNs);
+
+	void Reset();
+
+	uint64_t GetCount() const { return count.load(std::memory_order_relaxed); }
+
+	/** Copies the bucket counts into dst, which must hold @ref BUCKETS elements.
+	*/
+	void GetBuckets(uint64_t* dst) const;
+
+	/** Latency in milliseconds below which the given fraction of measurements lies.
+	* @param fraction value between 0 and 1, e.g. 0.99 for the 99th percentile
+	*/
+	float GetPercentile(float fraction) const;
+
+	/** Largest recorded latency in milliseconds.
+	*/
+	float GetMax() const;
+
+	/** Mean latency in milliseconds.
+	*/
+	float GetMean() const;
+
+private:
+
+	std::atomic<uint64_t> buckets[BUCKETS];
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> sumNs;
+	std::atomic<long long> maxNs;
+};
+
+}
+
+#endif // __FrameTiming_h__
@@ -0,0 +1,67 @@
+#include "GazeSampleRing.h"
+#include <string.h>
+
+namespace VisageSDK
+{
+
+static_assert(sizeof(GazeSample) == 32, "gaze sample layout is mirrored by VisageWrapper.GazeSamples");
+
+GazeSampleRing::GazeSampleRing(int capacity)
+{
+	int size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	samples.resize(size);
+	mask = (uint64_t) size - 1;
+
+	head.store(0);
+	tail.store(0);
+	dropped.store(0);
+}
+
+bool GazeSampleRing::Push(const GazeSample& sample)
+{
+	const uint64_t h = head.load(std::memory_order_relaxed);
+
+	if (h - tail.load(std::memory_order_acquire) >= samples.size())
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	samples[h & mask] = sample;
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+int GazeSampleRing::Drain(GazeSample* out, int maxSamples)
+{
+	const uint64_t t = tail.load(std::memory_order_relaxed);
+	const uint64_t available = head.load(std::memory_order_acquire) - t;
+
+	int count = (available < (uint64_t) maxSamples) ? (int) available : maxSamples;
+	if (count <= 0)
+		return 0;
+
+	// at most two copies, the queued samples wrap around the end of the array at most once
+	const int start = (int) (t & mask);
+	const int first = ((int) samples.size() - start < count) ? (int) samples.size() - start : count;
+	memcpy(out, &samples[start], first * sizeof(GazeSample));
+	if (count > first)
+		memcpy(out + first, &samples[0], (count - first) * sizeof(GazeSample));
+
+	tail.store(t + count, std::memory_order_release);
+	return count;
+}
+
+GazeSampleRingStats GazeSampleRing::GetStats() const
+{
+	GazeSampleRingStats stats;
+	stats.drained = tail.load(std::memory_order_acquire);
+	stats.pushed = head.load(std::memory_order_acquire);
+	stats.dropped = dropped.load(std::memory_order_relaxed);
+	return stats;
+}
+
+}
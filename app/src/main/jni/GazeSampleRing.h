@@ -0,0 +1,79 @@
+#ifndef __GazeSampleRing_h__
+#define __GazeSampleRing_h__
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+namespace VisageSDK
+{
+
+/** One screen space gaze estimate, as copied to Java by the gaze sample drain (32 bytes, native byte order).
+ */
+struct GazeSample {
+	int64_t timestamp;	///< sensor timestamp (ns) of the frame the gaze was estimated in
+	int32_t index;		///< ScreenSpaceGazeData::index
+	float x;			///< horizontal gaze position on screen
+	float y;			///< vertical gaze position on screen
+	int32_t inState;	///< state of the screen space gaze estimator
+	float quality;		///< quality of the estimate
+	int32_t face;		///< index of the face the gaze belongs to
+};
+
+/** Counters reported by @ref GazeSampleRing.
+ */
+struct GazeSampleRingStats {
+	uint64_t pushed;	///< samples stored by the producer
+	uint64_t drained;	///< samples handed out to the consumer
+	uint64_t dropped;	///< samples discarded because the ring was full
+};
+
+/** GazeSampleRing is a bounded lock-free single-producer/single-consumer queue of gaze samples.
+ *
+ * The tracking thread pushes every sample it produces, the consumer drains all samples pushed since its last call in
+ * one go. Each side only advances its own counter, so neither ever waits. When the consumer falls behind by the full
+ * capacity, new samples are dropped and counted, the ones already queued stay in order.
+ */
+class GazeSampleRing {
+
+public:
+
+	/** Constructor.
+	*
+	* @param capacity number of samples, rounded up to a power of two
+	*/
+	GazeSampleRing(int capacity = 1024);
+
+	int GetCapacity() const { return (int) samples.size(); }
+
+	/** Appends a sample. Producer thread only, never blocks.
+	* @return false if the ring was full and the sample was dropped
+	*/
+	bool Push(const GazeSample& sample);
+
+	/** Moves the oldest queued samples to the given array. Consumer thread only, never blocks.
+	* @param out destination for up to maxSamples samples, oldest first
+	* @return number of samples copied
+	*/
+	int Drain(GazeSample* out, int maxSamples);
+
+	GazeSampleRingStats GetStats() const;
+
+private:
+
+	GazeSampleRing(const GazeSampleRing&);
+	GazeSampleRing& operator=(const GazeSampleRing&);
+
+	std::vector<GazeSample> samples;
+	uint64_t mask;
+
+	// number of samples pushed, written by the producer
+	alignas(64) std::atomic<uint64_t> head;
+	// number of samples drained, written by the consumer
+	alignas(64) std::atomic<uint64_t> tail;
+	std::atomic<uint64_t> dropped;
+};
+
+}
+
+#endif // __GazeSampleRing_h__
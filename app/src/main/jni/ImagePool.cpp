@@ -0,0 +1,141 @@
+#include "ImagePool.h"
+#include <cstdlib>
+
+namespace VisageSDK
+{
+
+// alignment of pixel data, enough for any vector load
+static const size_t DATA_ALIGNMENT = 64;
+
+ImagePool& ImagePool::Shared()
+{
+	static ImagePool pool;
+	return pool;
+}
+
+ImagePool::ImagePool()
+{
+	pthread_mutex_init(&mutex, NULL);
+
+	stats.bytesLive = 0;
+	stats.bytesPooled = 0;
+	stats.peakBytes = 0;
+	stats.allocations = 0;
+	stats.reuses = 0;
+}
+
+ImagePool::~ImagePool()
+{
+	Trim();
+
+	for (size_t i = 0; i < live.size(); i++)
+		FreeEntry(live[i]);
+	live.clear();
+
+	pthread_mutex_destroy(&mutex);
+}
+
+void ImagePool::FreeEntry(Entry entry)
+{
+	free(entry.image->imageData);
+	vsReleaseImageHeader(&entry.image);
+}
+
+VsImage* ImagePool::Acquire(int width, int height, int channels)
+{
+	const size_t bytes = (size_t) width * height * channels;
+
+	pthread_mutex_lock(&mutex);
+
+	VsImage* image = 0;
+	for (size_t i = 0; i < pooled.size(); i++)
+	{
+		if (pooled[i].bytes == bytes && pooled[i].image->nChannels == channels)
+		{
+			image = pooled[i].image;
+			pooled[i] = pooled.back();
+			pooled.pop_back();
+			break;
+		}
+	}
+
+	if (image)
+	{
+		// same amount of pixel memory, only the shape may differ
+		image->width = width;
+		image->height = height;
+		image->widthStep = width * channels;
+		image->imageSize = (int) bytes;
+		stats.bytesPooled -= bytes;
+		stats.reuses++;
+	}
+	else
+	{
+		void* data = 0;
+		if (posix_memalign(&data, DATA_ALIGNMENT, bytes ? bytes : 1) != 0)
+		{
+			pthread_mutex_unlock(&mutex);
+			return 0;
+		}
+		image = vsCreateImageHeader(vsSize(width, height), VS_DEPTH_8U, channels);
+		vsSetData(image, data, width * channels);
+		stats.allocations++;
+	}
+
+	Entry entry = {image, bytes};
+	live.push_back(entry);
+	stats.bytesLive += bytes;
+	if (stats.bytesLive + stats.bytesPooled > stats.peakBytes)
+		stats.peakBytes = stats.bytesLive + stats.bytesPooled;
+
+	pthread_mutex_unlock(&mutex);
+
+	return image;
+}
+
+void ImagePool::Release(VsImage** image)
+{
+	if (!image || !*image)
+		return;
+
+	pthread_mutex_lock(&mutex);
+
+	for (size_t i = 0; i < live.size(); i++)
+	{
+		if (live[i].image == *image)
+		{
+			pooled.push_back(live[i]);
+			stats.bytesLive -= live[i].bytes;
+			stats.bytesPooled += live[i].bytes;
+			live[i] = live.back();
+			live.pop_back();
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+	*image = 0;
+}
+
+void ImagePool::Trim()
+{
+	pthread_mutex_lock(&mutex);
+
+	for (size_t i = 0; i < pooled.size(); i++)
+		FreeEntry(pooled[i]);
+	pooled.clear();
+	stats.bytesPooled = 0;
+
+	pthread_mutex_unlock(&mutex);
+}
+
+ImagePoolStats ImagePool::GetStats()
+{
+	pthread_mutex_lock(&mutex);
+	ImagePoolStats result = stats;
+	pthread_mutex_unlock(&mutex);
+	return result;
+}
+
+}
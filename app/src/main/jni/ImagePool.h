@@ -0,0 +1,80 @@
+#ifndef __ImagePool_h__
+#define __ImagePool_h__
+
+#include <pthread.h>
+#include <cstddef>
+#include <vector>
+#include "vs_main.h"
+
+namespace VisageSDK
+{
+
+/** Memory accounting reported by @ref ImagePool.
+ */
+struct ImagePoolStats {
+	size_t bytesLive;		///< pixel memory of images currently handed out
+	size_t bytesPooled;		///< pixel memory of released images kept for reuse
+	size_t peakBytes;		///< largest total (live + pooled) footprint so far
+	unsigned long allocations;	///< images that had to be allocated
+	unsigned long reuses;		///< images served from the pool
+};
+
+/** ImagePool owns the frame-sized 8-bit images of the wrapper and recycles them.
+ *
+ * Released images are kept and handed out again for any request with the same number of channels and
+ * pixel count, so a rotated frame (width and height swapped) or a recreated capture reuses the memory of
+ * the previous one without touching the heap. Images have no row padding (widthStep == width * channels),
+ * which is what the OpenGL upload and the YUV converter expect.
+ *
+ * Images obtained from the pool must be returned with @ref Release, never with vsReleaseImage.
+ */
+class ImagePool {
+
+public:
+
+	/** Pool shared by the capture and the wrapper.
+	*/
+	static ImagePool& Shared();
+
+	ImagePool();
+
+	~ImagePool();
+
+	/** Returns an 8-bit image of the given size, reusing pooled memory when possible.
+	* The content of a reused image is undefined.
+	*/
+	VsImage* Acquire(int width, int height, int channels);
+
+	/** Returns the image to the pool and sets the pointer to 0. Does nothing for a null image.
+	*/
+	void Release(VsImage** image);
+
+	/** Frees all pooled images. Images currently handed out are not affected.
+	*/
+	void Trim();
+
+	ImagePoolStats GetStats();
+
+private:
+
+	struct Entry {
+		VsImage* image;
+		size_t bytes;
+	};
+
+	static void FreeEntry(Entry entry);
+
+	ImagePool(const ImagePool&);
+	ImagePool& operator=(const ImagePool&);
+
+	pthread_mutex_t mutex;
+
+	std::vector<Entry> live;
+	std::vector<Entry> pooled;
+
+	ImagePoolStats stats;
+};
+
+}
+
+#endif // __ImagePool_h__
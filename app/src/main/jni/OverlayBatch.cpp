@@ -0,0 +1,634 @@
+#include "OverlayBatch.h"
+#include "PipelineMetrics.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+
+#define  LOG_TAG    "OverlayBatch"
+#define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
+#else
+#define  LOGE(...)  (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#endif
+
+namespace VisageSDK
+{
+
+// overlay coordinates are mapped to the viewport, (0, 0) to the lower left and (1, 1) to the upper right corner
+static const char* const SOLID_VERTEX_SHADER =
+	"attribute vec2 a_position;\n"
+	"attribute vec4 a_color;\n"
+	"varying vec4 v_color;\n"
+	"void main() {\n"
+	"	v_color = a_color;\n"
+	"	gl_Position = vec4(a_position * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+static const char* const SOLID_FRAGMENT_SHADER =
+	"precision mediump float;\n"
+	"varying vec4 v_color;\n"
+	"void main() {\n"
+	"	gl_FragColor = v_color;\n"
+	"}\n";
+
+static const char* const POINT_VERTEX_SHADER =
+	"attribute vec2 a_position;\n"
+	"attribute vec4 a_color;\n"
+	"attribute float a_size;\n"
+	"varying vec4 v_color;\n"
+	"void main() {\n"
+	"	v_color = a_color;\n"
+	"	gl_PointSize = a_size;\n"
+	"	gl_Position = vec4(a_position * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+// points are square, the corners are cut off
+static const char* const POINT_FRAGMENT_SHADER =
+	"precision mediump float;\n"
+	"varying vec4 v_color;\n"
+	"void main() {\n"
+	"	vec2 d = gl_PointCoord - vec2(0.5);\n"
+	"	if (dot(d, d) > 0.25)\n"
+	"		discard;\n"
+	"	gl_FragColor = v_color;\n"
+	"}\n";
+
+static const char* const TEXTURED_VERTEX_SHADER =
+	"attribute vec2 a_position;\n"
+	"attribute vec4 a_color;\n"
+	"attribute vec2 a_texCoord;\n"
+	"varying vec4 v_color;\n"
+	"varying vec2 v_texCoord;\n"
+	"void main() {\n"
+	"	v_color = a_color;\n"
+	"	v_texCoord = a_texCoord;\n"
+	"	gl_Position = vec4(a_position * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+static const char* const TEXTURED_FRAGMENT_SHADER =
+	"precision mediump float;\n"
+	"uniform sampler2D u_texture;\n"
+	"varying vec4 v_color;\n"
+	"varying vec2 v_texCoord;\n"
+	"void main() {\n"
+	"	gl_FragColor = texture2D(u_texture, v_texCoord) * v_color;\n"
+	"}\n";
+
+// NV12 camera frames: the luma texture holds Y, the luminance-alpha texture of half the size U and V. Chroma is sampled
+// at most up to the center of the last texel of the frame, the filter would mix in the unused rest of the texture at
+// the right and top edges otherwise. Texture coordinates of large frames need more than mediump to address single texels.
+static const char* const YUV_FRAGMENT_SHADER =
+	"#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+	"precision highp float;\n"
+	"#else\n"
+	"precision mediump float;\n"
+	"#endif\n"
+	"uniform sampler2D u_luma;\n"
+	"uniform sampler2D u_chroma;\n"
+	"uniform float u_lumaOffset;\n"
+	"uniform mat3 u_matrix;\n"
+	"uniform vec2 u_chromaLimit;\n"
+	"varying vec2 v_texCoord;\n"
+	"void main() {\n"
+	"	float y = texture2D(u_luma, v_texCoord).r - u_lumaOffset;\n"
+	"	vec2 uv = texture2D(u_chroma, min(v_texCoord, u_chromaLimit)).ra - 128.0 / 255.0;\n"
+	"	gl_FragColor = vec4(u_matrix * vec3(y, uv), 1.0);\n"
+	"}\n";
+
+// attribute locations shared by all programs
+enum {
+	ATTRIB_POSITION,
+	ATTRIB_COLOR,
+	ATTRIB_EXTRA	// a_size or a_texCoord
+};
+
+// buffer of the textured quads after the layer buffers, followed by the buffers of the retained layers
+static const int QUAD_BUFFER = OVERLAY_LAYER_COUNT;
+static const int RETAINED_BUFFERS = OVERLAY_LAYER_COUNT + 1;
+
+static inline void SetVertex(OverlayVertex& vertex, float x, float y, OverlayColor color)
+{
+	vertex.x = x;
+	vertex.y = y;
+	vertex.color = color;
+}
+
+static GLuint CompileShader(GLenum type, const char* source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint compiled = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled)
+	{
+		char log[512] = {0};
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		LOGE("Compiling overlay shader failed: %s", log);
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+static GLuint LinkProgram(const char* vertexSource, const char* fragmentSource, const char* extraAttribute)
+{
+	GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	if (!vertexShader || !fragmentShader)
+	{
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glBindAttribLocation(program, ATTRIB_POSITION, "a_position");
+	glBindAttribLocation(program, ATTRIB_COLOR, "a_color");
+	if (extraAttribute)
+		glBindAttribLocation(program, ATTRIB_EXTRA, extraAttribute);
+	glLinkProgram(program);
+
+	// the program keeps the shaders alive as long as it needs them
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint linked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		char log[512] = {0};
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		LOGE("Linking overlay program failed: %s", log);
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+OverlayBatch& OverlayBatch::Shared()
+{
+	static OverlayBatch batch;
+	return batch;
+}
+
+OverlayBatch::OverlayBatch()
+{
+	viewportWidth = 1;
+	viewportHeight = 1;
+	layerCapacity = 0;
+	Reset();
+}
+
+void OverlayBatch::Reset()
+{
+	solidProgram = 0;
+	pointProgram = 0;
+	texturedProgram = 0;
+	yuvProgram = 0;
+	texturedSampler = -1;
+	yuvLumaSampler = -1;
+	yuvChromaSampler = -1;
+	yuvLumaOffset = -1;
+	yuvMatrix = -1;
+	yuvChromaLimit = -1;
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		buffers[i] = 0;
+		bufferSizes[i] = 0;
+	}
+	retainedValid = false;
+	initFailed = false;
+	textTexture = 0;
+}
+
+bool OverlayBatch::Init()
+{
+	if (solidProgram)
+		return true;
+	// do not log the same failure on every frame
+	if (initFailed)
+		return false;
+
+	solidProgram = LinkProgram(SOLID_VERTEX_SHADER, SOLID_FRAGMENT_SHADER, NULL);
+	pointProgram = LinkProgram(POINT_VERTEX_SHADER, POINT_FRAGMENT_SHADER, "a_size");
+	texturedProgram = LinkProgram(TEXTURED_VERTEX_SHADER, TEXTURED_FRAGMENT_SHADER, "a_texCoord");
+	yuvProgram = LinkProgram(TEXTURED_VERTEX_SHADER, YUV_FRAGMENT_SHADER, "a_texCoord");
+
+	if (!solidProgram || !pointProgram || !texturedProgram || !yuvProgram)
+	{
+		glDeleteProgram(solidProgram);
+		glDeleteProgram(pointProgram);
+		glDeleteProgram(texturedProgram);
+		glDeleteProgram(yuvProgram);
+		solidProgram = pointProgram = texturedProgram = yuvProgram = 0;
+		initFailed = true;
+		return false;
+	}
+
+	texturedSampler = glGetUniformLocation(texturedProgram, "u_texture");
+	yuvLumaSampler = glGetUniformLocation(yuvProgram, "u_luma");
+	yuvChromaSampler = glGetUniformLocation(yuvProgram, "u_chroma");
+	yuvLumaOffset = glGetUniformLocation(yuvProgram, "u_lumaOffset");
+	yuvMatrix = glGetUniformLocation(yuvProgram, "u_matrix");
+	yuvChromaLimit = glGetUniformLocation(yuvProgram, "u_chromaLimit");
+	glGenBuffers(BUFFER_COUNT, buffers);
+	return true;
+}
+
+void OverlayBatch::SetViewport(int width, int height)
+{
+	viewportWidth = width > 0 ? width : 1;
+	viewportHeight = height > 0 ? height : 1;
+}
+
+bool OverlayBatch::ExpandLine(float x0, float y0, float x1, float y1, float width, OverlayColor color0,
+							  OverlayColor color1, OverlayVertex* quad) const
+{
+	// the normal is found in pixels, the viewport is rarely square
+	const float dx = (x1 - x0) * viewportWidth;
+	const float dy = (y1 - y0) * viewportHeight;
+	const float length = sqrtf(dx * dx + dy * dy);
+	if (length < 1e-6f)
+		return false;
+
+	const float half = 0.5f * width / length;
+	const float nx = -dy * half / viewportWidth;
+	const float ny = dx * half / viewportHeight;
+
+	// written field by field, a copy of a temporary quad is much slower when the stores cannot be forwarded to it
+	SetVertex(quad[0], x0 - nx, y0 - ny, color0);
+	SetVertex(quad[1], x1 - nx, y1 - ny, color1);
+	SetVertex(quad[2], x1 + nx, y1 + ny, color1);
+	SetVertex(quad[3], x0 - nx, y0 - ny, color0);
+	SetVertex(quad[4], x1 + nx, y1 + ny, color1);
+	SetVertex(quad[5], x0 + nx, y0 + ny, color0);
+	return true;
+}
+
+void OverlayBatch::AddLine(float x0, float y0, float x1, float y1, float width, OverlayColor color0, OverlayColor color1)
+{
+	OverlayVertex quad[6];
+	if (ExpandLine(x0, y0, x1, y1, width, color0, color1, quad))
+		fills.insert(fills.end(), quad, quad + 6);
+}
+
+size_t OverlayBatch::ReserveLines(int count)
+{
+	const size_t first = fills.size();
+	fills.resize(first + 6 * count);
+	return first;
+}
+
+void OverlayBatch::SetLine(size_t reserved, int line, float x0, float y0, float x1, float y1, float width,
+						   OverlayColor color0, OverlayColor color1)
+{
+	OverlayVertex* quad = &fills[reserved + 6 * line];
+	if (!ExpandLine(x0, y0, x1, y1, width, color0, color1, quad))
+	{
+		// AddLine skips such a line, here it collapses into triangles without area
+		const OverlayVertex point = {x0, y0, color0};
+		for (int i = 0; i < 6; i++)
+			quad[i] = point;
+	}
+}
+
+void OverlayBatch::AddHairline(float x0, float y0, float x1, float y1, OverlayColor color)
+{
+	const OverlayVertex line[2] = {
+		{x0, y0, color},
+		{x1, y1, color}
+	};
+	hairlines.insert(hairlines.end(), line, line + 2);
+}
+
+void OverlayBatch::AddPolygon(const float* xy, int count, OverlayColor color)
+{
+	// a fan around the first vertex
+	for (int i = 1; i + 1 < count; i++)
+	{
+		const OverlayVertex triangle[3] = {
+			{xy[0], xy[1], color},
+			{xy[2 * i], xy[2 * i + 1], color},
+			{xy[2 * i + 2], xy[2 * i + 3], color}
+		};
+		fills.insert(fills.end(), triangle, triangle + 3);
+	}
+}
+
+void OverlayBatch::AddPoint(float x, float y, float size, OverlayColor color, bool outline)
+{
+	const OverlayPointVertex point = {x, y, size, color};
+	(outline ? outlines : points).push_back(point);
+}
+
+void OverlayBatch::AddGlyph(float x0, float y0, float x1, float y1, const float* uv, OverlayColor color)
+{
+	const OverlayTexturedVertex glyph[6] = {
+		{x0, y0, uv[0], uv[1], color},
+		{x1, y0, uv[2], uv[3], color},
+		{x1, y1, uv[4], uv[5], color},
+		{x0, y1, uv[6], uv[7], color},
+		{x0, y0, uv[8], uv[9], color},
+		{x1, y1, uv[10], uv[11], color}
+	};
+	glyphs.insert(glyphs.end(), glyph, glyph + 6);
+}
+
+void OverlayBatch::Upload(int buffer, const void* data, size_t bytes, GLenum usage)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[buffer]);
+
+	// the whole buffer is replaced, so the driver can hand out new storage instead of waiting for the previous frame
+	if (bytes > bufferSizes[buffer])
+		bufferSizes[buffer] = bytes + bytes / 2;
+	glBufferData(GL_ARRAY_BUFFER, bufferSizes[buffer], NULL, usage);
+	if (data)
+		glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+}
+
+void OverlayBatch::CountDrawCall()
+{
+	PipelineMetrics::Shared().Count(COUNTER_DRAW_CALLS);
+}
+
+bool OverlayBatch::IsEmpty() const
+{
+	return fills.empty() && hairlines.empty() && outlines.empty() && points.empty() && glyphs.empty();
+}
+
+void OverlayBatch::Flush()
+{
+	if (IsEmpty())
+		return;
+
+	if (!Init())
+	{
+		Clear();
+		return;
+	}
+
+	GLsizei counts[OVERLAY_LAYER_COUNT];
+	Fill(0, GL_STREAM_DRAW, counts);
+	Draw(0, counts, textTexture);
+	Clear();
+}
+
+void OverlayBatch::FlushRetained()
+{
+	retainedValid = false;
+	if (!Init())
+	{
+		Clear();
+		return;
+	}
+
+	// redrawn at least once more, so the driver may keep the vertices in faster memory than streamed ones
+	Fill(RETAINED_BUFFERS, GL_DYNAMIC_DRAW, retainedCounts);
+	retainedTextTexture = textTexture;
+	retainedValid = true;
+	Draw(RETAINED_BUFFERS, retainedCounts, retainedTextTexture);
+	Clear();
+}
+
+bool OverlayBatch::DrawRetained()
+{
+	if (!retainedValid || !Init())
+		return false;
+
+	Draw(RETAINED_BUFFERS, retainedCounts, retainedTextTexture);
+	return true;
+}
+
+void OverlayBatch::Fill(int firstBuffer, GLenum usage, GLsizei* counts)
+{
+	counts[OVERLAY_FILLS] = (GLsizei) fills.size();
+	counts[OVERLAY_HAIRLINES] = (GLsizei) hairlines.size();
+	counts[OVERLAY_POINTS] = (GLsizei) (outlines.size() + points.size());
+	counts[OVERLAY_TEXT] = textTexture ? (GLsizei) glyphs.size() : 0;
+
+	if (!fills.empty())
+		Upload(firstBuffer + OVERLAY_FILLS, &fills[0], fills.size() * sizeof(OverlayVertex), usage);
+	if (!hairlines.empty())
+		Upload(firstBuffer + OVERLAY_HAIRLINES, &hairlines[0], hairlines.size() * sizeof(OverlayVertex), usage);
+
+	if (!outlines.empty() || !points.empty())
+	{
+		// outlines first, so no outline covers a point drawn before it
+		const size_t outlineBytes = outlines.size() * sizeof(OverlayPointVertex);
+		const size_t pointBytes = points.size() * sizeof(OverlayPointVertex);
+		Upload(firstBuffer + OVERLAY_POINTS, NULL, outlineBytes + pointBytes, usage);
+		if (outlineBytes)
+			glBufferSubData(GL_ARRAY_BUFFER, 0, outlineBytes, &outlines[0]);
+		if (pointBytes)
+			glBufferSubData(GL_ARRAY_BUFFER, outlineBytes, pointBytes, &points[0]);
+	}
+
+	if (counts[OVERLAY_TEXT])
+		Upload(firstBuffer + OVERLAY_TEXT, &glyphs[0], glyphs.size() * sizeof(OverlayTexturedVertex), usage);
+}
+
+void OverlayBatch::Draw(int firstBuffer, const GLsizei* counts, GLuint texture)
+{
+	if (!counts[OVERLAY_FILLS] && !counts[OVERLAY_HAIRLINES] && !counts[OVERLAY_POINTS] && !counts[OVERLAY_TEXT])
+		return;
+
+	glViewport(0, 0, viewportWidth, viewportHeight);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_STENCIL_TEST);
+	glDisable(GL_SCISSOR_TEST);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_BLEND);
+	glEnableVertexAttribArray(ATTRIB_POSITION);
+	glEnableVertexAttribArray(ATTRIB_COLOR);
+
+	if (counts[OVERLAY_FILLS] || counts[OVERLAY_HAIRLINES])
+	{
+		glUseProgram(solidProgram);
+
+		const int layers[2] = {OVERLAY_FILLS, OVERLAY_HAIRLINES};
+		const GLenum modes[2] = {GL_TRIANGLES, GL_LINES};
+
+		for (int i = 0; i < 2; i++)
+		{
+			if (!counts[layers[i]])
+				continue;
+
+			glBindBuffer(GL_ARRAY_BUFFER, buffers[firstBuffer + layers[i]]);
+			glVertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex),
+								  (const void*) offsetof(OverlayVertex, x));
+			glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(OverlayVertex),
+								  (const void*) offsetof(OverlayVertex, color));
+			if (modes[i] == GL_LINES)
+				glLineWidth(1.0f);
+			glDrawArrays(modes[i], 0, counts[layers[i]]);
+			CountDrawCall();
+		}
+	}
+
+	if (counts[OVERLAY_POINTS])
+	{
+		glUseProgram(pointProgram);
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[firstBuffer + OVERLAY_POINTS]);
+		glEnableVertexAttribArray(ATTRIB_EXTRA);
+		glVertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayPointVertex),
+							  (const void*) offsetof(OverlayPointVertex, x));
+		glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(OverlayPointVertex),
+							  (const void*) offsetof(OverlayPointVertex, color));
+		glVertexAttribPointer(ATTRIB_EXTRA, 1, GL_FLOAT, GL_FALSE, sizeof(OverlayPointVertex),
+							  (const void*) offsetof(OverlayPointVertex, size));
+		glDrawArrays(GL_POINTS, 0, counts[OVERLAY_POINTS]);
+		glDisableVertexAttribArray(ATTRIB_EXTRA);
+		CountDrawCall();
+	}
+
+	if (counts[OVERLAY_TEXT])
+	{
+		glUseProgram(texturedProgram);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glUniform1i(texturedSampler, 0);
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[firstBuffer + OVERLAY_TEXT]);
+		glEnableVertexAttribArray(ATTRIB_EXTRA);
+		glVertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayTexturedVertex),
+							  (const void*) offsetof(OverlayTexturedVertex, x));
+		glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(OverlayTexturedVertex),
+							  (const void*) offsetof(OverlayTexturedVertex, color));
+		glVertexAttribPointer(ATTRIB_EXTRA, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayTexturedVertex),
+							  (const void*) offsetof(OverlayTexturedVertex, u));
+		glDrawArrays(GL_TRIANGLES, 0, counts[OVERLAY_TEXT]);
+		glDisableVertexAttribArray(ATTRIB_EXTRA);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		CountDrawCall();
+	}
+
+	glDisableVertexAttribArray(ATTRIB_POSITION);
+	glDisableVertexAttribArray(ATTRIB_COLOR);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glUseProgram(0);
+	glDisable(GL_BLEND);
+}
+
+void OverlayBatch::Clear()
+{
+	// the layers keep their storage from frame to frame, only frames in which it had to grow touch the heap
+	const size_t capacity = (fills.capacity() + hairlines.capacity()) * sizeof(OverlayVertex) +
+							(outlines.capacity() + points.capacity()) * sizeof(OverlayPointVertex) +
+							glyphs.capacity() * sizeof(OverlayTexturedVertex);
+	if (capacity > layerCapacity)
+	{
+		PipelineMetrics::Shared().Count(COUNTER_OVERLAY_ALLOCATIONS);
+		layerCapacity = capacity;
+	}
+
+	fills.clear();
+	hairlines.clear();
+	outlines.clear();
+	points.clear();
+	glyphs.clear();
+}
+
+void OverlayBatch::DrawTexturedQuad(GLuint texture, float x0, float y0, float x1, float y1, float u0, float v0, float u1,
+									float v1, float alpha, bool blend)
+{
+	if (!Init())
+		return;
+
+	if (blend)
+	{
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glEnable(GL_BLEND);
+	}
+	else
+		glDisable(GL_BLEND);
+
+	glUseProgram(texturedProgram);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glUniform1i(texturedSampler, 0);
+
+	DrawQuad(x0, y0, x1, y1, u0, v0, u1, v1, OverlayRgbaf(1.0f, 1.0f, 1.0f, alpha));
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+	glDisable(GL_BLEND);
+}
+
+void OverlayBatch::DrawYuvQuad(GLuint luma, GLuint chroma, const float* coefficients, int chromaWidth, int chromaHeight,
+							   float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1)
+{
+	if (!Init())
+		return;
+
+	// columns multiply y, u and v
+	const float yMul = coefficients[1];
+	const float matrix[9] = {
+		yMul, yMul, yMul,
+		0.0f, -coefficients[3], coefficients[5],
+		coefficients[2], -coefficients[4], 0.0f
+	};
+
+	glDisable(GL_BLEND);
+	glUseProgram(yuvProgram);
+	glUniform1f(yuvLumaOffset, coefficients[0]);
+	glUniformMatrix3fv(yuvMatrix, 1, GL_FALSE, matrix);
+	glUniform2f(yuvChromaLimit, fmaxf(u0, u1) - 0.5f / chromaWidth, fmaxf(v0, v1) - 0.5f / chromaHeight);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, chroma);
+	glUniform1i(yuvChromaSampler, 1);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, luma);
+	glUniform1i(yuvLumaSampler, 0);
+
+	DrawQuad(x0, y0, x1, y1, u0, v0, u1, v1, OverlayRgba(255, 255, 255, 255));
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+}
+
+void OverlayBatch::DrawQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+							OverlayColor color)
+{
+	const OverlayTexturedVertex quad[4] = {
+		{x0, y0, u0, v0, color},
+		{x1, y0, u1, v0, color},
+		{x0, y1, u0, v1, color},
+		{x1, y1, u1, v1, color}
+	};
+
+	glViewport(0, 0, viewportWidth, viewportHeight);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_STENCIL_TEST);
+	glDisable(GL_SCISSOR_TEST);
+
+	// four vertices fit into the storage allocated for the first quad, it is only orphaned and refilled
+	Upload(QUAD_BUFFER, quad, sizeof(quad), GL_STREAM_DRAW);
+	glEnableVertexAttribArray(ATTRIB_POSITION);
+	glEnableVertexAttribArray(ATTRIB_COLOR);
+	glEnableVertexAttribArray(ATTRIB_EXTRA);
+	glVertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayTexturedVertex),
+						  (const void*) offsetof(OverlayTexturedVertex, x));
+	glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(OverlayTexturedVertex),
+						  (const void*) offsetof(OverlayTexturedVertex, color));
+	glVertexAttribPointer(ATTRIB_EXTRA, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayTexturedVertex),
+						  (const void*) offsetof(OverlayTexturedVertex, u));
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	CountDrawCall();
+
+	glDisableVertexAttribArray(ATTRIB_POSITION);
+	glDisableVertexAttribArray(ATTRIB_COLOR);
+	glDisableVertexAttribArray(ATTRIB_EXTRA);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+}
@@ -0,0 +1,239 @@
+#ifndef __OverlayBatch_h__
+#define __OverlayBatch_h__
+
+#include <stddef.h>
+#include <vector>
+
+#ifdef IOS
+#import <OpenGLES/ES2/gl.h>
+#else
+#include <GLES2/gl2.h>
+#endif
+
+namespace VisageSDK
+{
+
+/** Color of overlay geometry, 8 bits per channel as stored in the vertices.
+ */
+struct OverlayColor {
+	unsigned char r, g, b, a;
+};
+
+inline OverlayColor OverlayRgba(unsigned char r, unsigned char g, unsigned char b, unsigned char a)
+{
+	OverlayColor color = {r, g, b, a};
+	return color;
+}
+
+inline unsigned char OverlayChannel(float value)
+{
+	return value <= 0.0f ? 0 : value >= 1.0f ? 255 : (unsigned char) (value * 255 + 0.5f);
+}
+
+/** Color from channels between 0 and 1, values outside are clamped.
+ */
+inline OverlayColor OverlayRgbaf(float r, float g, float b, float a)
+{
+	return OverlayRgba(OverlayChannel(r), OverlayChannel(g), OverlayChannel(b), OverlayChannel(a));
+}
+
+/** Layers of the overlay, drawn in this order by @ref OverlayBatch::Flush.
+ */
+enum OverlayLayer {
+	OVERLAY_FILLS,			///< triangles: filled shapes and lines wider than one pixel
+	OVERLAY_HAIRLINES,		///< one pixel lines
+	OVERLAY_POINTS,			///< round points, outlines below the points they belong to
+	OVERLAY_TEXT,			///< glyphs of the font texture
+	OVERLAY_LAYER_COUNT
+};
+
+struct OverlayVertex {
+	float x, y;
+	OverlayColor color;
+
+	// left uninitialized, so that lines reserved in a layer are written only once
+	OverlayVertex() {}
+	OverlayVertex(float x, float y, OverlayColor color) : x(x), y(y), color(color) {}
+};
+
+struct OverlayPointVertex {
+	float x, y;
+	float size;
+	OverlayColor color;
+};
+
+struct OverlayTexturedVertex {
+	float x, y;
+	float u, v;
+	OverlayColor color;
+};
+
+/** OverlayBatch draws the tracking overlays with OpenGL ES 2.0 shaders.
+ *
+ * Geometry is collected per layer in normalized overlay coordinates, (0, 0) in the lower left and (1, 1) in the upper
+ * right corner of the viewport, and @ref Flush submits every layer that is not empty with a single draw call from a
+ * vertex buffer that lives as long as the GL context. Lines of any width are expanded into triangles on the CPU, wide
+ * lines are optional in OpenGL ES and would need a draw call per width.
+ *
+ * Layers that stay the same for several frames can be kept on the GPU with @ref FlushRetained and drawn again with
+ * @ref DrawRetained.
+ *
+ * Textured quads (the camera frame, logo and images) are drawn right away, they are not part of a layer.
+ *
+ * All methods except @ref Reset must be called on the GL thread.
+ */
+class OverlayBatch {
+
+public:
+
+	/** Batch of the GL thread.
+	*/
+	static OverlayBatch& Shared();
+
+	/** Forgets all GL objects without deleting them, the context they belonged to is gone. They are created again on
+	* the next draw. Collected geometry is kept, like VisageRendering::Reset this may be called off the GL thread.
+	*/
+	void Reset();
+
+	/** Size of the viewport in pixels, used to convert line widths and glyph sizes.
+	*/
+	void SetViewport(int width, int height);
+
+	/** Line of the given width in pixels, colors are interpolated from one end to the other.
+	*/
+	void AddLine(float x0, float y0, float x1, float y1, float width, OverlayColor color0, OverlayColor color1);
+
+	void AddLine(float x0, float y0, float x1, float y1, float width, OverlayColor color)
+	{
+		AddLine(x0, y0, x1, y1, width, color, color);
+	}
+
+	/** Keeps room for count lines in the fill layer, to be set with @ref SetLine before the next flush. Lines
+	* added afterwards are drawn above them, as if they had been added now.
+	* @return position of the lines in the layer
+	*/
+	size_t ReserveLines(int count);
+
+	/** Sets a line reserved by @ref ReserveLines, like @ref AddLine.
+	* @param reserved - position returned by @ref ReserveLines
+	* @param line - number of the line among the reserved ones
+	*/
+	void SetLine(size_t reserved, int line, float x0, float y0, float x1, float y1, float width, OverlayColor color0,
+				 OverlayColor color1);
+
+	/** Line one pixel wide.
+	*/
+	void AddHairline(float x0, float y0, float x1, float y1, OverlayColor color);
+
+	/** Filled convex polygon.
+	* @param xy - count vertices as x, y pairs
+	*/
+	void AddPolygon(const float* xy, int count, OverlayColor color);
+
+	/** Round point with a diameter of size pixels.
+	* @param outline - true for the dark outline drawn below a point, outlines of a frame are drawn before all points
+	*/
+	void AddPoint(float x, float y, float size, OverlayColor color, bool outline = false);
+
+	/** One glyph of the text texture set with @ref SetTextTexture.
+	* @param uv - 6 texture coordinates as u, v pairs for the corners (x0, y0), (x1, y0), (x1, y1), (x0, y1), (x0, y0), (x1, y1)
+	*/
+	void AddGlyph(float x0, float y0, float x1, float y1, const float* uv, OverlayColor color);
+
+	/** Texture of the text layer, usually the font.
+	*/
+	void SetTextTexture(GLuint texture) { textTexture = texture; }
+
+	/** Draws all layers and empties them.
+	*/
+	void Flush();
+
+	/** Draws all layers like @ref Flush, and keeps them in GPU buffers of their own so that @ref DrawRetained can draw
+	* them again without building or uploading them. Replaces what was retained before.
+	*/
+	void FlushRetained();
+
+	/** Draws the layers kept by the last @ref FlushRetained again, below anything flushed afterwards.
+	* @return false if nothing is retained, e.g. after @ref Reset
+	*/
+	bool DrawRetained();
+
+	/** Forgets the retained layers, @ref DrawRetained returns false until the next @ref FlushRetained.
+	*/
+	void DiscardRetained() { retainedValid = false; }
+
+	/** True if nothing was added since the last flush.
+	*/
+	bool IsEmpty() const;
+
+	/** Draws a texture on the given rectangle right away.
+	* @param u0, v0, u1, v1 - texture coordinates of the lower left and the upper right corner
+	* @param blend - blend with the image below using alpha
+	*/
+	void DrawTexturedQuad(GLuint texture, float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+						  float alpha = 1.0f, bool blend = false);
+
+	/** Draws an NV12 frame on the given rectangle right away, converted to RGB in the fragment shader.
+	* Both textures are sampled with the same texture coordinates, so the chroma texture must be half the size of the luma one.
+	* @param luma - GL_LUMINANCE texture of the Y plane
+	* @param chroma - GL_LUMINANCE_ALPHA texture of the interleaved U and V plane
+	* @param coefficients - color matrix as returned by YuvConverter::GetCoefficients
+	* @param chromaWidth, chromaHeight - size of the chroma texture, samples are kept off the texels beyond the frame
+	*/
+	void DrawYuvQuad(GLuint luma, GLuint chroma, const float* coefficients, int chromaWidth, int chromaHeight,
+					 float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1);
+
+private:
+
+	OverlayBatch();
+	OverlayBatch(const OverlayBatch&);
+	OverlayBatch& operator=(const OverlayBatch&);
+
+	bool Init();
+	void Clear();
+	bool ExpandLine(float x0, float y0, float x1, float y1, float width, OverlayColor color0, OverlayColor color1,
+					OverlayVertex* quad) const;
+	void Fill(int firstBuffer, GLenum usage, GLsizei* counts);
+	void Draw(int firstBuffer, const GLsizei* counts, GLuint texture);
+	void Upload(int buffer, const void* data, size_t bytes, GLenum usage);
+	void DrawQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, OverlayColor color);
+	void CountDrawCall();
+
+	// GL objects, 0 until the first draw in a context
+	GLuint solidProgram;
+	GLuint pointProgram;
+	GLuint texturedProgram;
+	GLuint yuvProgram;
+	// buffers of the layers, of the textured quads and of the retained layers
+	static const int BUFFER_COUNT = 2 * OVERLAY_LAYER_COUNT + 1;
+	GLuint buffers[BUFFER_COUNT];
+	size_t bufferSizes[BUFFER_COUNT];
+	GLint texturedSampler;
+	GLint yuvLumaSampler;
+	GLint yuvChromaSampler;
+	GLint yuvLumaOffset;
+	GLint yuvMatrix;
+	GLint yuvChromaLimit;
+	bool initFailed;
+
+	int viewportWidth;
+	int viewportHeight;
+
+	std::vector<OverlayVertex> fills;
+	std::vector<OverlayVertex> hairlines;
+	std::vector<OverlayPointVertex> outlines;
+	std::vector<OverlayPointVertex> points;
+	std::vector<OverlayTexturedVertex> glyphs;
+	// bytes reserved by the layers at the last Flush
+	size_t layerCapacity;
+	GLuint textTexture;
+
+	// vertices per layer in the retained buffers
+	GLsizei retainedCounts[OVERLAY_LAYER_COUNT];
+	GLuint retainedTextTexture;
+	bool retainedValid;
+};
+
+}
+
+#endif // __OverlayBatch_h__
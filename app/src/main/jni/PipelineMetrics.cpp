@@ -0,0 +1,342 @@
+#include "PipelineMetrics.h"
+#include "FrameTiming.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace VisageSDK
+{
+
+/** Histograms and counters written by a single thread, or by all threads for the shared overflow block.
+ */
+struct PipelineThreadBlock {
+	std::atomic<bool> owned;
+	bool shared;
+	std::atomic<uint32_t> buckets[STAGE_COUNT][PipelineMetrics::BUCKETS];
+	std::atomic<uint64_t> sumNs[STAGE_COUNT];
+	std::atomic<uint64_t> cpuNs[STAGE_COUNT];
+	std::atomic<uint64_t> counters[COUNTER_COUNT];
+
+	PipelineThreadBlock(bool shared)
+	{
+		owned.store(true);
+		this->shared = shared;
+		for (int s = 0; s < STAGE_COUNT; s++)
+		{
+			for (int b = 0; b < PipelineMetrics::BUCKETS; b++)
+				buckets[s][b].store(0, std::memory_order_relaxed);
+			sumNs[s].store(0, std::memory_order_relaxed);
+			cpuNs[s].store(0, std::memory_order_relaxed);
+		}
+		for (int c = 0; c < COUNTER_COUNT; c++)
+			counters[c].store(0, std::memory_order_relaxed);
+	}
+};
+
+/** Sum of all blocks.
+ */
+struct PipelineTotals {
+	uint64_t buckets[STAGE_COUNT][PipelineMetrics::BUCKETS];
+	uint64_t sumNs[STAGE_COUNT];
+	uint64_t cpuNs[STAGE_COUNT];
+	uint64_t counters[COUNTER_COUNT];
+};
+
+namespace
+{
+
+/** Block of the calling thread, handed back when the thread exits.
+ */
+struct ThreadHandle {
+	PipelineThreadBlock* block;
+
+	~ThreadHandle()
+	{
+		if (block && !block->shared)
+			block->owned.store(false, std::memory_order_release);
+	}
+};
+
+thread_local ThreadHandle threadHandle = {0};
+
+// only the owner of a block writes it, so a plain load and store is enough
+template <typename T>
+inline void Add(std::atomic<T>& counter, T n, bool shared)
+{
+	if (shared)
+		counter.fetch_add(n, std::memory_order_relaxed);
+	else
+		counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+}
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {
+	"yuv_conversion",
+	"rotation",
+	"frame_wait",
+	"track",
+	"publish",
+	"analysis",
+	"render_copy",
+	"texture_upload",
+	"overlay_draw"
+};
+
+static const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+	"frames_in",
+	"frames_dropped",
+	"frames_processed",
+	"frames_tracked",
+	"frames_rendered",
+	"draw_calls",
+	"overlay_allocations",
+	"overlay_cache_hits"
+};
+
+PipelineMetrics& PipelineMetrics::Shared()
+{
+	static PipelineMetrics metrics;
+	return metrics;
+}
+
+PipelineMetrics::PipelineMetrics()
+{
+	for (int i = 0; i < MAX_THREADS; i++)
+		blocks[i].store(0);
+	overflow = new PipelineThreadBlock(true);
+
+	pthread_mutex_init(&mutex, NULL);
+	baseline = new PipelineTotals();
+	current = new PipelineTotals();
+	memset(baseline, 0, sizeof(PipelineTotals));
+	baselineTime = MonotonicNsec();
+}
+
+PipelineMetrics::~PipelineMetrics()
+{
+	// blocks may still be referenced by threads that outlive static destruction, so they are not freed
+	pthread_mutex_destroy(&mutex);
+}
+
+int PipelineMetrics::BucketIndex(long long durationNs)
+{
+	if (durationNs < SUB_BUCKETS)
+		return durationNs < 0 ? 0 : (int) durationNs;
+
+	if (durationNs >= (1LL << MAX_EXPONENT))
+		return BUCKETS - 1;
+
+	const int msb = 63 - __builtin_clzll((unsigned long long) durationNs);
+	const int shift = msb - SUB_BUCKET_BITS;
+	return (shift + 1) * SUB_BUCKETS + (int) ((durationNs >> shift) - SUB_BUCKETS);
+}
+
+long long PipelineMetrics::BucketUpperBound(int bucket)
+{
+	if (bucket < SUB_BUCKETS)
+		return bucket;
+
+	const int shift = bucket / SUB_BUCKETS - 1;
+	const long long sub = bucket % SUB_BUCKETS + SUB_BUCKETS;
+	return ((sub + 1) << shift) - 1;
+}
+
+const char* PipelineMetrics::StageName(PipelineStage stage)
+{
+	return (stage >= 0 && stage < STAGE_COUNT) ? STAGE_NAMES[stage] : "unknown";
+}
+
+const char* PipelineMetrics::CounterName(PipelineCounter counter)
+{
+	return (counter >= 0 && counter < COUNTER_COUNT) ? COUNTER_NAMES[counter] : "unknown";
+}
+
+PipelineThreadBlock* PipelineMetrics::GetThreadBlock()
+{
+	if (threadHandle.block)
+		return threadHandle.block;
+
+	for (int i = 0; i < MAX_THREADS; i++)
+	{
+		PipelineThreadBlock* block = blocks[i].load(std::memory_order_acquire);
+
+		if (!block)
+		{
+			PipelineThreadBlock* created = new PipelineThreadBlock(false);
+			if (blocks[i].compare_exchange_strong(block, created, std::memory_order_acq_rel))
+			{
+				threadHandle.block = created;
+				return created;
+			}
+			// another thread filled the entry first, try to take over its block like any other
+			delete created;
+		}
+
+		bool expected = false;
+		if (block->owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+		{
+			threadHandle.block = block;
+			return block;
+		}
+	}
+
+	threadHandle.block = overflow;
+	return overflow;
+}
+
+void PipelineMetrics::Record(PipelineStage stage, long long durationNs, long long cpuNs)
+{
+	if (durationNs < 0)
+		durationNs = 0;
+	if (cpuNs < 0)
+		cpuNs = 0;
+
+	PipelineThreadBlock* block = GetThreadBlock();
+	Add<uint32_t>(block->buckets[stage][BucketIndex(durationNs)], 1, block->shared);
+	Add<uint64_t>(block->sumNs[stage], (uint64_t) durationNs, block->shared);
+	Add<uint64_t>(block->cpuNs[stage], (uint64_t) cpuNs, block->shared);
+}
+
+void PipelineMetrics::Count(PipelineCounter counter, uint64_t n)
+{
+	PipelineThreadBlock* block = GetThreadBlock();
+	Add<uint64_t>(block->counters[counter], n, block->shared);
+}
+
+void PipelineMetrics::Sum(PipelineTotals& totals) const
+{
+	memset(&totals, 0, sizeof(totals));
+
+	for (int i = 0; i <= MAX_THREADS; i++)
+	{
+		const PipelineThreadBlock* block = (i < MAX_THREADS) ? blocks[i].load(std::memory_order_acquire) : overflow;
+		if (!block)
+			continue;
+
+		for (int s = 0; s < STAGE_COUNT; s++)
+		{
+			for (int b = 0; b < BUCKETS; b++)
+				totals.buckets[s][b] += block->buckets[s][b].load(std::memory_order_relaxed);
+			totals.sumNs[s] += block->sumNs[s].load(std::memory_order_relaxed);
+			totals.cpuNs[s] += block->cpuNs[s].load(std::memory_order_relaxed);
+		}
+		for (int c = 0; c < COUNTER_COUNT; c++)
+			totals.counters[c] += block->counters[c].load(std::memory_order_relaxed);
+	}
+}
+
+void PipelineMetrics::GetSnapshot(PipelineMetricsSnapshot& snapshot)
+{
+	pthread_mutex_lock(&mutex);
+
+	Sum(*current);
+	snapshot.elapsedNs = MonotonicNsec() - baselineTime;
+
+	for (int s = 0; s < STAGE_COUNT; s++)
+	{
+		// counts only grow, so the difference to the baseline is the histogram of this period
+		uint64_t* buckets = current->buckets[s];
+		uint64_t count = 0;
+		int last = -1;
+		for (int b = 0; b < BUCKETS; b++)
+		{
+			buckets[b] -= baseline->buckets[s][b];
+			count += buckets[b];
+			if (buckets[b])
+				last = b;
+		}
+
+		PipelineStageStats& stats = snapshot.stages[s];
+		stats.count = count;
+		stats.meanNs = count ? (long long) ((current->sumNs[s] - baseline->sumNs[s]) / count) : 0;
+		stats.meanCpuNs = count ? (long long) ((current->cpuNs[s] - baseline->cpuNs[s]) / count) : 0;
+		stats.maxNs = (last >= 0) ? BucketUpperBound(last) : 0;
+
+		const double fractions[3] = {0.5, 0.9, 0.99};
+		long long* percentiles[3] = {&stats.p50Ns, &stats.p90Ns, &stats.p99Ns};
+		for (int p = 0; p < 3; p++)
+		{
+			*percentiles[p] = 0;
+			if (!count)
+				continue;
+
+			uint64_t target = (uint64_t) (fractions[p] * count);
+			if (target >= count)
+				target = count - 1;
+
+			uint64_t seen = 0;
+			for (int b = 0; b <= last; b++)
+			{
+				seen += buckets[b];
+				if (seen > target)
+				{
+					*percentiles[p] = BucketUpperBound(b);
+					break;
+				}
+			}
+		}
+	}
+
+	for (int c = 0; c < COUNTER_COUNT; c++)
+		snapshot.counters[c] = current->counters[c] - baseline->counters[c];
+
+	pthread_mutex_unlock(&mutex);
+}
+
+void PipelineMetrics::Reset()
+{
+	pthread_mutex_lock(&mutex);
+	Sum(*baseline);
+	baselineTime = MonotonicNsec();
+	pthread_mutex_unlock(&mutex);
+}
+
+std::string PipelineMetrics::Dump()
+{
+	PipelineMetricsSnapshot snapshot;
+	GetSnapshot(snapshot);
+
+	std::string text;
+	char line[160];
+
+	snprintf(line, sizeof(line), "Pipeline metrics over %.2f s, durations in ms\n", snapshot.elapsedNs / 1e9);
+	text += line;
+	snprintf(line, sizeof(line), "%-16s %10s %9s %9s %9s %9s %9s %9s %5s\n", "stage", "count", "mean", "p50", "p90", "p99",
+			 "max", "cpu", "cpu%");
+	text += line;
+
+	for (int s = 0; s < STAGE_COUNT; s++)
+	{
+		const PipelineStageStats& stats = snapshot.stages[s];
+		// CPU time of the recording thread against wall time, low values are time spent blocked or preempted
+		const int cpuPercent = stats.meanNs ? (int) (100 * stats.meanCpuNs / stats.meanNs) : 0;
+		snprintf(line, sizeof(line), "%-16s %10llu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %5d\n", STAGE_NAMES[s],
+				 (unsigned long long) stats.count, stats.meanNs / 1e6, stats.p50Ns / 1e6, stats.p90Ns / 1e6,
+				 stats.p99Ns / 1e6, stats.maxNs / 1e6, stats.meanCpuNs / 1e6, cpuPercent);
+		text += line;
+	}
+
+	for (int c = 0; c < COUNTER_COUNT; c++)
+	{
+		snprintf(line, sizeof(line), "%s%s %llu", c ? ", " : "", COUNTER_NAMES[c], (unsigned long long) snapshot.counters[c]);
+		text += line;
+	}
+	text += "\n";
+
+	return text;
+}
+
+PipelineTimer::PipelineTimer(PipelineStage stage)
+{
+	this->stage = stage;
+	start = MonotonicNsec();
+	cpuStart = ThreadCpuNsec();
+}
+
+PipelineTimer::~PipelineTimer()
+{
+	const long long cpu = ThreadCpuNsec() - cpuStart;
+	PipelineMetrics::Shared().Record(stage, MonotonicNsec() - start, cpu);
+}
+
+}
@@ -0,0 +1,170 @@
+#ifndef __PipelineMetrics_h__
+#define __PipelineMetrics_h__
+
+#include <atomic>
+#include <string>
+#include <pthread.h>
+#include <stdint.h>
+
+namespace VisageSDK
+{
+
+/** Timed stages of the camera → tracker → renderer pipeline.
+ */
+enum PipelineStage {
+	STAGE_YUV_CONVERSION,		///< camera thread: YUV to RGB conversion of a camera frame, including rotation when fused
+	STAGE_ROTATION,				///< camera thread: rotating, mirroring and scaling the planes into NV12
+	STAGE_FRAME_WAIT,			///< tracking thread: waiting in GrabFrame for a new camera frame
+	STAGE_TRACK,				///< tracking thread: VisageTracker::track
+	STAGE_PUBLISH,				///< tracking thread: snapshots, preview conversion and publication of the results
+	STAGE_ANALYSIS,				///< analysis thread: VisageFaceAnalyser::analyseStream
+	STAGE_RENDER_COPY,			///< rendering thread: taking the newest results in DisplayTrackingStatus
+	STAGE_TEXTURE_UPLOAD,		///< rendering thread: uploading the camera frame to the video texture
+	STAGE_OVERLAY_DRAW,			///< rendering thread: drawing the tracking results over the frame
+	STAGE_COUNT
+};
+
+/** Event counters of the pipeline.
+ */
+enum PipelineCounter {
+	COUNTER_FRAMES_IN,			///< camera frames written into the capture
+	COUNTER_FRAMES_DROPPED,		///< camera frames overwritten or skipped before the tracker took them
+	COUNTER_FRAMES_PROCESSED,	///< frames passed to VisageTracker::track
+	COUNTER_FRAMES_TRACKED,		///< processed frames in which at least one face was found
+	COUNTER_FRAMES_RENDERED,	///< frames drawn by DisplayTrackingStatus
+	COUNTER_DRAW_CALLS,			///< draw calls issued by VisageRendering, per rendered frame when divided by frames_rendered
+	COUNTER_OVERLAY_ALLOCATIONS,	///< heap allocations for overlay geometry on the GL thread, stays constant in steady state
+	COUNTER_OVERLAY_CACHE_HITS,	///< rendered frames whose overlays were redrawn from the retained buffers without being rebuilt
+	COUNTER_COUNT
+};
+
+/** Summary of one stage in a @ref PipelineMetricsSnapshot, durations in nanoseconds.
+ * Percentiles and the maximum are the upper bounds of their histogram buckets, within 1/16 of the true value.
+ */
+struct PipelineStageStats {
+	uint64_t count;
+	long long meanNs;
+	long long p50Ns;
+	long long p90Ns;
+	long long p99Ns;
+	long long maxNs;
+	long long meanCpuNs;	///< CPU time of the recording thread per run; well below meanNs means the stage mostly waited
+};
+
+/** All stages and counters since the last @ref PipelineMetrics::Reset.
+ */
+struct PipelineMetricsSnapshot {
+	long long elapsedNs;						///< time covered by the snapshot
+	PipelineStageStats stages[STAGE_COUNT];
+	uint64_t counters[COUNTER_COUNT];
+};
+
+struct PipelineThreadBlock;
+struct PipelineTotals;
+
+/** PipelineMetrics collects duration histograms per pipeline stage and event counters.
+ *
+ * Histograms are log-linear (as in HdrHistogram): every power of two of nanoseconds is split into 16 buckets, so a
+ * value is kept to within 1/16 of itself from 1 ns up to about a minute in 528 buckets.
+ *
+ * Each recording thread gets its own block of histograms and counters on its first use, so recording is a plain
+ * relaxed load and store of counters nobody else writes, without any read-modify-write or lock. Blocks of threads that
+ * have exited are handed to new threads and keep their counts. Readers sum all blocks; a snapshot taken while
+ * threads record may miss their latest values but never sees torn ones.
+ */
+class PipelineMetrics {
+
+public:
+
+	/** Number of buckets per power of two is 2^SUB_BUCKET_BITS.
+	*/
+	static const int SUB_BUCKET_BITS = 4;
+	static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	/** Durations from 2^MAX_EXPONENT ns (about 69 s) on are counted in the last bucket.
+	*/
+	static const int MAX_EXPONENT = 36;
+	static const int BUCKETS = SUB_BUCKETS * (MAX_EXPONENT - SUB_BUCKET_BITS + 1);
+	/** Recording threads with a block of their own, further threads share one block with atomic increments.
+	*/
+	static const int MAX_THREADS = 16;
+
+	/** Metrics of the whole process.
+	*/
+	static PipelineMetrics& Shared();
+
+	/** Adds the duration of one run of a stage.
+	* @param durationNs wall time in nanoseconds, negative values are counted as 0
+	* @param cpuNs CPU time the recording thread spent in the run (see ThreadCpuNsec), negative values are counted as 0
+	*/
+	void Record(PipelineStage stage, long long durationNs, long long cpuNs);
+
+	/** Adds n events to a counter.
+	*/
+	void Count(PipelineCounter counter, uint64_t n = 1);
+
+	/** Sums up all threads since the last @ref Reset.
+	*/
+	void GetSnapshot(PipelineMetricsSnapshot& snapshot);
+
+	/** Starts a new measurement period. Recording threads are not disturbed, the current totals become the baseline
+	* that later snapshots are taken relative to.
+	*/
+	void Reset();
+
+	/** Table of all stages and counters in milliseconds, for logs and bug reports.
+	*/
+	std::string Dump();
+
+	static int BucketIndex(long long durationNs);
+
+	/** Largest duration counted in the given bucket.
+	*/
+	static long long BucketUpperBound(int bucket);
+
+	static const char* StageName(PipelineStage stage);
+
+	static const char* CounterName(PipelineCounter counter);
+
+private:
+
+	PipelineMetrics();
+	~PipelineMetrics();
+	PipelineMetrics(const PipelineMetrics&);
+	PipelineMetrics& operator=(const PipelineMetrics&);
+
+	PipelineThreadBlock* GetThreadBlock();
+	void Sum(PipelineTotals& totals) const;
+
+	std::atomic<PipelineThreadBlock*> blocks[MAX_THREADS];
+	PipelineThreadBlock* overflow;
+
+	// reader side: totals at the last Reset and scratch totals for snapshots, protected by mutex
+	pthread_mutex_t mutex;
+	PipelineTotals* baseline;
+	PipelineTotals* current;
+	long long baselineTime;
+};
+
+/** Records the wall and CPU time from construction to destruction as one run of a stage.
+ */
+class PipelineTimer {
+
+public:
+
+	PipelineTimer(PipelineStage stage);
+
+	~PipelineTimer();
+
+private:
+
+	PipelineTimer(const PipelineTimer&);
+	PipelineTimer& operator=(const PipelineTimer&);
+
+	PipelineStage stage;
+	long long start;
+	long long cpuStart;
+};
+
+}
+
+#endif // __PipelineMetrics_h__
@@ -0,0 +1,310 @@
+#include "PipelineTrace.h"
+#include "FrameTiming.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+
+namespace VisageSDK
+{
+
+/** One recorded span.
+ */
+struct PipelineTraceEvent {
+	const char* name;
+	long long beginNs;
+	long long endNs;
+	long long frameId;
+	int tid;
+};
+
+/** Ring of the most recent spans of a single thread.
+ */
+struct PipelineTraceBlock {
+	std::atomic<bool> owned;
+	int tid;
+	// number of spans recorded, written by the owner
+	std::atomic<uint64_t> head;
+	// spans before this one were discarded by Clear
+	std::atomic<uint64_t> first;
+	PipelineTraceEvent events[PipelineTrace::EVENTS_PER_THREAD];
+
+	PipelineTraceBlock()
+	{
+		owned.store(true);
+		tid = 0;
+		head.store(0);
+		first.store(0);
+	}
+};
+
+static_assert((PipelineTrace::EVENTS_PER_THREAD & (PipelineTrace::EVENTS_PER_THREAD - 1)) == 0,
+			  "trace ring size must be a power of two");
+
+namespace
+{
+
+/** Block of the calling thread, handed back when the thread exits.
+ */
+struct ThreadHandle {
+	PipelineTraceBlock* block;
+	bool none;
+
+	~ThreadHandle()
+	{
+		if (block)
+			block->owned.store(false, std::memory_order_release);
+	}
+};
+
+thread_local ThreadHandle threadHandle = {0, false};
+
+void AppendEscaped(std::string& json, const char* text)
+{
+	for (const char* c = text; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			json += '\\';
+		if ((unsigned char) *c >= 0x20)
+			json += *c;
+	}
+}
+
+bool EarlierBegin(const PipelineTraceEvent& a, const PipelineTraceEvent& b)
+{
+	return a.beginNs < b.beginNs;
+}
+
+bool SameFrameEarlierBegin(const PipelineTraceEvent& a, const PipelineTraceEvent& b)
+{
+	return a.frameId != b.frameId ? a.frameId < b.frameId : a.beginNs < b.beginNs;
+}
+
+}
+
+std::atomic<bool> PipelineTrace::enabled(false);
+
+PipelineTrace& PipelineTrace::Shared()
+{
+	static PipelineTrace trace;
+	return trace;
+}
+
+PipelineTrace::PipelineTrace()
+{
+	for (int i = 0; i < MAX_THREADS; i++)
+		blocks[i].store(0);
+	dropped.store(0);
+	pthread_mutex_init(&mutex, NULL);
+}
+
+PipelineTrace::~PipelineTrace()
+{
+	// blocks may still be referenced by threads that outlive static destruction, so they are not freed
+	pthread_mutex_destroy(&mutex);
+}
+
+bool PipelineTrace::SetEnabled(bool enable)
+{
+#ifdef PIPELINE_TRACING
+	enabled.store(enable, std::memory_order_relaxed);
+	return true;
+#else
+	return !enable;
+#endif
+}
+
+PipelineTraceBlock* PipelineTrace::GetThreadBlock()
+{
+	if (threadHandle.block || threadHandle.none)
+		return threadHandle.block;
+
+	PipelineTraceBlock* claimed = 0;
+	for (int i = 0; i < MAX_THREADS && !claimed; i++)
+	{
+		PipelineTraceBlock* block = blocks[i].load(std::memory_order_acquire);
+
+		if (!block)
+		{
+			PipelineTraceBlock* created = new PipelineTraceBlock();
+			if (blocks[i].compare_exchange_strong(block, created, std::memory_order_acq_rel))
+			{
+				claimed = created;
+				break;
+			}
+			// another thread filled the entry first, try to take over its block like any other
+			delete created;
+		}
+
+		bool expected = false;
+		if (block->owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+			claimed = block;
+	}
+
+	if (!claimed)
+	{
+		threadHandle.none = true;
+		return 0;
+	}
+
+	// spans of a previous owner stay in the ring with their own thread ID
+	claimed->tid = (int) gettid();
+
+	char name[17] = {0};
+	prctl(PR_GET_NAME, name, 0, 0, 0);
+
+	pthread_mutex_lock(&mutex);
+	threads.push_back(std::make_pair(claimed->tid, std::string(name)));
+	pthread_mutex_unlock(&mutex);
+
+	threadHandle.block = claimed;
+	return claimed;
+}
+
+void PipelineTrace::Span(const char* name, long long beginNs, long long endNs, long long frameId)
+{
+	PipelineTraceBlock* block = GetThreadBlock();
+	if (!block)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	// only the owner writes the ring, readers check the head again to skip spans overwritten while they copied
+	const uint64_t h = block->head.load(std::memory_order_relaxed);
+	PipelineTraceEvent& event = block->events[h & (EVENTS_PER_THREAD - 1)];
+	event.name = name;
+	event.beginNs = beginNs;
+	event.endNs = endNs;
+	event.frameId = frameId;
+	event.tid = block->tid;
+	block->head.store(h + 1, std::memory_order_release);
+}
+
+void PipelineTrace::Clear()
+{
+	for (int i = 0; i < MAX_THREADS; i++)
+	{
+		PipelineTraceBlock* block = blocks[i].load(std::memory_order_acquire);
+		if (block)
+			block->first.store(block->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+	dropped.store(0, std::memory_order_relaxed);
+}
+
+std::string PipelineTrace::ExportJson()
+{
+	std::vector<PipelineTraceEvent> events;
+
+	for (int i = 0; i < MAX_THREADS; i++)
+	{
+		PipelineTraceBlock* block = blocks[i].load(std::memory_order_acquire);
+		if (!block)
+			continue;
+
+		const uint64_t head = block->head.load(std::memory_order_acquire);
+		uint64_t start = block->first.load(std::memory_order_relaxed);
+		if (head - start > (uint64_t) EVENTS_PER_THREAD)
+			start = head - EVENTS_PER_THREAD;
+
+		const size_t copied = events.size();
+		for (uint64_t n = start; n < head; n++)
+			events.push_back(block->events[n & (EVENTS_PER_THREAD - 1)]);
+
+		// the owner may have overwritten the oldest copied spans meanwhile, including the one it is writing now
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t current = block->head.load(std::memory_order_relaxed);
+		if (current + 1 > start + EVENTS_PER_THREAD)
+		{
+			const uint64_t valid = current + 1 - EVENTS_PER_THREAD;
+			const size_t skip = (size_t) std::min<uint64_t>(valid - start, head - start);
+			events.erase(events.begin() + copied, events.begin() + copied + skip);
+		}
+	}
+
+	std::sort(events.begin(), events.end(), EarlierBegin);
+
+	const int pid = (int) getpid();
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	char line[256];
+	bool firstEvent = true;
+
+	pthread_mutex_lock(&mutex);
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		snprintf(line, sizeof(line), "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"",
+				 firstEvent ? "" : ",", pid, threads[i].first);
+		json += line;
+		AppendEscaped(json, threads[i].second.c_str());
+		json += "\"}}";
+		firstEvent = false;
+	}
+	pthread_mutex_unlock(&mutex);
+
+	// timestamps in microseconds as the format expects, nanoseconds are kept as decimals
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		const PipelineTraceEvent& event = events[i];
+		snprintf(line, sizeof(line), "%s\n{\"name\":\"", firstEvent ? "" : ",");
+		json += line;
+		AppendEscaped(json, event.name);
+		snprintf(line, sizeof(line), "\",\"cat\":\"pipeline\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,"
+				 "\"args\":{\"frame\":%lld}}", event.beginNs / 1000.0, (event.endNs - event.beginNs) / 1000.0, pid,
+				 event.tid, event.frameId);
+		json += line;
+		firstEvent = false;
+	}
+
+	// flow arrows from the first to the last span of every frame, through the spans in between
+	std::stable_sort(events.begin(), events.end(), SameFrameEarlierBegin);
+	for (size_t begin = 0; begin < events.size();)
+	{
+		size_t end = begin + 1;
+		while (end < events.size() && events[end].frameId == events[begin].frameId)
+			end++;
+
+		if (events[begin].frameId >= 0 && end - begin > 1)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const char* phase = (i == begin) ? "s" : (i + 1 == end) ? "f" : "t";
+				snprintf(line, sizeof(line), ",\n{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"%s\",\"bp\":\"e\",\"id\":%lld,"
+						 "\"ts\":%.3f,\"pid\":%d,\"tid\":%d}", phase, events[i].frameId, events[i].beginNs / 1000.0, pid,
+						 events[i].tid);
+				json += line;
+			}
+		}
+		begin = end;
+	}
+
+	json += "\n]}\n";
+	return json;
+}
+
+bool PipelineTrace::WriteJson(const char* path)
+{
+	const std::string json = ExportJson();
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+
+	const bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+	return (fclose(file) == 0) && written;
+}
+
+PipelineTraceScope::PipelineTraceScope(const char* name, long long frameId)
+{
+	this->name = name;
+	this->frameId = frameId;
+	start = PipelineTrace::IsEnabled() ? MonotonicNsec() : 0;
+}
+
+PipelineTraceScope::~PipelineTraceScope()
+{
+	if (start)
+		PipelineTrace::Shared().Span(name, start, MonotonicNsec(), frameId);
+}
+
+}
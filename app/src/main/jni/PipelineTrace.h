@@ -0,0 +1,141 @@
+#ifndef __PipelineTrace_h__
+#define __PipelineTrace_h__
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <stdint.h>
+
+namespace VisageSDK
+{
+
+struct PipelineTraceBlock;
+
+/** PipelineTrace records begin/end spans of the pipeline stages, tagged with the camera frame ID, and writes them out
+ * as Chrome trace-event JSON that can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Every recording thread gets its own ring of the most recent spans on its first use, so recording is a few plain
+ * stores and one release store of the ring head, without any lock or read-modify-write. When a ring is full the
+ * oldest spans are overwritten, so an export always covers the last seconds before it.
+ *
+ * Spans are recorded through @ref PIPELINE_TRACE_SPAN, which compiles to nothing unless PIPELINE_TRACING is defined
+ * and costs a single relaxed load and branch while tracing is compiled in but not enabled.
+ */
+class PipelineTrace {
+
+public:
+
+	/** Spans kept per recording thread.
+	*/
+	static const int EVENTS_PER_THREAD = 4096;
+	/** Recording threads with a ring of their own, spans of further threads are dropped and counted.
+	*/
+	static const int MAX_THREADS = 16;
+
+	/** Trace of the whole process.
+	*/
+	static PipelineTrace& Shared();
+
+	/** True if spans are currently recorded.
+	*/
+	static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+	/** Starts or stops recording. Spans recorded so far are kept until @ref Clear.
+	* @return false if tracing was not compiled in (PIPELINE_TRACING), nothing is recorded then
+	*/
+	static bool SetEnabled(bool enable);
+
+	/** Adds one span of the calling thread.
+	* @param name name of the span, must stay valid for the life of the process (a string literal)
+	* @param beginNs start time, MonotonicNsec
+	* @param endNs end time, MonotonicNsec
+	* @param frameId camera frame the span worked on, as passed to WriteFrameStream, or -1 if it is not tied to one frame
+	*/
+	void Span(const char* name, long long beginNs, long long endNs, long long frameId);
+
+	/** Discards all recorded spans. Spans recorded concurrently may survive.
+	*/
+	void Clear();
+
+	/** All recorded spans as Chrome trace-event JSON. Spans of the same frame are connected by flow arrows.
+	* Can be called while threads record, spans overwritten during the export are left out.
+	*/
+	std::string ExportJson();
+
+	/** Writes @ref ExportJson to a file.
+	* @return false if the file could not be written
+	*/
+	bool WriteJson(const char* path);
+
+	/** Number of spans lost because the thread had no ring of its own.
+	*/
+	uint64_t GetDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+
+	PipelineTrace();
+	~PipelineTrace();
+	PipelineTrace(const PipelineTrace&);
+	PipelineTrace& operator=(const PipelineTrace&);
+
+	PipelineTraceBlock* GetThreadBlock();
+
+	static std::atomic<bool> enabled;
+
+	std::atomic<PipelineTraceBlock*> blocks[MAX_THREADS];
+	std::atomic<uint64_t> dropped;
+
+	// thread IDs and names of all threads that recorded spans, protected by mutex
+	pthread_mutex_t mutex;
+	std::vector<std::pair<int, std::string> > threads;
+};
+
+/** Records the time from construction to destruction as one span, if tracing was enabled at construction.
+ */
+class PipelineTraceScope {
+
+public:
+
+	PipelineTraceScope(const char* name, long long frameId);
+
+	~PipelineTraceScope();
+
+private:
+
+	PipelineTraceScope(const PipelineTraceScope&);
+	PipelineTraceScope& operator=(const PipelineTraceScope&);
+
+	const char* name;
+	long long frameId;
+	long long start;
+};
+
+}
+
+#ifdef PIPELINE_TRACING
+
+/** Records a span whose start and end times were already taken, e.g. for the pipeline metrics.
+ */
+#define PIPELINE_TRACE_SPAN(name, beginNs, endNs, frameId) \
+	do { \
+		if (VisageSDK::PipelineTrace::IsEnabled()) \
+			VisageSDK::PipelineTrace::Shared().Span(name, beginNs, endNs, frameId); \
+	} while (0)
+
+#define PIPELINE_TRACE_CONCAT2(a, b) a##b
+#define PIPELINE_TRACE_CONCAT(a, b) PIPELINE_TRACE_CONCAT2(a, b)
+
+/** Records the rest of the enclosing scope as a span.
+ */
+#define PIPELINE_TRACE_SCOPE(name, frameId) \
+	VisageSDK::PipelineTraceScope PIPELINE_TRACE_CONCAT(pipelineTraceScope, __LINE__)(name, frameId)
+
+#else
+
+#define PIPELINE_TRACE_SPAN(name, beginNs, endNs, frameId) do {} while (0)
+#define PIPELINE_TRACE_SCOPE(name, frameId) do {} while (0)
+
+#endif
+
+#endif // __PipelineTrace_h__
@@ -0,0 +1,327 @@
+#include "ReplayFrameSource.h"
+#include "AndroidStreamCapture.h"
+#include "FrameTiming.h"
+#include "ThreadCpuMonitor.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+
+#define  LOG_TAG    "ReplayFrameSource"
+#define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,LOG_TAG,__VA_ARGS__)
+#define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
+#else
+#include <cstdio>
+
+#define  LOGI(...)  (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define  LOGE(...)  (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#endif
+
+namespace VisageSDK
+{
+
+static void sleepUntil(long long monotonicNs) {
+	struct timespec until;
+	until.tv_sec = (time_t) (monotonicNs / 1000000000LL);
+	until.tv_nsec = (long) (monotonicNs % 1000000000LL);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, 0) == EINTR)
+		;
+}
+
+// checks that a record describes a frame whose planes lie within the record
+static bool IsValidRecord(const YuvFrameRecord* record, size_t available)
+{
+	if (available < sizeof(YuvFrameRecord) || record->magic != YUV_FRAME_RECORD_MAGIC)
+		return false;
+
+	if (record->recordSize > available || record->recordSize % YUV_RECORD_ALIGNMENT != 0 ||
+		(uint64_t) sizeof(YuvFrameRecord) + record->ySize + record->uSize + record->vSize > record->recordSize)
+		return false;
+
+	if (record->width <= 0 || record->height <= 0 || (record->width & 1) || (record->height & 1) ||
+		(record->uvPixelStride != 1 && record->uvPixelStride != 2))
+		return false;
+
+	// the last row of every plane only needs to hold the pixels, not the whole stride
+	const int chromaWidth = record->width / 2;
+	const int chromaHeight = record->height / 2;
+	const uint64_t ySize = (uint64_t) record->yRowStride * (record->height - 1) + record->width;
+	const uint64_t uvSize = (uint64_t) record->uvRowStride * (chromaHeight - 1) + (uint64_t) (chromaWidth - 1) * record->uvPixelStride + 1;
+
+	return record->yRowStride >= record->width && record->uvRowStride >= chromaWidth * record->uvPixelStride &&
+		   ySize <= record->ySize && uvSize <= record->uSize && uvSize <= record->vSize;
+}
+
+ReplayFrameSource::ReplayFrameSource()
+{
+	mapping = 0;
+	mappingSize = 0;
+	stopRequested.store(false);
+}
+
+ReplayFrameSource::~ReplayFrameSource()
+{
+	Close();
+}
+
+bool ReplayFrameSource::Open(const char* path)
+{
+	Close();
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+	{
+		LOGE("Cannot open recording %s", path);
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(YuvRecordingHeader))
+	{
+		LOGE("Recording %s is too short", path);
+		close(fd);
+		return false;
+	}
+
+	void* address = mmap(0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (address == MAP_FAILED)
+	{
+		LOGE("Cannot map recording %s", path);
+		return false;
+	}
+
+	mapping = (const unsigned char*) address;
+	mappingSize = (size_t) st.st_size;
+
+	const YuvRecordingHeader* header = (const YuvRecordingHeader*) mapping;
+	if (memcmp(header->magic, YUV_RECORDING_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != YUV_RECORDING_VERSION || header->headerSize < sizeof(YuvRecordingHeader))
+	{
+		LOGE("%s is not a YUV_420_888 recording", path);
+		Close();
+		return false;
+	}
+
+	// frames are read in order
+	madvise(address, mappingSize, MADV_SEQUENTIAL);
+
+	size_t offset = (header->headerSize + YUV_RECORD_ALIGNMENT - 1) & ~(size_t) (YUV_RECORD_ALIGNMENT - 1);
+	while (offset < mappingSize)
+	{
+		const YuvFrameRecord* record = (const YuvFrameRecord*) (mapping + offset);
+		if (mappingSize - offset >= sizeof(YuvFrameRecord) && record->magic == 0)
+			break;
+
+		if (!IsValidRecord(record, mappingSize - offset))
+		{
+			LOGE("Damaged frame record at offset %zu in %s, replaying the first %zu frames", offset, path, records.size());
+			break;
+		}
+
+		records.push_back(record);
+		offset += record->recordSize;
+	}
+
+	LOGI("Opened recording %s with %zu frames", path, records.size());
+	return true;
+}
+
+bool ReplayFrameSource::OpenSynthetic(int width, int height, int frameCount, int fps)
+{
+	Close();
+
+	if (width <= 0 || height <= 0 || (width & 1) || (height & 1) || frameCount <= 0 || fps <= 0)
+		return false;
+
+	// planar chroma without row padding
+	const uint32_t ySize = (uint32_t) (width * height);
+	const uint32_t uvSize = ySize / 4;
+	const uint32_t recordSize = YuvFrameRecordSize(ySize, uvSize, uvSize);
+	const size_t headerSize = (sizeof(YuvRecordingHeader) + YUV_RECORD_ALIGNMENT - 1) & ~(size_t) (YUV_RECORD_ALIGNMENT - 1);
+	const size_t size = headerSize + (size_t) recordSize * frameCount;
+
+	void* address = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (address == MAP_FAILED)
+	{
+		LOGE("Cannot map %zu bytes for a synthetic recording", size);
+		return false;
+	}
+
+	unsigned char* data = (unsigned char*) address;
+	YuvRecordingHeader* header = (YuvRecordingHeader*) data;
+	memcpy(header->magic, YUV_RECORDING_MAGIC, sizeof(header->magic));
+	header->version = YUV_RECORDING_VERSION;
+	header->headerSize = sizeof(YuvRecordingHeader);
+
+	for (int i = 0; i < frameCount; i++)
+	{
+		YuvFrameRecord* record = (YuvFrameRecord*) (data + headerSize + (size_t) recordSize * i);
+		record->magic = YUV_FRAME_RECORD_MAGIC;
+		record->recordSize = recordSize;
+		record->timestamp = i * 1000000000LL / fps;
+		record->width = width;
+		record->height = height;
+		record->yRowStride = width;
+		record->uvRowStride = width / 2;
+		record->uvPixelStride = 1;
+		record->ySize = ySize;
+		record->uSize = uvSize;
+		record->vSize = uvSize;
+		record->orientation = 0;
+		record->flip = 0;
+
+		// diagonal luma bands moving by 4 pixels per frame over horizontal and vertical chroma gradients
+		unsigned char* y = (unsigned char*) (record + 1);
+		unsigned char* u = y + ySize;
+		unsigned char* v = u + uvSize;
+		for (int row = 0; row < height; row++)
+			for (int col = 0; col < width; col++)
+				y[row * width + col] = (unsigned char) ((row + col + 4 * i) & 0xff);
+		for (int row = 0; row < height / 2; row++)
+			for (int col = 0; col < width / 2; col++)
+			{
+				u[row * (width / 2) + col] = (unsigned char) (col * 255 / (width / 2));
+				v[row * (width / 2) + col] = (unsigned char) (row * 255 / (height / 2));
+			}
+
+		records.push_back(record);
+	}
+
+	mapping = data;
+	mappingSize = size;
+
+	LOGI("Generated synthetic recording of %d %dx%d frames", frameCount, width, height);
+	return true;
+}
+
+void ReplayFrameSource::Close()
+{
+	if (mapping)
+		munmap((void*) mapping, mappingSize);
+
+	mapping = 0;
+	mappingSize = 0;
+	records.clear();
+}
+
+bool ReplayFrameSource::GetFrame(int index, YuvFrame& frame, long long& timestamp, int* orientation, int* flip) const
+{
+	if (index < 0 || index >= (int) records.size())
+		return false;
+
+	const YuvFrameRecord* record = records[index];
+	const unsigned char* planes = (const unsigned char*) (record + 1);
+
+	frame.y = planes;
+	frame.u = planes + record->ySize;
+	frame.v = planes + record->ySize + record->uSize;
+	frame.width = record->width;
+	frame.height = record->height;
+	frame.yRowStride = record->yRowStride;
+	frame.uvRowStride = record->uvRowStride;
+	frame.uvPixelStride = record->uvPixelStride;
+
+	timestamp = record->timestamp;
+	if (orientation)
+		*orientation = record->orientation;
+	if (flip)
+		*flip = record->flip;
+	return true;
+}
+
+void ReplayFrameSource::Prefault()
+{
+	if (!mapping)
+		return;
+
+	const long pageSize = sysconf(_SC_PAGESIZE);
+
+	volatile unsigned char sink = 0;
+	for (size_t offset = 0; offset < mappingSize; offset += (size_t) pageSize)
+		sink ^= mapping[offset];
+	(void) sink;
+}
+
+ReplayStats ReplayFrameSource::Play(AndroidStreamCapture* capture, ReplayMode mode, int loops)
+{
+	ReplayStats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	if (!capture || records.empty())
+		return stats;
+
+	stopRequested.store(false, std::memory_order_relaxed);
+
+	const long long firstTimestamp = records.front()->timestamp;
+	const long long duration = records.back()->timestamp - firstTimestamp;
+	// each loop continues one average frame interval after the last frame of the previous one
+	const long long loopDuration = duration + (records.size() > 1 ? duration / (long long) (records.size() - 1) : 0);
+
+	ThreadCpuMonitor::Shared().RegisterThread(THREAD_CAMERA);
+
+	const long long start = MonotonicNsec();
+	const long long cpuStart = ThreadCpuNsec();
+	long long previousDue = start;
+
+	for (int loop = 0; loop < loops && !stopRequested.load(std::memory_order_relaxed); loop++)
+	{
+		for (size_t i = 0; i < records.size() && !stopRequested.load(std::memory_order_relaxed); i++)
+		{
+			YuvFrame frame;
+			long long timestamp;
+			GetFrame((int) i, frame, timestamp);
+
+			long long now;
+			if (mode == REPLAY_ORIGINAL_TIMING)
+			{
+				const long long due = start + loop * loopDuration + (timestamp - firstTimestamp);
+				now = MonotonicNsec();
+				if (now < due)
+				{
+					sleepUntil(due);
+					now = due;
+				}
+				else if (now - due > due - previousDue && due > previousDue)
+				{
+					stats.lateFrames++;
+				}
+
+				// the frame is written with the time it was due, as if the camera had just delivered it
+				timestamp = due;
+				previousDue = due;
+			}
+			else
+			{
+				now = MonotonicNsec();
+				timestamp = now;
+			}
+
+			// replayed frames are numbered from the start of the replay
+			capture->WriteFrame(frame, timestamp, stats.frames);
+
+			const long long writeNs = MonotonicNsec() - now;
+			if (writeNs > stats.maxWriteNs)
+				stats.maxWriteNs = writeNs;
+			stats.frames++;
+		}
+	}
+
+	stats.wallNs = MonotonicNsec() - start;
+	stats.cpuNs = ThreadCpuNsec() - cpuStart;
+
+	LOGI("Replayed %d frames in %.1f ms (%.1f fps), %.3f ms CPU/frame, longest write %.3f ms, %d late",
+		 stats.frames, stats.wallNs / 1000000.0, stats.frames * 1000000000.0 / (stats.wallNs > 0 ? stats.wallNs : 1),
+		 stats.cpuNs / (1000000.0 * (stats.frames > 0 ? stats.frames : 1)), stats.maxWriteNs / 1000000.0, stats.lateFrames);
+
+	return stats;
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef __ReplayFrameSource_h__
+#define __ReplayFrameSource_h__
+
+#include "YuvConverter.h"
+#include "YuvRecording.h"
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace VisageSDK
+{
+
+class AndroidStreamCapture;
+
+/** Pacing of @ref ReplayFrameSource::Play.
+ */
+enum ReplayMode {
+	REPLAY_ORIGINAL_TIMING = 0,	///< frames are written at the intervals they were recorded with
+	REPLAY_AS_FAST_AS_POSSIBLE = 1	///< frames are written back to back
+};
+
+/** Results of a single @ref ReplayFrameSource::Play run.
+ */
+struct ReplayStats {
+	int frames;				///< frames written to the capture
+	int lateFrames;			///< frames written more than one recorded frame interval behind schedule (original timing only)
+	long long wallNs;		///< wall time of the whole run
+	long long cpuNs;		///< CPU time of the replaying thread spent writing frames
+	long long maxWriteNs;	///< longest wall time of a single frame write
+};
+
+/** ReplayFrameSource feeds recorded YUV_420_888 frames (see YuvRecording.h) into the capture pipeline.
+ *
+ * The recording is memory-mapped and frames are handed to the capture straight from the mapping, so replay adds no
+ * copies to the path being measured. Frames are either written at their original timing, which reproduces the camera
+ * thread load of a real session, or as fast as possible to measure conversion and handoff throughput.
+ *
+ * Only POSIX facilities are used, so the same code runs on device and on a Linux host. The replaying thread registers
+ * itself as the camera thread with the @ref ThreadCpuMonitor.
+ */
+class ReplayFrameSource {
+
+public:
+
+	ReplayFrameSource();
+
+	~ReplayFrameSource();
+
+	/** Maps the recording and indexes its frames.
+	* @param path recording file
+	* @return false if the file cannot be mapped or is not a valid recording; records following a damaged one are ignored
+	*/
+	bool Open(const char* path);
+
+	/** Generates a recording of a moving test pattern in memory instead of opening one, e.g. to drive the pipeline on
+	* a Linux host without a camera.
+	* @param width width of the frames, even
+	* @param height height of the frames, even
+	* @param frameCount number of frames
+	* @param fps frame rate the timestamps are spaced for
+	* @return false if the parameters are invalid or the memory cannot be mapped
+	*/
+	bool OpenSynthetic(int width, int height, int frameCount, int fps = 30);
+
+	void Close();
+
+	int GetFrameCount() const { return (int) records.size(); }
+
+	/** Describes the frame at the given index. The planes point into the mapping and stay valid until @ref Close.
+	* @param timestamp receives the recorded sensor timestamp in nanoseconds
+	* @param orientation if not null, receives the orientation the frame was captured with
+	* @param flip if not null, receives 1 if the frame was captured mirrored
+	* @return false if the index is out of range
+	*/
+	bool GetFrame(int index, YuvFrame& frame, long long& timestamp, int* orientation = 0, int* flip = 0) const;
+
+	/** Reads the whole mapping once so that page faults do not end up in the measurements.
+	*/
+	void Prefault();
+
+	/** Writes all frames into the capture, which must have been created with the size of the recorded frames.
+	*
+	* Timestamps are rebased to CLOCK_MONOTONIC at the time each frame is written (original timing keeps the recorded
+	* intervals), so latencies measured downstream stay meaningful.
+	* @param capture destination
+	* @param mode pacing of the frames
+	* @param loops number of times the recording is played
+	*/
+	ReplayStats Play(AndroidStreamCapture* capture, ReplayMode mode, int loops = 1);
+
+	/** Makes a running @ref Play return after the current frame. Can be called from any thread.
+	*/
+	void Stop() { stopRequested.store(true, std::memory_order_relaxed); }
+
+private:
+
+	ReplayFrameSource(const ReplayFrameSource&);
+	ReplayFrameSource& operator=(const ReplayFrameSource&);
+
+	const unsigned char* mapping;
+	size_t mappingSize;
+
+	std::vector<const YuvFrameRecord*> records;
+
+	std::atomic<bool> stopRequested;
+};
+
+}
+
+#endif // __ReplayFrameSource_h__
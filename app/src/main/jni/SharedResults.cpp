@@ -0,0 +1,46 @@
+#include "SharedResults.h"
+#include <string.h>
+
+namespace VisageSDK
+{
+
+// offsets mirrored by VisageWrapper.FrameResults
+static_assert(sizeof(std::atomic<int32_t>) == 4, "sequence counter must be a plain 32-bit int");
+static_assert(offsetof(SharedFrameResults, timestamp) == 16 - 8, "shared results layout out of sync");
+static_assert(offsetof(SharedFrameResults, gazeAvailable) == 32 - 8, "shared results layout out of sync");
+static_assert(offsetof(SharedFrameResults, currentFace) == 56 - 8, "shared results layout out of sync");
+static_assert(offsetof(SharedFrameResults, emotions) == 72 - 8, "shared results layout out of sync");
+static_assert(offsetof(SharedFrameResults, status) == 100 - 8, "shared results layout out of sync");
+static_assert(sizeof(SharedFrameResults) == 120 - 8, "shared results layout out of sync");
+
+SharedResults::SharedResults()
+{
+	memset(&last, 0, sizeof(last));
+	last.currentFace = -1;
+	last.trackingQuality = -1.0f;
+	last.age = -1.0f;
+	last.gender = -1;
+	for (int i = 0; i < SHARED_RESULTS_EMOTIONS; i++)
+		last.emotions[i] = -1.0f;
+
+	block.sequence.store(0, std::memory_order_relaxed);
+	block.reserved = 0;
+	block.results = last;
+}
+
+void SharedResults::Publish(const SharedFrameResults& results)
+{
+	last = results;
+	last.frame++;
+
+	const int32_t sequence = block.sequence.load(std::memory_order_relaxed);
+	block.sequence.store(sequence + 1, std::memory_order_relaxed);
+	// the odd counter becomes visible before any of the results change
+	std::atomic_thread_fence(std::memory_order_release);
+
+	memcpy(&block.results, &last, sizeof(last));
+
+	block.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+}
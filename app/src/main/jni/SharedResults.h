@@ -0,0 +1,91 @@
+#ifndef __SharedResults_h__
+#define __SharedResults_h__
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace VisageSDK
+{
+
+/** Number of face statuses kept in @ref SharedFrameResults.
+ */
+static const int SHARED_RESULTS_FACES = 16;
+
+/** Number of emotion probabilities kept in @ref SharedFrameResults.
+ */
+static const int SHARED_RESULTS_EMOTIONS = 7;
+
+/** Per-frame results as read by Java, in native byte order.
+ *
+ * The Java side reads the fields at fixed byte offsets from a direct ByteBuffer (VisageWrapper.FrameResults), so the
+ * layout must only change together with the offsets there. The offsets below are relative to the start of the
+ * buffer, which begins with the 8 byte header of @ref SharedResults.
+ */
+struct SharedFrameResults {
+	int32_t frame;				///<  8: number of frames published since the block was created
+	int32_t trackedFaces;		///< 12: number of faces with TRACK_STAT_OK
+	int64_t timestamp;			///< 16: sensor timestamp (ns) of the last frame in which a face was tracked, 0 if none
+	int64_t gazeTimestamp;		///< 24: sensor timestamp (ns) of the gaze sample
+	int32_t gazeAvailable;		///< 32: 1 if the gaze fields hold a sample, 0 after a reset
+	int32_t gazeIndex;			///< 36: ScreenSpaceGazeData::index
+	float gazeX;				///< 40: ScreenSpaceGazeData::x
+	float gazeY;				///< 44: ScreenSpaceGazeData::y
+	int32_t gazeInState;		///< 48: ScreenSpaceGazeData::inState
+	float gazeQuality;			///< 52: ScreenSpaceGazeData::quality
+	int32_t currentFace;		///< 56: face selected for the analyser, -1 if none
+	float trackingQuality;		///< 60: tracking quality of the current face, or of the first tracked face, -1 if none
+	float age;					///< 64: estimated age of the current face, -1 if not known
+	int32_t gender;				///< 68: 1 for male, 0 for female, -1 if not known
+	float emotions[SHARED_RESULTS_EMOTIONS];	///< 72: emotion probabilities of the current face, all -1 if not known
+	int8_t status[SHARED_RESULTS_FACES];		///< 100: tracking status of each face, TRACK_STAT_OFF beyond the face capacity
+};
+
+/** SharedResults publishes @ref SharedFrameResults to Java through memory both sides can read without a JNI call.
+ *
+ * The block starts with a sequence counter that is odd while the block is written, followed by the results. Readers
+ * copy the results and accept them if the counter was even and unchanged around the copy, so a torn copy is retried.
+ * The frame counter tells readers whether anything was published since their last read.
+ *
+ * There must be a single writer at a time, in the wrapper all writes are made with guardFrame_mutex held.
+ */
+class SharedResults {
+
+public:
+
+	SharedResults();
+
+	/** Publishes new results and increments the frame counter.
+	*/
+	void Publish(const SharedFrameResults& results);
+
+	/** Last published results, for writers that only change a few fields.
+	*/
+	const SharedFrameResults& GetLast() const { return last; }
+
+	/** Memory of the block, wrapped into a direct ByteBuffer for Java.
+	*/
+	void* GetAddress() { return &block; }
+
+	static size_t GetSize() { return sizeof(Block); }
+
+private:
+
+	SharedResults(const SharedResults&);
+	SharedResults& operator=(const SharedResults&);
+
+	struct Block {
+		std::atomic<int32_t> sequence;
+		int32_t reserved;
+		SharedFrameResults results;
+	};
+
+	alignas(64) Block block;
+
+	// copy of the published results, writer only
+	SharedFrameResults last;
+};
+
+}
+
+#endif // __SharedResults_h__
@@ -0,0 +1,301 @@
+#include "SplineBatch.h"
+#include <math.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SPLINE_BATCH_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SPLINE_BATCH_SSE2 1
+#endif
+
+namespace VisageSDK
+{
+
+// Four floats, the coefficients of four segments or four points of one segment
+#if defined(SPLINE_BATCH_NEON)
+
+typedef float32x4_t Vec4;
+
+static inline Vec4 Load(const float* p) { return vld1q_f32(p); }
+static inline void Store(float* p, Vec4 a) { vst1q_f32(p, a); }
+static inline Vec4 Set(float a) { return vdupq_n_f32(a); }
+static inline Vec4 Add(Vec4 a, Vec4 b) { return vaddq_f32(a, b); }
+static inline Vec4 Sub(Vec4 a, Vec4 b) { return vsubq_f32(a, b); }
+static inline Vec4 Mul(Vec4 a, Vec4 b) { return vmulq_f32(a, b); }
+
+// b where a < limit, a elsewhere
+static inline Vec4 ReplaceBelow(Vec4 a, float limit, Vec4 b) { return vbslq_f32(vcltq_f32(a, Set(limit)), b, a); }
+
+#if defined(__aarch64__)
+static inline Vec4 Div(Vec4 a, Vec4 b) { return vdivq_f32(a, b); }
+static inline Vec4 Sqrt(Vec4 a) { return vsqrtq_f32(a); }
+#else
+// ARMv7 has neither division nor square root, estimates are refined by two Newton-Raphson steps each
+static inline Vec4 Div(Vec4 a, Vec4 b)
+{
+	Vec4 r = vrecpeq_f32(b);
+	r = vmulq_f32(vrecpsq_f32(b, r), r);
+	r = vmulq_f32(vrecpsq_f32(b, r), r);
+	return vmulq_f32(a, r);
+}
+
+static inline Vec4 Sqrt(Vec4 a)
+{
+	// the reciprocal square root of 0 is infinite, tiny values give a square root of practically 0 instead
+	const Vec4 x = vmaxq_f32(a, Set(1e-30f));
+	Vec4 r = vrsqrteq_f32(x);
+	r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(x, r), r), r);
+	r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(x, r), r), r);
+	return vmulq_f32(x, r);
+}
+#endif
+
+#elif defined(SPLINE_BATCH_SSE2)
+
+typedef __m128 Vec4;
+
+static inline Vec4 Load(const float* p) { return _mm_loadu_ps(p); }
+static inline void Store(float* p, Vec4 a) { _mm_storeu_ps(p, a); }
+static inline Vec4 Set(float a) { return _mm_set1_ps(a); }
+static inline Vec4 Add(Vec4 a, Vec4 b) { return _mm_add_ps(a, b); }
+static inline Vec4 Sub(Vec4 a, Vec4 b) { return _mm_sub_ps(a, b); }
+static inline Vec4 Mul(Vec4 a, Vec4 b) { return _mm_mul_ps(a, b); }
+static inline Vec4 Div(Vec4 a, Vec4 b) { return _mm_div_ps(a, b); }
+static inline Vec4 Sqrt(Vec4 a) { return _mm_sqrt_ps(a); }
+
+static inline Vec4 ReplaceBelow(Vec4 a, float limit, Vec4 b)
+{
+	const Vec4 below = _mm_cmplt_ps(a, Set(limit));
+	return _mm_or_ps(_mm_and_ps(below, b), _mm_andnot_ps(below, a));
+}
+
+#else
+
+struct Vec4 {
+	float v[4];
+};
+
+static inline Vec4 Load(const float* p) { Vec4 r = {{p[0], p[1], p[2], p[3]}}; return r; }
+static inline void Store(float* p, Vec4 a) { for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+static inline Vec4 Set(float a) { Vec4 r = {{a, a, a, a}}; return r; }
+static inline Vec4 Add(Vec4 a, Vec4 b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+static inline Vec4 Sub(Vec4 a, Vec4 b) { for (int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+static inline Vec4 Mul(Vec4 a, Vec4 b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+static inline Vec4 Div(Vec4 a, Vec4 b) { for (int i = 0; i < 4; i++) a.v[i] /= b.v[i]; return a; }
+static inline Vec4 Sqrt(Vec4 a) { for (int i = 0; i < 4; i++) a.v[i] = sqrtf(a.v[i]); return a; }
+
+static inline Vec4 ReplaceBelow(Vec4 a, float limit, Vec4 b)
+{
+	for (int i = 0; i < 4; i++)
+		if (a.v[i] < limit)
+			a.v[i] = b.v[i];
+	return a;
+}
+
+#endif
+
+static const int WIDTH = 4;
+
+static inline int PadToWidth(int count)
+{
+	return (count + WIDTH - 1) / WIDTH * WIDTH;
+}
+
+// Tangents of a nonuniform Catmull-Rom segment turned into the coefficients of its cubic polynomial,
+// as InitNonuniformCatmullRom and InitCubicPoly in VisageRendering.cpp
+static inline void CubicCoefficients(Vec4& x0, Vec4& x1, Vec4& x2, Vec4& x3, Vec4 dt0, Vec4 dt1, Vec4 dt2)
+{
+	Vec4 t1 = Add(Sub(Div(Sub(x1, x0), dt0), Div(Sub(x2, x0), Add(dt0, dt1))), Div(Sub(x2, x1), dt1));
+	Vec4 t2 = Add(Sub(Div(Sub(x2, x1), dt1), Div(Sub(x3, x1), Add(dt1, dt2))), Div(Sub(x3, x2), dt2));
+	t1 = Mul(t1, dt1);
+	t2 = Mul(t2, dt1);
+
+	const Vec4 c2 = Sub(Sub(Add(Mul(Set(-3), x1), Mul(Set(3), x2)), Mul(Set(2), t1)), t2);
+	const Vec4 c3 = Add(Add(Sub(Mul(Set(2), x1), Mul(Set(2), x2)), t1), t2);
+	x0 = x1;
+	x1 = t1;
+	x2 = c2;
+	x3 = c3;
+}
+
+// Centripetal parameter intervals from squared distances, as InitCentripetalCR in VisageRendering.cpp
+static inline void CentripetalIntervals(Vec4 d0, Vec4 d1, Vec4 d2, Vec4& dt0, Vec4& dt1, Vec4& dt2)
+{
+	dt0 = Sqrt(Sqrt(d0));
+	dt1 = Sqrt(Sqrt(d1));
+	dt2 = Sqrt(Sqrt(d2));
+
+	dt1 = ReplaceBelow(dt1, 1e-4f, Set(1.0f));
+	dt0 = ReplaceBelow(dt0, 1e-4f, dt1);
+	dt2 = ReplaceBelow(dt2, 1e-4f, dt1);
+}
+
+static inline Vec4 SquaredDistance(Vec4 x0, Vec4 y0, Vec4 x1, Vec4 y1)
+{
+	const Vec4 dx = Sub(x1, x0);
+	const Vec4 dy = Sub(y1, y0);
+	return Add(Mul(dx, dx), Mul(dy, dy));
+}
+
+SplineBatch& SplineBatch::Shared()
+{
+	static SplineBatch batch;
+	return batch;
+}
+
+SplineBatch::SplineBatch(int ratio)
+{
+	this->ratio = ratio;
+	segmentCount = 0;
+	pointCount = 0;
+}
+
+void SplineBatch::Clear()
+{
+	contours.clear();
+	for (int i = 0; i < CHANNELS * CONTROL_POINTS; i++)
+		segments[i].clear();
+	segmentCount = 0;
+	pointCount = 0;
+}
+
+int SplineBatch::AddContour(const float* x, const float* y, const float* alpha, int count)
+{
+	if (count < 2)
+		return -1;
+
+	Contour contour;
+	contour.firstSegment = segmentCount;
+	contour.segmentCount = count - 1;
+	contour.firstPoint = pointCount;
+	contour.pointCount = PointCount(count);
+	contour.last[0] = x[count - 1];
+	contour.last[1] = y[count - 1];
+	contour.last[2] = alpha[count - 1];
+	contours.push_back(contour);
+	pointCount += contour.pointCount;
+
+	const int first = segmentCount;
+	segmentCount += contour.segmentCount;
+	for (int i = 0; i < CHANNELS * CONTROL_POINTS; i++)
+		segments[i].resize(segmentCount);
+
+	const float* channels[CHANNELS] = {x, y, alpha};
+	for (int c = 0; c < CHANNELS; c++)
+	{
+		const float* v = channels[c];
+		float* p0 = &segments[c * CONTROL_POINTS][first];
+		float* p1 = &segments[c * CONTROL_POINTS + 1][first];
+		float* p2 = &segments[c * CONTROL_POINTS + 2][first];
+		float* p3 = &segments[c * CONTROL_POINTS + 3][first];
+
+		for (int i = 0; i < count - 1; i++)
+		{
+			p0[i] = i > 0 ? v[i - 1] : v[0];
+			p1[i] = v[i];
+			p2[i] = v[i + 1];
+			p3[i] = i < count - 2 ? v[i + 2] : v[count - 1];
+		}
+
+		// the contour is extended by the first and the last point mirrored around their neighbours,
+		// so that the first and the last segment have four control points as well
+		p0[0] = v[0] + (v[0] - v[1]);
+		p3[count - 2] = v[count - 1] + (v[count - 1] - v[count - 2]);
+	}
+
+	return (int) contours.size() - 1;
+}
+
+void SplineBatch::Evaluate()
+{
+	const int segmentStride = PadToWidth(segmentCount);
+	const int segmentPoints = ratio + 1;
+	const int paddedSegmentPoints = PadToWidth(segmentPoints);
+
+	// the last block of a segment spills over into the first points of the next one, which are written afterwards
+	x.resize(pointCount + paddedSegmentPoints);
+	y.resize(pointCount + paddedSegmentPoints);
+	alpha.resize(pointCount + paddedSegmentPoints);
+	if (!segmentCount)
+		return;
+
+	if ((int) parameters.size() != 3 * paddedSegmentPoints)
+	{
+		parameters.resize(3 * paddedSegmentPoints);
+		for (int j = 0; j < paddedSegmentPoints; j++)
+		{
+			const float t = 1.00f / (ratio + 1) * j;
+			parameters[j] = t;
+			parameters[paddedSegmentPoints + j] = t * t;
+			parameters[2 * paddedSegmentPoints + j] = t * t * t;
+		}
+	}
+
+	// padding segments are all zeros, which is a valid segment of zero length
+	float* s[CHANNELS * CONTROL_POINTS];
+	for (int i = 0; i < CHANNELS * CONTROL_POINTS; i++)
+	{
+		segments[i].resize(segmentStride);
+		s[i] = &segments[i][0];
+	}
+
+	// coefficients of four segments at a time, in place of their control points
+	for (int i = 0; i < segmentStride; i += WIDTH)
+	{
+		Vec4 x0 = Load(s[0] + i), x1 = Load(s[1] + i), x2 = Load(s[2] + i), x3 = Load(s[3] + i);
+		Vec4 y0 = Load(s[4] + i), y1 = Load(s[5] + i), y2 = Load(s[6] + i), y3 = Load(s[7] + i);
+		Vec4 a0 = Load(s[8] + i), a1 = Load(s[9] + i), a2 = Load(s[10] + i), a3 = Load(s[11] + i);
+
+		Vec4 dt0, dt1, dt2;
+		CentripetalIntervals(SquaredDistance(x0, y0, x1, y1), SquaredDistance(x1, y1, x2, y2),
+							 SquaredDistance(x2, y2, x3, y3), dt0, dt1, dt2);
+		CubicCoefficients(x0, x1, x2, x3, dt0, dt1, dt2);
+		CubicCoefficients(y0, y1, y2, y3, dt0, dt1, dt2);
+
+		// alpha is a spline of its own, through points with equal x and y
+		CentripetalIntervals(SquaredDistance(a0, a0, a1, a1), SquaredDistance(a1, a1, a2, a2),
+							 SquaredDistance(a2, a2, a3, a3), dt0, dt1, dt2);
+		CubicCoefficients(a0, a1, a2, a3, dt0, dt1, dt2);
+
+		const Vec4 results[CHANNELS * CONTROL_POINTS] = {x0, x1, x2, x3, y0, y1, y2, y3, a0, a1, a2, a3};
+		for (int k = 0; k < CHANNELS * CONTROL_POINTS; k++)
+			Store(s[k] + i, results[k]);
+	}
+
+	// points of every segment, four at a time for all channels
+	float* out[CHANNELS] = {&x[0], &y[0], &alpha[0]};
+	const float* t = &parameters[0];
+	const float* t2 = t + paddedSegmentPoints;
+	const float* t3 = t2 + paddedSegmentPoints;
+	for (size_t c = 0; c < contours.size(); c++)
+	{
+		const Contour& contour = contours[c];
+		for (int i = 0; i < contour.segmentCount; i++)
+		{
+			const int segment = contour.firstSegment + i;
+			const int first = contour.firstPoint + i * segmentPoints;
+
+			for (int channel = 0; channel < CHANNELS; channel++)
+			{
+				const Vec4 c0 = Set(s[channel * CONTROL_POINTS][segment]);
+				const Vec4 c1 = Set(s[channel * CONTROL_POINTS + 1][segment]);
+				const Vec4 c2 = Set(s[channel * CONTROL_POINTS + 2][segment]);
+				const Vec4 c3 = Set(s[channel * CONTROL_POINTS + 3][segment]);
+
+				for (int j = 0; j < segmentPoints; j += WIDTH)
+				{
+					const Vec4 v = Add(Add(Add(c0, Mul(c1, Load(t + j))), Mul(c2, Load(t2 + j))), Mul(c3, Load(t3 + j)));
+					Store(out[channel] + first + j, v);
+				}
+			}
+		}
+
+		// the last control point ends the contour exactly, the coefficients have replaced it
+		const int last = contour.firstPoint + contour.pointCount - 1;
+		for (int channel = 0; channel < CHANNELS; channel++)
+			out[channel][last] = contour.last[channel];
+	}
+}
+
+}
@@ -0,0 +1,111 @@
+#ifndef __SplineBatch_h__
+#define __SplineBatch_h__
+
+#include <stddef.h>
+#include <vector>
+
+namespace VisageSDK
+{
+
+/** SplineBatch evaluates the centripetal Catmull-Rom splines of many contours at once.
+ *
+ * Contours of all faces are added with @ref AddContour, which splits them into segments and keeps the four control
+ * points of every segment as a structure of arrays, for position and for the alpha channel alike. @ref Evaluate then
+ * finds the coefficients of all segments and evaluates them at the subdivision ratio, four values per SIMD instruction
+ * (NEON on ARM, SSE2 on x86, scalar elsewhere), and writes the spline points of all contours into one packed stream of
+ * x, y and alpha arrays, contour after contour.
+ *
+ * The points of a contour are the same as VisageRendering::CalcSpline calculates for its positions and for its alpha
+ * values given as x, y pairs of equal values. Storage is kept between frames, so once the largest frame has been
+ * evaluated no memory is allocated. Not thread-safe.
+ */
+class SplineBatch {
+
+public:
+
+	/** Batch of the GL thread.
+	*/
+	static SplineBatch& Shared();
+
+	/** Constructor.
+	* @param ratio - number of spline points calculated between neighbouring control points
+	*/
+	explicit SplineBatch(int ratio = 10);
+
+	/** Changes the subdivision ratio, the batch must be empty.
+	*/
+	void SetRatio(int ratio) { this->ratio = ratio; }
+
+	int GetRatio() const { return ratio; }
+
+	/** Number of spline points of a contour of count control points.
+	*/
+	int PointCount(int count) const { return count + (count - 1) * ratio; }
+
+	/** Adds a contour.
+	* @param x, y - control points
+	* @param alpha - alpha value of every control point, interpolated along the spline
+	* @param count - number of control points
+	* @return index of the contour, -1 if it has fewer than 2 points and is not drawn
+	*/
+	int AddContour(const float* x, const float* y, const float* alpha, int count);
+
+	/** Evaluates all contours added since the last @ref Clear into the point stream.
+	*/
+	void Evaluate();
+
+	int GetContourCount() const { return (int) contours.size(); }
+
+	/** Index of the first point of a contour in the point stream.
+	*/
+	int GetFirstPoint(int contour) const { return contours[contour].firstPoint; }
+
+	/** Number of points of a contour in the point stream.
+	*/
+	int GetPointCount(int contour) const { return contours[contour].pointCount; }
+
+	/** Point stream filled by @ref Evaluate, valid until the next @ref Evaluate.
+	*/
+	const float* GetX() const { return &x[0]; }
+	const float* GetY() const { return &y[0]; }
+	const float* GetAlpha() const { return &alpha[0]; }
+
+	/** Removes all contours, keeping the memory.
+	*/
+	void Clear();
+
+private:
+
+	SplineBatch(const SplineBatch&);
+	SplineBatch& operator=(const SplineBatch&);
+
+	// channels of a control point and control points of a segment
+	static const int CHANNELS = 3;
+	static const int CONTROL_POINTS = 4;
+
+	struct Contour {
+		int firstSegment;
+		int segmentCount;
+		int firstPoint;
+		int pointCount;
+		// last control point, x, y and alpha
+		float last[CHANNELS];
+	};
+
+	int ratio;
+	std::vector<Contour> contours;
+	int segmentCount;
+	int pointCount;
+	// control point k of channel c of every segment in segments[c * CONTROL_POINTS + k], replaced by the coefficients
+	// of the cubic polynomials in Evaluate
+	std::vector<float> segments[CHANNELS * CONTROL_POINTS];
+	// spline parameters t of the points of a segment, padded to the SIMD width, followed by t^2 and t^3
+	std::vector<float> parameters;
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> alpha;
+};
+
+}
+
+#endif // __SplineBatch_h__
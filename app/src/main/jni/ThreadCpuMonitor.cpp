@@ -0,0 +1,452 @@
+#include "ThreadCpuMonitor.h"
+#include "FrameTiming.h"
+#include <algorithm>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+
+#define  LOG_TAG    "ThreadCpuMonitor"
+#define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
+#else
+#define  LOGE(...)  (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#endif
+
+namespace VisageSDK
+{
+
+static const char* const KIND_NAMES[THREAD_KIND_COUNT] = {
+	"camera",
+	"tracking",
+	"tracker_workers",
+	"analysis",
+	"render",
+	"other"
+};
+
+// kind the calling thread registered as, -1 before it registered
+static thread_local int registeredKind = -1;
+
+// reads a small /proc file into buffer, returns the number of bytes read or -1
+static int ReadProcFile(const char* path, char* buffer, int size)
+{
+	FILE* file = fopen(path, "re");
+	if (!file)
+		return -1;
+
+	const size_t length = fread(buffer, 1, (size_t) size - 1, file);
+	fclose(file);
+	buffer[length] = 0;
+	return (int) length;
+}
+
+ThreadCpuMonitor& ThreadCpuMonitor::Shared()
+{
+	static ThreadCpuMonitor monitor;
+	return monitor;
+}
+
+ThreadCpuMonitor::ThreadCpuMonitor()
+{
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&wakeup, NULL);
+	running = false;
+	stopRequested = false;
+	intervalMs = 1000;
+	history.resize(HISTORY);
+	historyNext = 0;
+	historyCount = 0;
+	lastSampleNs = -1;
+	resetNs = MonotonicNsec();
+}
+
+ThreadCpuMonitor::~ThreadCpuMonitor()
+{
+	Stop();
+	pthread_cond_destroy(&wakeup);
+	pthread_mutex_destroy(&mutex);
+}
+
+const char* ThreadCpuMonitor::KindName(PipelineThread kind)
+{
+	return (kind >= 0 && kind < THREAD_KIND_COUNT) ? KIND_NAMES[kind] : "unknown";
+}
+
+long long ThreadCpuMonitor::ReadThreadCpuNsec(int tid, std::string* name)
+{
+	char path[64];
+	char buffer[512];
+
+	// stat: "tid (comm) state ..." with utime and stime as fields 14 and 15, comm may contain spaces and parentheses
+	snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+	if (ReadProcFile(path, buffer, sizeof(buffer)) <= 0)
+		return -1;
+
+	char* open = strchr(buffer, '(');
+	char* close = strrchr(buffer, ')');
+	if (!open || !close || close < open)
+		return -1;
+
+	if (name)
+		name->assign(open + 1, close - open - 1);
+
+	// schedstat: time on CPU in nanoseconds, time waiting on a run queue, number of time slices
+	snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", tid);
+	char schedstat[128];
+	if (ReadProcFile(path, schedstat, sizeof(schedstat)) > 0)
+		return strtoll(schedstat, NULL, 10);
+
+	// fields after comm start with the state, which is field 3
+	char* field = close + 2;
+	for (int i = 3; i < 14 && field; i++)
+	{
+		field = strchr(field, ' ');
+		if (field)
+			field++;
+	}
+	if (!field)
+		return -1;
+
+	char* end;
+	const long long utime = strtoll(field, &end, 10);
+	const long long stime = strtoll(end, NULL, 10);
+	return (utime + stime) * (1000000000LL / sysconf(_SC_CLK_TCK));
+}
+
+void ThreadCpuMonitor::RegisterThread(PipelineThread kind)
+{
+	if (registeredKind == kind)
+		return;
+	registeredKind = kind;
+
+	const int tid = (int) gettid();
+
+	pthread_mutex_lock(&mutex);
+	registered[tid] = kind;
+	if (kind == THREAD_TRACKING)
+	{
+		char name[17] = {0};
+		prctl(PR_GET_NAME, name, 0, 0, 0);
+		trackingThreadName = name;
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+PipelineThread ThreadCpuMonitor::Classify(int tid, const std::string& name) const
+{
+	std::map<int, PipelineThread>::const_iterator it = registered.find(tid);
+	if (it != registered.end())
+		return it->second;
+
+	if (!trackingThreadName.empty() && name == trackingThreadName)
+		return THREAD_TRACKER_WORKERS;
+
+	return THREAD_OTHER;
+}
+
+bool ThreadCpuMonitor::Start(int intervalMs)
+{
+	Stop();
+
+	pthread_mutex_lock(&mutex);
+	this->intervalMs = intervalMs > 0 ? intervalMs : 1000;
+	stopRequested = false;
+	pthread_mutex_unlock(&mutex);
+
+	// the first sample only sets the baseline of every thread
+	Reset();
+	Sample();
+
+	if (pthread_create(&thread, 0, SamplingThread, this) != 0)
+	{
+		LOGE("Cannot start the thread CPU monitor");
+		return false;
+	}
+
+	pthread_mutex_lock(&mutex);
+	running = true;
+	pthread_mutex_unlock(&mutex);
+	return true;
+}
+
+void ThreadCpuMonitor::Stop()
+{
+	pthread_mutex_lock(&mutex);
+	if (!running)
+	{
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+	stopRequested = true;
+	pthread_cond_signal(&wakeup);
+	pthread_mutex_unlock(&mutex);
+
+	pthread_join(thread, 0);
+
+	pthread_mutex_lock(&mutex);
+	running = false;
+	pthread_mutex_unlock(&mutex);
+}
+
+void* ThreadCpuMonitor::SamplingThread(void* monitor)
+{
+	prctl(PR_SET_NAME, "CpuMonitor", 0, 0, 0);
+	((ThreadCpuMonitor*) monitor)->Run();
+	return 0;
+}
+
+void ThreadCpuMonitor::Run()
+{
+	pthread_mutex_lock(&mutex);
+	while (!stopRequested)
+	{
+		struct timespec until;
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_sec += intervalMs / 1000;
+		until.tv_nsec += (intervalMs % 1000) * 1000000L;
+		if (until.tv_nsec >= 1000000000L)
+		{
+			until.tv_sec++;
+			until.tv_nsec -= 1000000000L;
+		}
+
+		pthread_cond_timedwait(&wakeup, &mutex, &until);
+		if (stopRequested)
+			break;
+
+		pthread_mutex_unlock(&mutex);
+		Sample();
+		pthread_mutex_lock(&mutex);
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+void ThreadCpuMonitor::Sample()
+{
+	// /proc is read without the lock, registering threads are not held up by it
+	std::vector<std::pair<int, long long> > samples;
+	std::vector<std::string> names;
+
+	DIR* tasks = opendir("/proc/self/task");
+	if (!tasks)
+		return;
+
+	struct dirent* entry;
+	while ((entry = readdir(tasks)) != NULL)
+	{
+		const int tid = atoi(entry->d_name);
+		if (tid <= 0)
+			continue;
+
+		std::string name;
+		const long long cpu = ReadThreadCpuNsec(tid, &name);
+		if (cpu < 0)
+			continue;
+
+		samples.push_back(std::make_pair(tid, cpu));
+		names.push_back(name);
+	}
+	closedir(tasks);
+
+	const long long now = MonotonicNsec();
+
+	pthread_mutex_lock(&mutex);
+
+	ThreadCpuInterval interval;
+	memset(&interval, 0, sizeof(interval));
+	interval.startNs = lastSampleNs;
+	interval.wallNs = now - lastSampleNs;
+
+	for (std::map<int, ThreadEntry>::iterator it = threads.begin(); it != threads.end(); ++it)
+		it->second.alive = false;
+
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		const int tid = samples[i].first;
+		const long long cpu = samples[i].second;
+
+		std::map<int, ThreadEntry>::iterator it = threads.find(tid);
+		if (it == threads.end())
+		{
+			ThreadEntry created;
+			created.lastCpuNs = -1;
+			created.totalCpuNs = 0;
+			it = threads.insert(std::make_pair(tid, created)).first;
+		}
+
+		ThreadEntry& state = it->second;
+		// names and kinds are updated on every sample, Java threads are named only after they started
+		state.name = names[i];
+		state.kind = Classify(tid, names[i]);
+		state.alive = true;
+
+		// a thread started within the interval spent all of its CPU time in it, unless this is the first sample
+		long long delta = (state.lastCpuNs >= 0) ? cpu - state.lastCpuNs : (lastSampleNs >= 0 ? cpu : 0);
+		if (delta < 0)
+			delta = 0;
+		state.lastCpuNs = cpu;
+		state.totalCpuNs += delta;
+		interval.cpuNs[state.kind] += delta;
+	}
+
+	// threads that exited are kept for the totals, but their IDs may be reused
+	for (std::map<int, ThreadEntry>::iterator it = threads.begin(); it != threads.end(); ++it)
+	{
+		if (!it->second.alive)
+			it->second.lastCpuNs = -1;
+	}
+	for (std::map<int, PipelineThread>::iterator it = registered.begin(); it != registered.end();)
+	{
+		std::map<int, ThreadEntry>::const_iterator thread = threads.find(it->first);
+		if (thread == threads.end() || thread->second.alive)
+			++it;
+		else
+			registered.erase(it++);
+	}
+
+	if (lastSampleNs >= 0)
+	{
+		history[historyNext] = interval;
+		historyNext = (historyNext + 1) % HISTORY;
+		if (historyCount < HISTORY)
+			historyCount++;
+	}
+	lastSampleNs = now;
+
+	pthread_mutex_unlock(&mutex);
+}
+
+void ThreadCpuMonitor::Reset()
+{
+	pthread_mutex_lock(&mutex);
+	historyNext = 0;
+	historyCount = 0;
+	resetNs = MonotonicNsec();
+	// the next sample only sets the baseline
+	lastSampleNs = -1;
+	for (std::map<int, ThreadEntry>::iterator it = threads.begin(); it != threads.end();)
+	{
+		if (it->second.alive)
+		{
+			it->second.totalCpuNs = 0;
+			it->second.lastCpuNs = -1;
+			++it;
+		}
+		else
+		{
+			threads.erase(it++);
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+std::vector<ThreadCpuInterval> ThreadCpuMonitor::GetHistory()
+{
+	pthread_mutex_lock(&mutex);
+	std::vector<ThreadCpuInterval> intervals;
+	intervals.reserve(historyCount);
+	for (int i = 0; i < historyCount; i++)
+		intervals.push_back(history[(historyNext - historyCount + i + HISTORY) % HISTORY]);
+	pthread_mutex_unlock(&mutex);
+	return intervals;
+}
+
+std::vector<ThreadCpuUsage> ThreadCpuMonitor::GetThreads()
+{
+	pthread_mutex_lock(&mutex);
+	std::vector<ThreadCpuUsage> usage;
+	for (std::map<int, ThreadEntry>::const_iterator it = threads.begin(); it != threads.end(); ++it)
+	{
+		ThreadCpuUsage thread;
+		thread.tid = it->first;
+		thread.name = it->second.name;
+		thread.kind = it->second.kind;
+		thread.cpuNs = it->second.totalCpuNs;
+		usage.push_back(thread);
+	}
+	pthread_mutex_unlock(&mutex);
+	return usage;
+}
+
+static bool MoreCpu(const ThreadCpuUsage& a, const ThreadCpuUsage& b)
+{
+	return a.cpuNs > b.cpuNs;
+}
+
+std::string ThreadCpuMonitor::Dump()
+{
+	std::vector<ThreadCpuInterval> intervals = GetHistory();
+	std::vector<ThreadCpuUsage> usage = GetThreads();
+
+	pthread_mutex_lock(&mutex);
+	const long long start = resetNs;
+	pthread_mutex_unlock(&mutex);
+	std::sort(usage.begin(), usage.end(), MoreCpu);
+
+	long long wallNs = 0;
+	long long kindNs[THREAD_KIND_COUNT] = {0};
+	for (size_t i = 0; i < intervals.size(); i++)
+	{
+		wallNs += intervals[i].wallNs;
+		for (int k = 0; k < THREAD_KIND_COUNT; k++)
+			kindNs[k] += intervals[i].cpuNs[k];
+	}
+
+	std::string text;
+	char line[160];
+
+	long long totalNs = 0;
+	for (int k = 0; k < THREAD_KIND_COUNT; k++)
+		totalNs += kindNs[k];
+
+	// CPU time as a share of wall time, 100% is one core kept busy all the time
+	const double wall = wallNs > 0 ? (double) wallNs : 1.0;
+	snprintf(line, sizeof(line), "Thread CPU time over %.2f s: %.1f ms, %.1f%% of one core\n", wallNs / 1e9, totalNs / 1e6,
+			 100.0 * totalNs / wall);
+	text += line;
+	for (int k = 0; k < THREAD_KIND_COUNT; k++)
+	{
+		snprintf(line, sizeof(line), "%-16s %10.1f ms %6.1f%%\n", KIND_NAMES[k], kindNs[k] / 1e6, 100.0 * kindNs[k] / wall);
+		text += line;
+	}
+
+	text += "Busiest threads:\n";
+	for (size_t i = 0; i < usage.size() && i < 12 && usage[i].cpuNs > 0; i++)
+	{
+		snprintf(line, sizeof(line), "%6d %-16s %-16s %10.1f ms %6.1f%%\n", usage[i].tid, usage[i].name.c_str(),
+				 KIND_NAMES[usage[i].kind], usage[i].cpuNs / 1e6, 100.0 * usage[i].cpuNs / wall);
+		text += line;
+	}
+
+	text += "Last intervals, % of one core:";
+	for (int k = 0; k < THREAD_KIND_COUNT; k++)
+	{
+		text += ' ';
+		text += KIND_NAMES[k];
+	}
+	text += "\n";
+	const size_t first = intervals.size() > 10 ? intervals.size() - 10 : 0;
+	for (size_t i = first; i < intervals.size(); i++)
+	{
+		const ThreadCpuInterval& interval = intervals[i];
+		const double length = interval.wallNs > 0 ? (double) interval.wallNs : 1.0;
+		snprintf(line, sizeof(line), "%8.1f s", (interval.startNs + interval.wallNs - start) / 1e9);
+		text += line;
+		for (int k = 0; k < THREAD_KIND_COUNT; k++)
+		{
+			snprintf(line, sizeof(line), " %6.1f", 100.0 * interval.cpuNs[k] / length);
+			text += line;
+		}
+		text += "\n";
+	}
+
+	return text;
+}
+
+}
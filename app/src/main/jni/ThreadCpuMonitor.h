@@ -0,0 +1,152 @@
+#ifndef __ThreadCpuMonitor_h__
+#define __ThreadCpuMonitor_h__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+namespace VisageSDK
+{
+
+/** Threads of the process as reported by @ref ThreadCpuMonitor.
+ */
+enum PipelineThread {
+	THREAD_CAMERA,				///< camera callback thread writing frames (WriteFrameStream, or the replaying thread)
+	THREAD_TRACKING,			///< TrackLoop
+	THREAD_TRACKER_WORKERS,		///< OpenMP workers of the tracker, see @ref ThreadCpuMonitor
+	THREAD_ANALYSIS,			///< FaceAnalysisWorker
+	THREAD_RENDER,				///< GL thread calling DisplayTrackingStatus
+	THREAD_OTHER,				///< every other thread of the process: Java, binder, GC, the monitor itself
+	THREAD_KIND_COUNT
+};
+
+/** CPU time of all threads over one sampling interval.
+ */
+struct ThreadCpuInterval {
+	long long startNs;						///< MonotonicNsec at the start of the interval
+	long long wallNs;						///< length of the interval
+	long long cpuNs[THREAD_KIND_COUNT];		///< CPU time of the threads of each kind within the interval
+};
+
+/** CPU time of a single thread since the last @ref ThreadCpuMonitor::Reset.
+ */
+struct ThreadCpuUsage {
+	int tid;
+	std::string name;
+	PipelineThread kind;
+	long long cpuNs;
+};
+
+/** ThreadCpuMonitor samples the CPU time of every thread of the process and reports it against wall time,
+ * per kind of pipeline thread and per sampling interval (one second by default).
+ *
+ * Comparing CPU with wall time shows whether a change saved CPU time, and with it battery, or only moved work to
+ * another thread: a thread spinning while it waits, e.g. OpenMP workers in their spin phase after a parallel region,
+ * shows up as CPU time without any work done.
+ *
+ * The wrapper's own threads register themselves with @ref RegisterThread. The tracker's OpenMP workers cannot, they are
+ * created inside the SDK; since a new thread inherits the name of the thread that created it, unregistered threads
+ * named like the tracking thread are counted as its workers. All other threads are counted as THREAD_OTHER.
+ *
+ * CPU times are read from /proc/self/task/<tid>/schedstat in nanoseconds, or from the clock ticks in
+ * /proc/self/task/<tid>/stat where schedstat is not available. CPU time of threads that exit between two samples is
+ * lost since their previous sample.
+ */
+class ThreadCpuMonitor {
+
+public:
+
+	/** Number of intervals kept, older ones are discarded.
+	*/
+	static const int HISTORY = 600;
+
+	/** Monitor of the whole process.
+	*/
+	static ThreadCpuMonitor& Shared();
+
+	/** Tells the monitor what the calling thread does. Only the first call of a thread takes a lock, later calls
+	* return right away, so it can be called on every frame.
+	*/
+	void RegisterThread(PipelineThread kind);
+
+	/** Starts a background thread that samples every intervalMs milliseconds and clears the history.
+	* @return false if the thread could not be started
+	*/
+	bool Start(int intervalMs = 1000);
+
+	/** Stops sampling, the collected history is kept.
+	*/
+	void Stop();
+
+	bool IsRunning() const { return running; }
+
+	/** Takes one sample now and adds the interval since the previous one to the history.
+	* Called by the sampling thread, or directly when driving the monitor manually.
+	*/
+	void Sample();
+
+	/** Clears the history and the per-thread totals.
+	*/
+	void Reset();
+
+	/** Intervals since the last @ref Reset, oldest first.
+	*/
+	std::vector<ThreadCpuInterval> GetHistory();
+
+	/** All threads seen since the last @ref Reset, including those that have exited.
+	*/
+	std::vector<ThreadCpuUsage> GetThreads();
+
+	/** Totals per kind and thread and the most recent intervals in milliseconds, for logs and bug reports.
+	*/
+	std::string Dump();
+
+	static const char* KindName(PipelineThread kind);
+
+	/** CPU time of a thread of this process in nanoseconds, -1 if it does not exist (any more).
+	*/
+	static long long ReadThreadCpuNsec(int tid, std::string* name = 0);
+
+private:
+
+	ThreadCpuMonitor();
+	~ThreadCpuMonitor();
+	ThreadCpuMonitor(const ThreadCpuMonitor&);
+	ThreadCpuMonitor& operator=(const ThreadCpuMonitor&);
+
+	static void* SamplingThread(void* monitor);
+	void Run();
+	PipelineThread Classify(int tid, const std::string& name) const;
+
+	struct ThreadEntry {
+		std::string name;
+		PipelineThread kind;
+		long long lastCpuNs;	// at the previous sample, -1 before the first one
+		long long totalCpuNs;	// since Reset
+		bool alive;
+	};
+
+	// all fields below are protected by mutex
+	pthread_mutex_t mutex;
+	pthread_cond_t wakeup;
+	pthread_t thread;
+	bool running;
+	bool stopRequested;
+	int intervalMs;
+
+	// threads that registered themselves, by thread ID
+	std::map<int, PipelineThread> registered;
+	std::string trackingThreadName;
+
+	std::map<int, ThreadEntry> threads;
+	long long lastSampleNs;
+	long long resetNs;
+	std::vector<ThreadCpuInterval> history;
+	int historyNext;
+	int historyCount;
+};
+
+}
+
+#endif // __ThreadCpuMonitor_h__
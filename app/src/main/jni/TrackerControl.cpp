@@ -0,0 +1,180 @@
+#include "TrackerControl.h"
+#include "FrameTiming.h"
+#include <time.h>
+
+namespace VisageSDK
+{
+
+TrackerControl::TrackerControl()
+{
+	pthread_mutex_init(&mutex, 0);
+	pthread_cond_init(&changed, 0);
+
+	state.store(TRACKER_UNINITIALIZED);
+	captureNeeded.store(true);
+	capture = 0;
+	frameActive = false;
+	runnableSince = 0;
+
+	idleWakeups.store(0);
+	idleWallNs.store(0);
+	idleCpuNs.store(0);
+	busyCpuNs.store(0);
+	resumeLatencyNs.store(0);
+	frameCpuStart = 0;
+}
+
+TrackerControl::~TrackerControl()
+{
+	pthread_cond_destroy(&changed);
+	pthread_mutex_destroy(&mutex);
+}
+
+bool TrackerControl::IsRunnable() const
+{
+	return state.load(std::memory_order_relaxed) == TRACKER_RUNNING && capture != 0;
+}
+
+void TrackerControl::SetState(TrackerState newState)
+{
+	const bool wasRunnable = IsRunnable();
+	state.store(newState, std::memory_order_relaxed);
+
+	if (!wasRunnable && IsRunnable())
+		runnableSince = MonotonicNsec();
+
+	pthread_cond_broadcast(&changed);
+}
+
+void TrackerControl::WakeGrab()
+{
+	// a tracking thread waiting for a camera frame returns right away and sees the new state
+	if (capture)
+		capture->WakeGrab();
+}
+
+void TrackerControl::Initialize()
+{
+	pthread_mutex_lock(&mutex);
+	captureNeeded.store(true, std::memory_order_release);
+	SetState(TRACKER_PAUSED);
+	pthread_mutex_unlock(&mutex);
+}
+
+void TrackerControl::Pause()
+{
+	pthread_mutex_lock(&mutex);
+	if (GetState() != TRACKER_STOPPED)
+	{
+		SetState(TRACKER_PAUSED);
+		WakeGrab();
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+void TrackerControl::Resume()
+{
+	pthread_mutex_lock(&mutex);
+	if (GetState() != TRACKER_STOPPED)
+		SetState(TRACKER_RUNNING);
+	pthread_mutex_unlock(&mutex);
+}
+
+void TrackerControl::Stop()
+{
+	pthread_mutex_lock(&mutex);
+	SetState(TRACKER_STOPPED);
+	WakeGrab();
+	pthread_mutex_unlock(&mutex);
+}
+
+void TrackerControl::Reconfigure()
+{
+	pthread_mutex_lock(&mutex);
+	captureNeeded.store(true, std::memory_order_release);
+	SetState(TRACKER_PAUSED);
+	WakeGrab();
+	pthread_mutex_unlock(&mutex);
+}
+
+void TrackerControl::DetachCapture()
+{
+	pthread_mutex_lock(&mutex);
+	WakeGrab();
+	capture = 0;
+	pthread_cond_broadcast(&changed);
+
+	// without a capture the tracking thread does not start another frame
+	while (frameActive)
+		pthread_cond_wait(&changed, &mutex);
+	pthread_mutex_unlock(&mutex);
+}
+
+void TrackerControl::AttachCapture(AndroidCapture* newCapture)
+{
+	pthread_mutex_lock(&mutex);
+	capture = newCapture;
+	captureNeeded.store(false, std::memory_order_release);
+
+	// frames may arrive before the tracker is initialized, tracking only starts after Initialize
+	const TrackerState current = GetState();
+	SetState((current == TRACKER_STOPPED || current == TRACKER_UNINITIALIZED) ? current : TRACKER_RUNNING);
+	pthread_mutex_unlock(&mutex);
+}
+
+bool TrackerControl::BeginFrame()
+{
+	pthread_mutex_lock(&mutex);
+
+	if (!IsRunnable() && !IsStopped())
+	{
+		const long long wallStart = MonotonicNsec();
+		const long long cpuStart = ThreadCpuNsec();
+
+		while (!IsRunnable() && !IsStopped())
+		{
+			pthread_cond_wait(&changed, &mutex);
+			idleWakeups.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		idleWallNs.fetch_add(MonotonicNsec() - wallStart, std::memory_order_relaxed);
+		idleCpuNs.fetch_add(ThreadCpuNsec() - cpuStart, std::memory_order_relaxed);
+	}
+
+	if (runnableSince != 0)
+	{
+		resumeLatencyNs.store(MonotonicNsec() - runnableSince, std::memory_order_relaxed);
+		runnableSince = 0;
+	}
+
+	const bool run = !IsStopped();
+	frameActive = run;
+	pthread_mutex_unlock(&mutex);
+
+	frameCpuStart = ThreadCpuNsec();
+	return run;
+}
+
+void TrackerControl::EndFrame()
+{
+	busyCpuNs.fetch_add(ThreadCpuNsec() - frameCpuStart, std::memory_order_relaxed);
+
+	pthread_mutex_lock(&mutex);
+	frameActive = false;
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&mutex);
+}
+
+TrackerControlStats TrackerControl::GetStats() const
+{
+	TrackerControlStats stats;
+	stats.state = state.load(std::memory_order_relaxed);
+	stats.idleWakeups = idleWakeups.load(std::memory_order_relaxed);
+	stats.idleWallNs = idleWallNs.load(std::memory_order_relaxed);
+	stats.idleCpuNs = idleCpuNs.load(std::memory_order_relaxed);
+	stats.busyCpuNs = busyCpuNs.load(std::memory_order_relaxed);
+	stats.resumeLatencyNs = resumeLatencyNs.load(std::memory_order_relaxed);
+	return stats;
+}
+
+}
@@ -0,0 +1,129 @@
+#ifndef __TrackerControl_h__
+#define __TrackerControl_h__
+
+#include "AndroidCapture.h"
+#include <pthread.h>
+#include <atomic>
+
+namespace VisageSDK
+{
+
+/** States of the tracking thread managed by @ref TrackerControl.
+ */
+enum TrackerState {
+	TRACKER_UNINITIALIZED = 0,	///< no tracker yet
+	TRACKER_PAUSED = 1,			///< paused, or waiting for the capture to be recreated
+	TRACKER_RUNNING = 2,		///< tracking frames
+	TRACKER_STOPPED = 3			///< stopped, the tracking loop returns
+};
+
+/** Counters of the tracking thread reported by @ref TrackerControl.
+ */
+struct TrackerControlStats {
+	int state;					///< current @ref TrackerState
+	uint64_t idleWakeups;		///< times the tracking thread woke up while waiting to be runnable
+	long long idleWallNs;		///< wall time spent waiting to be runnable
+	long long idleCpuNs;		///< CPU time of the tracking thread while waiting to be runnable
+	long long busyCpuNs;		///< CPU time of the tracking thread while tracking
+	long long resumeLatencyNs;	///< time from the last transition into running until the tracking thread picked it up
+};
+
+/** TrackerControl drives the tracking loop through explicit state transitions.
+ *
+ * The tracking thread calls @ref BeginFrame before every frame. It blocks on a condition variable, without any
+ * periodic wakeups, until the tracker is running and a capture is attached, and returns false once the tracker is
+ * stopped. @ref EndFrame marks the end of the frame.
+ *
+ * The transitions are:
+ * - @ref Initialize: a tracker was created, the loop stays paused until a new capture is attached
+ * - @ref Pause, @ref Resume, @ref Stop: requested from the application
+ * - @ref Reconfigure: frame parameters changed, the loop pauses until the camera thread recreates the capture
+ * - @ref DetachCapture, @ref AttachCapture: the camera thread replaces the capture, which resumes tracking
+ *
+ * Pausing, reconfiguring and stopping also wake a tracking thread blocked in GrabFrame, so transitions take
+ * effect immediately instead of after the grab timeout.
+ */
+class TrackerControl {
+
+public:
+
+	TrackerControl();
+
+	~TrackerControl();
+
+	/** A tracker was created. The previous capture is discarded and tracking starts once a new one is attached.
+	*/
+	void Initialize();
+
+	void Pause();
+
+	void Resume();
+
+	void Stop();
+
+	/** Requests a new capture for changed frame parameters and pauses until it is attached. Also leaves the stopped state.
+	*/
+	void Reconfigure();
+
+	/** True if the camera thread has to (re)create the capture before writing the next frame.
+	*/
+	bool NeedsCapture() const { return captureNeeded.load(std::memory_order_acquire); }
+
+	/** Detaches the current capture so that it can be deleted, waiting for the tracking thread to finish its frame.
+	* Must not be called with locks held that the tracking thread takes during a frame.
+	*/
+	void DetachCapture();
+
+	/** Attaches a new capture and resumes tracking, unless stopped or not initialized yet.
+	*/
+	void AttachCapture(AndroidCapture* capture);
+
+	/** Called by the tracking thread before a frame. Waits until the tracker is running with a capture attached.
+	* @return false if the tracker was stopped and the loop should return
+	*/
+	bool BeginFrame();
+
+	/** Called by the tracking thread after a frame started with @ref BeginFrame.
+	*/
+	void EndFrame();
+
+	TrackerState GetState() const { return (TrackerState) state.load(std::memory_order_relaxed); }
+
+	bool IsStopped() const { return GetState() == TRACKER_STOPPED; }
+
+	bool IsPaused() const { return GetState() != TRACKER_RUNNING; }
+
+	TrackerControlStats GetStats() const;
+
+private:
+
+	TrackerControl(const TrackerControl&);
+	TrackerControl& operator=(const TrackerControl&);
+
+	// all called with the mutex held
+	void SetState(TrackerState newState);
+	void WakeGrab();
+	bool IsRunnable() const;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t changed;
+
+	std::atomic<int> state;
+	std::atomic<bool> captureNeeded;
+	AndroidCapture* capture;
+	bool frameActive;
+
+	// time of the last transition into runnable, 0 once the tracking thread picked it up
+	long long runnableSince;
+
+	std::atomic<uint64_t> idleWakeups;
+	std::atomic<long long> idleWallNs;
+	std::atomic<long long> idleCpuNs;
+	std::atomic<long long> busyCpuNs;
+	std::atomic<long long> resumeLatencyNs;
+	long long frameCpuStart;
+};
+
+}
+
+#endif // __TrackerControl_h__
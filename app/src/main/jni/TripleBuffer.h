@@ -0,0 +1,103 @@
+#ifndef __TripleBuffer_h__
+#define __TripleBuffer_h__
+
+#include <atomic>
+
+namespace VisageSDK
+{
+
+/** TripleBuffer hands the newest value from one writer thread to one reader thread without copying it.
+ *
+ * There are three slots: the writer fills the back slot and publishes it by swapping its index with the middle one,
+ * the reader takes the newest published slot by swapping the middle index with its front one. Each side only ever
+ * touches the slot it owns, so values are neither copied nor locked, and the writer never waits for the reader.
+ * Values the reader did not pick up in time are overwritten.
+ *
+ * The slots keep their contents when they change hands, so the writer sees the value it published three swaps ago
+ * in the back slot. Buffers kept in the slots (e.g. images) are therefore reused instead of reallocated.
+ */
+template <typename T>
+class TripleBuffer {
+
+public:
+
+	static const int SLOT_COUNT = 3;
+
+	TripleBuffer()
+	{
+		back = 0;
+		middle.store(1);
+		front = 2;
+	}
+
+	/** Slot the writer fills before @ref Publish. Writer thread only.
+	*/
+	T& Back() { return slots[back]; }
+
+	/** Makes the back slot the newest value and gives the writer the previous middle slot as its new back slot.
+	* Writer thread only.
+	*/
+	void Publish()
+	{
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	/** True if the reader has taken the last published value, or nothing was published yet.
+	* Lets the writer skip preparing values the reader would not pick up.
+	*/
+	bool IsConsumed() const
+	{
+		return !(middle.load(std::memory_order_acquire) & FRESH);
+	}
+
+	/** Makes the newest published value the front slot.
+	* Reader thread only.
+	* @return true if there was a newer value, false if the front slot is unchanged
+	*/
+	bool Update()
+	{
+		if (!(middle.load(std::memory_order_relaxed) & FRESH))
+			return false;
+
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	/** Slot the reader uses, valid until the next @ref Update. Reader thread only.
+	*/
+	T& Front() { return slots[front]; }
+
+	/** Direct access to all slots, e.g. to (re)allocate their buffers.
+	* Only while neither the writer nor the reader uses the buffer.
+	*/
+	T& GetSlot(int index) { return slots[index]; }
+
+	/** Forgets the published value, so that the reader keeps its front slot until the next @ref Publish.
+	* Only while neither the writer nor the reader uses the buffer.
+	*/
+	void Reset()
+	{
+		middle.store(middle.load() & INDEX_MASK);
+	}
+
+private:
+
+	TripleBuffer(const TripleBuffer&);
+	TripleBuffer& operator=(const TripleBuffer&);
+
+	static const int INDEX_MASK = 3;
+	static const int FRESH = 4;
+
+	T slots[SLOT_COUNT];
+
+	// owned by the writer
+	int back;
+	// index of the newest published slot, FRESH set until the reader takes it
+	std::atomic<int> middle;
+	// owned by the reader
+	int front;
+};
+
+}
+
+#endif // __TripleBuffer_h__
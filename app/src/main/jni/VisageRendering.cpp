@@ -16,97 +16,18 @@
 
 #include "VisageRendering.h"
 #include "MathMacros.h"
+#include "OverlayBatch.h"
+#include "FrameArena.h"
+#include "SplineBatch.h"
+#include "PipelineMetrics.h"
+#include "PipelineTrace.h"
+#include <algorithm>
 
 namespace VisageSDK
 {
 
-#if defined (IOS) || defined(ANDROID)
-void gluLookAt(GLfloat eyex, GLfloat eyey, GLfloat eyez,
-    GLfloat centerx, GLfloat centery, GLfloat centerz,
-    GLfloat upx, GLfloat upy, GLfloat upz)
-{
-    GLfloat m[16];
-    GLfloat x[3], y[3], z[3];
-    GLfloat mag;
-    GLfloat invmag;
-
-    /* Make rotation matrix */
-
-    /* Z vector */
-    z[0] = eyex - centerx;
-    z[1] = eyey - centery;
-    z[2] = eyez - centerz;
-    mag = sqrt(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
-    if (mag) {          /* mpichler, 19950515 */
-        invmag = 1.0f / mag;
-        z[0] *= invmag;
-        z[1] *= invmag;
-        z[2] *= invmag;
-    }
-
-    /* Y vector */
-    y[0] = upx;
-    y[1] = upy;
-    y[2] = upz;
-
-    /* X vector = Y cross Z */
-    x[0] = y[1] * z[2] - y[2] * z[1];
-    x[1] = -y[0] * z[2] + y[2] * z[0];
-    x[2] = y[0] * z[1] - y[1] * z[0];
-
-    /* Recompute Y = Z cross X */
-    y[0] = z[1] * x[2] - z[2] * x[1];
-    y[1] = -z[0] * x[2] + z[2] * x[0];
-    y[2] = z[0] * x[1] - z[1] * x[0];
-
-    /* mpichler, 19950515 */
-    /* cross product gives area of parallelogram, which is < 1.0 for
-    * non-perpendicular unit-length vectors; so normalize x, y here
-    */
-
-    mag = sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
-    if (mag) {
-        invmag = 1.0f / mag;
-        x[0] *= invmag;
-        x[1] *= invmag;
-        x[2] *= invmag;
-    }
-
-    mag = sqrt(y[0] * y[0] + y[1] * y[1] + y[2] * y[2]);
-    if (mag) {
-        invmag = 1.0f / mag;
-        y[0] *= invmag;
-        y[1] *= invmag;
-        y[2] *= invmag;
-    }
-
-#define M(row,col)  m[col*4+row]
-    M(0, 0) = x[0];
-    M(0, 1) = x[1];
-    M(0, 2) = x[2];
-    M(0, 3) = 0.0;
-    M(1, 0) = y[0];
-    M(1, 1) = y[1];
-    M(1, 2) = y[2];
-    M(1, 3) = 0.0;
-    M(2, 0) = z[0];
-    M(2, 1) = z[1];
-    M(2, 2) = z[2];
-    M(2, 3) = 0.0;
-    M(3, 0) = 0.0;
-    M(3, 1) = 0.0;
-    M(3, 2) = 0.0;
-    M(3, 3) = 1.0;
-#undef M
-    glMultMatrixf(m);
-
-    /* Translate Eye to Origin */
-    glTranslatef(-eyex, -eyey, -eyez);
-}
-
-#endif
-
 static GLuint frame_tex_id = 0;
+static GLuint chroma_tex_id = 0;
 static GLuint logo_tex_id = -1;
 static GLuint img_tex_id = -1;
 static GLuint font_tex_id = -1;
@@ -115,6 +36,8 @@ static float tex_y_coord = 0;
 static bool video_texture_inited = false;
 static int video_texture_width = 0;
 static int video_texture_height = 0;
+static int video_texture_channels = 0;
+static bool chroma_texture_inited = false;
 static int numberOfVertices = 0;
 static float m_fontUV[256][12];
 static int font_width = 0;
@@ -128,6 +51,20 @@ static int frameWidth;
 static int frameHeight;
 
 static std::vector<GLushort> output;
+static std::vector<float> projectedVertices;
+
+// overlays are collected until EndFrame instead of being drawn by every Display call
+static bool frameBatching = false;
+
+// key of the overlays kept in the retained buffers of OverlayBatch
+struct OverlayCacheKey {
+    std::vector<unsigned int> generations;
+    int width, height;
+    int frameWidth, frameHeight;
+    int drawingOptions;
+    bool valid;
+};
+static OverlayCacheKey overlayCache = {std::vector<unsigned int>(), 0, 0, 0, 0, 0, false};
 
 typedef struct CubicPoly
 {
@@ -191,37 +128,119 @@ static void InitCentripetalCR(const Vec2D& p0, const Vec2D& p1, const Vec2D& p2,
     InitNonuniformCatmullRom(p0.y, p1.y, p2.y, p3.y, dt0, dt1, dt2, py);
 }
 
-static void SetupCamera(int width, int height, float f)
+/** Camera of the tracker and pose of an object in front of it.
+ *
+ * Points are projected on the CPU with the frustum the fixed-function renderer used (camera in the origin looking along
+ * +z, up vector +y), so that 3D overlays end up in the same 2D layers as everything else.
+ */
+struct OverlayProjection
 {
-    GLfloat x_offset = 1;
-    GLfloat y_offset = 1;
+    float rotation[9];
+    float translation[3];
+    float scaleX;
+    float scaleY;
+};
+
+static void SetupProjection(OverlayProjection& projection, int width, int height, float f, const float* translation,
+                            float yaw, float pitch, float roll)
+{
+    float x_offset = 1;
+    float y_offset = 1;
     if (width > height)
-        x_offset = ((GLfloat)width) / ((GLfloat)height);
+        x_offset = ((float)width) / ((float)height);
     else if (width < height)
-        y_offset = ((GLfloat)height) / ((GLfloat)width);
-
-    //Note:
-    // FOV in radians is: fov*0.5 = arctan ((top-bottom)*0.5 / near)
-    // In this case: FOV = 2 * arctan(frustum_y / frustum_near)
-    //set frustum specs
-    GLfloat frustum_near = 0.001f;
-    GLfloat frustum_far = 30; //hard to estimate face too far away
-    GLfloat frustum_x = x_offset*frustum_near / f;
-    GLfloat frustum_y = y_offset*frustum_near / f;
-    //set frustum
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glFrustum(-frustum_x, frustum_x, -frustum_y, frustum_y, frustum_near, frustum_far);
-#else
-    glFrustumf(-frustum_x, frustum_x, -frustum_y, frustum_y, frustum_near, frustum_far);
-#endif
-    glMatrixMode(GL_MODELVIEW);
-    //clear matrix
-    glLoadIdentity();
-    //camera in (0,0,0) looking at (0,0,1) up vector (0,1,0)
-    gluLookAt(0, 0, 0, 0, 0, 1, 0, 1, 0);
+        y_offset = ((float)height) / ((float)width);
+
+    // the camera looks along +z, so x is mirrored
+    projection.scaleX = -0.5f * f / x_offset;
+    projection.scaleY = 0.5f * f / y_offset;
+
+    // rotation about y, then x, then z, as glRotatef applied them
+    const float cy = cos(yaw), sy = sin(yaw);
+    const float cx = cos(pitch), sx = sin(pitch);
+    const float cz = cos(roll), sz = sin(roll);
+    float* r = projection.rotation;
+    r[0] = cy * cz + sy * sx * sz;  r[1] = -cy * sz + sy * sx * cz; r[2] = sy * cx;
+    r[3] = cx * sz;                 r[4] = cx * cz;                 r[5] = -sx;
+    r[6] = -sy * cz + cy * sx * sz; r[7] = sy * sz + cy * sx * cz;  r[8] = cy * cx;
+
+    projection.translation[0] = translation[0];
+    projection.translation[1] = translation[1];
+    projection.translation[2] = translation[2];
+}
+
+/** Projects a point of the object to overlay coordinates.
+ * @return false if the point is behind the near plane
+ */
+static bool Project(const OverlayProjection& projection, const float* v, float& x, float& y)
+{
+    const float* r = projection.rotation;
+    const float* t = projection.translation;
+    const float X = r[0] * v[0] + r[1] * v[1] + r[2] * v[2] + t[0];
+    const float Y = r[3] * v[0] + r[4] * v[1] + r[5] * v[2] + t[1];
+    const float Z = r[6] * v[0] + r[7] * v[1] + r[8] * v[2] + t[2];
+
+    if (Z < 0.001f)
+        return false;
+
+    x = 0.5f + projection.scaleX * X / Z;
+    y = 0.5f + projection.scaleY * Y / Z;
+    return true;
+}
+
+// splines of DrawSpline2D, evaluated all at once when the overlays are flushed
+struct QueuedSpline
+{
+    int contour;
+    size_t lines;
+    float width;
+};
+static std::vector<QueuedSpline> queuedSplines;
 
+static OverlayColor SplineColor(float alpha)
+{
+    return OverlayRgbaf(0.69f, 0.77f, 0.87f, alpha);
+}
+
+static void DrawQueuedSplines()
+{
+    if (queuedSplines.empty())
+        return;
+
+    SplineBatch& splines = SplineBatch::Shared();
+    splines.Evaluate();
+    const float* x = splines.GetX();
+    const float* y = splines.GetY();
+    const float* alpha = splines.GetAlpha();
+
+    OverlayBatch& batch = OverlayBatch::Shared();
+    for (size_t s = 0; s < queuedSplines.size(); s++)
+    {
+        const QueuedSpline& spline = queuedSplines[s];
+        const int first = splines.GetFirstPoint(spline.contour);
+        const int count = splines.GetPointCount(spline.contour);
+
+        OverlayColor color = SplineColor(alpha[first]);
+        for (int i = 1; i < count; i++)
+        {
+            const int p = first + i;
+            const OverlayColor nextColor = SplineColor(alpha[p]);
+            batch.SetLine(spline.lines, i - 1, x[p - 1], y[p - 1], x[p], y[p], spline.width, color, nextColor);
+            color = nextColor;
+        }
+    }
+
+    queuedSplines.clear();
+    splines.Clear();
+}
+
+static void FlushUnlessBatching()
+{
+    if (!frameBatching)
+    {
+        DrawQueuedSplines();
+        OverlayBatch::Shared().Flush();
+    }
 }
 
 static void ClearGL()
@@ -230,96 +249,55 @@ static void ClearGL()
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
-static void DrawSpline2D(int *points, int num, FaceData* trackingData, bool useAlpha = false)
+static void DrawSpline2D(const int *points, int num, const FaceSnapshot* face, bool useAlpha = false, float width = 2.0f)
 {
     if (num < 2)
         return;
 
-    std::vector<float> pointCoords;
-    std::vector<float> pointCoordsQuality;
+    FrameArena& arena = FrameArena::Shared();
+    float* x = arena.Allocate<float>(num);
+    float* y = arena.Allocate<float>(num);
+    float* alpha = arena.Allocate<float>(num);
+    if (!x || !y || !alpha)
+        return;
 
     int n = 0;
-    FDP *fdp = trackingData->featurePoints2D;
 
     for (int i = 0; i < num; i++)
     {
-        const FeaturePoint &fp = fdp->getFP(points[2 * i], points[2 * i + 1]);
+        const int p = points[i];
 
-        if (fp.defined && fp.detected && fp.pos[0] != 0 && fp.pos[1] != 0)
+        if (face->flags[p] & FACE_POINT_DRAWABLE)
         {
-            //vector of points position
-            pointCoords.push_back(fp.pos[0]);
-            pointCoords.push_back(fp.pos[1]);
-
-            float alphaChannel = (fp.quality > 0 && useAlpha) ? std::max(fp.quality*0.75f, 0.2f) : 0.75f;
-
-            pointCoordsQuality.push_back(alphaChannel);
-            pointCoordsQuality.push_back(alphaChannel);
+            //position determines the shape of the spline, quality its transparency
+            x[n] = face->x[p];
+            y[n] = face->y[p];
+            alpha[n] = (face->quality[p] > 0 && useAlpha) ? std::max(face->quality[p]*0.75f, 0.2f) : 0.75f;
 
             n++;
         }
     }
 
-    if (pointCoords.size() == 0 || n <= 2)
+    if (n <= 2)
         return;
 
-    int factor = 10;
-    std::vector<float> pointsToDraw;
-    std::vector<float> qualityToDraw;
-    //
-    // Interpolate between points position and points quality
-    // Poistion is used to determin the spline shape
-    // Quality is used to determin the color of the spline
-    VisageRendering::CalcSpline(pointCoords, factor, pointsToDraw);
-    VisageRendering::CalcSpline(pointCoordsQuality, factor, qualityToDraw);
-    //
-    int nVert = (int)pointsToDraw.size() / 2;
-    float *vertices = new float[nVert * 3];
-    float *colors = new float[nVert * 4];
-
-    float rChannel = 0.69f;
-    float gChannel = 0.77f;
-    float bChannel = 0.87f;
-
-    int cnt = 0;
-    for (int i = 0; i < nVert; ++i)
-    {
-        vertices[3 * i + 0] = pointsToDraw.at(cnt++);
-        vertices[3 * i + 1] = pointsToDraw.at(cnt++);
-        vertices[3 * i + 2] = 0.0f;
-        //
-        colors[4 * i + 0] = rChannel;
-        colors[4 * i + 1] = gChannel;
-        colors[4 * i + 2] = bChannel;
-        colors[4 * i + 3] = qualityToDraw[i * 2];
-    }
-
-
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, vertices);
-    glColorPointer(4, GL_FLOAT, 0, colors);
-    glDrawArrays(GL_LINE_STRIP, 0, nVert);
-    glDisableClientState(GL_COLOR_ARRAY);
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisable(GL_BLEND);
-
-
-    //clean-up
-    delete[] vertices;
-    delete[] colors;
+    //the lines keep their place among the overlays, they are set once the splines of all contours are evaluated
+    SplineBatch& splines = SplineBatch::Shared();
+    QueuedSpline spline;
+    spline.contour = splines.AddContour(x, y, alpha, n);
+    spline.lines = OverlayBatch::Shared().ReserveLines(splines.PointCount(n) - 1);
+    spline.width = width;
+    queuedSplines.push_back(spline);
 }
 
-static void DrawElipse(float x, float y, float radiusX, float radiusY, bool filled = true)
+static void DrawElipse(float x, float y, float radiusX, float radiusY, OverlayColor color, bool filled = true, float width = 2.0f)
 {
     static const int circle_points = 100;
 
     float step = 2 * V_PI / circle_points;
     float theta = 0.0;
 
-    float *vertices = new float[circle_points * 2];
+    float vertices[circle_points * 2];
     for (int i = 0; i < circle_points; i++)
     {
         vertices[2 * i] = x + radiusX * cos(theta);
@@ -327,139 +305,53 @@ static void DrawElipse(float x, float y, float radiusX, float radiusY, bool fill
         theta += step;
     }
 
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(2, GL_FLOAT, 0, vertices);
+    OverlayBatch& batch = OverlayBatch::Shared();
 
     if (filled)
-        glDrawArrays(GL_TRIANGLE_FAN, 0, circle_points);
+        batch.AddPolygon(vertices, circle_points, color);
     else
-        glDrawArrays(GL_LINE_LOOP, 0, circle_points);
-
-    glDisableClientState(GL_VERTEX_ARRAY);
-
-    delete[] vertices;
+    {
+        for (int i = 0; i < circle_points; i++)
+        {
+            const int next = (i + 1) % circle_points;
+            batch.AddLine(vertices[2 * i], vertices[2 * i + 1], vertices[2 * next], vertices[2 * next + 1], width, color);
+        }
+    }
 }
 
-static void DrawPoints2D(int *points, int num, bool singleColor, FaceData* trackingData, VsImage* frame, bool drawQuality = true, bool useAlpha = false)
+static void DrawPoints2D(const int *points, int num, bool singleColor, const FaceSnapshot* face, VsImage* frame, bool drawQuality = true, bool useAlpha = false)
 {
 #ifdef IOS
-    float radius = (trackingData->faceScale / (float)frame->width) * 10;
+    float radius = (face->faceScale / (float)frame->width) * 10;
 #elif defined(MAC_OS_X) || defined(WIN32)
-    float faceScaleNormalized = (frame->width > frame->height) ? trackingData->faceScale / (float)frame->width : trackingData->faceScale / (float)frame->height;
+    float faceScaleNormalized = (frame->width > frame->height) ? face->faceScale / (float)frame->width : face->faceScale / (float)frame->height;
     float radius = ((1 + (faceScaleNormalized * 2.0)) * (1 + (winHeight / 250.0)));
 #else
-    float radius = (trackingData->faceScale / (float)frame->width) * 30;
+    float radius = (face->faceScale / (float)frame->width) * 30;
 #endif
 
-    FDP *fdp = trackingData->featurePoints2D;
+    OverlayBatch& batch = OverlayBatch::Shared();
 
-    float *vertices = new float[num * 2];
-    float *colorsQuality = new float[num * 4];
-    float *colorsCircle = new float[num * 4];
-    int n = 0;
     for (int i = 0; i < num; i++) {
-        const FeaturePoint &fp = fdp->getFP(points[2 * i], points[2 * i + 1]);
-        if (fp.detected && fp.defined && fp.pos[0] != 0 && fp.pos[1] != 0) {
-            vertices[2 * n + 0] = fp.pos[0];
-            vertices[2 * n + 1] = fp.pos[1];
-            if (drawQuality && fp.quality >= 0) {
-                colorsQuality[4 * n + 0] = 1.0f - fp.quality;
-                colorsQuality[4 * n + 1] = fp.quality;
-                colorsQuality[4 * n + 2] = 0;
-                colorsQuality[4 * n + 3] = useAlpha ? std::max(fp.quality, 0.5f) : 1.0f;
-                //
-                colorsCircle[4 * n + 0] = 0.0f;
-                colorsCircle[4 * n + 1] = 0.0f;
-                colorsCircle[4 * n + 2] = 0.0f;
-                colorsCircle[4 * n + 3] = useAlpha ? std::max(fp.quality, 0.3f) : 1.0f;
+        const int p = points[i];
+        if (face->flags[p] & FACE_POINT_DRAWABLE) {
+            const float quality = face->quality[p];
+            OverlayColor colorQuality;
+            OverlayColor colorCircle;
+            if (drawQuality && quality >= 0) {
+                colorQuality = OverlayRgbaf(1.0f - quality, quality, 0, useAlpha ? std::max(quality, 0.5f) : 1.0f);
+                colorCircle = OverlayRgbaf(0.0f, 0.0f, 0.0f, useAlpha ? std::max(quality, 0.3f) : 1.0f);
             }
             else {
-                colorsQuality[4 * n + 0] = 0;
-                colorsQuality[4 * n + 1] = 1.0f;
-                colorsQuality[4 * n + 2] = 1.0f;
-                colorsQuality[4 * n + 3] = 1.0f;
-                //
-                colorsCircle[4 * n + 0] = 0.0f;
-                colorsCircle[4 * n + 1] = 0.0f;
-                colorsCircle[4 * n + 2] = 0.0f;
-                colorsCircle[4 * n + 3] = 1.0f;
+                colorQuality = OverlayRgbaf(0, 1.0f, 1.0f, 1.0f);
+                colorCircle = OverlayRgbaf(0.0f, 0.0f, 0.0f, 1.0f);
             }
-            n++;
-        }
-    }
-
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_POINT_SMOOTH);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(2, GL_FLOAT, 0, vertices);
 
-    glPointSize(radius);
-    glEnableClientState(GL_COLOR_ARRAY);
-    glColorPointer(4, GL_FLOAT, 0, colorsCircle);
-    glDrawArrays(GL_POINTS, 0, n);
-    glDisableClientState(GL_COLOR_ARRAY);
-
-    if (!singleColor)
-    {
-        glPointSize(0.65f * radius);
-        glEnableClientState(GL_COLOR_ARRAY);
-        glColorPointer(4, GL_FLOAT, 0, colorsQuality);
-        glDrawArrays(GL_POINTS, 0, n);
-        glDisableClientState(GL_COLOR_ARRAY);
-    }
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisable(GL_BLEND);
-    //clean-up
-    delete[] vertices;
-    delete[] colorsQuality;
-    delete[] colorsCircle;
-}
-
-static void DrawPoints3D(int *points, int num, bool singleColor, FaceData* trackingData, VsImage* frame, bool relative)
-{
-
-#ifdef IOS
-    float radius = (trackingData->faceScale / (float)frame->width) * 10;
-#elif MAC_OS_X
-    float radius = (trackingData->faceScale / (float)frame->width) * 20;
-#else
-    float faceScaleNormalized = (frame->width > frame->height) ? trackingData->faceScale / (float)frame->width : trackingData->faceScale / (float)frame->height;
-    float radius = ((1 + (faceScaleNormalized * 2.0)) * (1 + (winHeight / 250.0)));
-#endif
-
-    FDP *fdp = relative ? trackingData->featurePoints3DRelative : trackingData->featurePoints3D;
-
-    float *vertices = new float[num * 3];
-    int n = 0;
-    for (int i = 0; i < num; i++)
-    {
-        const FeaturePoint &fp = fdp->getFP(points[2 * i], points[2 * i + 1]);
-        if (fp.defined && fp.pos[0] != 0 && fp.pos[1] != 0)
-        {
-            vertices[3 * n + 0] = fp.pos[0];
-            vertices[3 * n + 1] = fp.pos[1];
-            vertices[3 * n + 2] = fp.pos[2];
-            n++;
+            batch.AddPoint(face->x[p], face->y[p], radius, colorCircle, true);
+            if (!singleColor)
+                batch.AddPoint(face->x[p], face->y[p], 0.65f * radius, colorQuality);
         }
     }
-
-    glEnable(GL_POINT_SMOOTH);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, vertices);
-    glPointSize(radius);
-    glColor4ub(0, 0, 0, 255);
-    glDrawArrays(GL_POINTS, 0, n);
-    if (!singleColor)
-    {
-        glPointSize(0.8f * radius);
-        glColor4ub(0, 255, 255, 255);
-        glDrawArrays(GL_POINTS, 0, n);
-    }
-    glDisableClientState(GL_VERTEX_ARRAY);
-
-    //clean-up
-    delete[] vertices;
 }
 
 static int NearestPow2(int n)
@@ -485,8 +377,8 @@ static void InitFrameTex(int x_size, int y_size, const VsImage *image)
 
     //Typical Texture Generation Using Data From The Bitmap
     glBindTexture(GL_TEXTURE_2D, frame_tex_id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
@@ -509,8 +401,11 @@ static void InitFrameTex(int x_size, int y_size, const VsImage *image)
     case 1:
         glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, x_size, y_size, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, 0);
         break;
-    case 3:
     case 4:
+        // the format of the texture must match the format of the pixels uploaded into it
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, x_size, y_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        break;
+    case 3:
     default:
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, x_size, y_size, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
         break;
@@ -523,6 +418,45 @@ static void InitFrameTex(int x_size, int y_size, const VsImage *image)
     tex_y_coord = (float)image->height / (float)y_size;
 }
 
+/** (Re)creates the frame texture if the size or the format of the frames changed, together with the chroma texture.
+ */
+static void PrepareFrameTex(const VsImage *image)
+{
+    if (video_texture_inited && (video_texture_width != image->width || video_texture_height != image->height ||
+                                 video_texture_channels != image->nChannels))
+    {
+        glDeleteTextures(1, &frame_tex_id);
+        video_texture_inited = false;
+        if (chroma_texture_inited)
+            glDeleteTextures(1, &chroma_tex_id);
+        chroma_texture_inited = false;
+    }
+
+    if (!video_texture_inited)
+    {
+        InitFrameTex(NearestPow2(image->width), NearestPow2(image->height), image);
+        video_texture_width = image->width;
+        video_texture_height = image->height;
+        video_texture_channels = image->nChannels;
+        video_texture_inited = true;
+    }
+}
+
+static void InitChromaTex()
+{
+    glGenTextures(1, &chroma_tex_id);
+
+    glBindTexture(GL_TEXTURE_2D, chroma_tex_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    //Half the size of the luma texture, so that both are sampled with the same texture coordinates
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, NearestPow2(video_texture_width) / 2,
+                 NearestPow2(video_texture_height) / 2, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, 0);
+}
+
 static void GenerateImgTex(GLuint &tex_id)
 {
     glGenTextures(1, &tex_id);
@@ -530,8 +464,8 @@ static void GenerateImgTex(GLuint &tex_id)
     //Bind the newly created texture
     glBindTexture(GL_TEXTURE_2D, tex_id);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
@@ -547,8 +481,8 @@ void VisageRendering::DisplayLogo(const VsImage *logo, int width, int height)
         //Bind the newly created texture
         glBindTexture(GL_TEXTURE_2D, logo_tex_id);
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
@@ -562,42 +496,6 @@ void VisageRendering::DisplayLogo(const VsImage *logo, int width, int height)
 #endif
     }
 
-    glBindTexture(GL_TEXTURE_2D, logo_tex_id);
-
-#if defined(WIN32) || defined(LINUX)
-    glPushAttrib(GL_DEPTH_BUFFER_BIT | GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_FOG_BIT | GL_STENCIL_BUFFER_BIT | GL_TRANSFORM_BIT | GL_TEXTURE_BIT);
-#endif
-
-    glDisable(GL_ALPHA_TEST);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_DITHER);
-    glDisable(GL_FOG);
-    glDisable(GL_SCISSOR_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_LIGHTING);
-    glDisable(GL_LIGHT0);
-
-    //transparency
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
-
-    //use texture
-    glEnable(GL_TEXTURE_2D);
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glOrtho(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#else
-    glOrthof(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#endif
-
     //logo aspect
     float logoAspect = logo->width / (float)logo->height;
     //viewport aspect
@@ -606,937 +504,656 @@ void VisageRendering::DisplayLogo(const VsImage *logo, int width, int height)
     float x = 0.75f;
     float y = 1 - ((1 - x) * viewportAspect / logoAspect);
 
-    GLfloat vertices[] = {
-        x,y,-5.0f,
-        1.0f,y,-5.0f,
-        x,1.0f,-5.0f,
-        1.0f,1.0f,-5.0f,
-    };
-
     //tex coords are flipped upside down instead of an image
-    GLfloat texcoords[] = {
-        0.0f,1.0f,
-        1.0f,1.0f,
-        0.0f,0.0f,
-        1.0f,0.0f,
-    };
-
-    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glEnableClientState(GL_VERTEX_ARRAY);
-
-    glVertexPointer(3, GL_FLOAT, 0, vertices);
-    glTexCoordPointer(2, GL_FLOAT, 0, texcoords);
-
-    glViewport(0, 0, width, height);
-
-    //drawing vertices and texcoords
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    glDisableClientState(GL_VERTEX_ARRAY);
-
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_BLEND);
-
-    glPopMatrix();
-
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
-
-    //disable logo texture
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-#if defined(WIN32) || defined(LINUX)
-    glPopAttrib();
-#endif
-
-    //glClear(GL_DEPTH_BUFFER_BIT);
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetViewport(width, height);
+    batch.DrawTexturedQuad(logo_tex_id, x, y, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, true);
 }
 
 void VisageRendering::DisplayFrame(const VsImage *image, int width, int height)
 {
     glPixelStorei(GL_UNPACK_ALIGNMENT, (image->widthStep & 3) ? 1 : 4);
 
-    if (video_texture_inited && (video_texture_width != image->width || video_texture_height != image->height))
-    {
-        glDeleteTextures(1, &frame_tex_id);
-        video_texture_inited = false;
-    }
-
-    if (!video_texture_inited)
-    {
-        InitFrameTex(NearestPow2(image->width), NearestPow2(image->height), image);
-        video_texture_width = image->width;
-        video_texture_height = image->height;
-        video_texture_inited = true;
-    }
+    PrepareFrameTex(image);
 
     glBindTexture(GL_TEXTURE_2D, frame_tex_id);
 
-    switch (image->nChannels) {
-    case 3:
+    {
+        // time the driver takes to accept the pixels, the copy to the GPU may complete later
+        PipelineTimer uploadTimer(STAGE_TEXTURE_UPLOAD);
+        PIPELINE_TRACE_SCOPE("texture_upload", -1);
+
+        switch (image->nChannels) {
+        case 3:
 #if defined (IOS) || defined (ANDROID)
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height, GL_RGB, GL_UNSIGNED_BYTE, image->imageData);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height, GL_RGB, GL_UNSIGNED_BYTE, image->imageData);
 #else
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height, GL_BGR, GL_UNSIGNED_BYTE, image->imageData);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height, GL_BGR, GL_UNSIGNED_BYTE, image->imageData);
 #endif
-        break;
-    case 4:
+            break;
+        case 4:
 #if defined(IOS) || defined(MAC_OS_X)
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height, GL_BGRA, GL_UNSIGNED_BYTE, image->imageData);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height, GL_BGRA, GL_UNSIGNED_BYTE, image->imageData);
 #else
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height, GL_RGBA, GL_UNSIGNED_BYTE, image->imageData);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height, GL_RGBA, GL_UNSIGNED_BYTE, image->imageData);
 #endif
-        break;
-    case 1:
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height, GL_LUMINANCE, GL_UNSIGNED_BYTE, image->imageData);
-        break;
-    default:
-        return;
+            break;
+        case 1:
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height, GL_LUMINANCE, GL_UNSIGNED_BYTE, image->imageData);
+            break;
+        default:
+            return;
+        }
     }
 
-#if defined(WIN32) || defined(LINUX)
-    glPushAttrib(GL_DEPTH_BUFFER_BIT | GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_FOG_BIT | GL_STENCIL_BUFFER_BIT | GL_TRANSFORM_BIT | GL_TEXTURE_BIT);
-#endif
-
-    glDisable(GL_ALPHA_TEST);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
-    glDisable(GL_DITHER);
-    glDisable(GL_FOG);
-    glDisable(GL_SCISSOR_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_LIGHTING);
-    glDisable(GL_LIGHT0);
-    glEnable(GL_TEXTURE_2D);
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glOrtho(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#else
-    glOrthof(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#endif
-
-    static GLfloat vertices[] = {
-        0.0f,0.0f,-5.0f,
-        1.0f,0.0f,-5.0f,
-        0.0f,1.0f,-5.0f,
-        1.0f,1.0f,-5.0f,
-    };
+    glBindTexture(GL_TEXTURE_2D, 0);
 
     // tex coords are flipped upside down instead of an image
-    GLfloat texcoords[] = {
-        0.0f,           tex_y_coord,
-        tex_x_coord,    tex_y_coord,
-        0.0f,           0.0f,
-        tex_x_coord,    0.0f,
-    };
-
-    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetViewport(width, height);
+    batch.DrawTexturedQuad(frame_tex_id, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, tex_y_coord, tex_x_coord, 0.0f);
 
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glEnableClientState(GL_VERTEX_ARRAY);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
 
-    glVertexPointer(3, GL_FLOAT, 0, vertices);
-    glTexCoordPointer(2, GL_FLOAT, 0, texcoords);
+void VisageRendering::DisplayFrameNV12(const VsImage *luma, const VsImage *chroma, YuvColorMatrix matrix, int width, int height)
+{
+    if (!luma || !chroma)
+        return;
 
-    glViewport(0, 0, width, height);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    ClearGL();
 
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    glDisableClientState(GL_VERTEX_ARRAY);
+    //rows of both planes are as long as the frame is wide
+    glPixelStorei(GL_UNPACK_ALIGNMENT, ((luma->widthStep | chroma->widthStep) & 3) ? 1 : 4);
 
-    glDisable(GL_TEXTURE_2D);
+    PrepareFrameTex(luma);
+    if (!chroma_texture_inited)
+    {
+        InitChromaTex();
+        chroma_texture_inited = true;
+    }
 
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
+    {
+        // half the bytes of an RGB frame, the conversion is left to the fragment shader
+        PipelineTimer uploadTimer(STAGE_TEXTURE_UPLOAD);
+        PIPELINE_TRACE_SCOPE("texture_upload", -1);
+
+        glBindTexture(GL_TEXTURE_2D, frame_tex_id);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, luma->width, luma->height, GL_LUMINANCE, GL_UNSIGNED_BYTE, luma->imageData);
+        glBindTexture(GL_TEXTURE_2D, chroma_tex_id);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, chroma->width, chroma->height, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE,
+                        chroma->imageData);
+    }
 
     glBindTexture(GL_TEXTURE_2D, 0);
 
-#if defined(WIN32) || defined(LINUX)
-    glPopAttrib();
-#endif
+    float coefficients[6];
+    YuvConverter::GetCoefficients(matrix, coefficients);
+
+    //the planes are rotated and mirrored by the capture like RGB frames, so the tex coords are the same
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetViewport(width, height);
+    batch.DrawYuvQuad(frame_tex_id, chroma_tex_id, coefficients, NearestPow2(video_texture_width) / 2,
+                      NearestPow2(video_texture_height) / 2, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, tex_y_coord, tex_x_coord, 0.0f);
 
     glClear(GL_DEPTH_BUFFER_BIT);
 }
 
-void VisageRendering::DisplayFeaturePoints(FaceData* trackingData, int width, int height, VsImage* frame, bool _3D, bool relative, bool drawQuality)
+void VisageRendering::DisplayFeaturePoints(const FaceSnapshot* face, int width, int height, VsImage* frame, bool drawQuality)
 {
-    glViewport(0, 0, width, height);
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glPushAttrib(GL_DEPTH_BUFFER_BIT | GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_FOG_BIT | GL_STENCIL_BUFFER_BIT | GL_TRANSFORM_BIT | GL_TEXTURE_BIT);
-#endif
-
-    glDisable(GL_ALPHA_TEST);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_DITHER);
-    glDisable(GL_FOG);
-    glDisable(GL_SCISSOR_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_BLEND);
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glOrtho(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#else
-    glOrthof(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#endif
+    OverlayBatch::Shared().SetViewport(width, height);
 
-    if (_3D) {
-        SetupCamera(width, height, trackingData->cameraFocus);
-
-        if (relative) {
-            const float *r = trackingData->faceRotation;
-            const float *t = trackingData->faceTranslation;
-
-            glTranslatef(t[0], t[1], t[2]);
-            glRotatef(V_RAD2DEG(r[1] + V_PI), 0.0f, 1.0f, 0.0f);
-            glRotatef(V_RAD2DEG(r[0]), 1.0f, 0.0f, 0.0f);
-            glRotatef(V_RAD2DEG(r[2]), 0.0f, 0.0f, 1.0f);
-        }
-    }
-
-    static int chinPoints[] = {
-        2,  1
+    static const int chinPoints[] = {
+        FaceSnapshotPoint(2, 1)
     };
 
-    if (_3D) DrawPoints3D(chinPoints, 1, false, trackingData, frame, relative);
-    else DrawPoints2D(chinPoints, 1, false, trackingData, frame, drawQuality);
-
-    static int innerLipPoints[] = {
-        2,  2,
-        17, 18,
-        2,  6,
-        17, 14,
-        2,  4,
-        17, 16,
-        2,  8,
-        17, 20,
-        2,  3,
-        17, 19,
-        2,  9,
-        17, 15,
-        2,  5,
-        17, 13,
-        2,  7,
-        17, 17,
+    DrawPoints2D(chinPoints, 1, false, face, frame, drawQuality);
+
+    static const int innerLipPoints[] = {
+        FaceSnapshotPoint(2, 2),
+        FaceSnapshotPoint(17, 18),
+        FaceSnapshotPoint(2, 6),
+        FaceSnapshotPoint(17, 14),
+        FaceSnapshotPoint(2, 4),
+        FaceSnapshotPoint(17, 16),
+        FaceSnapshotPoint(2, 8),
+        FaceSnapshotPoint(17, 20),
+        FaceSnapshotPoint(2, 3),
+        FaceSnapshotPoint(17, 19),
+        FaceSnapshotPoint(2, 9),
+        FaceSnapshotPoint(17, 15),
+        FaceSnapshotPoint(2, 5),
+        FaceSnapshotPoint(17, 13),
+        FaceSnapshotPoint(2, 7),
+        FaceSnapshotPoint(17, 17)
     };
-    if (_3D) DrawPoints3D(innerLipPoints, 16, false, trackingData, frame, relative);
-    else DrawPoints2D(innerLipPoints, 16, false, trackingData, frame, drawQuality);
-
-    static int outerLipPoints[] = {
-        8,  1,
-        8,  10,
-        17, 10,
-        8,  5,
-        17, 5,
-        8,  3,
-        17, 7,
-        8,  7,
-        17, 11,
-        8,  2,
-        17, 12,
-        8,  8,
-        17, 8,
-        8,  4,
-        17, 6,
-        8,  6,
-        17, 9,
-        8,  9,
+    DrawPoints2D(innerLipPoints, 16, false, face, frame, drawQuality);
+
+    static const int outerLipPoints[] = {
+        FaceSnapshotPoint(8, 1),
+        FaceSnapshotPoint(8, 10),
+        FaceSnapshotPoint(17, 10),
+        FaceSnapshotPoint(8, 5),
+        FaceSnapshotPoint(17, 5),
+        FaceSnapshotPoint(8, 3),
+        FaceSnapshotPoint(17, 7),
+        FaceSnapshotPoint(8, 7),
+        FaceSnapshotPoint(17, 11),
+        FaceSnapshotPoint(8, 2),
+        FaceSnapshotPoint(17, 12),
+        FaceSnapshotPoint(8, 8),
+        FaceSnapshotPoint(17, 8),
+        FaceSnapshotPoint(8, 4),
+        FaceSnapshotPoint(17, 6),
+        FaceSnapshotPoint(8, 6),
+        FaceSnapshotPoint(17, 9),
+        FaceSnapshotPoint(8, 9)
     };
-    if (_3D) DrawPoints3D(outerLipPoints, 18, false, trackingData, frame, relative);
-    else DrawPoints2D(outerLipPoints, 18, false, trackingData, frame, drawQuality);
-
-    static int nosePoints[] = {
-        9,  5,
-        9,  4,
-        9,  3,
-        9,  15,
-        14, 22,
-        14, 23,
-        14, 24,
-        14, 25
+    DrawPoints2D(outerLipPoints, 18, false, face, frame, drawQuality);
+
+    static const int nosePoints[] = {
+        FaceSnapshotPoint(9, 5),
+        FaceSnapshotPoint(9, 4),
+        FaceSnapshotPoint(9, 3),
+        FaceSnapshotPoint(9, 15),
+        FaceSnapshotPoint(14, 22),
+        FaceSnapshotPoint(14, 23),
+        FaceSnapshotPoint(14, 24),
+        FaceSnapshotPoint(14, 25)
     };
-    if (_3D) DrawPoints3D(nosePoints, 8, false, trackingData, frame, relative);
-    else DrawPoints2D(nosePoints, 8, false, trackingData, frame, drawQuality);
+    DrawPoints2D(nosePoints, 8, false, face, frame, drawQuality);
 
-    if (trackingData->eyeClosure[1] > 0.5f)
+    if (face->eyeClosure[1] > 0.5f)
     {
         //if eye is open, draw the pupil
-        glColor4ub(200, 80, 0, 255);
-        static int pupilPoints[] = {
-            3,  6,
-        };
-        if (_3D) DrawPoints3D(pupilPoints, 1, false, trackingData, frame, relative);
-        else DrawPoints2D(pupilPoints, 1, false, trackingData, frame, drawQuality);
+        static const int pupilPoints[] = {
+        FaceSnapshotPoint(3, 6)
+    };
+        DrawPoints2D(pupilPoints, 1, false, face, frame, drawQuality);
     }
 
-    if (trackingData->eyeClosure[0] > 0.5f)
+    if (face->eyeClosure[0] > 0.5f)
     {
-        glColor4ub(200, 80, 0, 255);
-        static int pupilPoints[] = {
-            3,  5,
-        };
-        if (_3D) DrawPoints3D(pupilPoints, 1, false, trackingData, frame, relative);
-        else DrawPoints2D(pupilPoints, 1, false, trackingData, frame, drawQuality);
+        static const int pupilPoints[] = {
+        FaceSnapshotPoint(3, 5)
+    };
+        DrawPoints2D(pupilPoints, 1, false, face, frame, drawQuality);
     }
 
-    static int eyesPointsR[] = {
-        3,  2,
-        3,  4,
-        3,  8,
-        3,  10,
-        3,  12,
-        3,  14,
-        12, 6,
-        12, 8,
-        12, 10,
-        12, 12,
-        16, 2,
-        16, 4,
-        16, 6,
-        16, 8,
-        16, 10,
-        16, 12,
-        16, 14,
-        16, 16,
-        16, 18,
-        16, 20,
-        16, 22,
-        16, 24,
-        16, 26,
-        16, 28,
+    static const int eyesPointsR[] = {
+        FaceSnapshotPoint(3, 2),
+        FaceSnapshotPoint(3, 4),
+        FaceSnapshotPoint(3, 8),
+        FaceSnapshotPoint(3, 10),
+        FaceSnapshotPoint(3, 12),
+        FaceSnapshotPoint(3, 14),
+        FaceSnapshotPoint(12, 6),
+        FaceSnapshotPoint(12, 8),
+        FaceSnapshotPoint(12, 10),
+        FaceSnapshotPoint(12, 12),
+        FaceSnapshotPoint(16, 2),
+        FaceSnapshotPoint(16, 4),
+        FaceSnapshotPoint(16, 6),
+        FaceSnapshotPoint(16, 8),
+        FaceSnapshotPoint(16, 10),
+        FaceSnapshotPoint(16, 12),
+        FaceSnapshotPoint(16, 14),
+        FaceSnapshotPoint(16, 16),
+        FaceSnapshotPoint(16, 18),
+        FaceSnapshotPoint(16, 20),
+        FaceSnapshotPoint(16, 22),
+        FaceSnapshotPoint(16, 24),
+        FaceSnapshotPoint(16, 26),
+        FaceSnapshotPoint(16, 28)
     };
-    if (_3D) DrawPoints3D(eyesPointsR, 24, trackingData->eyeClosure[1] <= 0.5f, trackingData, frame, relative);
-    else DrawPoints2D(eyesPointsR, 24, trackingData->eyeClosure[1] <= 0.5f, trackingData, frame, drawQuality);
-
-    static int eyesPointsL[] = {
-        3,  1,
-        3,  3,
-        3,  7,
-        3,  9,
-        3,  11,
-        3,  13,
-        12, 5,
-        12, 7,
-        12, 9,
-        12, 11,
-        16, 1,
-        16, 3,
-        16, 5,
-        16, 7,
-        16, 9,
-        16, 11,
-        16, 13,
-        16, 15,
-        16, 17,
-        16, 19,
-        16, 21,
-        16, 23,
-        16, 25,
-        16, 27,
+    DrawPoints2D(eyesPointsR, 24, face->eyeClosure[1] <= 0.5f, face, frame, drawQuality);
+
+    static const int eyesPointsL[] = {
+        FaceSnapshotPoint(3, 1),
+        FaceSnapshotPoint(3, 3),
+        FaceSnapshotPoint(3, 7),
+        FaceSnapshotPoint(3, 9),
+        FaceSnapshotPoint(3, 11),
+        FaceSnapshotPoint(3, 13),
+        FaceSnapshotPoint(12, 5),
+        FaceSnapshotPoint(12, 7),
+        FaceSnapshotPoint(12, 9),
+        FaceSnapshotPoint(12, 11),
+        FaceSnapshotPoint(16, 1),
+        FaceSnapshotPoint(16, 3),
+        FaceSnapshotPoint(16, 5),
+        FaceSnapshotPoint(16, 7),
+        FaceSnapshotPoint(16, 9),
+        FaceSnapshotPoint(16, 11),
+        FaceSnapshotPoint(16, 13),
+        FaceSnapshotPoint(16, 15),
+        FaceSnapshotPoint(16, 17),
+        FaceSnapshotPoint(16, 19),
+        FaceSnapshotPoint(16, 21),
+        FaceSnapshotPoint(16, 23),
+        FaceSnapshotPoint(16, 25),
+        FaceSnapshotPoint(16, 27)
     };
-    if (_3D) DrawPoints3D(eyesPointsL, 24, trackingData->eyeClosure[0] <= 0.5f, trackingData, frame, relative);
-    else DrawPoints2D(eyesPointsL, 24, trackingData->eyeClosure[0] <= 0.5f, trackingData, frame, drawQuality);
-
-    static int eyebrowPoints[] = {
-        4,  1,
-        4,  2,
-        4,  3,
-        4,  4,
-        4,  5,
-        4,  6,
-        14, 1,
-        14, 2,
-        14, 3,
-        14, 4,
-        14, 5,
-        14, 6,
-        14, 7,
-        14, 8,
-        14, 9,
-        14, 10,
-        14, 11,
-        14, 12
+    DrawPoints2D(eyesPointsL, 24, face->eyeClosure[0] <= 0.5f, face, frame, drawQuality);
+
+    static const int eyebrowPoints[] = {
+        FaceSnapshotPoint(4, 1),
+        FaceSnapshotPoint(4, 2),
+        FaceSnapshotPoint(4, 3),
+        FaceSnapshotPoint(4, 4),
+        FaceSnapshotPoint(4, 5),
+        FaceSnapshotPoint(4, 6),
+        FaceSnapshotPoint(14, 1),
+        FaceSnapshotPoint(14, 2),
+        FaceSnapshotPoint(14, 3),
+        FaceSnapshotPoint(14, 4),
+        FaceSnapshotPoint(14, 5),
+        FaceSnapshotPoint(14, 6),
+        FaceSnapshotPoint(14, 7),
+        FaceSnapshotPoint(14, 8),
+        FaceSnapshotPoint(14, 9),
+        FaceSnapshotPoint(14, 10),
+        FaceSnapshotPoint(14, 11),
+        FaceSnapshotPoint(14, 12)
     };
-    if (_3D) DrawPoints3D(eyebrowPoints, 18, false, trackingData, frame, relative);
-    else DrawPoints2D(eyebrowPoints, 18, false, trackingData, frame, drawQuality);
+    DrawPoints2D(eyebrowPoints, 18, false, face, frame, drawQuality);
 
 
     // physical contour
-    static int contourPointsPhysical[] = {
-        15, 1,
-        15, 3,
-        15, 5,
-        15, 7,
-        15, 9,
-        15, 11,
-        15, 13,
-        15, 15,
-        15, 17,
-        15, 16,
-        15, 14,
-        15, 12,
-        15, 10,
-        15, 8,
-        15, 6,
-        15, 4,
-        15, 2
+    static const int contourPointsPhysical[] = {
+        FaceSnapshotPoint(15, 1),
+        FaceSnapshotPoint(15, 3),
+        FaceSnapshotPoint(15, 5),
+        FaceSnapshotPoint(15, 7),
+        FaceSnapshotPoint(15, 9),
+        FaceSnapshotPoint(15, 11),
+        FaceSnapshotPoint(15, 13),
+        FaceSnapshotPoint(15, 15),
+        FaceSnapshotPoint(15, 17),
+        FaceSnapshotPoint(15, 16),
+        FaceSnapshotPoint(15, 14),
+        FaceSnapshotPoint(15, 12),
+        FaceSnapshotPoint(15, 10),
+        FaceSnapshotPoint(15, 8),
+        FaceSnapshotPoint(15, 6),
+        FaceSnapshotPoint(15, 4),
+        FaceSnapshotPoint(15, 2)
     };
-    if (_3D) DrawPoints3D(contourPointsPhysical, 17, false, trackingData, frame, relative);
-    else DrawPoints2D(contourPointsPhysical, 17, false, trackingData, frame, drawQuality, true);
-
-    static int leftEarPoints[] = {
-        10, 1,
-        10, 3,
-        10, 5,
-        10, 7,
-        10, 9,
-        10, 11,
-        10, 13,
-        10, 15,
-        10, 17,
-        10, 19,
-        10, 21,
-        10, 23,
+    DrawPoints2D(contourPointsPhysical, 17, false, face, frame, drawQuality, true);
+
+    static const int leftEarPoints[] = {
+        FaceSnapshotPoint(10, 1),
+        FaceSnapshotPoint(10, 3),
+        FaceSnapshotPoint(10, 5),
+        FaceSnapshotPoint(10, 7),
+        FaceSnapshotPoint(10, 9),
+        FaceSnapshotPoint(10, 11),
+        FaceSnapshotPoint(10, 13),
+        FaceSnapshotPoint(10, 15),
+        FaceSnapshotPoint(10, 17),
+        FaceSnapshotPoint(10, 19),
+        FaceSnapshotPoint(10, 21),
+        FaceSnapshotPoint(10, 23)
     };
-    if (_3D) DrawPoints3D(leftEarPoints, 12, false, trackingData, frame, relative);
-    else DrawPoints2D(leftEarPoints, 12, false, trackingData, frame, drawQuality);
-
-    static int rightEarPoints[] = {
-        10, 2,
-        10, 4,
-        10, 6,
-        10, 8,
-        10, 10,
-        10, 12,
-        10, 14,
-        10, 16,
-        10, 18,
-        10, 20,
-        10, 22,
-        10, 24,
+    DrawPoints2D(leftEarPoints, 12, false, face, frame, drawQuality);
+
+    static const int rightEarPoints[] = {
+        FaceSnapshotPoint(10, 2),
+        FaceSnapshotPoint(10, 4),
+        FaceSnapshotPoint(10, 6),
+        FaceSnapshotPoint(10, 8),
+        FaceSnapshotPoint(10, 10),
+        FaceSnapshotPoint(10, 12),
+        FaceSnapshotPoint(10, 14),
+        FaceSnapshotPoint(10, 16),
+        FaceSnapshotPoint(10, 18),
+        FaceSnapshotPoint(10, 20),
+        FaceSnapshotPoint(10, 22),
+        FaceSnapshotPoint(10, 24)
     };
 
-    if (_3D) DrawPoints3D(rightEarPoints, 12, false, trackingData, frame, relative);
-    else DrawPoints2D(rightEarPoints, 12, false, trackingData, frame, drawQuality);
+    DrawPoints2D(rightEarPoints, 12, false, face, frame, drawQuality);
 
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glPopAttrib();
-#endif
+    FlushUnlessBatching();
 }
 
-void VisageRendering::DisplaySplines(FaceData* trackingData, int width, int height)
+void VisageRendering::DisplaySplines(const FaceSnapshot* face, int width, int height)
 {
-    glViewport(0, 0, width, height);
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glPushAttrib(GL_DEPTH_BUFFER_BIT | GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_FOG_BIT | GL_STENCIL_BUFFER_BIT | GL_TRANSFORM_BIT | GL_TEXTURE_BIT);
-#endif
-
-    glDisable(GL_ALPHA_TEST);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_DITHER);
-    glDisable(GL_FOG);
-    glDisable(GL_SCISSOR_TEST);
-    glDisable(GL_STENCIL_TEST);
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glOrtho(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#else
-    glOrthof(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#endif
-
-    glPointSize(3);
-    glLineWidth(2);
-
-    static int outerUpperLipPoints[] = {
-        8, 4,
-        17, 6,
-        8, 6,
-        17, 9,
-        8, 9,
-        8, 1,
-        8, 10,
-        17, 10,
-        8, 5,
-        17, 5,
-        8, 3,
+    OverlayBatch::Shared().SetViewport(width, height);
+
+    static const int outerUpperLipPoints[] = {
+        FaceSnapshotPoint(8, 4),
+        FaceSnapshotPoint(17, 6),
+        FaceSnapshotPoint(8, 6),
+        FaceSnapshotPoint(17, 9),
+        FaceSnapshotPoint(8, 9),
+        FaceSnapshotPoint(8, 1),
+        FaceSnapshotPoint(8, 10),
+        FaceSnapshotPoint(17, 10),
+        FaceSnapshotPoint(8, 5),
+        FaceSnapshotPoint(17, 5),
+        FaceSnapshotPoint(8, 3)
     };
-    DrawSpline2D(outerUpperLipPoints, 11, trackingData);
-
-    static int outerLowerLipPoints[] = {
-        8, 4,
-        17, 8,
-        8, 8,
-        17, 12,
-        8, 2,
-        17, 11,
-        8, 7,
-        17, 7,
-        8, 3,
+    DrawSpline2D(outerUpperLipPoints, 11, face);
+
+    static const int outerLowerLipPoints[] = {
+        FaceSnapshotPoint(8, 4),
+        FaceSnapshotPoint(17, 8),
+        FaceSnapshotPoint(8, 8),
+        FaceSnapshotPoint(17, 12),
+        FaceSnapshotPoint(8, 2),
+        FaceSnapshotPoint(17, 11),
+        FaceSnapshotPoint(8, 7),
+        FaceSnapshotPoint(17, 7),
+        FaceSnapshotPoint(8, 3)
     };
-    DrawSpline2D(outerLowerLipPoints, 9, trackingData);
-
-    static int innerUpperLipPoints[] = {
-        2, 5,
-        17, 13,
-        2, 7,
-        17, 17,
-        2, 2,
-        17, 18,
-        2, 6,
-        17, 14,
-        2, 4,
+    DrawSpline2D(outerLowerLipPoints, 9, face);
+
+    static const int innerUpperLipPoints[] = {
+        FaceSnapshotPoint(2, 5),
+        FaceSnapshotPoint(17, 13),
+        FaceSnapshotPoint(2, 7),
+        FaceSnapshotPoint(17, 17),
+        FaceSnapshotPoint(2, 2),
+        FaceSnapshotPoint(17, 18),
+        FaceSnapshotPoint(2, 6),
+        FaceSnapshotPoint(17, 14),
+        FaceSnapshotPoint(2, 4)
     };
-    DrawSpline2D(innerUpperLipPoints, 9, trackingData);
-
-    static int innerLowerLipPoints[] = {
-        2, 5,
-        17, 15,
-        2, 9,
-        17, 19,
-        2, 3,
-        17, 20,
-        2, 8,
-        17, 16,
-        2, 4,
+    DrawSpline2D(innerUpperLipPoints, 9, face);
+
+    static const int innerLowerLipPoints[] = {
+        FaceSnapshotPoint(2, 5),
+        FaceSnapshotPoint(17, 15),
+        FaceSnapshotPoint(2, 9),
+        FaceSnapshotPoint(17, 19),
+        FaceSnapshotPoint(2, 3),
+        FaceSnapshotPoint(17, 20),
+        FaceSnapshotPoint(2, 8),
+        FaceSnapshotPoint(17, 16),
+        FaceSnapshotPoint(2, 4)
     };
-    DrawSpline2D(innerLowerLipPoints, 9, trackingData);
+    DrawSpline2D(innerLowerLipPoints, 9, face);
 
-    static int noseLinePoints[] = {
-        9,  5,
-        9,  3,
-        9,  4
+    static const int noseLinePoints[] = {
+        FaceSnapshotPoint(9, 5),
+        FaceSnapshotPoint(9, 3),
+        FaceSnapshotPoint(9, 4)
     };
-    DrawSpline2D(noseLinePoints, 3, trackingData);
-
-    static int noseLinePoints2[] = {
-        9,  3,
-        14, 22,
-        14, 23,
-        14, 24,
-        14, 25
+    DrawSpline2D(noseLinePoints, 3, face);
+
+    static const int noseLinePoints2[] = {
+        FaceSnapshotPoint(9, 3),
+        FaceSnapshotPoint(14, 22),
+        FaceSnapshotPoint(14, 23),
+        FaceSnapshotPoint(14, 24),
+        FaceSnapshotPoint(14, 25)
     };
-    DrawSpline2D(noseLinePoints2, 5, trackingData);
-
-    static int outerUpperEyePointsR[] = {
-        16,  28,
-        16,  6,
-        3,   14,
-        16,  2,
-        16,  26,
+    DrawSpline2D(noseLinePoints2, 5, face);
+
+    static const int outerUpperEyePointsR[] = {
+        FaceSnapshotPoint(16, 28),
+        FaceSnapshotPoint(16, 6),
+        FaceSnapshotPoint(3, 14),
+        FaceSnapshotPoint(16, 2),
+        FaceSnapshotPoint(16, 26)
     };
-    DrawSpline2D(outerUpperEyePointsR, 5, trackingData);
-
-    static int outerLowerEyePointsR[] = {
-        16,  26,
-        16,  4,
-        3,   10,
-        16,  8,
-        16,  28,
+    DrawSpline2D(outerUpperEyePointsR, 5, face);
+
+    static const int outerLowerEyePointsR[] = {
+        FaceSnapshotPoint(16, 26),
+        FaceSnapshotPoint(16, 4),
+        FaceSnapshotPoint(3, 10),
+        FaceSnapshotPoint(16, 8),
+        FaceSnapshotPoint(16, 28)
     };
-    DrawSpline2D(outerLowerEyePointsR, 5, trackingData);
-
-    static int innerUpperEyePointsR[] = {
-        3,  12,
-        16, 22,
-        12, 10,
-        16, 18,
-        3,  2,
-        16, 14,
-        12, 6,
-        16, 10,
-        3,  8
+    DrawSpline2D(outerLowerEyePointsR, 5, face);
+
+    static const int innerUpperEyePointsR[] = {
+        FaceSnapshotPoint(3, 12),
+        FaceSnapshotPoint(16, 22),
+        FaceSnapshotPoint(12, 10),
+        FaceSnapshotPoint(16, 18),
+        FaceSnapshotPoint(3, 2),
+        FaceSnapshotPoint(16, 14),
+        FaceSnapshotPoint(12, 6),
+        FaceSnapshotPoint(16, 10),
+        FaceSnapshotPoint(3, 8)
     };
-    DrawSpline2D(innerUpperEyePointsR, 9, trackingData);
-
-    static int innerLowerEyePointsR[] = {
-        3,  8,
-        16, 12,
-        12, 8,
-        16, 16,
-        3,  4,
-        16, 20,
-        12, 12,
-        16, 24,
-        3,  12,
+    DrawSpline2D(innerUpperEyePointsR, 9, face);
+
+    static const int innerLowerEyePointsR[] = {
+        FaceSnapshotPoint(3, 8),
+        FaceSnapshotPoint(16, 12),
+        FaceSnapshotPoint(12, 8),
+        FaceSnapshotPoint(16, 16),
+        FaceSnapshotPoint(3, 4),
+        FaceSnapshotPoint(16, 20),
+        FaceSnapshotPoint(12, 12),
+        FaceSnapshotPoint(16, 24),
+        FaceSnapshotPoint(3, 12)
     };
-    DrawSpline2D(innerLowerEyePointsR, 9, trackingData);
-
-    static int outerUpperEyePointsL[] = {
-        16,  27,
-        16,  5,
-        3,   13,
-        16,  1,
-        16,  25,
+    DrawSpline2D(innerLowerEyePointsR, 9, face);
+
+    static const int outerUpperEyePointsL[] = {
+        FaceSnapshotPoint(16, 27),
+        FaceSnapshotPoint(16, 5),
+        FaceSnapshotPoint(3, 13),
+        FaceSnapshotPoint(16, 1),
+        FaceSnapshotPoint(16, 25)
     };
-    DrawSpline2D(outerUpperEyePointsL, 5, trackingData);
-
-    static int outerLowerEyePointsL[] = {
-        16,  25,
-        16,  3,
-        3,   9,
-        16,  7,
-        16,  27,
+    DrawSpline2D(outerUpperEyePointsL, 5, face);
+
+    static const int outerLowerEyePointsL[] = {
+        FaceSnapshotPoint(16, 25),
+        FaceSnapshotPoint(16, 3),
+        FaceSnapshotPoint(3, 9),
+        FaceSnapshotPoint(16, 7),
+        FaceSnapshotPoint(16, 27)
     };
-    DrawSpline2D(outerLowerEyePointsL, 5, trackingData);
-
-    static int innerUpperEyePointsL[] = {
-        3,   11,
-        16,  21,
-        12,  9,
-        16,  17,
-        3,   1,
-        16,  13,
-        12,  5,
-        16,  9,
-        3,   7,
+    DrawSpline2D(outerLowerEyePointsL, 5, face);
+
+    static const int innerUpperEyePointsL[] = {
+        FaceSnapshotPoint(3, 11),
+        FaceSnapshotPoint(16, 21),
+        FaceSnapshotPoint(12, 9),
+        FaceSnapshotPoint(16, 17),
+        FaceSnapshotPoint(3, 1),
+        FaceSnapshotPoint(16, 13),
+        FaceSnapshotPoint(12, 5),
+        FaceSnapshotPoint(16, 9),
+        FaceSnapshotPoint(3, 7)
     };
-    DrawSpline2D(innerUpperEyePointsL, 9, trackingData);
-
-    static int innerLowerEyePointsL[] = {
-        3,   7,
-        16,  11,
-        12,  7,
-        16,  15,
-        3,   3,
-        16,  19,
-        12,  11,
-        16,  23,
-        3,   11
+    DrawSpline2D(innerUpperEyePointsL, 9, face);
+
+    static const int innerLowerEyePointsL[] = {
+        FaceSnapshotPoint(3, 7),
+        FaceSnapshotPoint(16, 11),
+        FaceSnapshotPoint(12, 7),
+        FaceSnapshotPoint(16, 15),
+        FaceSnapshotPoint(3, 3),
+        FaceSnapshotPoint(16, 19),
+        FaceSnapshotPoint(12, 11),
+        FaceSnapshotPoint(16, 23),
+        FaceSnapshotPoint(3, 11)
     };
-    DrawSpline2D(innerLowerEyePointsL, 9, trackingData);
-
-    static int eyebrowUpperPointsR[] = {
-        14, 6,
-        4,  2,
-        14, 2,
-        4,  4,
-        14, 4,
-        4,  6
+    DrawSpline2D(innerLowerEyePointsL, 9, face);
+
+    static const int eyebrowUpperPointsR[] = {
+        FaceSnapshotPoint(14, 6),
+        FaceSnapshotPoint(4, 2),
+        FaceSnapshotPoint(14, 2),
+        FaceSnapshotPoint(4, 4),
+        FaceSnapshotPoint(14, 4),
+        FaceSnapshotPoint(4, 6)
     };
-    DrawSpline2D(eyebrowUpperPointsR, 6, trackingData);
-
-    static int eyebrowLowerPointsR[] = {
-        4,  6,
-        14, 12,
-        14, 10,
-        14, 8,
-        14, 6
+    DrawSpline2D(eyebrowUpperPointsR, 6, face);
+
+    static const int eyebrowLowerPointsR[] = {
+        FaceSnapshotPoint(4, 6),
+        FaceSnapshotPoint(14, 12),
+        FaceSnapshotPoint(14, 10),
+        FaceSnapshotPoint(14, 8),
+        FaceSnapshotPoint(14, 6)
     };
-    DrawSpline2D(eyebrowLowerPointsR, 5, trackingData);
-
-    static int eyebrowUpperPointsL[] = {
-        14, 5,
-        4,  1,
-        14, 1,
-        4,  3,
-        14, 3,
-        4,  5
+    DrawSpline2D(eyebrowLowerPointsR, 5, face);
+
+    static const int eyebrowUpperPointsL[] = {
+        FaceSnapshotPoint(14, 5),
+        FaceSnapshotPoint(4, 1),
+        FaceSnapshotPoint(14, 1),
+        FaceSnapshotPoint(4, 3),
+        FaceSnapshotPoint(14, 3),
+        FaceSnapshotPoint(4, 5)
     };
-    DrawSpline2D(eyebrowUpperPointsL, 6, trackingData);
-
-    static int eyebrowLowerPointsL[] = {
-        4,  5,
-        14, 11,
-        14, 9,
-        14, 7,
-        14, 5
+    DrawSpline2D(eyebrowUpperPointsL, 6, face);
+
+    static const int eyebrowLowerPointsL[] = {
+        FaceSnapshotPoint(4, 5),
+        FaceSnapshotPoint(14, 11),
+        FaceSnapshotPoint(14, 9),
+        FaceSnapshotPoint(14, 7),
+        FaceSnapshotPoint(14, 5)
     };
-    DrawSpline2D(eyebrowLowerPointsL, 5, trackingData);
-
-    static int contourLinesPointsLPhysical[] = {
-        15, 1,
-        15, 3,
-        15, 5,
-        15, 7,
-        15, 9,
-        15, 11,
-        15, 13,
-        15, 15,
-        15, 17,
-        15, 16,
-        15, 14,
-        15, 12,
-        15, 10,
-        15, 8,
-        15, 6,
-        15, 4,
-        15, 2
+    DrawSpline2D(eyebrowLowerPointsL, 5, face);
+
+    static const int contourLinesPointsLPhysical[] = {
+        FaceSnapshotPoint(15, 1),
+        FaceSnapshotPoint(15, 3),
+        FaceSnapshotPoint(15, 5),
+        FaceSnapshotPoint(15, 7),
+        FaceSnapshotPoint(15, 9),
+        FaceSnapshotPoint(15, 11),
+        FaceSnapshotPoint(15, 13),
+        FaceSnapshotPoint(15, 15),
+        FaceSnapshotPoint(15, 17),
+        FaceSnapshotPoint(15, 16),
+        FaceSnapshotPoint(15, 14),
+        FaceSnapshotPoint(15, 12),
+        FaceSnapshotPoint(15, 10),
+        FaceSnapshotPoint(15, 8),
+        FaceSnapshotPoint(15, 6),
+        FaceSnapshotPoint(15, 4),
+        FaceSnapshotPoint(15, 2)
     };
-    DrawSpline2D(contourLinesPointsLPhysical, 17, trackingData, true);
-
-    static int leftEarPoints[] = {
-        10, 11,
-        10, 1,
-        10, 13,
-        10, 3,
-        10, 15,
-        10, 5,
-        10, 19,
+    DrawSpline2D(contourLinesPointsLPhysical, 17, face, true);
+
+    static const int leftEarPoints[] = {
+        FaceSnapshotPoint(10, 11),
+        FaceSnapshotPoint(10, 1),
+        FaceSnapshotPoint(10, 13),
+        FaceSnapshotPoint(10, 3),
+        FaceSnapshotPoint(10, 15),
+        FaceSnapshotPoint(10, 5),
+        FaceSnapshotPoint(10, 19)
     };
 
-    DrawSpline2D(leftEarPoints, 7, trackingData);
+    DrawSpline2D(leftEarPoints, 7, face);
 
-    static int rightEarPoints[] = {
-        10, 12,
-        10, 2,
-        10, 14,
-        10, 4,
-        10, 16,
-        10, 6,
-        10, 20
+    static const int rightEarPoints[] = {
+        FaceSnapshotPoint(10, 12),
+        FaceSnapshotPoint(10, 2),
+        FaceSnapshotPoint(10, 14),
+        FaceSnapshotPoint(10, 4),
+        FaceSnapshotPoint(10, 16),
+        FaceSnapshotPoint(10, 6),
+        FaceSnapshotPoint(10, 20)
     };
 
-    DrawSpline2D(rightEarPoints, 7, trackingData);
+    DrawSpline2D(rightEarPoints, 7, face);
 
-    glDisable(GL_BLEND);
-
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glPopAttrib();
-#endif
+    FlushUnlessBatching();
 }
 
-void VisageRendering::DisplayGaze(FaceData* trackingData, int width, int height)
+void VisageRendering::DisplayGaze(const FaceSnapshot* face, int width, int height)
 {
-    glViewport(0, 0, width, height);
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-    SetupCamera(width, height, trackingData->cameraFocus);
-
-    glShadeModel(GL_FLAT);
-
-    static float vertices[] = {
+    static const float vertices[] = {
         0.0f, 0.0f, 0.0f,
         0.0f, 0.0f, 0.04f
     };
 
     float tr[6] = { 0, 0, 0, 0, 0, 0 };
 
-    FDP *fdp = trackingData->featurePoints3D;
-
-    if (fdp == NULL)
+    if (!face->has3D)
         return;
 
-    const FeaturePoint &leye = fdp->getFP(3, 5);
-    const FeaturePoint &reye = fdp->getFP(3, 6);
-
-    if (leye.defined && reye.defined)
+    if (face->eyes3DDefined)
     {
-        tr[0] = leye.pos[0];
-        tr[1] = leye.pos[1];
-        tr[2] = leye.pos[2];
-        tr[3] = reye.pos[0];
-        tr[4] = reye.pos[1];
-        tr[5] = reye.pos[2];
+        tr[0] = face->eyes3D[0][0];
+        tr[1] = face->eyes3D[0][1];
+        tr[2] = face->eyes3D[0][2];
+        tr[3] = face->eyes3D[1][0];
+        tr[4] = face->eyes3D[1][1];
+        tr[5] = face->eyes3D[1][2];
     }
 
-    float h_rot = V_RAD2DEG(trackingData->gazeDirectionGlobal[1] + V_PI);
-    float v_rot = V_RAD2DEG(trackingData->gazeDirectionGlobal[0]);
-    float roll = V_RAD2DEG(trackingData->gazeDirectionGlobal[2]);
-
-    glEnableClientState(GL_VERTEX_ARRAY);
+    float h_rot = face->gazeDirectionGlobal[1] + V_PI;
+    float v_rot = face->gazeDirectionGlobal[0];
+    float roll = face->gazeDirectionGlobal[2];
 
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetViewport(width, height);
 
-    glTranslatef(tr[0], tr[1], tr[2]);
-    glRotatef(h_rot, 0.0f, 1.0f, 0.0f);
-    glRotatef(v_rot, 1.0f, 0.0f, 0.0f);
-    glRotatef(roll, 0.0f, 0.0f, 1.0f);
+    const OverlayColor color = OverlayRgba(240, 96, 0, 255);
 
-    glLineWidth(2);
-
-    glColor4ub(240, 96, 0, 255);
-
-    if (trackingData->eyeClosure[0] > 0.5f)
+    for (int eye = 0; eye < 2; eye++)
     {
-        glVertexPointer(3, GL_FLOAT, 0, vertices);
-        glDrawArrays(GL_LINES, 0, 2);
-    }
-
-    glPopMatrix();
-
-    glPushMatrix();
+        if (face->eyeClosure[eye] <= 0.5f)
+            continue;
 
-    glTranslatef(tr[3], tr[4], tr[5]);
-    glRotatef(h_rot, 0.0f, 1.0f, 0.0f);
-    glRotatef(v_rot, 1.0f, 0.0f, 0.0f);
-    glRotatef(roll, 0.0f, 0.0f, 1.0f);
+        OverlayProjection projection;
+        SetupProjection(projection, width, height, face->cameraFocus, &tr[3 * eye], h_rot, v_rot, roll);
 
-    if (trackingData->eyeClosure[1] > 0.5f)
-    {
-        glVertexPointer(3, GL_FLOAT, 0, vertices);
-        glDrawArrays(GL_LINES, 0, 2);
+        float x0, y0, x1, y1;
+        if (Project(projection, &vertices[0], x0, y0) && Project(projection, &vertices[3], x1, y1))
+            batch.AddLine(x0, y0, x1, y1, 2.0f, color);
     }
 
-    glDisableClientState(GL_VERTEX_ARRAY);
-
-    glPopMatrix();
-
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
+    FlushUnlessBatching();
 }
 
-void VisageRendering::DisplayIrises(FaceData* trackingData, int width, int height, VsImage* frame)
+void VisageRendering::DisplayIrises(const FaceSnapshot* face, int width, int height, VsImage* frame)
 {
-
-    glViewport(0, 0, width, height);
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glPushAttrib(GL_DEPTH_BUFFER_BIT | GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_FOG_BIT | GL_STENCIL_BUFFER_BIT | GL_TRANSFORM_BIT | GL_TEXTURE_BIT);
-#endif
-
-    glDisable(GL_ALPHA_TEST);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_DITHER);
-    glDisable(GL_FOG);
-    glDisable(GL_SCISSOR_TEST);
-    glDisable(GL_STENCIL_TEST);
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glOrtho(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#else
-    glOrthof(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#endif
-
-    glPointSize(3);
-    glLineWidth(2);
-
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
-
-    FDP *fdp = trackingData->featurePoints3D;
-
-    if (fdp == NULL)
+    if (!face->has3D)
         return;
 
-    const FeaturePoint &leye = fdp->getFP(3, 5);
-    const FeaturePoint &reye = fdp->getFP(3, 6);
+    OverlayBatch::Shared().SetViewport(width, height);
+
+    static const int leye = FaceSnapshotPoint(3, 5);
+    static const int reye = FaceSnapshotPoint(3, 6);
 
-    if (trackingData->irisRadius[0] > 0)
+    if (face->irisRadius[0] > 0)
     {
-        FeaturePoint fp = trackingData->featurePoints2D->getFP(3, 5);
-        float rx = trackingData->irisRadius[0] / float(frame->width);
-        float ry = trackingData->irisRadius[0] / float(frame->height);
-        glColor4ub(255, 255, 255, 20);
-        DrawElipse(fp.pos[0], fp.pos[1], rx, ry);
-        glColor4ub(255, 255, 255, 255);
-        DrawElipse(fp.pos[0], fp.pos[1], rx, ry, false);
+        float rx = face->irisRadius[0] / float(frame->width);
+        float ry = face->irisRadius[0] / float(frame->height);
+        DrawElipse(face->x[leye], face->y[leye], rx, ry, OverlayRgba(255, 255, 255, 20));
+        DrawElipse(face->x[leye], face->y[leye], rx, ry, OverlayRgba(255, 255, 255, 255), false);
     }
 
-    if (trackingData->irisRadius[1] > 0)
+    if (face->irisRadius[1] > 0)
     {
-        FeaturePoint fp = trackingData->featurePoints2D->getFP(3, 6);
-        float rx = trackingData->irisRadius[1] / float(frame->width);
-        float ry = trackingData->irisRadius[1] / float(frame->height);
-        glColor4ub(255, 255, 255, 20);
-        DrawElipse(fp.pos[0], fp.pos[1], rx, ry);
-        glColor4ub(255, 255, 255, 255);
-        DrawElipse(fp.pos[0], fp.pos[1], rx, ry, false);
+        float rx = face->irisRadius[1] / float(frame->width);
+        float ry = face->irisRadius[1] / float(frame->height);
+        DrawElipse(face->x[reye], face->y[reye], rx, ry, OverlayRgba(255, 255, 255, 20));
+        DrawElipse(face->x[reye], face->y[reye], rx, ry, OverlayRgba(255, 255, 255, 255), false);
     }
 
-    glDisable(GL_BLEND);
-
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glPopAttrib();
-#endif
-
+    FlushUnlessBatching();
 }
 
-void VisageRendering::DisplayModelAxes(FaceData* trackingData, int width, int height)
+void VisageRendering::DisplayModelAxes(const FaceSnapshot* face, int width, int height)
 {
-    glViewport(0, 0, width, height);
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-    SetupCamera(width, height, trackingData->cameraFocus);
-
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
-
-    glShadeModel(GL_FLAT);
-
     //rotate and translate into the current coordinate system of the head
-    const float *r = trackingData->faceRotation;
-    //const float *t = trackingData->faceTranslation;
-    FDP *fdp = trackingData->featurePoints3D;
+    const float *r = face->faceRotation;
+    //const float *t = face->faceTranslation;
 
-    if (fdp == NULL)
+    if (!face->has3D)
         return;
 
-    const FeaturePoint &fp1 = fdp->getFP(4, 1);
-    const FeaturePoint &fp2 = fdp->getFP(4, 2);
+    const float *center = face->browCenter3D;
 
-    glTranslatef((fp1.pos[0] + fp2.pos[0]) / 2.0f, (fp1.pos[1] + fp2.pos[1]) / 2.0f, (fp1.pos[2] + fp2.pos[2]) / 2.0f);
-    glRotatef(V_RAD2DEG(r[1] + V_PI), 0.0f, 1.0f, 0.0f);
-    glRotatef(V_RAD2DEG(r[0]), 1.0f, 0.0f, 0.0f);
-    glRotatef(V_RAD2DEG(r[2]), 0.0f, 0.0f, 1.0f);
+    OverlayProjection projection;
+    SetupProjection(projection, width, height, face->cameraFocus, center, r[1] + V_PI, r[0], r[2]);
 
     static const float coordVertices[] = {
         0.0f,   0.0f,   0.0f,
@@ -1549,72 +1166,33 @@ void VisageRendering::DisplayModelAxes(FaceData* trackingData, int width, int he
 
     static const float coordColors[] = {
         1.0f, 0.0f, 0.0f, 0.25f,
-        1.0f, 0.0f, 0.0f, 0.25f,
-        0.0f, 0.0f, 1.0f, 0.25f,
         0.0f, 0.0f, 1.0f, 0.25f,
         0.0f, 1.0f, 0.0f, 0.25f,
-        0.0f, 1.0f, 0.0f, 0.25f,
     };
 
-    glLineWidth(2);
-
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, coordVertices);
-    glColorPointer(4, GL_FLOAT, 0, coordColors);
-    glDrawArrays(GL_LINES, 0, 6);
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
-
-    glDisable(GL_BLEND);
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetViewport(width, height);
 
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float x0, y0, x1, y1;
+        if (!Project(projection, &coordVertices[6 * axis], x0, y0) || !Project(projection, &coordVertices[6 * axis + 3], x1, y1))
+            continue;
 
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
+        const float *c = &coordColors[4 * axis];
+        batch.AddLine(x0, y0, x1, y1, 2.0f, OverlayRgbaf(c[0], c[1], c[2], c[3]));
+    }
 
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glPopAttrib();
-#endif
+    FlushUnlessBatching();
 }
 
 void VisageRendering::DisplayWireFrame(FaceData* trackingData, int width, int height, float alpha)
 {
-    //set image specs
-    glViewport(0, 0, width, height);
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-    SetupCamera(width, height, trackingData->cameraFocus);
-
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glShadeModel(GL_FLAT);
-
-    //transparency
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
-
-    //set the color for the wireframe
-    glColor4f(0.0f, 1.0f, 0.0f, alpha);
-    //vertex list
-    glVertexPointer(3, GL_FLOAT, 0, trackingData->faceModelVertices);
-
-    glLineWidth(1);
-
     const float *r = trackingData->faceRotation;
     const float *t = trackingData->faceTranslation;
 
-    glTranslatef(t[0], t[1], t[2]);
-    glRotatef(V_RAD2DEG(r[1] + V_PI), 0.0f, 1.0f, 0.0f);
-    glRotatef(V_RAD2DEG(r[0]), 1.0f, 0.0f, 0.0f);
-    glRotatef(V_RAD2DEG(r[2]), 0.0f, 0.0f, 1.0f);
+    OverlayProjection projection;
+    SetupProjection(projection, width, height, trackingData->cameraFocus, t, r[1] + V_PI, r[0], r[2]);
 
     //draw the wireframe
     //initialize indexes for drawing wireframe (once per model)
@@ -1650,123 +1228,153 @@ void VisageRendering::DisplayWireFrame(FaceData* trackingData, int width, int he
 
     numberOfVertices = trackingData->faceModelVertexCount;
 
-    glDrawElements(GL_LINES, (int)output.size(), GL_UNSIGNED_SHORT, &output[0]);
+    // every vertex is shared by several edges, so all are projected once up front, NaN marks those behind the camera
+    projectedVertices.resize(2 * numberOfVertices);
+    for (int i = 0; i < numberOfVertices; i++)
+    {
+        float *p = &projectedVertices[2 * i];
+        if (!Project(projection, &trackingData->faceModelVertices[3 * i], p[0], p[1]))
+            p[0] = NAN;
+    }
+
+    //set the color for the wireframe
+    const OverlayColor color = OverlayRgbaf(0.0f, 1.0f, 0.0f, alpha);
 
-    glDisable(GL_BLEND);
-    glDisableClientState(GL_VERTEX_ARRAY);
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetViewport(width, height);
 
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
+    for (size_t i = 0; i + 1 < output.size(); i += 2)
+    {
+        const float *p0 = &projectedVertices[2 * output[i]];
+        const float *p1 = &projectedVertices[2 * output[i + 1]];
+        if (!isnan(p0[0]) && !isnan(p1[0]))
+            batch.AddHairline(p0[0], p0[1], p1[0], p1[1], color);
+    }
 
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
+    FlushUnlessBatching();
 }
 
 void VisageRendering::CalcSpline(std::vector <float>& inputPoints, int ratio, std::vector <float>& outputPoints) {
 
-    int nPoints, nPointsToDraw, nLines;
+    int count = (int)inputPoints.size() / 2;
+    if (count < 2) {
+        outputPoints.clear();
+        return;
+    }
 
-    nPoints = (int)inputPoints.size() / 2 + 2;
-    nPointsToDraw = (int)inputPoints.size() / 2 + ((int)inputPoints.size() / 2 - 1) * ratio;
-    nLines = nPoints - 1 - 2;
+    outputPoints.resize(2 * SplinePointCount(count, ratio));
+    CalcSpline(&inputPoints[0], count, ratio, &outputPoints[0]);
+}
 
-    inputPoints.insert(inputPoints.begin(), inputPoints[1] + (inputPoints[1] - inputPoints[3]));
-    inputPoints.insert(inputPoints.begin(), inputPoints[1] + (inputPoints[1] - inputPoints[3]));
-    inputPoints.insert(inputPoints.end(), inputPoints[inputPoints.size() / 2 - 2] + (inputPoints[inputPoints.size() / 2 - 2] - inputPoints[inputPoints.size() / 2 - 4]));
-    inputPoints.insert(inputPoints.end(), inputPoints[inputPoints.size() / 2 - 1] + (inputPoints[inputPoints.size() / 2 - 1] - inputPoints[inputPoints.size() / 2 - 3]));
+void VisageRendering::CalcSpline(const float* inputPoints, int count, int ratio, float* outputPoints) {
 
     Vec2D p0(0, 0), p1(0, 0), p2(0, 0), p3(0, 0);
     CubicPoly px, py;
 
-    outputPoints.resize(2 * nPointsToDraw);
-
-    for (int i = 0; i < nPoints - 2; i++) {
-        outputPoints[i * 2 * (ratio + 1)] = inputPoints[2 * i + 2];
-        outputPoints[i * 2 * (ratio + 1) + 1] = inputPoints[2 * i + 1 + 2];
-    }
-
-    for (int i = 0; i < 2 * nLines; i = i + 2) {
-        p0.x = inputPoints[i];
-        p0.y = inputPoints[i + 1];
-        p1.x = inputPoints[i + 2];
-        p1.y = inputPoints[i + 3];
-        p2.x = inputPoints[i + 4];
-        p2.y = inputPoints[i + 5];
-        p3.x = inputPoints[i + 6];
-        p3.y = inputPoints[i + 7];
+    for (int i = 0; i < count - 1; i++) {
+        const float* p = inputPoints + 2 * i;
+
+        p1.x = p[0];
+        p1.y = p[1];
+        p2.x = p[2];
+        p2.y = p[3];
+
+        //the contour is extended by the first and the last point mirrored around their neighbours,
+        //so that the first and the last segment have four control points as well
+        if (i > 0) {
+            p0.x = p[-2];
+            p0.y = p[-1];
+        } else {
+            p0.x = p1.x + (p1.x - p2.x);
+            p0.y = p1.y + (p1.y - p2.y);
+        }
+        if (i < count - 2) {
+            p3.x = p[4];
+            p3.y = p[5];
+        } else {
+            p3.x = p2.x + (p2.x - p1.x);
+            p3.y = p2.y + (p2.y - p1.y);
+        }
 
         InitCentripetalCR(p0, p1, p2, p3, px, py);
 
+        float* out = outputPoints + 2 * i * (ratio + 1);
+        out[0] = p1.x;
+        out[1] = p1.y;
         for (int j = 1; j <= ratio; j++) {
-            outputPoints[i*(ratio + 1) + 2 * j] = (px.eval(1.00f / (ratio + 1)*(j)));
-            outputPoints[i*(ratio + 1) + 2 * j + 1] = (py.eval(1.00f / (ratio + 1)*(j)));
+            out[2 * j] = (px.eval(1.00f / (ratio + 1)*(j)));
+            out[2 * j + 1] = (py.eval(1.00f / (ratio + 1)*(j)));
         }
-
     }
 
-    inputPoints.erase(inputPoints.begin(), inputPoints.begin() + 2);
-    inputPoints.erase(inputPoints.end() - 2, inputPoints.end());
+    outputPoints[2 * (count - 1) * (ratio + 1)] = inputPoints[2 * count - 2];
+    outputPoints[2 * (count - 1) * (ratio + 1) + 1] = inputPoints[2 * count - 1];
 }
 
-void VisageRendering::DisplayTrackingQualityBar(FaceData* trackingData)
+void VisageRendering::DisplayTrackingQualityBar(const FaceSnapshot* face)
 {
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
+    OverlayBatch& batch = OverlayBatch::Shared();
 
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
+    batch.AddLine(0.1f, 0.9f, 0.25f, 0.9f, 10.0f, OverlayRgbaf(0.5f, 0.5f, 0.5f, 1.0f));
+    batch.AddLine(0.1f, 0.9f, 0.1f + face->trackingQuality * 0.15f, 0.9f, 10.0f,
+                  OverlayRgbaf(1 - face->trackingQuality, face->trackingQuality, 0, 1));
 
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glOrtho(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#else
-    glOrthof(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#endif
-
-    int points_to_draw = 2;
-    float vertices[6];
-    char tmpbuff[200];
-    glLineWidth(10);
-
-    vertices[0] = 0.1f;
-    vertices[1] = 0.9f;
-    vertices[2] = 0.0f;
-    vertices[3] = 0.25f;
-    vertices[4] = 0.9f;
-    vertices[5] = 0.0f;
-    glColor4f(0.5, 0.5, 0.5, 1);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, vertices);
-    glDrawArrays(GL_LINES, 0, points_to_draw);
-    glDisableClientState(GL_VERTEX_ARRAY);
-
-    vertices[0] = 0.1f;
-    vertices[1] = 0.9f;
-    vertices[2] = 0.0f;
-    vertices[3] = 0.1 + trackingData->trackingQuality * 0.15f;
-    vertices[4] = 0.9f;
-    vertices[5] = 0.0f;
-    glColor4f((1 - trackingData->trackingQuality), trackingData->trackingQuality, 0, 1);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, vertices);
-    glDrawArrays(GL_LINES, 0, points_to_draw);
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glLineWidth(1);
-
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
+    FlushUnlessBatching();
 }
 
 void VisageRendering::Reset()
 {
     video_texture_inited = false;
+    chroma_texture_inited = false;
     logo_tex_id = -1;
     img_tex_id = -1;
     font_tex_id = -1;
+    overlayCache.valid = false;
+    OverlayBatch::Shared().Reset();
+}
+
+void VisageRendering::BeginFrame()
+{
+    FrameArena::Shared().Reset();
+    frameBatching = true;
+}
+
+void VisageRendering::EndFrame()
+{
+    frameBatching = false;
+    DrawQueuedSplines();
+    OverlayBatch::Shared().Flush();
+}
+
+bool VisageRendering::DrawCachedResults(const unsigned int* generations, int count, int width, int height, const VsImage* frame, int drawingOptions)
+{
+    if (!overlayCache.valid || count != (int) overlayCache.generations.size() ||
+        width != overlayCache.width || height != overlayCache.height ||
+        frame->width != overlayCache.frameWidth || frame->height != overlayCache.frameHeight ||
+        drawingOptions != overlayCache.drawingOptions ||
+        !std::equal(generations, generations + count, overlayCache.generations.begin()))
+        return false;
+
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetViewport(width, height);
+    return batch.DrawRetained();
+}
+
+void VisageRendering::CacheResults(const unsigned int* generations, int count, int width, int height, const VsImage* frame, int drawingOptions)
+{
+    //the vector keeps its capacity, so caching the results of a new frame does not touch the heap
+    overlayCache.generations.assign(generations, generations + count);
+    overlayCache.width = width;
+    overlayCache.height = height;
+    overlayCache.frameWidth = frame->width;
+    overlayCache.frameHeight = frame->height;
+    overlayCache.drawingOptions = drawingOptions;
+    overlayCache.valid = true;
+
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetViewport(width, height);
+    DrawQueuedSplines();
+    batch.FlushRetained();
 }
 
 void VisageRendering::DisplayImage(VsImage *image, float effectValue, bool imageChanged)
@@ -1788,40 +1396,6 @@ void VisageRendering::DisplayImage(VsImage *image, float effectValue, bool image
 #endif
     }
 
-#if defined(WIN32) || defined(LINUX)
-    glPushAttrib(GL_DEPTH_BUFFER_BIT | GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_FOG_BIT | GL_STENCIL_BUFFER_BIT | GL_TRANSFORM_BIT | GL_TEXTURE_BIT);
-#endif
-
-    glDisable(GL_ALPHA_TEST);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_DITHER);
-    glDisable(GL_FOG);
-    glDisable(GL_SCISSOR_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_LIGHTING);
-    glDisable(GL_LIGHT0);
-
-    //transparency
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
-
-    //use texture
-    glEnable(GL_TEXTURE_2D);
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glOrtho(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#else
-    glOrthof(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#endif
-
     //image aspect
     float imageAspect = image->width / (float)image->height;
     //viewport aspect
@@ -1832,58 +1406,16 @@ void VisageRendering::DisplayImage(VsImage *image, float effectValue, bool image
     float x2 = 1.0f - x1;
     float y2 = 1.0f - y1;
 
-    GLfloat vertices[] = {
-        x1,y1,-5.0f,
-        x2,y1,-5.0f,
-        x1,y2,-5.0f,
-        x2,y2,-5.0f,
-    };
-
     //tex coords are flipped upside down instead of an image
-    GLfloat texcoords[] = {
-        0.0f,1.0f,
-        1.0f,1.0f,
-        0.0f,0.0f,
-        1.0f,0.0f,
-    };
-
-    glColor4f(1.0f, 1.0f, 1.0f, effectValue);
-
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glEnableClientState(GL_VERTEX_ARRAY);
-
-    glVertexPointer(3, GL_FLOAT, 0, vertices);
-    glTexCoordPointer(2, GL_FLOAT, 0, texcoords);
-
-    glViewport(0, 0, winWidth, winHeight);
-
-    //drawing vertices and texcoords
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    glDisableClientState(GL_VERTEX_ARRAY);
-
-    glDisable(GL_TEXTURE_2D);
-
-    glDisable(GL_BLEND);
-
-    glPopMatrix();
-
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
-
-    //disable texture
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-#if defined(WIN32) || defined(LINUX)
-    glPopAttrib();
-#endif
-
-    //glClear(GL_DEPTH_BUFFER_BIT);
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetViewport(winWidth, winHeight);
+    batch.DrawTexturedQuad(img_tex_id, x1, y1, x2, y2, 0.0f, 1.0f, 1.0f, 0.0f, effectValue, true);
 }
 
 void VisageRendering::SetFontTexture(const VsImage *font) {
     font_tex = font;
+    //cached text was drawn with the previous font
+    overlayCache.valid = false;
 }
 
 static void InitFontTexture(const VsImage *font_tex)
@@ -1926,9 +1458,13 @@ static void InitFontTexture(const VsImage *font_tex)
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex_width, tex_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, font_tex->imageData);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 }
 
-static void DrawString(const char* buffer, float xc, float yc, int width, int height, float scale = 1.0f, bool centerText = false)
+/** Adds a string to the text layer, a character covers font_width by font_height pixels of a width by height viewport.
+ */
+static void DrawString(const char* buffer, float xc, float yc, int width, int height, OverlayColor color, float scale = 1.0f, bool centerText = false)
 {
     if (font_tex == NULL)
         return;
@@ -1937,125 +1473,44 @@ static void DrawString(const char* buffer, float xc, float yc, int width, int he
         InitFontTexture(font_tex);
     }
 
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetTextTexture(font_tex_id);
+
     float f_w = font_width / (float)width * scale;
     float f_h = font_height / (float)height * scale;
 
     int len = strlen(buffer);
 
-    float *vertices = new float[6 * 3 * len];
-    float *tex_coords = new float[6 * 2 * len];
-
     float y = yc;
     float x = xc;
     if (centerText)
         x = xc - len*f_w / 2;
 
-    // generate quad array
     for (int i = 0; i < len; i++) {
-        int n = 0;
-        vertices[18 * i + n++] = x + i * f_w;
-        vertices[18 * i + n++] = y + 0.0f;
-        vertices[18 * i + n++] = 0.0f;
-
-        vertices[18 * i + n++] = x + (i + 1) * f_w;
-        vertices[18 * i + n++] = y + 0.0f;
-        vertices[18 * i + n++] = 0.0f;
-
-        vertices[18 * i + n++] = x + (i + 1) * f_w;
-        vertices[18 * i + n++] = y + f_h;
-        vertices[18 * i + n++] = 0.0f;
-
-        vertices[18 * i + n++] = x + i * f_w;
-        vertices[18 * i + n++] = y + f_h;
-        vertices[18 * i + n++] = 0.0f;
-
-        vertices[18 * i + n++] = x + i * f_w;
-        vertices[18 * i + n++] = y + 0.0f;
-        vertices[18 * i + n++] = 0.0f;
-
-        vertices[18 * i + n++] = x + (i + 1) * f_w;
-        vertices[18 * i + n++] = y + f_h;
-        vertices[18 * i + n++] = 0.0f;
+        batch.AddGlyph(x + i * f_w, y, x + (i + 1) * f_w, y + f_h, m_fontUV[(unsigned char)buffer[i]], color);
     }
-
-    // copy texture coordinate for each letter
-    for (int i = 0; i < len; i++) {
-        memcpy(&tex_coords[12 * i], m_fontUV[buffer[i]], 12 * sizeof(float));
-    }
-
-    //  glPushClientAttrib(GL_CLIENT_ALL_ATTRIB_BITS);
-
-    //glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    //glEnable(GL_BLEND);
-
-    glEnable(GL_TEXTURE_2D);
-
-    glBindTexture(GL_TEXTURE_2D, font_tex_id);
-
-    //  glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-    glVertexPointer(3, GL_FLOAT, 0, vertices);
-    glTexCoordPointer(2, GL_FLOAT, 0, tex_coords);
-    glDrawArrays(GL_TRIANGLES, 0, 6 * len);
-
-    //  glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
-    glDisable(GL_TEXTURE_2D);
-
-    //glDisable(GL_BLEND);
-
-    //  glPopClientAttrib();
-
-    delete[] vertices;
-    delete[] tex_coords;
 }
 
 void VisageRendering::DisplayText(const char* displayText, float effectValue, float scale)
 {
     float ev = effectValue * 255;
 
-    glColor4ub(255, 0, 0, ev);
-
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
-
-    glEnableClientState(GL_VERTEX_ARRAY);
-    DrawString(displayText, 0, -0.7f, winWidth, winHeight, scale, true);
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisable(GL_BLEND);
+    // the text used to be placed in clip coordinates, which span twice the overlay coordinates
+    OverlayBatch::Shared().SetViewport(winWidth, winHeight);
+    DrawString(displayText, 0.5f, 0.15f, 2 * winWidth, 2 * winHeight, OverlayRgba(255, 0, 0, (unsigned char)ev), scale, true);
 
+    FlushUnlessBatching();
 }
 
 void VisageRendering::DisplayActionUnits(FaceData* trackingData, int width, int height)
 {
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-#if defined(WIN32) || defined(LINUX) || defined(MAC_OS_X)
-    glOrtho(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#else
-    glOrthof(0.0f, 1.0f, 0.0f, 1.0f, -10.0f, 10.0f);
-#endif
-
     float auVis[] = {
-        0.5f, 0.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        1.0f, 0.1f, 0.0f,
-        0.5f, 0.1f, 0.0f
+        0.5f, 0.0f,
+        1.0f, 0.0f,
+        1.0f, 0.1f,
+        0.5f, 0.1f
     };
 
-    glColor4ub(0, 255, 0, 255);
-
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, auVis);
-
     char tmpbuff[200];
     /* default AUs
     0 au_nose_wrinkler
@@ -2091,40 +1546,32 @@ void VisageRendering::DisplayActionUnits(FaceData* trackingData, int width, int
 
     const float vis_scale = 16.0f / height;
 
-    glLineWidth(1);
+    OverlayBatch& batch = OverlayBatch::Shared();
+    batch.SetViewport(width, height);
 
     for (int i = 0; i<actionUnitCount; i++) {
-        glVertexPointer(3, GL_FLOAT, 0, auVis);
-        auVis[3] = auVis[6] = 0.5f + trackingData->actionUnits[au_order[i]] * 0.5f;
-        auVis[1] = auVis[4] = 1.0f - (2 * i + 2)*vis_scale;
-        auVis[7] = auVis[10] = 1.0f - (2 * i + 1)*vis_scale;
+        auVis[2] = auVis[4] = 0.5f + trackingData->actionUnits[au_order[i]] * 0.5f;
+        auVis[1] = auVis[3] = 1.0f - (2 * i + 2)*vis_scale;
+        auVis[5] = auVis[7] = 1.0f - (2 * i + 1)*vis_scale;
 
-        glColor4ub(0, 255, 0, 128);
-        //  glDrawArrays(GL_POLYGON, 0, 4);
+        batch.AddPolygon(auVis, 4, OverlayRgba(0, 255, 0, 128));
 
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-
-        glColor4ub(0, 0, 0, 128);
-        glDrawArrays(GL_LINE_LOOP, 0, 4);
+        for (int j = 0; j < 4; j++) {
+            const int next = (j + 1) % 4;
+            batch.AddHairline(auVis[2 * j], auVis[2 * j + 1], auVis[2 * next], auVis[2 * next + 1], OverlayRgba(0, 0, 0, 128));
+        }
 
         sprintf(tmpbuff, "%+6.2f %s", trackingData->actionUnits[au_order[i]], trackingData->actionUnitsNames[au_order[i]]);
 
-        glColor4ub(0, 0, 0, 255);
-        DrawString(tmpbuff, 0.5f, auVis[1] + 0.000f, width, height, 1.0f);
+        DrawString(tmpbuff, 0.5f, auVis[1] + 0.000f, width, height, OverlayRgba(0, 0, 0, 255), 1.0f);
 
         cnt++;
     }
 
-    glDisableClientState(GL_VERTEX_ARRAY);
-
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
+    FlushUnlessBatching();
 }
 
-void VisageRendering::DisplayResults(FaceData* trackingData, int trackStat, int width, int height, VsImage* frame, int drawingOptions)
+void VisageRendering::DisplayResults(const FaceSnapshot* face, FaceData* trackingData, int trackStat, int width, int height, VsImage* frame, int drawingOptions)
 {
     winWidth = width;
     winHeight = height;
@@ -2132,7 +1579,11 @@ void VisageRendering::DisplayResults(FaceData* trackingData, int trackStat, int
     frameWidth = frame->width;
     frameHeight = frame->height;
 
-    glViewport(0, 0, width, height);
+    OverlayBatch::Shared().SetViewport(width, height);
+
+    //everything drawn so far has been flushed, unless the overlays of several faces are collected
+    if (!frameBatching)
+        FrameArena::Shared().Reset();
 
     if (frame != NULL && (drawingOptions & DISPLAY_FRAME))
     {
@@ -2144,45 +1595,43 @@ void VisageRendering::DisplayResults(FaceData* trackingData, int trackStat, int
     {
         if (drawingOptions & DISPLAY_SPLINES)
         {
-            DisplaySplines(trackingData, width, height);
+            DisplaySplines(face, width, height);
         }
 
         if (drawingOptions & DISPLAY_FEATURE_POINTS)
         {
             bool drawQuality = drawingOptions & DISPLAY_POINT_QUALITY;
-            DisplayFeaturePoints(trackingData, width, height, frame, false, false, drawQuality); // draw 2D feature points
-                                                                                                 //DisplayFeaturePoints(trackingData, width, height, frame, true); // draw 3D feature points
-                                                                                                 //DisplayFeaturePoints(trackingData, width, height, frame, true, true); // draw relative 3D feature points
+            DisplayFeaturePoints(face, width, height, frame, drawQuality); // draw 2D feature points
         }
 
         if (drawingOptions & DISPLAY_GAZE)
         {
-            DisplayGaze(trackingData, width, height);
+            DisplayGaze(face, width, height);
         }
 
         if (drawingOptions & DISPLAY_IRIS)
         {
-            DisplayIrises(trackingData, width, height, frame);
+            DisplayIrises(face, width, height, frame);
         }
 
         if (drawingOptions & DISPLAY_AXES)
         {
-            DisplayModelAxes(trackingData, width, height);
+            DisplayModelAxes(face, width, height);
         }
 
-        if (drawingOptions & DISPLAY_WIRE_FRAME)
+        if ((drawingOptions & DISPLAY_WIRE_FRAME) && trackingData)
         {
             DisplayWireFrame(trackingData, width, height);
         }
 
-        if (drawingOptions & DISPLAY_ACTION_UNITS)
+        if ((drawingOptions & DISPLAY_ACTION_UNITS) && trackingData)
         {
             DisplayActionUnits(trackingData, width, height);
         }
 
         if (drawingOptions & DISPLAY_TRACKING_QUALITY)
         {
-            DisplayTrackingQualityBar(trackingData);
+            DisplayTrackingQualityBar(face);
         }
     }
 }
@@ -19,31 +19,17 @@
 #include <vector>
 #include <stdio.h>
 #include "FaceData.h"
-
-#ifdef WIN32
-#ifndef NOMINMAX
-#define NOMINMAX
-#endif /* !NOMINMAX */
-#include <windows.h>
-#include <GL/gl.h>
-#include <GL/glu.h>
-#endif
+#include "FaceSnapshot.h"
+#include "YuvConverter.h"
 
 #ifdef IOS
 #import <OpenGLES/EAGL.h>
-#import <OpenGLES/ES1/gl.h>
-#import <OpenGLES/ES1/glext.h>
+#import <OpenGLES/ES2/gl.h>
 #endif
 
 #ifdef ANDROID
 #include <EGL/egl.h> 
-#include <GLES/gl.h>
-#endif
-
-#ifdef MAC_OS_X
-#include <OpenGL/gl.h>
-#include <OpenGL/glu.h>
-#include <GLUT/glut.h>
+#include <GLES2/gl2.h>
 #endif
 
 #ifndef GL_BGR
@@ -69,34 +55,61 @@ namespace VisageSDK
 
 #define TRACK_STAT_OK 1
 
-#if defined (IOS) || defined(ANDROID)
-void gluLookAt(GLfloat eyex, GLfloat eyey, GLfloat eyez,
-				GLfloat centerx, GLfloat centery, GLfloat centerz,
-				GLfloat upx, GLfloat upy, GLfloat upz);
-#endif
-	
-/** VisageRendering displays the current frame and the following tracking results using OpenGL
+/** VisageRendering displays the current frame and the following tracking results using OpenGL ES 2.0
 * - facial feature points
 * - eye closure
 * - gaze direction
 * - model axes
 * Adjacent facial feature points are connected with splines that are calculated using implementation of a Catmull-Rom method
+*
+* Overlays are drawn through @ref OverlayBatch. Between @ref BeginFrame and @ref EndFrame the overlays of all faces are
+* collected and drawn with one draw call per layer, otherwise every method draws its own overlays right away.
+* Temporary geometry is taken from a @ref FrameArena that is reset by @ref BeginFrame, or by @ref DisplayResults
+* outside of it. Splines of all contours are evaluated together by a @ref SplineBatch just before the overlays are drawn. Overlays of results that are displayed more than once can be cached with @ref CacheResults, frames
+* drawn before the next results arrive then only redraw them with @ref DrawCachedResults.
 */
 class VisageRendering
 {
 public:
 	/** Method calls other methods for drawing the frame and tracking results
-	* @param trackingData - tracking results
+	* @param face - snapshot of the tracking results
+	* @param trackingData - full tracking results, only needed for DISPLAY_WIRE_FRAME and DISPLAY_ACTION_UNITS, may be NULL
 	* @param trackStat - tracker status
 	* @param width - width of the OpenGL window, adjusted so that the aspect of the drawing frame is perserved
 	* @param height - height of the OpenGL window, adjusted so that the aspect of the drawing frame is perserved
 	* @param frame - image for drawing
 	* @param drawingOptions - enables user to choose what tracking results to display; by default all the tracking results are displayed
 	*/
-	static void DisplayResults(FaceData* trackingData, int trackStat, int width, int height, VsImage* frame, int drawingOptions = DISPLAY_DEFAULT);
+	static void DisplayResults(const FaceSnapshot* face, FaceData* trackingData, int trackStat, int width, int height, VsImage* frame, int drawingOptions = DISPLAY_DEFAULT);
 
 	static void Reset();
 
+	/** Starts collecting the overlays of the following calls, until @ref EndFrame draws them all at once.
+	* The frame, logo and images are still drawn right away, below the overlays.
+	*/
+	static void BeginFrame();
+
+	/** Draws the overlays collected since @ref BeginFrame.
+	*/
+	static void EndFrame();
+
+	/** Draws the overlays kept by @ref CacheResults again, if they were built from the same results with the same settings.
+	* Call it after @ref BeginFrame, before anything else is collected.
+	* @param generations - FaceSnapshot::generation of the faces, in the order they are drawn
+	* @param count - number of faces
+	* @param width - adjusted width of the OpenGL window
+	* @param height - adjusted height of the OpenGL window
+	* @param frame - image the results belong to
+	* @param drawingOptions - options the overlays are drawn with
+	* @return false if nothing matching is cached, the overlays then have to be drawn and cached again
+	*/
+	static bool DrawCachedResults(const unsigned int* generations, int count, int width, int height, const VsImage* frame, int drawingOptions);
+
+	/** Draws the overlays collected since @ref BeginFrame and keeps them on the GPU for @ref DrawCachedResults, with the
+	* same arguments as the key. Overlays collected afterwards are drawn by @ref EndFrame and are not cached.
+	*/
+	static void CacheResults(const unsigned int* generations, int count, int width, int height, const VsImage* frame, int drawingOptions);
+
 	/** Method draws the current frame
 	* @param image - image for drawing
 	* @param width - adjusted width of the OpenGL window 
@@ -104,45 +117,52 @@ public:
 	*/
 	static void DisplayFrame (const VsImage *image, int width, int height);
 
-	/** Method draws facial feature points
-	* @param trackingData - tracking results
+	/** Method clears the window and draws the current frame given as NV12 planes, converted to RGB on the GPU
+	* @param luma - 1 channel image of the Y plane
+	* @param chroma - 2 channel image of the interleaved U and V plane, half the size of luma
+	* @param matrix - color matrix of the frame
+	* @param width - adjusted width of the OpenGL window
+	* @param height - adjusted height of the OpenGL window
+	*/
+	static void DisplayFrameNV12(const VsImage *luma, const VsImage *chroma, YuvColorMatrix matrix, int width, int height);
+
+	/** Method draws 2D facial feature points
+	* @param face - snapshot of the tracking results
 	* @param width - adjusted width of the OpenGL window 
 	* @param height - adjusted height of the OpenGL window
 	* @param frame - image for drawing
-	* @param _3D - use 3D feature points
-	* @param relative - use relative 3D feature points
 	* @param drawQuality - indicates whether tracking quality of feature points will be displayed
 	*/
-	static void DisplayFeaturePoints(FaceData* trackingData, int width, int height, VsImage* frame, bool _3D = false, bool relative = false, bool drawQuality = true);
+	static void DisplayFeaturePoints(const FaceSnapshot* face, int width, int height, VsImage* frame, bool drawQuality = true);
 
 	/** Method draws splines
-	* @param trackingData - tracking results
+	* @param face - snapshot of the tracking results
 	* @param width - adjusted width of the OpenGL window 
 	* @param height - adjusted height of the OpenGL window
 	*/
-	static void DisplaySplines(FaceData* trackingData, int width, int height);
+	static void DisplaySplines(const FaceSnapshot* face, int width, int height);
 
 	/** Method draws the gaze direction
-	* @param trackingData - tracking results
+	* @param face - snapshot of the tracking results
 	* @param width - adjusted width of the OpenGL window 
 	* @param height - adjusted height of the OpenGL window
 	*/
-	static void DisplayGaze(FaceData* trackingData, int width, int height); 
+	static void DisplayGaze(const FaceSnapshot* face, int width, int height); 
 
 	/** Method draws the circle around irises
-	* @param trackingData - tracking results
+	* @param face - snapshot of the tracking results
 	* @param width - adjusted width of the OpenGL window
 	* @param height - adjusted height of the OpenGL window
 	* @param frame - image for drawing
 	*/
-	static void DisplayIrises(FaceData* trackingData, int width, int height, VsImage* frame);
+	static void DisplayIrises(const FaceSnapshot* face, int width, int height, VsImage* frame);
 
 	/** Method draws model axes
-	* @param trackingData - tracking results
+	* @param face - snapshot of the tracking results
 	* @param width - adjusted width of the OpenGL window 
 	* @param height - adjusted height of the OpenGL window
 	*/
-	static void DisplayModelAxes(FaceData* trackingData, int width, int height);
+	static void DisplayModelAxes(const FaceSnapshot* face, int width, int height);
 
 	/** Method draws face model
 	* @param trackingData - tracking results
@@ -166,10 +186,22 @@ public:
 	*/
 	static void CalcSpline(std::vector <float>& inputPoints, int ratio, std::vector<float>& outputPoints);
 
+	/** Method calculates spline points into an array of @ref SplinePointCount points, without allocating memory.
+	* @param inputPoints - count points as x, y pairs which need to be connected with a spline
+	* @param count - number of input points, at least 2
+	* @param ratio - number of spline points that need to be calculated between neighbouring input points
+	* @param outputPoints - calculated spline points as x, y pairs
+	*/
+	static void CalcSpline(const float* inputPoints, int count, int ratio, float* outputPoints);
+
+	/** Method returns the number of spline points calculated by @ref CalcSpline for count input points.
+	*/
+	static int SplinePointCount(int count, int ratio) { return count + (count - 1) * ratio; }
+
 	/** Method draws a bar in the lower left corner indicating tracking quality value.
-	* @param trackingData - tracking results
+	* @param face - snapshot of the tracking results
 	*/
-	static void DisplayTrackingQualityBar(FaceData* trackingData);
+	static void DisplayTrackingQualityBar(const FaceSnapshot* face);
     
     /** Method draws a logo in the upper right corner.
     * @param logo - existing logo image
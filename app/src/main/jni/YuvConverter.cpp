@@ -0,0 +1,794 @@
+#include "YuvConverter.h"
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define YUV_CONVERTER_NEON 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define YUV_CONVERTER_SSSE3 1
+#endif
+
+namespace VisageSDK
+{
+
+// Fixed-point coefficients with 6 fractional bits: { yOffset, yMul, vr, ug, vg, ub }
+static const short colorMatrices[4][6] = {
+	{  0, 64,  90, 22, 46, 113 },	// BT.601 full range (JFIF)
+	{ 16, 75, 102, 25, 52, 129 },	// BT.601 limited range
+	{  0, 64, 101, 12, 30, 119 },	// BT.709 full range
+	{ 16, 75, 115, 14, 34, 135 },	// BT.709 limited range
+};
+
+static const int FIXED_SHIFT = 6;
+static const int FIXED_ROUND = 1 << (FIXED_SHIFT - 1);
+
+static inline int saturate16(int x)
+{
+	return x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+}
+
+static inline unsigned char clampToByte(int x)
+{
+	x >>= FIXED_SHIFT;
+	return (unsigned char) (x > 255 ? 255 : (x < 0 ? 0 : x));
+}
+
+YuvConverter::YuvConverter(YuvColorMatrix matrix)
+{
+	SetColorMatrix(matrix);
+}
+
+void YuvConverter::SetColorMatrix(YuvColorMatrix matrix)
+{
+	if (matrix < YUV_MATRIX_BT601_FULL || matrix > YUV_MATRIX_BT709_LIMITED)
+		matrix = YUV_MATRIX_BT601_FULL;
+
+	this->matrix = matrix;
+	yOffset = colorMatrices[matrix][0];
+	yMul = colorMatrices[matrix][1];
+	vr = colorMatrices[matrix][2];
+	ug = colorMatrices[matrix][3];
+	vg = colorMatrices[matrix][4];
+	ub = colorMatrices[matrix][5];
+}
+
+void YuvConverter::GetCoefficients(YuvColorMatrix matrix, float coefficients[6])
+{
+	if (matrix < YUV_MATRIX_BT601_FULL || matrix > YUV_MATRIX_BT709_LIMITED)
+		matrix = YUV_MATRIX_BT601_FULL;
+
+	coefficients[0] = colorMatrices[matrix][0] / 255.0f;
+	for (int i = 1; i < 6; i++)
+		coefficients[i] = colorMatrices[matrix][i] / (float) (1 << FIXED_SHIFT);
+}
+
+const char* YuvConverter::BackendName()
+{
+#if defined(YUV_CONVERTER_NEON)
+	return "neon";
+#elif defined(YUV_CONVERTER_SSSE3)
+	return "ssse3";
+#else
+	return "scalar";
+#endif
+}
+
+/**
+ * Reference implementation. Mirrors the vector code exactly, including 16-bit saturation of
+ * intermediate sums, so that row tails and the vector body are bit-identical.
+ */
+void YuvConverter::ConvertRowScalar(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+									int uvPixelStride, unsigned char* rgb, int x, int width) const
+{
+	for (; x < width; x += 2)
+	{
+		const int k = (x >> 1) * uvPixelStride;
+		const int cu = u[k] - 128;
+		const int cv = v[k] - 128;
+
+		const int rc = vr * cv;
+		const int gc = ug * cu + vg * cv;
+		const int bc = ub * cu;
+
+		for (int i = 0; i < 2; i++)
+		{
+			const int yc = (y[x + i] - yOffset) * yMul + FIXED_ROUND;
+			unsigned char* p = rgb + 3 * (x + i);
+			p[0] = clampToByte(saturate16(yc + rc));
+			p[1] = clampToByte(saturate16(yc - gc));
+			p[2] = clampToByte(saturate16(yc + bc));
+		}
+	}
+}
+
+void YuvConverter::ConvertRow(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+							  int uvPixelStride, unsigned char* rgb, int width) const
+{
+	int x = 0;
+
+#if defined(YUV_CONVERTER_NEON) || defined(YUV_CONVERTER_SSSE3)
+	// With interleaved chroma a 16 pixel block reads 16 bytes from both u and v; v is the second
+	// byte of each pair, so the final block would read one byte past the end of the plane.
+	const int vectorEnd = (uvPixelStride == 2) ? width - 1 : width;
+#endif
+
+#if defined(YUV_CONVERTER_NEON)
+	const int16x8_t vOffset = vdupq_n_s16(yOffset);
+	const int16x8_t vRound = vdupq_n_s16(FIXED_ROUND);
+	const int16x8_t vBias = vdupq_n_s16(128);
+
+	for (; x + 16 <= vectorEnd; x += 16)
+	{
+		const uint8x16_t y8 = vld1q_u8(y + x);
+		uint8x8_t u8, v8;
+		if (uvPixelStride == 2)
+		{
+			u8 = vld2_u8(u + x).val[0];
+			v8 = vld2_u8(v + x).val[0];
+		}
+		else
+		{
+			u8 = vld1_u8(u + (x >> 1));
+			v8 = vld1_u8(v + (x >> 1));
+		}
+
+		const int16x8_t cu = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), vBias);
+		const int16x8_t cv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), vBias);
+
+		const int16x8_t rc = vmulq_n_s16(cv, vr);
+		const int16x8_t gc = vaddq_s16(vmulq_n_s16(cu, ug), vmulq_n_s16(cv, vg));
+		const int16x8_t bc = vmulq_n_s16(cu, ub);
+
+		// every chroma sample covers two horizontally neighbouring pixels
+		const int16x8x2_t rcz = vzipq_s16(rc, rc);
+		const int16x8x2_t gcz = vzipq_s16(gc, gc);
+		const int16x8x2_t bcz = vzipq_s16(bc, bc);
+
+		const int16x8_t ylo = vaddq_s16(vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y8))), vOffset), yMul), vRound);
+		const int16x8_t yhi = vaddq_s16(vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(y8))), vOffset), yMul), vRound);
+
+		uint8x16x3_t out;
+		out.val[0] = vcombine_u8(vqshrun_n_s16(vqaddq_s16(ylo, rcz.val[0]), FIXED_SHIFT),
+								 vqshrun_n_s16(vqaddq_s16(yhi, rcz.val[1]), FIXED_SHIFT));
+		out.val[1] = vcombine_u8(vqshrun_n_s16(vqsubq_s16(ylo, gcz.val[0]), FIXED_SHIFT),
+								 vqshrun_n_s16(vqsubq_s16(yhi, gcz.val[1]), FIXED_SHIFT));
+		out.val[2] = vcombine_u8(vqshrun_n_s16(vqaddq_s16(ylo, bcz.val[0]), FIXED_SHIFT),
+								 vqshrun_n_s16(vqaddq_s16(yhi, bcz.val[1]), FIXED_SHIFT));
+		vst3q_u8(rgb + 3 * x, out);
+	}
+#elif defined(YUV_CONVERTER_SSSE3)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i vOffset = _mm_set1_epi16(yOffset);
+	const __m128i vMul = _mm_set1_epi16(yMul);
+	const __m128i vRound = _mm_set1_epi16(FIXED_ROUND);
+	const __m128i vBias = _mm_set1_epi16(128);
+	const __m128i cVr = _mm_set1_epi16(vr);
+	const __m128i cUg = _mm_set1_epi16(ug);
+	const __m128i cVg = _mm_set1_epi16(vg);
+	const __m128i cUb = _mm_set1_epi16(ub);
+	const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+
+	// shuffles interleaving planar R, G and B registers into three 16 byte blocks of RGB24
+	const __m128i r0 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+	const __m128i r1 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+	const __m128i r2 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+	const __m128i g0 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+	const __m128i g1 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+	const __m128i g2 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+	const __m128i b0 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+	const __m128i b1 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+	const __m128i b2 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+
+	for (; x + 16 <= vectorEnd; x += 16)
+	{
+		const __m128i y8 = _mm_loadu_si128((const __m128i*) (y + x));
+		__m128i cu, cv;
+		if (uvPixelStride == 2)
+		{
+			cu = _mm_and_si128(_mm_loadu_si128((const __m128i*) (u + x)), lowBytes);
+			cv = _mm_and_si128(_mm_loadu_si128((const __m128i*) (v + x)), lowBytes);
+		}
+		else
+		{
+			cu = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (u + (x >> 1))), zero);
+			cv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (v + (x >> 1))), zero);
+		}
+		cu = _mm_sub_epi16(cu, vBias);
+		cv = _mm_sub_epi16(cv, vBias);
+
+		const __m128i rc = _mm_mullo_epi16(cv, cVr);
+		const __m128i gc = _mm_add_epi16(_mm_mullo_epi16(cu, cUg), _mm_mullo_epi16(cv, cVg));
+		const __m128i bc = _mm_mullo_epi16(cu, cUb);
+
+		const __m128i ylo = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(y8, zero), vOffset), vMul), vRound);
+		const __m128i yhi = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(y8, zero), vOffset), vMul), vRound);
+
+		const __m128i r = _mm_packus_epi16(
+				_mm_srai_epi16(_mm_adds_epi16(ylo, _mm_unpacklo_epi16(rc, rc)), FIXED_SHIFT),
+				_mm_srai_epi16(_mm_adds_epi16(yhi, _mm_unpackhi_epi16(rc, rc)), FIXED_SHIFT));
+		const __m128i g = _mm_packus_epi16(
+				_mm_srai_epi16(_mm_subs_epi16(ylo, _mm_unpacklo_epi16(gc, gc)), FIXED_SHIFT),
+				_mm_srai_epi16(_mm_subs_epi16(yhi, _mm_unpackhi_epi16(gc, gc)), FIXED_SHIFT));
+		const __m128i b = _mm_packus_epi16(
+				_mm_srai_epi16(_mm_adds_epi16(ylo, _mm_unpacklo_epi16(bc, bc)), FIXED_SHIFT),
+				_mm_srai_epi16(_mm_adds_epi16(yhi, _mm_unpackhi_epi16(bc, bc)), FIXED_SHIFT));
+
+		__m128i* out = (__m128i*) (rgb + 3 * x);
+		_mm_storeu_si128(out + 0, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r0), _mm_shuffle_epi8(g, g0)), _mm_shuffle_epi8(b, b0)));
+		_mm_storeu_si128(out + 1, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r1), _mm_shuffle_epi8(g, g1)), _mm_shuffle_epi8(b, b1)));
+		_mm_storeu_si128(out + 2, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r2), _mm_shuffle_epi8(g, g2)), _mm_shuffle_epi8(b, b2)));
+	}
+#endif
+
+	ConvertRowScalar(y, u, v, uvPixelStride, rgb, x, width);
+}
+
+void YuvConverter::Convert(const YuvFrame& frame, VsImage* dst) const
+{
+	for (int row = 0; row < frame.height; row++)
+	{
+		const int uvOffset = (row >> 1) * frame.uvRowStride;
+		ConvertRow(frame.y + row * frame.yRowStride, frame.u + uvOffset, frame.v + uvOffset,
+				   frame.uvPixelStride, (unsigned char*) dst->imageData + row * dst->widthStep, frame.width);
+	}
+}
+
+void YuvConverter::OrientedSize(int width, int height, int orientation, int& outWidth, int& outHeight)
+{
+	if (orientation == 90 || orientation == 270)
+	{
+		outWidth = height;
+		outHeight = width;
+	}
+	else
+	{
+		outWidth = width;
+		outHeight = height;
+	}
+}
+
+static inline void ReversePixels(unsigned char* row, int width)
+{
+	unsigned char* a = row;
+	unsigned char* b = row + 3 * (width - 1);
+	for (; a < b; a += 3, b -= 3)
+	{
+		unsigned char t0 = a[0], t1 = a[1], t2 = a[2];
+		a[0] = b[0]; a[1] = b[1]; a[2] = b[2];
+		b[0] = t0; b[1] = t1; b[2] = t2;
+	}
+}
+
+/**
+ * Equivalent of the former vsTranspose/vsFlip sequence expressed as: optional transpose, followed by
+ * mirroring of destination columns (mirrorX) and/or destination rows (mirrorY).
+ */
+static void DecodeOrientation(int orientation, int flip, bool& transpose, bool& mirrorX, bool& mirrorY)
+{
+	switch (orientation)
+	{
+	case 90:
+		transpose = true;  mirrorX = !flip; mirrorY = false;
+		break;
+	case 180:
+		transpose = false; mirrorX = !flip; mirrorY = true;
+		break;
+	case 270:
+		transpose = true;  mirrorX = flip != 0; mirrorY = true;
+		break;
+	case 0: case 360: default:
+		transpose = false; mirrorX = flip != 0; mirrorY = false;
+		break;
+	}
+}
+
+void YuvConverter::Convert(const YuvFrame& frame, VsImage* dst, int orientation, int flip)
+{
+	bool transpose, mirrorX, mirrorY;
+	DecodeOrientation(orientation, flip, transpose, mirrorX, mirrorY);
+
+	if (transpose)
+	{
+		ConvertTransposed(frame, dst, mirrorX, mirrorY);
+		return;
+	}
+
+	for (int row = 0; row < frame.height; row++)
+	{
+		const int uvOffset = (row >> 1) * frame.uvRowStride;
+		const int dstRow = mirrorY ? frame.height - 1 - row : row;
+		unsigned char* out = (unsigned char*) dst->imageData + dstRow * dst->widthStep;
+
+		ConvertRow(frame.y + row * frame.yRowStride, frame.u + uvOffset, frame.v + uvOffset,
+				   frame.uvPixelStride, out, frame.width);
+		if (mirrorX)
+			ReversePixels(out, frame.width);
+	}
+}
+
+#if defined(YUV_CONVERTER_NEON) || defined(YUV_CONVERTER_SSSE3)
+/**
+ * Transposes a block of 8x8 pixels of BPP bytes: byte (or byte pair) x of in[r] + offset is written to
+ * out + x * outStep + BPP * r. A negative outStep writes the destination rows bottom up.
+ */
+template <int BPP>
+static inline void Transpose8x8(const unsigned char* const* in, int offset, unsigned char* out, int outStep);
+
+#if defined(YUV_CONVERTER_NEON)
+template <>
+inline void Transpose8x8<1>(const unsigned char* const* in, int offset, unsigned char* out, int outStep)
+{
+	const uint8x8x2_t t01 = vtrn_u8(vld1_u8(in[0] + offset), vld1_u8(in[1] + offset));
+	const uint8x8x2_t t23 = vtrn_u8(vld1_u8(in[2] + offset), vld1_u8(in[3] + offset));
+	const uint8x8x2_t t45 = vtrn_u8(vld1_u8(in[4] + offset), vld1_u8(in[5] + offset));
+	const uint8x8x2_t t67 = vtrn_u8(vld1_u8(in[6] + offset), vld1_u8(in[7] + offset));
+
+	const uint16x4x2_t u02 = vtrn_u16(vreinterpret_u16_u8(t01.val[0]), vreinterpret_u16_u8(t23.val[0]));
+	const uint16x4x2_t u13 = vtrn_u16(vreinterpret_u16_u8(t01.val[1]), vreinterpret_u16_u8(t23.val[1]));
+	const uint16x4x2_t u46 = vtrn_u16(vreinterpret_u16_u8(t45.val[0]), vreinterpret_u16_u8(t67.val[0]));
+	const uint16x4x2_t u57 = vtrn_u16(vreinterpret_u16_u8(t45.val[1]), vreinterpret_u16_u8(t67.val[1]));
+
+	const uint32x2x2_t c04 = vtrn_u32(vreinterpret_u32_u16(u02.val[0]), vreinterpret_u32_u16(u46.val[0]));
+	const uint32x2x2_t c15 = vtrn_u32(vreinterpret_u32_u16(u13.val[0]), vreinterpret_u32_u16(u57.val[0]));
+	const uint32x2x2_t c26 = vtrn_u32(vreinterpret_u32_u16(u02.val[1]), vreinterpret_u32_u16(u46.val[1]));
+	const uint32x2x2_t c37 = vtrn_u32(vreinterpret_u32_u16(u13.val[1]), vreinterpret_u32_u16(u57.val[1]));
+
+	vst1_u8(out + 0 * outStep, vreinterpret_u8_u32(c04.val[0]));
+	vst1_u8(out + 1 * outStep, vreinterpret_u8_u32(c15.val[0]));
+	vst1_u8(out + 2 * outStep, vreinterpret_u8_u32(c26.val[0]));
+	vst1_u8(out + 3 * outStep, vreinterpret_u8_u32(c37.val[0]));
+	vst1_u8(out + 4 * outStep, vreinterpret_u8_u32(c04.val[1]));
+	vst1_u8(out + 5 * outStep, vreinterpret_u8_u32(c15.val[1]));
+	vst1_u8(out + 6 * outStep, vreinterpret_u8_u32(c26.val[1]));
+	vst1_u8(out + 7 * outStep, vreinterpret_u8_u32(c37.val[1]));
+}
+
+template <>
+inline void Transpose8x8<2>(const unsigned char* const* in, int offset, unsigned char* out, int outStep)
+{
+	const uint16x8x2_t t01 = vtrnq_u16(vreinterpretq_u16_u8(vld1q_u8(in[0] + offset)), vreinterpretq_u16_u8(vld1q_u8(in[1] + offset)));
+	const uint16x8x2_t t23 = vtrnq_u16(vreinterpretq_u16_u8(vld1q_u8(in[2] + offset)), vreinterpretq_u16_u8(vld1q_u8(in[3] + offset)));
+	const uint16x8x2_t t45 = vtrnq_u16(vreinterpretq_u16_u8(vld1q_u8(in[4] + offset)), vreinterpretq_u16_u8(vld1q_u8(in[5] + offset)));
+	const uint16x8x2_t t67 = vtrnq_u16(vreinterpretq_u16_u8(vld1q_u8(in[6] + offset)), vreinterpretq_u16_u8(vld1q_u8(in[7] + offset)));
+
+	// each register holds two destination rows, rows 0 to 3 in the low and rows 4 to 7 in the high half
+	const uint32x4x2_t u02 = vtrnq_u32(vreinterpretq_u32_u16(t01.val[0]), vreinterpretq_u32_u16(t23.val[0]));
+	const uint32x4x2_t u13 = vtrnq_u32(vreinterpretq_u32_u16(t01.val[1]), vreinterpretq_u32_u16(t23.val[1]));
+	const uint32x4x2_t u46 = vtrnq_u32(vreinterpretq_u32_u16(t45.val[0]), vreinterpretq_u32_u16(t67.val[0]));
+	const uint32x4x2_t u57 = vtrnq_u32(vreinterpretq_u32_u16(t45.val[1]), vreinterpretq_u32_u16(t67.val[1]));
+
+	vst1q_u8(out + 0 * outStep, vreinterpretq_u8_u32(vcombine_u32(vget_low_u32(u02.val[0]), vget_low_u32(u46.val[0]))));
+	vst1q_u8(out + 1 * outStep, vreinterpretq_u8_u32(vcombine_u32(vget_low_u32(u13.val[0]), vget_low_u32(u57.val[0]))));
+	vst1q_u8(out + 2 * outStep, vreinterpretq_u8_u32(vcombine_u32(vget_low_u32(u02.val[1]), vget_low_u32(u46.val[1]))));
+	vst1q_u8(out + 3 * outStep, vreinterpretq_u8_u32(vcombine_u32(vget_low_u32(u13.val[1]), vget_low_u32(u57.val[1]))));
+	vst1q_u8(out + 4 * outStep, vreinterpretq_u8_u32(vcombine_u32(vget_high_u32(u02.val[0]), vget_high_u32(u46.val[0]))));
+	vst1q_u8(out + 5 * outStep, vreinterpretq_u8_u32(vcombine_u32(vget_high_u32(u13.val[0]), vget_high_u32(u57.val[0]))));
+	vst1q_u8(out + 6 * outStep, vreinterpretq_u8_u32(vcombine_u32(vget_high_u32(u02.val[1]), vget_high_u32(u46.val[1]))));
+	vst1q_u8(out + 7 * outStep, vreinterpretq_u8_u32(vcombine_u32(vget_high_u32(u13.val[1]), vget_high_u32(u57.val[1]))));
+}
+#else
+template <>
+inline void Transpose8x8<1>(const unsigned char* const* in, int offset, unsigned char* out, int outStep)
+{
+	const __m128i a0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (in[0] + offset)), _mm_loadl_epi64((const __m128i*) (in[1] + offset)));
+	const __m128i a1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (in[2] + offset)), _mm_loadl_epi64((const __m128i*) (in[3] + offset)));
+	const __m128i a2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (in[4] + offset)), _mm_loadl_epi64((const __m128i*) (in[5] + offset)));
+	const __m128i a3 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (in[6] + offset)), _mm_loadl_epi64((const __m128i*) (in[7] + offset)));
+
+	const __m128i b0 = _mm_unpacklo_epi16(a0, a1);
+	const __m128i b1 = _mm_unpackhi_epi16(a0, a1);
+	const __m128i b2 = _mm_unpacklo_epi16(a2, a3);
+	const __m128i b3 = _mm_unpackhi_epi16(a2, a3);
+
+	// each register holds two destination rows
+	const __m128i c01 = _mm_unpacklo_epi32(b0, b2);
+	const __m128i c23 = _mm_unpackhi_epi32(b0, b2);
+	const __m128i c45 = _mm_unpacklo_epi32(b1, b3);
+	const __m128i c67 = _mm_unpackhi_epi32(b1, b3);
+
+	_mm_storel_epi64((__m128i*) (out + 0 * outStep), c01);
+	_mm_storel_epi64((__m128i*) (out + 1 * outStep), _mm_unpackhi_epi64(c01, c01));
+	_mm_storel_epi64((__m128i*) (out + 2 * outStep), c23);
+	_mm_storel_epi64((__m128i*) (out + 3 * outStep), _mm_unpackhi_epi64(c23, c23));
+	_mm_storel_epi64((__m128i*) (out + 4 * outStep), c45);
+	_mm_storel_epi64((__m128i*) (out + 5 * outStep), _mm_unpackhi_epi64(c45, c45));
+	_mm_storel_epi64((__m128i*) (out + 6 * outStep), c67);
+	_mm_storel_epi64((__m128i*) (out + 7 * outStep), _mm_unpackhi_epi64(c67, c67));
+}
+
+template <>
+inline void Transpose8x8<2>(const unsigned char* const* in, int offset, unsigned char* out, int outStep)
+{
+	__m128i r[8];
+	for (int i = 0; i < 8; i++)
+		r[i] = _mm_loadu_si128((const __m128i*) (in[i] + offset));
+
+	__m128i a[8];
+	for (int i = 0; i < 4; i++)
+	{
+		a[i] = _mm_unpacklo_epi16(r[2 * i], r[2 * i + 1]);
+		a[i + 4] = _mm_unpackhi_epi16(r[2 * i], r[2 * i + 1]);
+	}
+
+	// b[0..3] hold destination rows 0-1, 2-3, 4-5 and 6-7 of source rows 0 to 3, b[4..7] the same of rows 4 to 7
+	__m128i b[8];
+	for (int i = 0; i < 2; i++)
+	{
+		b[2 * i] = _mm_unpacklo_epi32(a[4 * i], a[4 * i + 1]);
+		b[2 * i + 1] = _mm_unpackhi_epi32(a[4 * i], a[4 * i + 1]);
+		b[2 * i + 4] = _mm_unpacklo_epi32(a[4 * i + 2], a[4 * i + 3]);
+		b[2 * i + 5] = _mm_unpackhi_epi32(a[4 * i + 2], a[4 * i + 3]);
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		_mm_storeu_si128((__m128i*) (out + (2 * i) * outStep), _mm_unpacklo_epi64(b[i], b[i + 4]));
+		_mm_storeu_si128((__m128i*) (out + (2 * i + 1) * outStep), _mm_unpackhi_epi64(b[i], b[i + 4]));
+	}
+}
+#endif
+#endif
+
+/**
+ * Copies a plane of 1 (luma) or 2 (interleaved chroma) byte pixels into its oriented position.
+ * Source pixel x of a row is read from src[x * srcPixelStride] (plus src2[...] for the second byte),
+ * which lets planar, NV12 and NV21 chroma all be written out as interleaved U/V.
+ */
+template <int BPP>
+static void OrientPlane(const unsigned char* src, const unsigned char* src2, int srcPixelStride, int srcRowStride,
+						int width, int height, unsigned char* dst, int dstRowStride,
+						bool transpose, bool mirrorX, bool mirrorY)
+{
+	static const int BLOCK = 16;
+
+	if (!transpose)
+	{
+		for (int row = 0; row < height; row++)
+		{
+			const unsigned char* in = src + row * srcRowStride;
+			const unsigned char* in2 = src2 + row * srcRowStride;
+			unsigned char* out = dst + (mirrorY ? height - 1 - row : row) * dstRowStride;
+
+			if (BPP == 1 && srcPixelStride == 1 && !mirrorX)
+			{
+				memcpy(out, in, width);
+				continue;
+			}
+			for (int col = 0; col < width; col++)
+			{
+				unsigned char* o = out + BPP * (mirrorX ? width - 1 - col : col);
+				o[0] = in[col * srcPixelStride];
+				if (BPP == 2)
+					o[1] = in2[col * srcPixelStride];
+			}
+		}
+		return;
+	}
+
+	// Transposed: source rows become destination columns. Work in square blocks so that both the
+	// strided source reads and the destination writes stay within a few cache lines.
+	const unsigned char* in[BLOCK];
+	const unsigned char* in2[BLOCK];
+#if defined(YUV_CONVERTER_NEON) || defined(YUV_CONVERTER_SSSE3)
+	const int outStep = mirrorY ? -dstRowStride : dstRowStride;
+	// pixels whose bytes lie next to each other in the source are moved as a whole by the vector transpose
+	const bool packed = srcPixelStride == BPP && (BPP == 1 || src2 == src + 1);
+#endif
+
+	for (int row0 = 0; row0 < height; row0 += BLOCK)
+	{
+		const int rows = (height - row0 < BLOCK) ? height - row0 : BLOCK;
+		const int dstCol0 = mirrorX ? height - row0 - rows : row0;
+
+		// source rows in destination column order
+		for (int r = 0; r < rows; r++)
+		{
+			const int row = row0 + (mirrorX ? rows - 1 - r : r);
+			in[r] = src + row * srcRowStride;
+			in2[r] = src2 + row * srcRowStride;
+		}
+
+		for (int col0 = 0; col0 < width; col0 += BLOCK)
+		{
+			const int cols = (width - col0 < BLOCK) ? width - col0 : BLOCK;
+
+#if defined(YUV_CONVERTER_NEON) || defined(YUV_CONVERTER_SSSE3)
+			if (packed && rows == BLOCK && cols == BLOCK)
+			{
+				unsigned char* out = dst + (mirrorY ? width - 1 - col0 : col0) * dstRowStride + BPP * dstCol0;
+				for (int c = 0; c < BLOCK; c += 8)
+					for (int r = 0; r < BLOCK; r += 8)
+						Transpose8x8<BPP>(in + r, BPP * (col0 + c), out + c * outStep + BPP * r, outStep);
+				continue;
+			}
+#endif
+
+			for (int col = col0; col < col0 + cols; col++)
+			{
+				unsigned char* out = dst + (mirrorY ? width - 1 - col : col) * dstRowStride + BPP * dstCol0;
+				const int offset = col * srcPixelStride;
+
+				for (int r = 0; r < rows; r++)
+				{
+					out[BPP * r] = in[r][offset];
+					if (BPP == 2)
+						out[BPP * r + 1] = in2[r][offset];
+				}
+			}
+		}
+	}
+}
+
+void YuvConverter::ConvertTransposed(const YuvFrame& frame, VsImage* dst, bool mirrorX, bool mirrorY)
+{
+	// Source columns become destination rows. A band of TRANSPOSE_ROWS source columns is transposed as Y and
+	// interleaved U/V planes into the scratch buffer, one byte per sample, and its rows are then converted straight
+	// into the destination, so RGB is written row after row as in the unrotated conversion.
+	const int bandStride = frame.height;
+	const int uvBandStride = 2 * (frame.height >> 1);
+	strip.resize(TRANSPOSE_ROWS * bandStride + (TRANSPOSE_ROWS >> 1) * uvBandStride);
+	unsigned char* bandY = &strip[0];
+	unsigned char* bandUV = bandY + TRANSPOSE_ROWS * bandStride;
+
+	for (int col0 = 0; col0 < frame.width; col0 += TRANSPOSE_ROWS)
+	{
+		const int cols = (frame.width - col0 < TRANSPOSE_ROWS) ? frame.width - col0 : TRANSPOSE_ROWS;
+		const int uvCol = (col0 >> 1) * frame.uvPixelStride;
+
+		OrientPlane<1>(frame.y + col0, frame.y + col0, 1, frame.yRowStride, cols, frame.height,
+					   bandY, bandStride, true, mirrorX, false);
+		OrientPlane<2>(frame.u + uvCol, frame.v + uvCol, frame.uvPixelStride, frame.uvRowStride, cols >> 1, frame.height >> 1,
+					   bandUV, uvBandStride, true, mirrorX, false);
+
+		for (int col = 0; col < cols; col++)
+		{
+			const int dstRow = mirrorY ? frame.width - 1 - (col0 + col) : col0 + col;
+			const unsigned char* uv = bandUV + (col >> 1) * uvBandStride;
+			ConvertRow(bandY + col * bandStride, uv, uv + 1, 2,
+					   (unsigned char*) dst->imageData + dstRow * dst->widthStep, frame.height);
+		}
+	}
+}
+
+#if defined(YUV_CONVERTER_NEON) || defined(YUV_CONVERTER_SSSE3)
+#if defined(YUV_CONVERTER_NEON)
+typedef uint16x8_t PixelSums;
+#else
+typedef __m128i PixelSums;
+#endif
+
+/**
+ * Adds neighbouring pixels of two registers of 16 bit sums, pixels of BPP lanes each: the sums of the pixel
+ * pairs of a are followed by those of b.
+ */
+template <int BPP>
+static inline PixelSums AddPixelPairs(PixelSums a, PixelSums b)
+{
+#if defined(YUV_CONVERTER_NEON)
+	if (BPP == 2)
+	{
+		const uint32x4x2_t pairs = vuzpq_u32(vreinterpretq_u32_u16(a), vreinterpretq_u32_u16(b));
+		return vaddq_u16(vreinterpretq_u16_u32(pairs.val[0]), vreinterpretq_u16_u32(pairs.val[1]));
+	}
+	const uint16x8x2_t pairs = vuzpq_u16(a, b);
+	return vaddq_u16(pairs.val[0], pairs.val[1]);
+#else
+	if (BPP == 2)
+	{
+		// u0 v0 u1 v1 to u0 u1 v0 v1, so that the samples of a pair are neighbouring lanes
+		const __m128i order = _mm_setr_epi8(0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15);
+		a = _mm_shuffle_epi8(a, order);
+		b = _mm_shuffle_epi8(b, order);
+	}
+	const __m128i ones = _mm_set1_epi16(1);
+	return _mm_packs_epi32(_mm_madd_epi16(a, ones), _mm_madd_epi16(b, ones));
+#endif
+}
+
+/**
+ * Vector part of DownscaleRow for pixels whose bytes lie next to each other in the source, 8 output bytes at a
+ * time: the rows are summed in 16 bit lanes and neighbouring pixels are then added SHIFT times.
+ * Returns the number of output pixels written.
+ */
+template <int BPP, int SHIFT>
+static int DownscaleRowVector(const unsigned char* src, int srcRowStride, int outWidth, unsigned char* dst)
+{
+	const int scale = 1 << SHIFT;
+	const int step = 8 / BPP;
+	int x = 0;
+
+	for (; x + step <= outWidth; x += step)
+	{
+		const unsigned char* in = src + BPP * x * scale;
+		PixelSums sums[4];
+
+		for (int i = 0; i < scale; i += 2)
+		{
+#if defined(YUV_CONVERTER_NEON)
+			uint16x8_t lo = vdupq_n_u16(0), hi = vdupq_n_u16(0);
+			for (int r = 0; r < scale; r++)
+			{
+				const uint8x16_t bytes = vld1q_u8(in + r * srcRowStride + 8 * i);
+				lo = vaddw_u8(lo, vget_low_u8(bytes));
+				hi = vaddw_u8(hi, vget_high_u8(bytes));
+			}
+#else
+			const __m128i zero = _mm_setzero_si128();
+			__m128i lo = zero, hi = zero;
+			for (int r = 0; r < scale; r++)
+			{
+				const __m128i bytes = _mm_loadu_si128((const __m128i*) (in + r * srcRowStride + 8 * i));
+				lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(bytes, zero));
+				hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(bytes, zero));
+			}
+#endif
+			sums[i] = lo;
+			sums[i + 1] = hi;
+		}
+
+		PixelSums total = AddPixelPairs<BPP>(sums[0], sums[1]);
+		if (SHIFT == 2)
+			total = AddPixelPairs<BPP>(total, AddPixelPairs<BPP>(sums[2], sums[3]));
+
+#if defined(YUV_CONVERTER_NEON)
+		vst1_u8(dst + BPP * x, vrshrn_n_u16(total, 2 * SHIFT));
+#else
+		total = _mm_srli_epi16(_mm_add_epi16(total, _mm_set1_epi16(1 << (2 * SHIFT - 1))), 2 * SHIFT);
+		_mm_storel_epi64((__m128i*) (dst + BPP * x), _mm_packus_epi16(total, total));
+#endif
+	}
+	return x;
+}
+#endif
+
+/**
+ * Area-averages one output row of a plane downscaled by 2^shift in both directions.
+ * Pixels are read like in OrientPlane and written packed (BPP bytes per pixel) to dst.
+ */
+template <int BPP, int SHIFT>
+static void DownscaleRow(const unsigned char* src, const unsigned char* src2, int srcPixelStride, int srcRowStride,
+						 int outWidth, unsigned char* dst)
+{
+	const int scale = 1 << SHIFT;
+	const int round = 1 << (2 * SHIFT - 1);
+	int x = 0;
+
+#if defined(YUV_CONVERTER_NEON) || defined(YUV_CONVERTER_SSSE3)
+	if (srcPixelStride == BPP && (BPP == 1 || src2 == src + 1))
+		x = DownscaleRowVector<BPP, SHIFT>(src, srcRowStride, outWidth, dst);
+#endif
+
+	for (; x < outWidth; x++)
+	{
+		unsigned int sum = 0, sum2 = 0;
+		const int offset = x * scale * srcPixelStride;
+
+		for (int r = 0; r < scale; r++)
+		{
+			const unsigned char* in = src + r * srcRowStride + offset;
+			const unsigned char* in2 = src2 + r * srcRowStride + offset;
+			for (int c = 0; c < scale; c++)
+			{
+				sum += in[c * srcPixelStride];
+				if (BPP == 2)
+					sum2 += in2[c * srcPixelStride];
+			}
+		}
+
+		dst[BPP * x] = (unsigned char) ((sum + round) >> (2 * SHIFT));
+		if (BPP == 2)
+			dst[BPP * x + 1] = (unsigned char) ((sum2 + round) >> (2 * SHIFT));
+	}
+}
+
+/**
+ * Downscales a plane by 2^shift and writes it oriented. Rows are downscaled in strips of STRIP_ROWS into
+ * the scratch buffer, and each strip is oriented while still in cache, so the source is read only once.
+ * With full given, the source rows of each strip are also written oriented at full resolution while
+ * they are in cache; dst may then be NULL if only the full resolution plane is needed.
+ */
+template <int BPP>
+static void DownscaleOrientPlane(const unsigned char* src, const unsigned char* src2, int srcPixelStride, int srcRowStride,
+								 int width, int height, int shift, unsigned char* dst, int dstRowStride,
+								 unsigned char* full, int fullRowStride,
+								 bool transpose, bool mirrorX, bool mirrorY, std::vector<unsigned char>& strip, int stripRows)
+{
+	const int outWidth = width >> shift;
+	const int outHeight = height >> shift;
+	const int stripStride = BPP * outWidth;
+
+	if ((int) strip.size() < stripStride * stripRows)
+		strip.resize(stripStride * stripRows);
+
+	for (int row0 = 0; row0 < outHeight; row0 += stripRows)
+	{
+		const int rows = (outHeight - row0 < stripRows) ? outHeight - row0 : stripRows;
+
+		for (int r = 0; dst && r < rows; r++)
+		{
+			const int srcOffset = ((row0 + r) << shift) * srcRowStride;
+			if (shift == 1)
+				DownscaleRow<BPP, 1>(src + srcOffset, src2 + srcOffset, srcPixelStride, srcRowStride, outWidth, &strip[r * stripStride]);
+			else
+				DownscaleRow<BPP, 2>(src + srcOffset, src2 + srcOffset, srcPixelStride, srcRowStride, outWidth, &strip[r * stripStride]);
+		}
+
+		// the strip is a sub-image whose rows land at an offset (a row offset, or a column offset when transposing)
+		// of the destination; mirroring along rows moves it to the opposite end
+		if (full)
+		{
+			const int srcRow0 = row0 << shift;
+			const int srcRows = rows << shift;
+			const int first = ((transpose ? mirrorX : mirrorY) ? height - srcRow0 - srcRows : srcRow0);
+			OrientPlane<BPP>(src + srcRow0 * srcRowStride, src2 + srcRow0 * srcRowStride, srcPixelStride, srcRowStride,
+							 width, srcRows, full + (transpose ? BPP * first : first * fullRowStride), fullRowStride,
+							 transpose, mirrorX, mirrorY);
+		}
+
+		if (dst)
+		{
+			const int first = ((transpose ? mirrorX : mirrorY) ? outHeight - row0 - rows : row0);
+			unsigned char* out = dst + (transpose ? BPP * first : first * dstRowStride);
+
+			OrientPlane<BPP>(&strip[0], &strip[0] + 1, BPP, stripStride, outWidth, rows, out, dstRowStride,
+							 transpose, mirrorX, mirrorY);
+		}
+	}
+}
+
+void YuvConverter::ExtractNV12(const YuvFrame& frame, VsImage* yDst, VsImage* uvDst, int orientation, int flip, int scale,
+							   VsImage* yFull, VsImage* uvFull)
+{
+	bool transpose, mirrorX, mirrorY;
+	DecodeOrientation(orientation, flip, transpose, mirrorX, mirrorY);
+
+	if (scale <= 1)
+	{
+		OrientPlane<1>(frame.y, frame.y, 1, frame.yRowStride, frame.width, frame.height,
+					   (unsigned char*) yDst->imageData, yDst->widthStep, transpose, mirrorX, mirrorY);
+
+		OrientPlane<2>(frame.u, frame.v, frame.uvPixelStride, frame.uvRowStride, frame.width >> 1, frame.height >> 1,
+					   (unsigned char*) uvDst->imageData, uvDst->widthStep, transpose, mirrorX, mirrorY);
+		return;
+	}
+
+	const int shift = (scale >= 4) ? 2 : 1;
+
+	DownscaleOrientPlane<1>(frame.y, frame.y, 1, frame.yRowStride, frame.width, frame.height, shift,
+							(unsigned char*) yDst->imageData, yDst->widthStep,
+							yFull ? (unsigned char*) yFull->imageData : NULL, yFull ? yFull->widthStep : 0,
+							transpose, mirrorX, mirrorY, strip, STRIP_ROWS);
+
+	if (uvDst || uvFull)
+		DownscaleOrientPlane<2>(frame.u, frame.v, frame.uvPixelStride, frame.uvRowStride, frame.width >> 1, frame.height >> 1, shift,
+								uvDst ? (unsigned char*) uvDst->imageData : NULL, uvDst ? uvDst->widthStep : 0,
+								uvFull ? (unsigned char*) uvFull->imageData : NULL, uvFull ? uvFull->widthStep : 0,
+								transpose, mirrorX, mirrorY, strip, STRIP_ROWS);
+}
+
+bool YuvConverter::IsScaleSupported(int width, int height, int scale)
+{
+	if (scale != 1 && scale != 2 && scale != 4)
+		return false;
+
+	// both the luma and the subsampled chroma planes have to divide evenly
+	return (width % (2 * scale)) == 0 && (height % (2 * scale)) == 0;
+}
+
+void YuvConverter::ConvertNV12(const VsImage* yImage, const VsImage* uvImage, VsImage* dst) const
+{
+	YuvFrame frame;
+	frame.y = (const unsigned char*) yImage->imageData;
+	frame.u = (const unsigned char*) uvImage->imageData;
+	frame.v = (const unsigned char*) uvImage->imageData + 1;
+	frame.width = yImage->width;
+	frame.height = yImage->height;
+	frame.yRowStride = yImage->widthStep;
+	frame.uvRowStride = uvImage->widthStep;
+	frame.uvPixelStride = 2;
+
+	Convert(frame, dst);
+}
+
+}
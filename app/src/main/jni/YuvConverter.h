@@ -0,0 +1,153 @@
+#ifndef __YuvConverter_h__
+#define __YuvConverter_h__
+
+#include "vs_main.h"
+#include <vector>
+
+namespace VisageSDK
+{
+
+/** Color matrices supported by @ref YuvConverter.
+ * Android cameras deliver JFIF (BT.601 full range) YUV_420_888 in practice, which is the default.
+ */
+enum YuvColorMatrix {
+	YUV_MATRIX_BT601_FULL = 0,
+	YUV_MATRIX_BT601_LIMITED = 1,
+	YUV_MATRIX_BT709_FULL = 2,
+	YUV_MATRIX_BT709_LIMITED = 3
+};
+
+/** Description of a single YUV_420_888 frame as delivered by the Android ImageReader.
+ * Chroma planes are subsampled 2x2. With uvPixelStride 1 the planes are fully planar (I420),
+ * with uvPixelStride 2 they are semi-planar (NV12/NV21) and u/v point into the same interleaved buffer.
+ */
+struct YuvFrame {
+	const unsigned char* y;
+	const unsigned char* u;
+	const unsigned char* v;
+	int width;
+	int height;
+	int yRowStride;
+	int uvRowStride;
+	int uvPixelStride;
+};
+
+/** YuvConverter converts YUV_420_888 frames to packed 8-bit RGB.
+ *
+ * Conversion is done in 16-bit fixed point (6 fractional bits) so that it maps directly onto
+ * NEON (ARM) and SSSE3 (x86) vector instructions; the scalar path performs the exact same
+ * arithmetic and is used for row tails and on other architectures, so all backends produce
+ * identical output.
+ */
+class YuvConverter {
+
+public:
+
+	/** Constructor.
+	*
+	* @param matrix color matrix used for conversion
+	*/
+	YuvConverter(YuvColorMatrix matrix = YUV_MATRIX_BT601_FULL);
+
+	/** Selects the color matrix used for all subsequent conversions.
+	*/
+	void SetColorMatrix(YuvColorMatrix matrix);
+
+	YuvColorMatrix GetColorMatrix() const { return matrix; }
+
+	/** Coefficients of a color matrix for samples normalized to 0..1, e.g. for conversion in a shader:
+	* r = yMul * (y - yOffset) + vr * v, g = yMul * (y - yOffset) - ug * u - vg * v, b = yMul * (y - yOffset) + ub * u
+	* with u and v centered on 0. They are the fixed-point coefficients of the conversion, so both produce the same colors.
+	* @param coefficients receives yOffset, yMul, vr, ug, vg, ub
+	*/
+	static void GetCoefficients(YuvColorMatrix matrix, float coefficients[6]);
+
+	/** Converts a single row of pixels.
+	* @param y luma row
+	* @param u chroma U row (already subsampled vertically)
+	* @param v chroma V row (already subsampled vertically)
+	* @param uvPixelStride distance in bytes between neighbouring chroma samples (1 or 2)
+	* @param rgb destination, 3*width bytes
+	* @param width number of pixels to convert, must be even
+	*/
+	void ConvertRow(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+					int uvPixelStride, unsigned char* rgb, int width) const;
+
+	/** Converts the whole frame into a 3 channel image of the same size.
+	*/
+	void Convert(const YuvFrame& frame, VsImage* dst) const;
+
+	/** Converts the whole frame and writes every pixel directly into its rotated and mirrored position,
+	* producing the same image as conversion followed by vsTranspose/vsFlip in a single pass.
+	*
+	* For 90 and 270 degrees the Y and U/V planes are transposed in bands of TRANSPOSE_ROWS destination
+	* rows into a scratch buffer that stays in cache, and the band is then converted row by row, so that
+	* destination writes remain sequential.
+	* @param frame source frame
+	* @param dst destination image, sized according to @ref OrientedSize
+	* @param orientation Orientation of image. Allowed values are 0, 90, 180, 270
+	* @param flip Flip image horizontaly.
+	*/
+	void Convert(const YuvFrame& frame, VsImage* dst, int orientation, int flip);
+
+	/** Copies the frame into oriented NV12 form without any color conversion: the luma plane goes into
+	* a 1 channel image and the chroma planes into a 2 channel (interleaved U/V) image of half the size.
+	* Both images must be sized according to @ref OrientedSize. Used when the tracker consumes luminance
+	* directly and RGB is only produced on demand with @ref ConvertNV12.
+	*
+	* With scale larger than 1 both planes are area-averaged down by that factor in the same pass, so the
+	* output is sized according to @ref OrientedSize of width/scale x height/scale. The planes can also be
+	* written at full resolution in that pass, which reads every row of the frame only once.
+	* @param scale downscale factor, 1, 2 or 4, see @ref IsScaleSupported
+	* @param yFull if not NULL and scale is larger than 1, receives the luma plane at full resolution
+	* @param uvFull if not NULL and scale is larger than 1, receives the chroma plane at full resolution; uvDst
+	* may be NULL when only the downscaled luma is needed
+	*/
+	void ExtractNV12(const YuvFrame& frame, VsImage* yDst, VsImage* uvDst, int orientation, int flip, int scale = 1,
+					 VsImage* yFull = NULL, VsImage* uvFull = NULL);
+
+	/** Returns true if a frame of the given size can be downscaled by scale in @ref ExtractNV12
+	* (the factor is 1, 2 or 4 and the chroma planes divide evenly).
+	*/
+	static bool IsScaleSupported(int width, int height, int scale);
+
+	/** Converts an NV12 frame produced by @ref ExtractNV12 to RGB.
+	*/
+	void ConvertNV12(const VsImage* yImage, const VsImage* uvImage, VsImage* dst) const;
+
+	/** Size of the image produced by oriented @ref Convert for a frame of the given size.
+	*/
+	static void OrientedSize(int width, int height, int orientation, int& outWidth, int& outHeight);
+
+	/** Name of the vector backend compiled in ("neon", "ssse3" or "scalar").
+	*/
+	static const char* BackendName();
+
+private:
+
+	void ConvertRowScalar(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+						  int uvPixelStride, unsigned char* rgb, int x, int width) const;
+
+	void ConvertTransposed(const YuvFrame& frame, VsImage* dst, bool mirrorX, bool mirrorY);
+
+	static const int STRIP_ROWS = 16;
+
+	// destination rows produced per band of the transposing conversion, a full cache line of every source row
+	static const int TRANSPOSE_ROWS = 64;
+
+	std::vector<unsigned char> strip;
+
+	YuvColorMatrix matrix;
+
+	// fixed-point coefficients, 6 fractional bits
+	short yOffset;
+	short yMul;
+	short vr;
+	short ug;
+	short vg;
+	short ub;
+};
+
+}
+
+#endif // __YuvConverter_h__
@@ -0,0 +1,64 @@
+#ifndef __YuvRecording_h__
+#define __YuvRecording_h__
+
+#include <cstdint>
+
+namespace VisageSDK
+{
+
+/** On-disk layout of raw YUV_420_888 camera recordings, written by @ref FrameRecorder and read by @ref ReplayFrameSource.
+ *
+ * A recording starts with a @ref YuvRecordingHeader followed by frame records. Every record is a
+ * @ref YuvFrameRecord followed by the Y, U and V planes exactly as the camera delivered them (including row
+ * padding), back to back, and padding up to a multiple of @ref YUV_RECORD_ALIGNMENT bytes, so that records can be
+ * used in place from a memory mapping. A record with a zero magic marks the end of the frames (space preallocated
+ * by an interrupted recording). All fields are stored in the byte order of the recording device
+ * (little endian on every supported platform).
+ */
+
+/** "VSYUV420" */
+static const char YUV_RECORDING_MAGIC[8] = { 'V', 'S', 'Y', 'U', 'V', '4', '2', '0' };
+
+static const uint32_t YUV_RECORDING_VERSION = 1;
+
+/** "FRME" */
+static const uint32_t YUV_FRAME_RECORD_MAGIC = 0x454d5246;
+
+/** Alignment of frame records within the file, in bytes.
+ */
+static const uint32_t YUV_RECORD_ALIGNMENT = 64;
+
+struct YuvRecordingHeader {
+	char magic[8];			///< @ref YUV_RECORDING_MAGIC
+	uint32_t version;		///< @ref YUV_RECORDING_VERSION
+	uint32_t headerSize;	///< size of this header in bytes, the first record starts at the next aligned offset
+};
+
+struct YuvFrameRecord {
+	uint32_t magic;			///< @ref YUV_FRAME_RECORD_MAGIC
+	uint32_t recordSize;	///< size of the whole record including this header and padding, multiple of @ref YUV_RECORD_ALIGNMENT
+	int64_t timestamp;		///< sensor timestamp in nanoseconds
+	int32_t width;
+	int32_t height;
+	int32_t yRowStride;
+	int32_t uvRowStride;
+	int32_t uvPixelStride;	///< 1 for planar, 2 for semi-planar chroma
+	uint32_t ySize;			///< size of the Y plane in bytes
+	uint32_t uSize;			///< size of the U plane in bytes
+	uint32_t vSize;			///< size of the V plane in bytes
+	int32_t orientation;	///< orientation the frame was captured with (0, 90, 180, 270)
+	int32_t flip;			///< 1 if the frame was captured mirrored
+	uint32_t reserved[2];
+};
+
+/** Size of a frame record holding planes of the given sizes, including padding.
+ */
+inline uint32_t YuvFrameRecordSize(uint32_t ySize, uint32_t uSize, uint32_t vSize)
+{
+	uint32_t size = (uint32_t) sizeof(YuvFrameRecord) + ySize + uSize + vSize;
+	return (size + YUV_RECORD_ALIGNMENT - 1) & ~(YUV_RECORD_ALIGNMENT - 1);
+}
+
+}
+
+#endif // __YuvRecording_h__
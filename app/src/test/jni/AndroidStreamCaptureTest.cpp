@@ -0,0 +1,109 @@
+#include "AndroidStreamCapture.h"
+#include "YuvReference.h"
+#include "HostTest.h"
+#include <cstring>
+
+using namespace VisageSDK;
+
+static VsImage* CreateImage(int width, int height, int channels)
+{
+	return vsCreateImage(vsSize(width, height), VS_DEPTH_8U, channels);
+}
+
+static bool SameImage(const VsImage* a, const VsImage* b)
+{
+	if (a->width != b->width || a->height != b->height || a->nChannels != b->nChannels)
+		return false;
+	for (int row = 0; row < a->height; row++)
+		if (memcmp(a->imageData + row * a->widthStep, b->imageData + row * b->widthStep, a->width * a->nChannels))
+			return false;
+	return true;
+}
+
+/** A downscaled capture hands the tracker the same frame as the fused downscale of ExtractNV12, while the preview
+ * planes and the RGB frame for the analyser keep the camera resolution.
+ */
+static void TestScaledCapture(int width, int height, int orientation, int flip, int format, int scale)
+{
+	const int failures = hostTestFailures;
+	TestYuvFrame input(width, height, 2, 16);
+	AndroidStreamCapture capture(width, height, orientation, flip, format, scale);
+	capture.WriteFrame(input.frame, 1000, 1);
+
+	long long timestamp = 0;
+	VsImage* tracked = capture.GrabFrame(timestamp);
+	HOST_CHECK(tracked != 0);
+	HOST_CHECK(timestamp == 1000);
+	HOST_CHECK(capture.GetGrabbedFrameId() == 1);
+	if (!tracked)
+		return;
+
+	YuvConverter converter;
+	int scaledWidth, scaledHeight;
+	YuvConverter::OrientedSize(width / scale, height / scale, orientation, scaledWidth, scaledHeight);
+	VsImage* scaledLuma = CreateImage(scaledWidth, scaledHeight, 1);
+	VsImage* scaledChroma = CreateImage(scaledWidth / 2, scaledHeight / 2, 2);
+	VsImage* scaledRgb = CreateImage(scaledWidth, scaledHeight, 3);
+	converter.ExtractNV12(input.frame, scaledLuma, scaledChroma, orientation, flip, scale);
+	converter.ConvertNV12(scaledLuma, scaledChroma, scaledRgb);
+
+	bool luminance = format == VISAGE_FRAMEGRABBER_FMT_LUMINANCE;
+	HOST_CHECK(SameImage(tracked, luminance ? scaledLuma : scaledRgb));
+
+	int fullWidth, fullHeight;
+	YuvConverter::OrientedSize(width, height, orientation, fullWidth, fullHeight);
+	VsImage* fullLuma = CreateImage(fullWidth, fullHeight, 1);
+	VsImage* fullChroma = CreateImage(fullWidth / 2, fullHeight / 2, 2);
+	VsImage* fullRgb = CreateImage(fullWidth, fullHeight, 3);
+	converter.ExtractNV12(input.frame, fullLuma, fullChroma, orientation, flip);
+	converter.ConvertNV12(fullLuma, fullChroma, fullRgb);
+
+	VsImage* previewLuma = CreateImage(fullWidth, fullHeight, 1);
+	VsImage* previewChroma = CreateImage(fullWidth / 2, fullHeight / 2, 2);
+	VsImage* previewRgb = CreateImage(fullWidth, fullHeight, 3);
+
+	// only luminance capture hands out the planes, RGB capture without downscale converts from the tracked frame
+	bool copied = capture.CopyGrabbedFrameNV12(previewLuma, previewChroma);
+	HOST_CHECK(copied == luminance);
+	if (copied)
+	{
+		HOST_CHECK(SameImage(previewLuma, fullLuma));
+		HOST_CHECK(SameImage(previewChroma, fullChroma));
+	}
+
+	// the preview is sized from the capture, at camera resolution whatever the tracking scale
+	int frameWidth, frameHeight;
+	capture.GetFrameSize(frameWidth, frameHeight);
+	HOST_CHECK(frameWidth == fullWidth && frameHeight == fullHeight);
+
+	HOST_CHECK(capture.ConvertGrabbedFrameToRGB(previewRgb));
+	if (luminance || scale > 1)
+		HOST_CHECK(SameImage(previewRgb, fullRgb));
+	else
+		HOST_CHECK(SameImage(previewRgb, tracked));
+
+	if (hostTestFailures > failures)
+		fprintf(stderr, "failed: orientation %d flip %d %s scale %d\n", orientation, flip, luminance ? "luminance" : "rgb", scale);
+
+	vsReleaseImage(&scaledLuma);
+	vsReleaseImage(&scaledChroma);
+	vsReleaseImage(&scaledRgb);
+	vsReleaseImage(&fullLuma);
+	vsReleaseImage(&fullChroma);
+	vsReleaseImage(&fullRgb);
+	vsReleaseImage(&previewLuma);
+	vsReleaseImage(&previewChroma);
+	vsReleaseImage(&previewRgb);
+}
+
+int main()
+{
+	const int formats[] = {VISAGE_FRAMEGRABBER_FMT_LUMINANCE, VISAGE_FRAMEGRABBER_FMT_RGB};
+	for (int f = 0; f < 2; f++)
+		for (int orientation = 0; orientation < 360; orientation += 90)
+			for (int flip = 0; flip < 2; flip++)
+				for (int scale = 1; scale <= 4; scale *= 2)
+					TestScaledCapture(640, 360, orientation, flip, formats[f], scale);
+
+	return HostTestResult();
+}
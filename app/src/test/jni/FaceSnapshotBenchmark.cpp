@@ -0,0 +1,88 @@
+#include "FaceSnapshot.h"
+#include "HostTest.h"
+
+using namespace VisageSDK;
+
+// The chin and jaw contour as VisageRendering draws it
+static const int CONTOUR[][2] = {
+	{2, 2}, {17, 18}, {2, 6}, {17, 14}, {2, 4}, {17, 16}, {2, 8}, {17, 20},
+	{2, 3}, {17, 19}, {2, 9}, {17, 15}, {2, 5}, {17, 13}, {2, 7}, {17, 17}
+};
+static const int CONTOUR_POINTS = sizeof(CONTOUR) / sizeof(CONTOUR[0]);
+
+static void FillFeaturePoints(FDP* fdp)
+{
+	for (int group = FDP::FP_START_GROUP_INDEX; group <= FDP::FP_END_GROUP_INDEX; group++)
+		for (int n = 1; FDP::FPIsValid(group, n); n++)
+		{
+			FeaturePoint fp;
+			fp.pos[0] = 0.3f + 0.01f * n;
+			fp.pos[1] = 0.2f + 0.03f * group;
+			fp.pos[2] = 0.5f;
+			fp.defined = 1;
+			fp.detected = 1;
+			fp.quality = 0.8f;
+			fdp->setFP(group, n, fp);
+		}
+}
+
+// Publishing and reading the results of one face: the FaceData copy and FDP::getFP lookups the tracking thread and
+// renderer made before, and the snapshot they use now. The host FaceData stand-in (HostFaceData.cpp) copies only the
+// feature points, so the FaceData copy is a lower bound of the cost on a device.
+int main()
+{
+	FaceData faceData;
+	FillFeaturePoints(faceData.featurePoints2D);
+	FillFeaturePoints(faceData.featurePoints3D);
+	FillFeaturePoints(faceData.featurePoints3DRelative);
+
+	FaceData faceDataCopy;
+	static FaceSnapshot snapshot, snapshotCopy;
+	TakeFaceSnapshot(faceData, snapshot);
+
+	static const int contourIndex[CONTOUR_POINTS] = {
+		FaceSnapshotPoint(2, 2), FaceSnapshotPoint(17, 18), FaceSnapshotPoint(2, 6), FaceSnapshotPoint(17, 14),
+		FaceSnapshotPoint(2, 4), FaceSnapshotPoint(17, 16), FaceSnapshotPoint(2, 8), FaceSnapshotPoint(17, 20),
+		FaceSnapshotPoint(2, 3), FaceSnapshotPoint(17, 19), FaceSnapshotPoint(2, 9), FaceSnapshotPoint(17, 15),
+		FaceSnapshotPoint(2, 5), FaceSnapshotPoint(17, 13), FaceSnapshotPoint(2, 7), FaceSnapshotPoint(17, 17)
+	};
+
+	volatile float sink = 0.0f;
+
+	double copyFaceData = BenchmarkNs(5, 2000, [&]() { faceDataCopy = faceData; });
+	double takeSnapshot = BenchmarkNs(5, 2000, [&]() { TakeFaceSnapshot(faceData, snapshot); });
+	double copySnapshot = BenchmarkNs(5, 20000, [&]() { snapshotCopy = snapshot; sink = snapshotCopy.x[0]; });
+
+	double lookupFDP = BenchmarkNs(5, 20000, [&]() {
+		const FDP* fdp = faceDataCopy.featurePoints2D;
+		float sum = 0.0f;
+		for (int i = 0; i < CONTOUR_POINTS; i++)
+		{
+			if (!FDP::FPIsValid(CONTOUR[i][0], CONTOUR[i][1]))
+				continue;
+			const FeaturePoint& fp = fdp->getFP(CONTOUR[i][0], CONTOUR[i][1]);
+			if (fp.defined && fp.detected && fp.pos[0] != 0 && fp.pos[1] != 0)
+				sum += fp.pos[0] + fp.pos[1];
+		}
+		sink = sum;
+	});
+	double lookupSnapshot = BenchmarkNs(5, 20000, [&]() {
+		float sum = 0.0f;
+		for (int i = 0; i < CONTOUR_POINTS; i++)
+		{
+			const int p = contourIndex[i];
+			if (snapshotCopy.flags[p] & FACE_POINT_DRAWABLE)
+				sum += snapshotCopy.x[p] + snapshotCopy.y[p];
+		}
+		sink = sum;
+	});
+
+	printf("FaceSnapshot: %zu bytes, aligned to %zu\n", sizeof(FaceSnapshot), alignof(FaceSnapshot));
+	printf("%-28s %10.0f ns\n", "FaceData copy", copyFaceData);
+	printf("%-28s %10.0f ns\n", "TakeFaceSnapshot", takeSnapshot);
+	printf("%-28s %10.0f ns\n", "FaceSnapshot copy", copySnapshot);
+	printf("%-28s %10.2f ns/point\n", "FDP::getFP contour", lookupFDP / CONTOUR_POINTS);
+	printf("%-28s %10.2f ns/point\n", "FaceSnapshot contour", lookupSnapshot / CONTOUR_POINTS);
+
+	return sink < 0.0f ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+#include "FaceStore.h"
+#include "FaceSnapshot.h"
+#include "VisageTracker.h"
+#include "HostTest.h"
+#include <algorithm>
+
+using namespace VisageSDK;
+
+static void FillFeaturePoints(FDP* fdp)
+{
+	for (int group = FDP::FP_START_GROUP_INDEX; group <= FDP::FP_END_GROUP_INDEX; group++)
+		for (int n = 1; FDP::FPIsValid(group, n); n++)
+		{
+			FeaturePoint fp;
+			fp.pos[0] = 0.3f + 0.01f * n;
+			fp.pos[1] = 0.2f + 0.03f * group;
+			fp.defined = 1;
+			fp.detected = 1;
+			fp.quality = 0.8f;
+			fdp->setFP(group, n, fp);
+		}
+}
+
+// The per-frame wrapper work around VisageTracker::track for a face capacity and number of tracked faces, as in the
+// tracking loop: the status pass of FaceStore::Update, a snapshot of every active face, the status copy and the tracked
+// face list for face selection. Tracked faces are spread over the slots, so the lists skip empty ones.
+int main()
+{
+	printf("%-9s %-8s %12s %12s\n", "capacity", "tracked", "frame", "per face");
+
+	const int capacities[] = {DEFAULT_FACE_CAPACITY, MAX_FACE_CAPACITY};
+	for (int c = 0; c < 2; c++)
+	{
+		const int capacity = capacities[c];
+		for (int faces = 0; faces <= capacity; faces = faces < 4 ? faces + 1 : faces * 2)
+		{
+			FaceStore store;
+			store.SetCapacity(capacity);
+			for (int i = 0; i < capacity; i++)
+			{
+				FillFeaturePoints(store.GetTrackingData()[i].featurePoints2D);
+				FillFeaturePoints(store.GetTrackingData()[i].featurePoints3D);
+			}
+
+			std::vector<int> status(capacity, TRACK_STAT_OFF);
+			for (int k = 0; k < faces; k++)
+				status[(k * capacity) / faces] = TRACK_STAT_OK;
+
+			std::vector<FaceSnapshot> snapshots(capacity);
+			std::vector<int> statusCopy(capacity);
+			std::vector<int> tracked(capacity);
+			volatile int sink = 0;
+
+			double frame = BenchmarkNs(5, faces ? 2000 : 200000, [&]() {
+				store.Update(&status[0]);
+				for (int n = 0; n < store.GetActiveCount(); n++)
+				{
+					const int face = store.GetActive(n);
+					TakeFaceSnapshot(store.GetFaceData(face), snapshots[face]);
+				}
+				std::copy(store.GetStatuses(), store.GetStatuses() + capacity, statusCopy.begin());
+				int scale = 0;
+				for (int n = 0; n < store.GetTrackedCount(); n++)
+				{
+					tracked[n] = store.GetTracked(n);
+					scale += store.GetFaceData(tracked[n]).faceScale;
+				}
+				sink = scale;
+			});
+
+			char perFace[16] = "-";
+			if (faces)
+				snprintf(perFace, sizeof(perFace), "%9.0f ns", frame / faces);
+			printf("%-9d %-8d %9.0f ns %12s\n", capacity, faces, frame, perFace);
+		}
+	}
+
+	return 0;
+}
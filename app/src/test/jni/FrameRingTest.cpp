@@ -0,0 +1,75 @@
+#include "FrameRing.h"
+#include "HostTest.h"
+
+using namespace VisageSDK;
+
+/** The consumer gets the newest frame and the older ones count as dropped.
+ */
+static void TestLatestWins()
+{
+	FrameRing ring(3);
+	const int first = ring.BeginWrite();
+	ring.EndWrite();
+	const int second = ring.BeginWrite();
+	HOST_CHECK(second != first);
+	ring.EndWrite();
+
+	uint64_t sequence = 0;
+	HOST_CHECK(ring.AcquireLatest(0, &sequence) == second);
+	HOST_CHECK(sequence == 2);
+	HOST_CHECK(ring.AcquireLatest(0) == -1);
+
+	FrameRingStats stats = ring.GetStats();
+	HOST_CHECK(stats.produced == 2);
+	HOST_CHECK(stats.consumed == 1);
+	HOST_CHECK(stats.dropped == 1);
+}
+
+/** A wakeup is returned before a ready frame, which stays in the ring for the next acquire.
+ */
+static void TestWakeBeforeReady()
+{
+	FrameRing ring(3);
+	const int slot = ring.BeginWrite();
+	ring.EndWrite();
+	ring.Wake();
+
+	HOST_CHECK(ring.AcquireLatest(0) == -1);
+	HOST_CHECK(ring.AcquireLatest(0) == slot);
+}
+
+/** Reset drops a frame that was never consumed, the slot held by the consumer and a pending wakeup, as when an
+ * analysis worker is stopped and a new one started on the same ring.
+ */
+static void TestReset()
+{
+	FrameRing ring(3);
+	ring.BeginWrite();
+	ring.EndWrite();
+	HOST_CHECK(ring.AcquireLatest(0) != -1);
+	ring.BeginWrite();
+	ring.EndWrite();
+	ring.Wake();
+
+	ring.Reset();
+	HOST_CHECK(ring.AcquireLatest(0) == -1);
+	HOST_CHECK(ring.GetStats().dropped == 1);
+
+	// every slot is free again, the producer never has to reclaim one
+	for (int i = 0; i < ring.GetSlotCount(); i++)
+	{
+		ring.BeginWrite();
+		ring.EndWrite();
+	}
+	HOST_CHECK(ring.GetStats().dropped == 1);
+	HOST_CHECK(ring.AcquireLatest(0) != -1);
+}
+
+int main()
+{
+	TestLatestWins();
+	TestWakeBeforeReady();
+	TestReset();
+
+	return HostTestResult();
+}
@@ -0,0 +1,238 @@
+#include "FaceData.h"
+#include "TrackerGazeCalibrator.h"
+#include <cstring>
+#include <utility>
+
+// Stand-ins for the feature point and face data classes of the visage|SDK libraries, which are only shipped for
+// Android. Feature points live in one heap array per group as in the SDK, FaceData owns its three feature point sets
+// and copies them deeply. The face model mesh, shape units and action units are left out, so copying a FaceData here
+// is cheaper than on a device.
+
+namespace VisageSDK
+{
+
+// at least the highest index the wrapper reads in each group, 2 to 17
+const int FDP::groupSizes[FDP::FP_NUMBER_OF_GROUPS] = {14, 14, 6, 4, 4, 1, 10, 15, 24, 6, 12, 4, 25, 17, 28, 20};
+
+FDP::FDP()
+{
+	mFilename[0] = 0;
+	MNS0 = ENS0 = ES0 = MW0 = IRISD0 = 0.0f;
+	normalized = false;
+	for (int group = 0; group < FP_START_GROUP_INDEX; group++)
+		fp[group] = 0;
+	for (int group = FP_START_GROUP_INDEX; group <= FP_END_GROUP_INDEX; group++)
+		fp[group] = new FeaturePoint[groupSizes[group - FP_START_GROUP_INDEX]];
+	initialized = true;
+}
+
+FDP::FDP(const FDP& featurePoints)
+{
+	for (int group = 0; group < FP_START_GROUP_INDEX; group++)
+		fp[group] = 0;
+	for (int group = FP_START_GROUP_INDEX; group <= FP_END_GROUP_INDEX; group++)
+		fp[group] = new FeaturePoint[groupSizes[group - FP_START_GROUP_INDEX]];
+	*this = featurePoints;
+}
+
+FDP::~FDP()
+{
+	for (int group = FP_START_GROUP_INDEX; group <= FP_END_GROUP_INDEX; group++)
+		delete[] fp[group];
+}
+
+FDP& FDP::operator=(const FDP& featurePoints)
+{
+	if (this == &featurePoints)
+		return *this;
+
+	memcpy(mFilename, featurePoints.mFilename, sizeof(mFilename));
+	MNS0 = featurePoints.MNS0;
+	ENS0 = featurePoints.ENS0;
+	ES0 = featurePoints.ES0;
+	MW0 = featurePoints.MW0;
+	IRISD0 = featurePoints.IRISD0;
+	normalized = featurePoints.normalized;
+	initialized = featurePoints.initialized;
+	for (int group = FP_START_GROUP_INDEX; group <= FP_END_GROUP_INDEX; group++)
+		for (int n = 0; n < groupSizes[group - FP_START_GROUP_INDEX]; n++)
+			fp[group][n] = featurePoints.fp[group][n];
+	return *this;
+}
+
+const FeaturePoint& FDP::getFP(int group, int n) const
+{
+	return fp[group][n - 1];
+}
+
+void FDP::setFP(int group, int n, const FeaturePoint& f)
+{
+	fp[group][n - 1] = f;
+}
+
+bool FDP::FPIsValid(int group, int n)
+{
+	return group >= FP_START_GROUP_INDEX && group <= FP_END_GROUP_INDEX &&
+		   n >= 1 && n <= groupSizes[group - FP_START_GROUP_INDEX];
+}
+
+ScreenSpaceGazeData::ScreenSpaceGazeData()
+{
+	index = 0;
+	x = 0.5f;
+	y = 0.5f;
+	inState = 0;
+	quality = 0.0f;
+	isFix = false;
+	lEyeImage = 0;
+	rEyeImage = 0;
+	usedEye = 0;
+	calibrationGroup = 0;
+	regularizationWeight = 0.0;
+}
+
+ScreenSpaceGazeData::~ScreenSpaceGazeData()
+{
+}
+
+FaceData::FaceData()
+{
+	hasMask = 0.0f;
+	trackingQuality = 0.0f;
+	trackingQualityBdts = 0.0f;
+	frameRate = 0.0f;
+	timeStamp = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		faceTranslation[i] = faceTranslationCompensated[i] = 0.0f;
+		faceRotation[i] = faceRotationApparent[i] = 0.0f;
+		gazeDirectionGlobal[i] = 0.0f;
+	}
+	for (int i = 0; i < 2; i++)
+		gazeDirection[i] = eyeClosure[i] = irisRadius[i] = 0.0f;
+
+	shapeUnitCount = 0;
+	shapeUnits = 0;
+	actionUnitCount = 0;
+	actionUnitsUsed = 0;
+	actionUnits = 0;
+	actionUnitsNames = 0;
+
+	featurePoints3D = new FDP();
+	featurePoints3DRelative = new FDP();
+	featurePoints2D = new FDP();
+
+	faceModelVertexCount = 0;
+	faceModelVertices = 0;
+	faceModelVerticesProjected = 0;
+	faceModelTriangleCount = 0;
+	faceModelTriangles = 0;
+	faceModelTextureCoords = 0;
+	faceModelTextureCoordsStatic = 0;
+
+	faceScale = 0;
+	faceBoundingBox = vsRect(0, 0, 0, 0);
+	cameraFocus = 0.0f;
+	isDataInitialized = false;
+	dataRange = 0;
+	gazeQuality = 0.0f;
+}
+
+FaceData::FaceData(const FaceData& faceData)
+{
+	hasMask = faceData.hasMask;
+	trackingQuality = faceData.trackingQuality;
+	trackingQualityBdts = faceData.trackingQualityBdts;
+	frameRate = faceData.frameRate;
+	timeStamp = faceData.timeStamp;
+	for (int i = 0; i < 3; i++)
+	{
+		faceTranslation[i] = faceData.faceTranslation[i];
+		faceTranslationCompensated[i] = faceData.faceTranslationCompensated[i];
+		faceRotation[i] = faceData.faceRotation[i];
+		faceRotationApparent[i] = faceData.faceRotationApparent[i];
+		gazeDirectionGlobal[i] = faceData.gazeDirectionGlobal[i];
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		gazeDirection[i] = faceData.gazeDirection[i];
+		eyeClosure[i] = faceData.eyeClosure[i];
+		irisRadius[i] = faceData.irisRadius[i];
+	}
+
+	shapeUnitCount = 0;
+	shapeUnits = 0;
+	actionUnitCount = 0;
+	actionUnitsUsed = 0;
+	actionUnits = 0;
+	actionUnitsNames = 0;
+
+	featurePoints3D = faceData.featurePoints3D ? new FDP(*faceData.featurePoints3D) : 0;
+	featurePoints3DRelative = faceData.featurePoints3DRelative ? new FDP(*faceData.featurePoints3DRelative) : 0;
+	featurePoints2D = faceData.featurePoints2D ? new FDP(*faceData.featurePoints2D) : 0;
+
+	faceModelVertexCount = 0;
+	faceModelVertices = 0;
+	faceModelVerticesProjected = 0;
+	faceModelTriangleCount = 0;
+	faceModelTriangles = 0;
+	faceModelTextureCoords = 0;
+	faceModelTextureCoordsStatic = 0;
+
+	faceScale = faceData.faceScale;
+	faceBoundingBox = faceData.faceBoundingBox;
+	cameraFocus = faceData.cameraFocus;
+	isDataInitialized = faceData.isDataInitialized;
+	dataRange = 0;
+	gazeData.index = faceData.gazeData.index;
+	gazeData.x = faceData.gazeData.x;
+	gazeData.y = faceData.gazeData.y;
+	gazeData.inState = faceData.gazeData.inState;
+	gazeData.quality = faceData.gazeData.quality;
+	gazeQuality = faceData.gazeQuality;
+}
+
+FaceData::~FaceData()
+{
+	delete featurePoints3D;
+	delete featurePoints3DRelative;
+	delete featurePoints2D;
+}
+
+FaceData& FaceData::operator=(FaceData faceData)
+{
+	swap(*this, faceData);
+	return *this;
+}
+
+void FaceData::swap(FaceData& first, FaceData& second)
+{
+	std::swap(first.hasMask, second.hasMask);
+	std::swap(first.trackingQuality, second.trackingQuality);
+	std::swap(first.trackingQualityBdts, second.trackingQualityBdts);
+	std::swap(first.frameRate, second.frameRate);
+	std::swap(first.timeStamp, second.timeStamp);
+	std::swap(first.faceTranslation, second.faceTranslation);
+	std::swap(first.faceTranslationCompensated, second.faceTranslationCompensated);
+	std::swap(first.faceRotation, second.faceRotation);
+	std::swap(first.faceRotationApparent, second.faceRotationApparent);
+	std::swap(first.gazeDirection, second.gazeDirection);
+	std::swap(first.gazeDirectionGlobal, second.gazeDirectionGlobal);
+	std::swap(first.eyeClosure, second.eyeClosure);
+	std::swap(first.irisRadius, second.irisRadius);
+	std::swap(first.featurePoints3D, second.featurePoints3D);
+	std::swap(first.featurePoints3DRelative, second.featurePoints3DRelative);
+	std::swap(first.featurePoints2D, second.featurePoints2D);
+	std::swap(first.faceScale, second.faceScale);
+	std::swap(first.faceBoundingBox, second.faceBoundingBox);
+	std::swap(first.cameraFocus, second.cameraFocus);
+	std::swap(first.isDataInitialized, second.isDataInitialized);
+	std::swap(first.gazeData.index, second.gazeData.index);
+	std::swap(first.gazeData.x, second.gazeData.x);
+	std::swap(first.gazeData.y, second.gazeData.y);
+	std::swap(first.gazeData.inState, second.gazeData.inState);
+	std::swap(first.gazeData.quality, second.gazeData.quality);
+	std::swap(first.gazeQuality, second.gazeQuality);
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef __HostTest_h__
+#define __HostTest_h__
+
+#include "FrameTiming.h"
+#include <cstdio>
+
+/** Minimal checks for the host tests, which have no test framework to link against.
+ *
+ * A failed @ref HOST_CHECK prints the condition and is counted, the test's main returns @ref HostTestResult so that
+ * ctest reports the failure.
+ */
+static int hostTestFailures = 0;
+
+#define HOST_CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			hostTestFailures++; \
+		} \
+	} while (0)
+
+static inline int HostTestResult()
+{
+	if (hostTestFailures)
+		fprintf(stderr, "%d checks failed\n", hostTestFailures);
+	return hostTestFailures ? 1 : 0;
+}
+
+/** Runs fn iterations times in each of repetitions runs and returns the lowest thread CPU time of a run, in nanoseconds
+ * per iteration. The first run only warms up caches and is not counted.
+ */
+template <class F>
+static double BenchmarkNs(int repetitions, int iterations, F fn)
+{
+	long long best = -1;
+	for (int rep = 0; rep <= repetitions; rep++)
+	{
+		long long start = VisageSDK::ThreadCpuNsec();
+		for (int i = 0; i < iterations; i++)
+			fn();
+		long long elapsed = VisageSDK::ThreadCpuNsec() - start;
+		if (rep > 0 && (best < 0 || elapsed < best))
+			best = elapsed;
+	}
+	return (double) best / iterations;
+}
+
+#endif // __HostTest_h__
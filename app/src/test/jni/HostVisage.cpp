@@ -0,0 +1,61 @@
+#include "vs_main.h"
+#include <cstdlib>
+#include <cstring>
+
+// Stand-ins for the image functions of the visage|SDK libraries, which are only shipped for Android.
+// Images are allocated without row padding, like the ones the wrapper takes from the ImagePool.
+
+VsImage* vsCreateImageHeader(VsSize size, int depth, int channels)
+{
+	VsImage* image = (VsImage*) calloc(1, sizeof(VsImage));
+	image->nSize = sizeof(VsImage);
+	image->width = size.width;
+	image->height = size.height;
+	image->depth = depth;
+	image->nChannels = channels;
+	image->widthStep = size.width * channels * ((depth & 255) / 8);
+	image->imageSize = image->widthStep * size.height;
+	return image;
+}
+
+VsImage* vsCreateImage(VsSize size, int depth, int channels)
+{
+	VsImage* image = vsCreateImageHeader(size, depth, channels);
+	image->imageData = (char*) calloc(image->imageSize, 1);
+	image->imageDataOrigin = image->imageData;
+	return image;
+}
+
+void vsReleaseImageHeader(VsImage** image)
+{
+	if (!image || !*image)
+		return;
+	free(*image);
+	*image = 0;
+}
+
+void vsReleaseImage(VsImage** image)
+{
+	if (!image || !*image)
+		return;
+	free((*image)->imageDataOrigin);
+	vsReleaseImageHeader(image);
+}
+
+void vsSetData(VsArr* arr, void* data, int step)
+{
+	VsImage* image = (VsImage*) arr;
+	image->imageData = (char*) data;
+	image->widthStep = step;
+	image->imageSize = step * image->height;
+}
+
+void vsCopy(const VsArr* src, VsArr* dst, const VsArr* mask)
+{
+	const VsImage* from = (const VsImage*) src;
+	VsImage* to = (VsImage*) dst;
+	const int rowBytes = from->width * from->nChannels * ((from->depth & 255) / 8);
+
+	for (int row = 0; row < from->height; row++)
+		memcpy(to->imageData + row * to->widthStep, from->imageData + row * from->widthStep, rowBytes);
+}
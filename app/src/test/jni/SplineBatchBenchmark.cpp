@@ -0,0 +1,132 @@
+#include "SplineBatch.h"
+#include "VisageRendering.h"
+#include "FrameArena.h"
+#include "HostTest.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using namespace VisageSDK;
+
+// control point counts of the contours drawn by DisplaySplines
+static const int LENGTHS[] = {11, 9, 9, 9, 3, 5, 5, 5, 9, 9, 5, 5, 9, 9, 6, 5, 6, 5, 17, 7, 7};
+static const int CONTOURS = sizeof(LENGTHS) / sizeof(LENGTHS[0]);
+static const int RATIO = 10;
+
+static volatile float sink;
+
+/** Spline evaluation of all contours of a frame: one CalcSpline for positions and one for alpha per contour, as
+ * DrawSpline2D did it, against one SplineBatch for all of them.
+ */
+static void BenchmarkSplines(int faces)
+{
+	std::vector<float> x, y, alpha;
+	srand(1);
+	for (int face = 0; face < faces; face++)
+		for (int c = 0; c < CONTOURS; c++)
+			for (int i = 0; i < LENGTHS[c]; i++)
+			{
+				const float angle = i * 0.4f + c;
+				x.push_back(0.5f + 0.2f * cosf(angle) + 0.01f * rand() / RAND_MAX + 0.02f * face);
+				y.push_back(0.5f + 0.2f * sinf(angle) + 0.01f * rand() / RAND_MAX);
+				alpha.push_back(0.75f);
+			}
+
+	FrameArena& arena = FrameArena::Shared();
+	double perContour = BenchmarkNs(5, 2000 / faces, [&]() {
+		arena.Reset();
+		int first = 0;
+		for (int k = 0; k < faces * CONTOURS; k++)
+		{
+			const int count = LENGTHS[k % CONTOURS];
+			float* positions = arena.Allocate<float>(2 * count);
+			float* alphas = arena.Allocate<float>(2 * count);
+			for (int i = 0; i < count; i++)
+			{
+				positions[2 * i] = x[first + i];
+				positions[2 * i + 1] = y[first + i];
+				alphas[2 * i] = alphas[2 * i + 1] = alpha[first + i];
+			}
+			const int points = VisageRendering::SplinePointCount(count, RATIO);
+			float* splinePositions = arena.Allocate<float>(2 * points);
+			float* splineAlphas = arena.Allocate<float>(2 * points);
+			VisageRendering::CalcSpline(positions, count, RATIO, splinePositions);
+			VisageRendering::CalcSpline(alphas, count, RATIO, splineAlphas);
+			sink = splinePositions[points] + splineAlphas[points];
+			first += count;
+		}
+	});
+
+	SplineBatch batch(RATIO);
+	double batched = BenchmarkNs(5, 2000 / faces, [&]() {
+		batch.Clear();
+		int first = 0;
+		for (int k = 0; k < faces * CONTOURS; k++)
+		{
+			batch.AddContour(&x[first], &y[first], &alpha[first], LENGTHS[k % CONTOURS]);
+			first += LENGTHS[k % CONTOURS];
+		}
+		batch.Evaluate();
+		sink = batch.GetX()[0];
+	});
+
+	printf("%-6d %12.2f us %12.2f us %8.2fx\n", faces, perContour / 1e3, batched / 1e3, perContour / batched);
+}
+
+/** CPU side of drawing the overlays of a frame with DisplayResults, without a GL context: the geometry of all
+ * overlays is built and batched, and every GL call fails.
+ */
+static void BenchmarkOverlays(int faces, int options)
+{
+	VsImage frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.nChannels = 3;
+	frame.width = 480;
+	frame.height = 640;
+
+	static FaceSnapshot face;
+	memset(&face, 0, sizeof(face));
+	srand(1);
+	for (int p = 0; p < FACE_SNAPSHOT_POINTS; p++)
+	{
+		face.x[p] = 0.5f + 0.3f * cosf(p * 0.37f) + 0.01f * rand() / RAND_MAX;
+		face.y[p] = 0.5f + 0.35f * sinf(p * 0.37f) + 0.01f * rand() / RAND_MAX;
+		face.quality[p] = (p % 10) / 10.0f;
+		face.flags[p] = FACE_POINT_DEFINED | FACE_POINT_DRAWABLE;
+	}
+	face.faceTranslation[2] = 0.5f;
+	face.cameraFocus = 3.0f;
+	face.trackingQuality = 0.7f;
+	face.faceScale = 200;
+
+	double frameNs = BenchmarkNs(5, 400 / faces, [&]() {
+		VisageRendering::BeginFrame();
+		for (int i = 0; i < faces; i++)
+			VisageRendering::DisplayResults(&face, NULL, TRACK_STAT_OK, 720, 960, &frame, options);
+		VisageRendering::EndFrame();
+	});
+
+	printf("%-6d %12.2f us\n", faces, frameNs / 1e3);
+}
+
+int main()
+{
+	printf("spline evaluation per frame\n");
+	printf("%-6s %15s %15s %9s\n", "faces", "per contour", "batched", "speedup");
+	const int faces[] = {1, 2, 4, 8, 16};
+	for (int i = 0; i < 5; i++)
+		BenchmarkSplines(faces[i]);
+
+	// GL errors of the missing context are expected here, only the time matters
+	printf("\nDisplayResults per frame, splines only\n");
+	printf("%-6s %15s\n", "faces", "frame");
+	for (int i = 0; i < 5; i++)
+		BenchmarkOverlays(faces[i], DISPLAY_SPLINES);
+
+	printf("\nDisplayResults per frame, default overlays\n");
+	printf("%-6s %15s\n", "faces", "frame");
+	for (int i = 0; i < 5; i++)
+		BenchmarkOverlays(faces[i], DISPLAY_DEFAULT);
+
+	return 0;
+}
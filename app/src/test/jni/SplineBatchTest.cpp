@@ -0,0 +1,117 @@
+#include "SplineBatch.h"
+#include "VisageRendering.h"
+#include "HostTest.h"
+#include <cmath>
+#include <cstdlib>
+
+using namespace VisageSDK;
+
+// control point counts of the contours drawn by DisplaySplines
+static const int LENGTHS[] = {11, 9, 9, 9, 3, 5, 5, 5, 9, 9, 5, 5, 9, 9, 6, 5, 6, 5, 17, 7, 7};
+static const int CONTOURS = sizeof(LENGTHS) / sizeof(LENGTHS[0]);
+
+// the batch evaluates the same polynomials in a different order of operations
+static const float MAX_DIFFERENCE = 1e-6f;
+
+struct TestContours {
+	std::vector<float> x, y, alpha;
+	std::vector<int> first;
+
+	TestContours(int faces, unsigned int seed)
+	{
+		srand(seed);
+		for (int face = 0; face < faces; face++)
+			for (int c = 0; c < CONTOURS; c++)
+			{
+				first.push_back((int) x.size());
+				for (int i = 0; i < LENGTHS[c]; i++)
+				{
+					const float angle = i * 0.4f + c;
+					x.push_back(0.5f + 0.2f * cosf(angle) + 0.01f * rand() / RAND_MAX + 0.02f * face);
+					y.push_back(0.5f + 0.2f * sinf(angle) + 0.01f * rand() / RAND_MAX);
+					// the ear contour fades with the quality of its points, the others are drawn at a fixed alpha
+					alpha.push_back(c == 18 ? 0.2f + 0.55f * (rand() % 10) / 10.0f : 0.75f);
+				}
+			}
+	}
+};
+
+/** Compares every contour of the batch with CalcSpline of its positions and of its alpha values.
+ */
+static void CheckAgainstCalcSpline(const SplineBatch& batch, const TestContours& input, int faces, int ratio)
+{
+	HOST_CHECK(batch.GetContourCount() == faces * CONTOURS);
+	float maxDifference = 0.0f;
+	int nextPoint = 0;
+
+	for (int k = 0; k < batch.GetContourCount(); k++)
+	{
+		const int count = LENGTHS[k % CONTOURS];
+		const int first = input.first[k];
+		std::vector<float> positions(2 * count), alphas(2 * count);
+		for (int i = 0; i < count; i++)
+		{
+			positions[2 * i] = input.x[first + i];
+			positions[2 * i + 1] = input.y[first + i];
+			alphas[2 * i] = alphas[2 * i + 1] = input.alpha[first + i];
+		}
+		std::vector<float> expectedPositions, expectedAlphas;
+		VisageRendering::CalcSpline(positions, ratio, expectedPositions);
+		VisageRendering::CalcSpline(alphas, ratio, expectedAlphas);
+
+		// contours follow each other in the point stream
+		HOST_CHECK(batch.GetFirstPoint(k) == nextPoint);
+		HOST_CHECK(batch.GetPointCount(k) == VisageRendering::SplinePointCount(count, ratio));
+		HOST_CHECK(2 * batch.GetPointCount(k) == (int) expectedPositions.size());
+		nextPoint += batch.GetPointCount(k);
+
+		const int point = batch.GetFirstPoint(k);
+		for (int i = 0; i < batch.GetPointCount(k) && 2 * i + 1 < (int) expectedPositions.size(); i++)
+		{
+			maxDifference = std::max(maxDifference, fabsf(batch.GetX()[point + i] - expectedPositions[2 * i]));
+			maxDifference = std::max(maxDifference, fabsf(batch.GetY()[point + i] - expectedPositions[2 * i + 1]));
+			maxDifference = std::max(maxDifference, fabsf(batch.GetAlpha()[point + i] - expectedAlphas[2 * i]));
+		}
+	}
+
+	printf("%2d faces, ratio %2d: difference to CalcSpline %.2g at most\n", faces, ratio, maxDifference);
+	HOST_CHECK(maxDifference <= MAX_DIFFERENCE);
+}
+
+static void TestBatch(int faces, int ratio)
+{
+	TestContours input(faces, faces);
+	SplineBatch batch(ratio);
+
+	// a second round on the same batch reuses its storage and must give the same points
+	for (int round = 0; round < 2; round++)
+	{
+		batch.Clear();
+		for (int k = 0; k < faces * CONTOURS; k++)
+		{
+			const int first = input.first[k];
+			HOST_CHECK(batch.AddContour(&input.x[first], &input.y[first], &input.alpha[first], LENGTHS[k % CONTOURS]) == k);
+		}
+		batch.Evaluate();
+		CheckAgainstCalcSpline(batch, input, faces, ratio);
+	}
+}
+
+int main()
+{
+	const int faces[] = {1, 4, 16};
+	for (int i = 0; i < 3; i++)
+	{
+		TestBatch(faces[i], 10);
+		TestBatch(faces[i], 3);
+	}
+
+	// single points are not drawn, an empty batch evaluates to nothing
+	SplineBatch batch;
+	const float point[] = {0.5f};
+	HOST_CHECK(batch.AddContour(point, point, point, 1) == -1);
+	HOST_CHECK(batch.GetContourCount() == 0);
+	batch.Evaluate();
+
+	return HostTestResult();
+}
@@ -0,0 +1,164 @@
+#include "ThreadCpuMonitor.h"
+#include "PipelineMetrics.h"
+#include "ReplayFrameSource.h"
+#include "AndroidStreamCapture.h"
+#include "FrameTiming.h"
+#include "HostTest.h"
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+#include <sys/prctl.h>
+
+using namespace VisageSDK;
+
+// CPU time the stand-in for VisageTracker::track spends per frame
+static const long long TRACK_CPU_NS = 2000000;
+
+static const int FRAMES = 30;
+
+static void BusyCpu(long long cpuNs)
+{
+	const long long until = ThreadCpuNsec() + cpuNs;
+	while (ThreadCpuNsec() < until)
+		;
+}
+
+/** Runs the camera and tracking threads of the wrapper on synthetic frames, with a tracker stand-in that spins for a
+ * fixed CPU time per frame and a worker thread it starts like the tracker's OpenMP workers, and checks that
+ * ThreadCpuMonitor and PipelineMetrics account their CPU and wall time consistently.
+ */
+int main()
+{
+	ReplayFrameSource source;
+	HOST_CHECK(source.OpenSynthetic(640, 480, FRAMES, 30));
+	source.Prefault();
+	AndroidStreamCapture capture(640, 480, 90, 1, VISAGE_FRAMEGRABBER_FMT_RGB);
+
+	ThreadCpuMonitor& monitor = ThreadCpuMonitor::Shared();
+	PipelineMetrics& metrics = PipelineMetrics::Shared();
+	metrics.Reset();
+	HOST_CHECK(monitor.Start(100));
+	HOST_CHECK(monitor.IsRunning());
+
+	std::atomic<bool> stop(false);
+	std::atomic<bool> done(false);
+	std::atomic<bool> sampled(false);
+	int tracked = 0;
+
+	std::thread tracking([&]() {
+		prctl(PR_SET_NAME, "TrackLoop", 0, 0, 0);
+		monitor.RegisterThread(THREAD_TRACKING);
+		// named like the tracking thread, as threads created by it are, and burns CPU while it waits for work
+		std::thread worker([&]() {
+			while (!stop)
+				;
+		});
+
+		while (!stop)
+		{
+			long long waitStart = MonotonicNsec();
+			long long waitCpu = ThreadCpuNsec();
+			long long timestamp;
+			VsImage* frame = capture.GrabFrame(timestamp);
+			long long grabbed = MonotonicNsec();
+			long long grabbedCpu = ThreadCpuNsec();
+			if (!frame)
+				continue;
+
+			BusyCpu(TRACK_CPU_NS);
+			metrics.Record(STAGE_FRAME_WAIT, grabbed - waitStart, grabbedCpu - waitCpu);
+			metrics.Record(STAGE_TRACK, MonotonicNsec() - grabbed, ThreadCpuNsec() - grabbedCpu);
+			tracked++;
+		}
+		worker.join();
+
+		// stay alive until the monitor has seen the final CPU time of this thread
+		done = true;
+		while (!sampled)
+			usleep(1000);
+	});
+
+	std::thread camera([&]() {
+		prctl(PR_SET_NAME, "CameraFeed", 0, 0, 0);
+		ReplayStats stats = source.Play(&capture, REPLAY_ORIGINAL_TIMING);
+		HOST_CHECK(stats.frames == FRAMES);
+	});
+
+	camera.join();
+	// the last frame may still be waiting to be grabbed
+	usleep(100000);
+	stop = true;
+	capture.WakeGrab();
+	while (!done)
+		usleep(1000);
+	monitor.Stop();
+	monitor.Sample();
+	sampled = true;
+	tracking.join();
+
+	// per interval, the process cannot have used more CPU than all cores had, up to the time a sample takes
+	std::vector<ThreadCpuInterval> history = monitor.GetHistory();
+	HOST_CHECK(history.size() >= 2);
+	const long long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	long long wallNs = 0;
+	long long kindCpuNs[THREAD_KIND_COUNT] = {0};
+	for (size_t i = 0; i < history.size(); i++)
+	{
+		long long intervalCpuNs = 0;
+		HOST_CHECK(history[i].wallNs > 0);
+		for (int kind = 0; kind < THREAD_KIND_COUNT; kind++)
+		{
+			HOST_CHECK(history[i].cpuNs[kind] >= 0);
+			intervalCpuNs += history[i].cpuNs[kind];
+			kindCpuNs[kind] += history[i].cpuNs[kind];
+		}
+		HOST_CHECK(intervalCpuNs <= cores * history[i].wallNs * 12 / 10 + 10000000);
+		wallNs += history[i].wallNs;
+	}
+
+	// threads of each kind, at most as much CPU as the wall time they ran, since each is a single thread
+	HOST_CHECK(kindCpuNs[THREAD_CAMERA] > 0);
+	HOST_CHECK(kindCpuNs[THREAD_TRACKING] >= tracked * TRACK_CPU_NS);
+	HOST_CHECK(kindCpuNs[THREAD_TRACKER_WORKERS] > 0);
+	HOST_CHECK(kindCpuNs[THREAD_CAMERA] <= wallNs);
+	HOST_CHECK(kindCpuNs[THREAD_TRACKING] <= wallNs);
+	HOST_CHECK(kindCpuNs[THREAD_TRACKER_WORKERS] <= wallNs);
+
+	// the per-thread totals add up to the per-kind totals of the history
+	std::vector<ThreadCpuUsage> threads = monitor.GetThreads();
+	long long threadCpuNs[THREAD_KIND_COUNT] = {0};
+	bool trackingSeen = false;
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threadCpuNs[threads[i].kind] += threads[i].cpuNs;
+		if (threads[i].kind == THREAD_TRACKING)
+			trackingSeen |= threads[i].name == "TrackLoop";
+	}
+	HOST_CHECK(trackingSeen);
+	for (int kind = 0; kind < THREAD_KIND_COUNT; kind++)
+		HOST_CHECK(threadCpuNs[kind] == kindCpuNs[kind]);
+
+	// every frame passed through the camera and tracking stages, and no stage used more CPU than wall time
+	PipelineMetricsSnapshot snapshot;
+	metrics.GetSnapshot(snapshot);
+	HOST_CHECK(tracked > 0 && tracked <= FRAMES);
+	HOST_CHECK(snapshot.stages[STAGE_YUV_CONVERSION].count == (uint64_t) FRAMES);
+	HOST_CHECK(snapshot.stages[STAGE_FRAME_WAIT].count == (uint64_t) tracked);
+	HOST_CHECK(snapshot.stages[STAGE_TRACK].count == (uint64_t) tracked);
+	HOST_CHECK(snapshot.stages[STAGE_TRACK].meanCpuNs >= TRACK_CPU_NS);
+	const PipelineStage stages[] = {STAGE_YUV_CONVERSION, STAGE_FRAME_WAIT, STAGE_TRACK};
+	for (int i = 0; i < 3; i++)
+	{
+		const PipelineStageStats& stats = snapshot.stages[stages[i]];
+		HOST_CHECK(stats.meanCpuNs <= stats.meanNs + stats.meanNs / 100 + 50000);
+	}
+
+	// the CPU the monitor saw on the tracking thread covers what it recorded for its stages
+	const long long recordedTrackingCpuNs = (long long) tracked *
+		(snapshot.stages[STAGE_FRAME_WAIT].meanCpuNs + snapshot.stages[STAGE_TRACK].meanCpuNs);
+	HOST_CHECK(kindCpuNs[THREAD_TRACKING] >= recordedTrackingCpuNs * 99 / 100);
+
+	if (hostTestFailures)
+		fprintf(stderr, "%s\n%s", monitor.Dump().c_str(), metrics.Dump().c_str());
+	return HostTestResult();
+}
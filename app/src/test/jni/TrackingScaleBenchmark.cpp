@@ -0,0 +1,59 @@
+#include "AndroidStreamCapture.h"
+#include "YuvReference.h"
+#include "HostTest.h"
+
+using namespace VisageSDK;
+
+// Per tracking scale, what the wrapper spends around the tracker on a portrait 1280x720 camera stream: preparing the
+// tracked frame on the camera thread, and the camera resolution preview and analyser frames on the tracking thread.
+// The tracker itself is part of the binary SDK, which only exists for Android; on a device its time per scale is
+// logged by the tracking loop and returned by GetTrackerTimeByScale.
+int main()
+{
+	const int width = 1280;
+	const int height = 720;
+	const int orientation = 270;
+	const int flip = 1;
+	TestYuvFrame input(width, height, 2);
+
+	printf("YUV converter backend: %s\n", YuvConverter::BackendName());
+	printf("%-10s %-6s %-10s %12s %12s %12s\n", "format", "scale", "tracked", "write", "nv12 copy", "rgb");
+
+	const int formats[] = {VISAGE_FRAMEGRABBER_FMT_LUMINANCE, VISAGE_FRAMEGRABBER_FMT_RGB};
+	for (int f = 0; f < 2; f++)
+		for (int scale = 1; scale <= 4; scale *= 2)
+		{
+			const bool luminance = formats[f] == VISAGE_FRAMEGRABBER_FMT_LUMINANCE;
+			AndroidStreamCapture capture(width, height, orientation, flip, formats[f], scale);
+
+			long long timestamp = 0;
+			long long frameId = 0;
+			double write = BenchmarkNs(5, 20, [&]() { capture.WriteFrame(input.frame, frameId, frameId); frameId++; });
+			VsImage* tracked = capture.GrabFrame(timestamp);
+			if (!tracked)
+				return 1;
+
+			int previewWidth, previewHeight;
+			YuvConverter::OrientedSize(width, height, orientation, previewWidth, previewHeight);
+			VsImage* luma = vsCreateImage(vsSize(previewWidth, previewHeight), VS_DEPTH_8U, 1);
+			VsImage* chroma = vsCreateImage(vsSize(previewWidth / 2, previewHeight / 2), VS_DEPTH_8U, 2);
+			VsImage* rgb = vsCreateImage(vsSize(previewWidth, previewHeight), VS_DEPTH_8U, 3);
+
+			double copy = luminance ? BenchmarkNs(5, 20, [&]() { capture.CopyGrabbedFrameNV12(luma, chroma); }) : 0;
+			double convert = BenchmarkNs(5, 20, [&]() { capture.ConvertGrabbedFrameToRGB(rgb); });
+
+			char size[16];
+			snprintf(size, sizeof(size), "%dx%d", tracked->width, tracked->height);
+			char copyText[16] = "-";
+			if (luminance)
+				snprintf(copyText, sizeof(copyText), "%9.3f ms", copy / 1e6);
+			printf("%-10s 1/%-4d %-10s %9.3f ms %12s %9.3f ms\n", luminance ? "luminance" : "rgb", scale, size,
+				   write / 1e6, copyText, convert / 1e6);
+
+			vsReleaseImage(&luma);
+			vsReleaseImage(&chroma);
+			vsReleaseImage(&rgb);
+		}
+
+	return 0;
+}
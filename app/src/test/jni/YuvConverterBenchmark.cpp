@@ -0,0 +1,44 @@
+#include "YuvConverter.h"
+#include "YuvReference.h"
+#include "HostTest.h"
+
+using namespace VisageSDK;
+
+// Conversion of a camera frame to RGB: the per-pixel double precision conversion YuvConverter replaced, and
+// YuvConverter without and with the rotation of a portrait preview, for planar and interleaved chroma.
+int main()
+{
+	printf("YUV converter backend: %s\n", YuvConverter::BackendName());
+	printf("%-10s %-7s %12s %12s %12s\n", "frame", "chroma", "reference", "convert", "rotated");
+
+	const int sizes[][2] = {{640, 480}, {1280, 720}, {1920, 1080}};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		for (int pixelStride = 1; pixelStride <= 2; pixelStride++)
+		{
+			const int width = sizes[i][0];
+			const int height = sizes[i][1];
+			TestYuvFrame input(width, height, pixelStride);
+			std::vector<unsigned char> y, u, v;
+			input.Pack(y, u, v);
+
+			VsImage* rgb = vsCreateImage(vsSize(width, height), VS_DEPTH_8U, 3);
+			VsImage* rotated = vsCreateImage(vsSize(height, width), VS_DEPTH_8U, 3);
+			YuvConverter converter;
+
+			double reference = BenchmarkNs(5, 3, [&]() {
+				ReferenceYUV420toRGB(&y[0], &u[0], &v[0], (unsigned char*) rgb->imageData, width, height, pixelStride);
+			});
+			double convert = BenchmarkNs(5, 20, [&]() { converter.Convert(input.frame, rgb); });
+			double convertRotated = BenchmarkNs(5, 20, [&]() { converter.Convert(input.frame, rotated, 270, 1); });
+
+			char frame[16];
+			snprintf(frame, sizeof(frame), "%dx%d", width, height);
+			printf("%-10s %-7s %9.3f ms %9.3f ms %9.3f ms\n", frame, pixelStride == 1 ? "I420" : "NV12",
+				   reference / 1e6, convert / 1e6, convertRotated / 1e6);
+
+			vsReleaseImage(&rgb);
+			vsReleaseImage(&rotated);
+		}
+
+	return 0;
+}
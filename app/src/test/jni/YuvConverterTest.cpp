@@ -0,0 +1,235 @@
+#include "YuvConverter.h"
+#include "YuvReference.h"
+#include "HostTest.h"
+#include <cstdlib>
+#include <cstring>
+
+using namespace VisageSDK;
+
+// The previous conversion truncated each chroma term towards zero in double precision, the fixed-point one rounds
+// with coefficients of 6 fractional bits. On random frames they differ by 5 levels at most, at extreme chroma values,
+// and by about 1.4 levels on average.
+static const int MAX_REFERENCE_DIFFERENCE = 5;
+static const double MAX_MEAN_REFERENCE_DIFFERENCE = 1.5;
+
+static VsImage* CreateImage(int width, int height, int channels)
+{
+	return vsCreateImage(vsSize(width, height), VS_DEPTH_8U, channels);
+}
+
+static bool SameImage(const VsImage* a, const VsImage* b)
+{
+	if (a->width != b->width || a->height != b->height || a->nChannels != b->nChannels)
+		return false;
+	for (int row = 0; row < a->height; row++)
+		if (memcmp(a->imageData + row * a->widthStep, b->imageData + row * b->widthStep, a->width * a->nChannels))
+			return false;
+	return true;
+}
+
+/** Compares Convert with the conversion it replaced, for tightly packed planes as the wrapper used to receive them.
+ */
+static void TestAgainstReference(int width, int height, int pixelStride)
+{
+	TestYuvFrame input(width, height, pixelStride);
+	std::vector<unsigned char> y, u, v;
+	input.Pack(y, u, v);
+
+	std::vector<unsigned char> expected(3 * width * height);
+	ReferenceYUV420toRGB(&y[0], &u[0], &v[0], &expected[0], width, height, pixelStride);
+
+	VsImage* rgb = CreateImage(width, height, 3);
+	YuvConverter converter(YUV_MATRIX_BT601_FULL);
+	converter.Convert(input.frame, rgb);
+
+	int maxDifference = 0;
+	long long sumDifference = 0;
+	for (int row = 0; row < height; row++)
+		for (int i = 0; i < 3 * width; i++)
+		{
+			int difference = abs((int) (unsigned char) rgb->imageData[row * rgb->widthStep + i] - expected[row * 3 * width + i]);
+			if (difference > maxDifference)
+				maxDifference = difference;
+			sumDifference += difference;
+		}
+	double meanDifference = (double) sumDifference / (3.0 * width * height);
+
+	printf("%dx%d pixel stride %d: difference to the reference %d at most, %.3f on average\n", width, height, pixelStride,
+		   maxDifference, meanDifference);
+	HOST_CHECK(maxDifference <= MAX_REFERENCE_DIFFERENCE);
+	// the average of a handful of pixels says nothing
+	if (width * height >= 4096)
+		HOST_CHECK(meanDifference <= MAX_MEAN_REFERENCE_DIFFERENCE);
+	vsReleaseImage(&rgb);
+}
+
+/** Padded rows, as ImageReader delivers them for many sizes, must not change the result.
+ */
+static void TestRowStrides(int width, int height, int pixelStride)
+{
+	TestYuvFrame padded(width, height, pixelStride, 64 + 4, 7);
+	std::vector<unsigned char> y, u, v;
+	padded.Pack(y, u, v);
+
+	// same pixels as the padded frame, without the padding
+	YuvFrame packed = padded.frame;
+	packed.y = &y[0];
+	packed.u = &u[0];
+	packed.v = &v[0];
+	packed.yRowStride = width;
+	packed.uvRowStride = (width / 2) * pixelStride;
+
+	VsImage* fromPacked = CreateImage(width, height, 3);
+	VsImage* fromPadded = CreateImage(width, height, 3);
+	YuvConverter converter;
+	converter.Convert(packed, fromPacked);
+	converter.Convert(padded.frame, fromPadded);
+
+	HOST_CHECK(SameImage(fromPacked, fromPadded));
+	vsReleaseImage(&fromPacked);
+	vsReleaseImage(&fromPadded);
+}
+
+/** The conversion with fused rotation must match rotating the planes first and converting them afterwards.
+ */
+static void TestOrientations(int width, int height, int pixelStride)
+{
+	TestYuvFrame input(width, height, pixelStride, 32, 3);
+	YuvConverter converter(YUV_MATRIX_BT709_LIMITED);
+
+	for (int orientation = 0; orientation < 360; orientation += 90)
+		for (int flip = 0; flip < 2; flip++)
+		{
+			int outWidth, outHeight;
+			YuvConverter::OrientedSize(width, height, orientation, outWidth, outHeight);
+			VsImage* fused = CreateImage(outWidth, outHeight, 3);
+			VsImage* luma = CreateImage(outWidth, outHeight, 1);
+			VsImage* chroma = CreateImage(outWidth / 2, outHeight / 2, 2);
+			VsImage* separate = CreateImage(outWidth, outHeight, 3);
+
+			converter.Convert(input.frame, fused, orientation, flip);
+			converter.ExtractNV12(input.frame, luma, chroma, orientation, flip);
+			converter.ConvertNV12(luma, chroma, separate);
+
+			if (!SameImage(fused, separate))
+				fprintf(stderr, "orientation %d flip %d differs\n", orientation, flip);
+			HOST_CHECK(SameImage(fused, separate));
+
+			vsReleaseImage(&fused);
+			vsReleaseImage(&luma);
+			vsReleaseImage(&chroma);
+			vsReleaseImage(&separate);
+		}
+}
+
+/** Checks every pixel of oriented planes against the rounded mean of the scale x scale source pixels their orientation
+ * maps there: a 90 or 270 degree rotation is a transpose, mirrored columns and rows as the camera orientation and
+ * front camera flip require. Returns the number of wrong pixels.
+ */
+static int CheckOrientedPlanes(const YuvFrame& frame, const VsImage* luma, const VsImage* chroma, int orientation, int flip,
+							   int scale)
+{
+	const bool transpose = orientation == 90 || orientation == 270;
+	const bool mirrorX = (orientation == 90 || orientation == 180) ? !flip : flip != 0;
+	const bool mirrorY = orientation == 180 || orientation == 270;
+	const int area = scale * scale;
+	int wrong = 0;
+
+	for (int y = 0; y < luma->height; y++)
+		for (int x = 0; x < luma->width; x++)
+		{
+			const int dx = mirrorX ? luma->width - 1 - x : x;
+			const int dy = mirrorY ? luma->height - 1 - y : y;
+			const int sx = transpose ? dy : dx;
+			const int sy = transpose ? dx : dy;
+
+			int sum = 0;
+			for (int r = 0; r < scale; r++)
+				for (int c = 0; c < scale; c++)
+					sum += frame.y[(sy * scale + r) * frame.yRowStride + sx * scale + c];
+			wrong += (unsigned char) luma->imageData[y * luma->widthStep + x] != (sum + area / 2) / area;
+
+			if ((x | y) & 1)
+				continue;
+			int sumU = 0, sumV = 0;
+			for (int r = 0; r < scale; r++)
+				for (int c = 0; c < scale; c++)
+				{
+					const int k = ((sy / 2) * scale + r) * frame.uvRowStride + ((sx / 2) * scale + c) * frame.uvPixelStride;
+					sumU += frame.u[k];
+					sumV += frame.v[k];
+				}
+			const unsigned char* uv = (const unsigned char*) chroma->imageData + (y / 2) * chroma->widthStep + x;
+			wrong += uv[0] != (sumU + area / 2) / area || uv[1] != (sumV + area / 2) / area;
+		}
+
+	return wrong;
+}
+
+/** Checks the planes ExtractNV12 writes in every orientation, at full resolution and downscaled, and the full
+ * resolution planes written in the same pass as the downscaled ones.
+ */
+static void TestPlaneOrientations(int width, int height, int pixelStride)
+{
+	TestYuvFrame input(width, height, pixelStride, 32, 5);
+	YuvConverter converter(YUV_MATRIX_BT709_LIMITED);
+
+	for (int orientation = 0; orientation < 360; orientation += 90)
+		for (int flip = 0; flip < 2; flip++)
+		{
+			int outWidth, outHeight;
+			YuvConverter::OrientedSize(width, height, orientation, outWidth, outHeight);
+			VsImage* luma = CreateImage(outWidth, outHeight, 1);
+			VsImage* chroma = CreateImage(outWidth / 2, outHeight / 2, 2);
+
+			for (int scale = 1; scale <= 4; scale *= 2)
+			{
+				if (!YuvConverter::IsScaleSupported(width, height, scale))
+					continue;
+				int wrong = 0;
+				if (scale == 1)
+				{
+					converter.ExtractNV12(input.frame, luma, chroma, orientation, flip);
+					wrong = CheckOrientedPlanes(input.frame, luma, chroma, orientation, flip, 1);
+				}
+				else
+				{
+					VsImage* scaledLuma = CreateImage(outWidth / scale, outHeight / scale, 1);
+					VsImage* scaledChroma = CreateImage(outWidth / scale / 2, outHeight / scale / 2, 2);
+					memset(luma->imageData, 0, luma->imageSize);
+					memset(chroma->imageData, 0, chroma->imageSize);
+					converter.ExtractNV12(input.frame, scaledLuma, scaledChroma, orientation, flip, scale, luma, chroma);
+					wrong = CheckOrientedPlanes(input.frame, scaledLuma, scaledChroma, orientation, flip, scale) +
+							CheckOrientedPlanes(input.frame, luma, chroma, orientation, flip, 1);
+					vsReleaseImage(&scaledLuma);
+					vsReleaseImage(&scaledChroma);
+				}
+
+				if (wrong)
+					fprintf(stderr, "%dx%d orientation %d flip %d scale %d: %d pixels wrong\n", width, height, orientation, flip,
+							scale, wrong);
+				HOST_CHECK(!wrong);
+			}
+
+			vsReleaseImage(&luma);
+			vsReleaseImage(&chroma);
+		}
+}
+
+int main()
+{
+	printf("YUV converter backend: %s\n", YuvConverter::BackendName());
+
+	// widths that are not a multiple of the vector width exercise the scalar row tails
+	const int sizes[][2] = {{1920, 1080}, {640, 480}, {650, 362}, {18, 2}};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		for (int pixelStride = 1; pixelStride <= 2; pixelStride++)
+		{
+			TestAgainstReference(sizes[i][0], sizes[i][1], pixelStride);
+			TestRowStrides(sizes[i][0], sizes[i][1], pixelStride);
+			TestOrientations(sizes[i][0], sizes[i][1], pixelStride);
+			TestPlaneOrientations(sizes[i][0], sizes[i][1], pixelStride);
+		}
+
+	return HostTestResult();
+}
@@ -0,0 +1,92 @@
+#ifndef __YuvReference_h__
+#define __YuvReference_h__
+
+#include "YuvConverter.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+/** The YUV_420_888 to RGB conversion AndroidStreamCapture did before YuvConverter, per pixel in double precision
+ * with BT.601 full range coefficients. Planes must be tightly packed, the way the wrapper received them then.
+ */
+static inline void ReferenceYuvToRgb(int y, int u, int v, unsigned char* rgb)
+{
+	int r = y + (int) (1.370705 * (v - 128));
+	int g = y - (int) (0.698001 * (v - 128)) - (int) (0.337633 * (u - 128));
+	int b = y + (int) (1.732446 * (u - 128));
+
+	rgb[0] = (unsigned char) (r > 255 ? 255 : r < 0 ? 0 : r);
+	rgb[1] = (unsigned char) (g > 255 ? 255 : g < 0 ? 0 : g);
+	rgb[2] = (unsigned char) (b > 255 ? 255 : b < 0 ? 0 : b);
+}
+
+static inline void ReferenceYUV420toRGB(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+										unsigned char* rgb, int width, int height, int pixelStride)
+{
+	const int widthStep = 3 * width;
+	for (int row = 0; row < height; row += 2)
+	{
+		for (int col = 0, k = (row / 2) * (width / 2) * pixelStride; col < width; col += 2, k += pixelStride)
+		{
+			const int i = row * width + col;
+			unsigned char* out = rgb + row * widthStep + 3 * col;
+			ReferenceYuvToRgb(y[i], u[k], v[k], out);
+			ReferenceYuvToRgb(y[i + 1], u[k], v[k], out + 3);
+			ReferenceYuvToRgb(y[i + width], u[k], v[k], out + widthStep);
+			ReferenceYuvToRgb(y[i + width + 1], u[k], v[k], out + widthStep + 3);
+		}
+	}
+}
+
+/** Planes of a random YUV_420_888 frame, laid out like the camera delivers them: I420 with pixelStride 1, interleaved
+ * chroma (NV12) with pixelStride 2. Rows are padded by the given number of bytes.
+ */
+struct TestYuvFrame {
+	std::vector<unsigned char> y;
+	std::vector<unsigned char> uv;
+	VisageSDK::YuvFrame frame;
+
+	TestYuvFrame(int width, int height, int pixelStride, int padding = 0, unsigned int seed = 1)
+	{
+		const int yRowStride = width + padding;
+		const int uvRowStride = (width / 2) * pixelStride + padding;
+		y.resize(yRowStride * height);
+		// planar U followed by planar V, or one interleaved plane
+		uv.resize(uvRowStride * (height / 2) * (pixelStride == 1 ? 2 : 1));
+
+		srand(seed);
+		for (size_t i = 0; i < y.size(); i++)
+			y[i] = (unsigned char) rand();
+		for (size_t i = 0; i < uv.size(); i++)
+			uv[i] = (unsigned char) rand();
+
+		frame.y = &y[0];
+		frame.u = &uv[0];
+		frame.v = (pixelStride == 1) ? &uv[uvRowStride * (height / 2)] : &uv[1];
+		frame.width = width;
+		frame.height = height;
+		frame.yRowStride = yRowStride;
+		frame.uvRowStride = uvRowStride;
+		frame.uvPixelStride = pixelStride;
+	}
+
+	/** Copies the frame with its rows tightly packed, as @ref ReferenceYUV420toRGB needs them.
+	*/
+	void Pack(std::vector<unsigned char>& py, std::vector<unsigned char>& pu, std::vector<unsigned char>& pv) const
+	{
+		const int chromaRow = (frame.width / 2) * frame.uvPixelStride;
+		py.resize(frame.width * frame.height);
+		pu.assign(chromaRow * (frame.height / 2) + 1, 0);
+		pv.assign(chromaRow * (frame.height / 2) + 1, 0);
+		for (int row = 0; row < frame.height; row++)
+			std::copy(frame.y + row * frame.yRowStride, frame.y + row * frame.yRowStride + frame.width, &py[row * frame.width]);
+		for (int row = 0; row < frame.height / 2; row++)
+			for (int col = 0; col < chromaRow; col += frame.uvPixelStride)
+			{
+				pu[row * chromaRow + col] = frame.u[row * frame.uvRowStride + col];
+				pv[row * chromaRow + col] = frame.v[row * frame.uvRowStride + col];
+			}
+	}
+};
+
+#endif // __YuvReference_h__